@@ -0,0 +1,141 @@
+/**
+ * @file async_method.c
+ * @brief Method calls answered by a worker thread instead of the server thread.
+ *
+ * Long methods, the kinetics estimation of opcuaSettings.c among them,
+ * would stall the server loop for every client while they run. open62541
+ * built with UA_MULTITHREADING >= 100 can queue the calls of methods
+ * marked asynchronous (UA_Server_setMethodNodeAsync()) instead and answer
+ * them once a result is set. async_method_start() registers the
+ * notification of a queued call and starts a thread that takes the
+ * calls off the queue (UA_Server_getAsyncOperationNonBlocking()), runs
+ * them through UA_Server_call() and hands the result back; the server
+ * thread sends the response in its next iteration. Calls run one after
+ * another, in the order they arrived.
+ *
+ * Without multithreading support in the library async_method_start()
+ * returns UA_STATUSCODE_BADNOTSUPPORTED and async_method_set() leaves the
+ * methods synchronous: they still work, on the server thread.
+ */
+
+#include <string.h>
+#include "async_method.h"
+#include "log.h"
+
+#if UA_MULTITHREADING >= 100
+
+/* Worker of the server, for the notification callback which has no context */
+static AsyncMethodWorker* asyncWorker;
+
+static void async_method_notify(UA_Server* server) {
+    AsyncMethodWorker* w = asyncWorker;
+    if (!w)
+        return;
+    platform_mutex_lock(&w->lock);
+    w->pending = true;
+    platform_cond_broadcast(&w->wake);
+    platform_mutex_unlock(&w->lock);
+}
+
+static void async_method_main(void* arg) {
+    AsyncMethodWorker* w = (AsyncMethodWorker*)arg;
+    for (;;) {
+        platform_mutex_lock(&w->lock);
+        while (w->running && !w->pending)
+            platform_cond_wait(&w->wake, &w->lock);
+        const UA_Boolean running = w->running;
+        w->pending = false;
+        platform_mutex_unlock(&w->lock);
+        if (!running)
+            break;
+
+        UA_AsyncOperationType type;
+        const UA_AsyncOperationRequest* request;
+        void* context;
+        UA_DateTime timeout;
+        while (UA_Server_getAsyncOperationNonBlocking(w->server, &type, &request, &context, &timeout)) {
+            if (type != UA_ASYNCOPERATIONTYPE_CALL)
+                continue;
+            UA_CallMethodResult result = UA_Server_call(w->server, &request->callMethodRequest);
+            UA_Server_setAsyncOperationResult(w->server, (const UA_AsyncOperationResponse*)&result,
+                context);
+            UA_CallMethodResult_clear(&result);
+            w->calls++;
+        }
+    }
+}
+
+/**
+ * @brief Starts the worker answering the asynchronous methods of server.
+ *
+ * Call before the server runs; one worker per server.
+ */
+UA_StatusCode async_method_start(AsyncMethodWorker* w, UA_Server* server) {
+    memset(w, 0, sizeof(*w));
+    w->server = server;
+    platform_mutex_init(&w->lock);
+    platform_cond_init(&w->wake);
+    w->running = true;
+    asyncWorker = w;
+    UA_Server_getConfig(server)->asyncOperationNotifyCallback = async_method_notify;
+
+    const UA_StatusCode rc = platform_thread_start(&w->thread, async_method_main, w);
+    if (rc != UA_STATUSCODE_GOOD) {
+        UA_Server_getConfig(server)->asyncOperationNotifyCallback = NULL;
+        asyncWorker = NULL;
+        platform_cond_destroy(&w->wake);
+        platform_mutex_destroy(&w->lock);
+        return rc;
+    }
+    w->started = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Stops the worker after the call it is running.
+ *
+ * Calls still queued are answered by the server with a timeout.
+ */
+void async_method_stop(AsyncMethodWorker* w) {
+    if (!w->started)
+        return;
+    platform_mutex_lock(&w->lock);
+    w->running = false;
+    platform_cond_broadcast(&w->wake);
+    platform_mutex_unlock(&w->lock);
+    platform_thread_join(&w->thread);
+
+    UA_Server_getConfig(w->server)->asyncOperationNotifyCallback = NULL;
+    asyncWorker = NULL;
+    w->started = false;
+    platform_cond_destroy(&w->wake);
+    platform_mutex_destroy(&w->lock);
+    LOG_MSG(LOG_LEVEL_INFO, "Asynchronous methods: %u calls answered", w->calls);
+}
+
+/**
+ * @brief Marks the method methodId to be answered by the worker.
+ */
+UA_StatusCode async_method_set(UA_Server* server, const UA_NodeId methodId) {
+    return UA_Server_setMethodNodeAsync(server, methodId, true);
+}
+
+#else
+
+UA_StatusCode async_method_start(AsyncMethodWorker* w, UA_Server* server) {
+    memset(w, 0, sizeof(*w));
+    w->server = server;
+    return UA_STATUSCODE_BADNOTSUPPORTED;
+}
+
+void async_method_stop(AsyncMethodWorker* w) {
+    (void)w;
+}
+
+UA_StatusCode async_method_set(UA_Server* server, const UA_NodeId methodId) {
+    (void)server;
+    (void)methodId;
+    return UA_STATUSCODE_BADNOTSUPPORTED;
+}
+
+#endif
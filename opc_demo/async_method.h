@@ -0,0 +1,22 @@
+#pragma once
+#include <open62541/server.h>
+#include "platform.h"
+
+/*
+ * Worker thread running the methods marked asynchronous
+ * (async_method_set()) off the server thread.
+ */
+typedef struct {
+    UA_Server* server;
+    PlatformThread thread;
+    PlatformMutex lock;
+    PlatformCond wake;          /* signalled when a call is queued or on stop */
+    UA_Boolean pending;         /* calls queued since the last drain, guarded by lock */
+    UA_Boolean running;         /* guarded by lock */
+    UA_Boolean started;
+    UA_UInt64 calls;
+} AsyncMethodWorker;
+
+UA_StatusCode async_method_start(AsyncMethodWorker* w, UA_Server* server);
+void async_method_stop(AsyncMethodWorker* w);
+UA_StatusCode async_method_set(UA_Server* server, const UA_NodeId methodId);
@@ -0,0 +1,7 @@
+#pragma once
+#include <open62541/types.h>
+
+int bench_read(UA_UInt32 reads);
+int bench_startup(UA_UInt32 maxReactors);
+int bench_history(UA_UInt32 tags);
+int bench_suite(const char* jsonPath, UA_UInt16 port);
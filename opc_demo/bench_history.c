@@ -0,0 +1,104 @@
+/**
+ * @file bench_history.c
+ * @brief Benchmark of the historian: memory per tag, recording and queries.
+ *
+ * Runs `opc_demo --bench-history [tags]`. For every compression mode a
+ * historian of the given number of tags (3600 samples each, one hour at
+ * the default period) is fed two hours of one-second samples of a slowly
+ * drifting, slightly noisy signal, tag after tag as historian_record()
+ * does each tick. Reported are:
+ *   - the memory per tag and in total, which does not depend on the data;
+ *   - the recording cost per offered sample and the share archived;
+ *   - the latency of forward raw reads of the last minute, ten minutes
+ *     and hour of a random tag, copying the samples out as HistoryRead
+ *     does before encoding.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "bench.h"
+#include "historian.h"
+#include "platform.h"
+
+#define BENCH_HISTORY_DEPTH 3600
+#define BENCH_HISTORY_TICKS (2 * BENCH_HISTORY_DEPTH)
+#define BENCH_HISTORY_QUERIES 2000
+
+/* Deterministic noise in [-1, 1) */
+static double bench_history_noise(UA_UInt32* seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (double)(*seed >> 8) / (double)(1u << 23) - 1.0;
+}
+
+static double bench_history_signal(UA_UInt32 tag, UA_UInt32 tick, UA_UInt32* seed) {
+    const double phase = (double)tag * 0.37;
+    return 320.0 + 5.0 * sin(tick / 600.0 + phase) + 1e-5 * bench_history_noise(seed);
+}
+
+static int bench_history_mode(const char* name, HistoryCompression compression,
+    UA_Double deviation, UA_UInt32 tags) {
+
+    Historian h;
+    const UA_UInt32 reactors = (tags + FLEET_SENSOR_COUNT - 1) / FLEET_SENSOR_COUNT;
+    if (historian_init(&h, reactors, BENCH_HISTORY_DEPTH, compression, deviation) != UA_STATUSCODE_GOOD)
+        return 1;
+
+    UA_UInt32 seed = 12345u;
+    const UA_DateTime start = UA_DATETIME_UNIX_EPOCH + (UA_DateTime)1700000000 * UA_DATETIME_SEC;
+    UA_UInt64 t0 = platform_now_ns();
+    for (UA_UInt32 k = 0; k < BENCH_HISTORY_TICKS; k++) {
+        const UA_DateTime time = start + (UA_DateTime)k * UA_DATETIME_SEC;
+        for (UA_UInt32 tag = 0; tag < h.tagCount; tag++)
+            historian_add(&h, tag, time, bench_history_signal(tag, k, &seed));
+    }
+    UA_UInt64 t1 = platform_now_ns();
+
+    UA_UInt64 received = 0, archived = 0;
+    for (UA_UInt32 tag = 0; tag < h.tagCount; tag++) {
+        received += h.tags[tag].received;
+        archived += h.tags[tag].archived;
+    }
+    const size_t bytes = historian_tag_bytes(&h);
+    printf("%-14s %9zu %9.1f %10.1f %8.2f %%", name, bytes,
+        (double)bytes * h.tagCount / (1024.0 * 1024.0),
+        received ? (double)(t1 - t0) / received : 0.0,
+        received ? 100.0 * archived / received : 0.0);
+
+    static UA_DateTime times[BENCH_HISTORY_DEPTH + 1];
+    static UA_Double values[BENCH_HISTORY_DEPTH + 1];
+    const UA_DateTime end = start + (UA_DateTime)(BENCH_HISTORY_TICKS - 1) * UA_DATETIME_SEC;
+    const UA_UInt32 ranges[3] = { 60, 600, 3600 };
+    for (int r = 0; r < 3; r++) {
+        size_t samples = 0;
+        UA_DateTime next;
+        t0 = platform_now_ns();
+        for (UA_UInt32 q = 0; q < BENCH_HISTORY_QUERIES; q++) {
+            const UA_UInt32 tag = (UA_UInt32)((bench_history_noise(&seed) + 1.0) * 0.5 * h.tagCount) % h.tagCount;
+            samples += historian_read(&h, tag, end - (UA_DateTime)ranges[r] * UA_DATETIME_SEC, end,
+                false, 0, times, values, &next);
+        }
+        t1 = platform_now_ns();
+        printf(" %9.2f/%-5.0f", (double)(t1 - t0) / BENCH_HISTORY_QUERIES / 1000.0,
+            (double)samples / BENCH_HISTORY_QUERIES);
+    }
+    printf("\n");
+
+    historian_clear(&h);
+    return 0;
+}
+
+int bench_history(UA_UInt32 tags) {
+    if (tags == 0)
+        return 1;
+
+    printf("Historian, %u tags x %u samples, %u ticks offered, %u queries per range\n",
+        tags, BENCH_HISTORY_DEPTH, BENCH_HISTORY_TICKS, BENCH_HISTORY_QUERIES);
+    printf("%-14s %9s %9s %10s %10s %15s %15s %15s\n", "compression", "B/tag", "MiB",
+        "ns/sample", "archived", "1 min us/n", "10 min us/n", "1 h us/n");
+
+    int rc = 0;
+    rc |= bench_history_mode("none", HISTORY_COMPRESSION_NONE, 0.0, tags);
+    rc |= bench_history_mode("deadband", HISTORY_COMPRESSION_DEADBAND, 1e-2, tags);
+    rc |= bench_history_mode("swinging-door", HISTORY_COMPRESSION_SWINGING_DOOR, 1e-2, tags);
+    return rc;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file bench_main.c
+ * @brief Entry point of the opc_demo_bench executable.
+ *
+ * `opc_demo_bench [--out file.json] [--port n]` runs the benchmark suite
+ * of bench_suite.c, the same as `opc_demo --bench-suite`, and writes its
+ * JSON results to the given file or to stdout. The exit code is 0 when
+ * every case ran.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "config.h"
+#include "log.h"
+
+int main(int argc, char** argv) {
+	const char* out = NULL;
+	UA_UInt16 port = config_bench_port;
+	for (int a = 1; a + 1 < argc; a += 2) {
+		if (strcmp(argv[a], "--out") == 0)
+			out = argv[a + 1];
+		else if (strcmp(argv[a], "--port") == 0)
+			port = (UA_UInt16)strtoul(argv[a + 1], NULL, 10);
+	}
+
+	log_init(config_log_capacity, config_log_level);
+	int rc = bench_suite(out, port);
+	log_shutdown();
+	return rc;
+}
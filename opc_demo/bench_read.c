@@ -0,0 +1,143 @@
+/**
+ * @file bench_read.c
+ * @brief Microbenchmark of the DataSource read path.
+ *
+ * Runs `opc_demo --bench-read [reads]`. For each bound variable kind the
+ * read is performed the way the server does it: binding_read() fills a
+ * UA_DataValue that is cleared right after, as after encoding a Read
+ * response.
+ *
+ * Each kind is measured twice:
+ *   - "copy":   the node has a monitored item, binding_read() falls back
+ *               to UA_Variant_setScalarCopy() – the path every read took
+ *               before NodeBinding;
+ *   - "borrow": no monitored item, the value is lent from the binding.
+ *
+ * The allocation column counts the calls into the open62541 allocator
+ * per read, in a pass of its own after the timed one. It needs a library
+ * built with UA_ENABLE_MALLOC_SINGLETON, whose allocator hooks
+ * (UA_mallocSingleton and friends) are wrapped for the pass; without
+ * them the column shows n/a.
+ */
+
+#include <stdio.h>
+#include "bench.h"
+#include "binding.h"
+#include "fleet.h"
+#include "platform.h"
+
+typedef struct {
+    double nsPerRead;
+    double allocsPerRead;       /* negative if allocations cannot be counted */
+} BenchReadResult;
+
+#ifdef UA_ENABLE_MALLOC_SINGLETON
+/* Allocator of the library while bench_read_count() wraps it */
+static UA_UInt64 g_allocs;
+static void* (*g_malloc)(size_t size);
+static void* (*g_calloc)(size_t nelem, size_t elsize);
+static void* (*g_realloc)(void* ptr, size_t size);
+
+static void* bench_read_malloc(size_t size) {
+    g_allocs++;
+    return g_malloc(size);
+}
+
+static void* bench_read_calloc(size_t nelem, size_t elsize) {
+    g_allocs++;
+    return g_calloc(nelem, elsize);
+}
+
+static void* bench_read_realloc(void* ptr, size_t size) {
+    g_allocs++;
+    return g_realloc(ptr, size);
+}
+#endif
+
+static void bench_read_loop(NodeBinding* b, UA_UInt32 reads) {
+    UA_DataValue dv;
+    for (UA_UInt32 i = 0; i < reads; i++) {
+        binding_read(b, true, NULL, &dv);
+        UA_DataValue_clear(&dv);
+    }
+}
+
+/**
+ * @brief Calls into the open62541 allocator during `reads` reads; -1 if not countable.
+ */
+static double bench_read_count(NodeBinding* b, UA_UInt32 reads) {
+#ifdef UA_ENABLE_MALLOC_SINGLETON
+    g_malloc = UA_mallocSingleton;
+    g_calloc = UA_callocSingleton;
+    g_realloc = UA_reallocSingleton;
+    UA_mallocSingleton = bench_read_malloc;
+    UA_callocSingleton = bench_read_calloc;
+    UA_reallocSingleton = bench_read_realloc;
+    g_allocs = 0;
+    bench_read_loop(b, reads);
+    UA_mallocSingleton = g_malloc;
+    UA_callocSingleton = g_calloc;
+    UA_reallocSingleton = g_realloc;
+    return (double)g_allocs;
+#else
+    (void)b;
+    (void)reads;
+    return -1.0;
+#endif
+}
+
+static BenchReadResult bench_read_one(NodeBinding* b, UA_UInt32 monitored, UA_UInt32 reads) {
+    BenchReadResult r;
+
+    b->monitored = monitored;
+    const UA_UInt64 t0 = platform_now_ns();
+    bench_read_loop(b, reads);
+    const UA_UInt64 t1 = platform_now_ns();
+    const double allocs = bench_read_count(b, reads);
+    b->monitored = 0;
+
+    r.nsPerRead = reads ? (double)(t1 - t0) / reads : 0.0;
+    r.allocsPerRead = allocs < 0.0 ? -1.0 : reads ? allocs / reads : 0.0;
+    return r;
+}
+
+static void bench_read_print(const char* kind, const char* path, const BenchReadResult* r) {
+    if (r->allocsPerRead < 0.0)
+        printf("%-8s %-7s %10.1f %12s\n", kind, path, r->nsPerRead, "n/a");
+    else
+        printf("%-8s %-7s %10.1f %12.2f\n", kind, path, r->nsPerRead, r->allocsPerRead);
+}
+
+int bench_read(UA_UInt32 reads) {
+    ReactorFleet f;
+    if (fleet_init(&f, 1) != UA_STATUSCODE_GOOD || fleet_add_reactor(&f, NULL) != UA_STATUSCODE_GOOD)
+        return 1;
+    f.volume[0] = 100.0;
+    f.substanceId[0] = 7;
+
+    struct {
+        const char* name;
+        NodeBinding* binding;
+    } kinds[3];
+    kinds[0].name = "Double";
+    kinds[0].binding = binding_new(BINDING_DOUBLE, &f.volume[0]);
+    kinds[1].name = "UInt32";
+    kinds[1].binding = binding_new(BINDING_UINT32, &f.substanceId[0]);
+    kinds[2].name = "Sensor";
+    kinds[2].binding = binding_new(BINDING_SENSOR, &f.sensorSlot[FLEET_SENSOR_CB][0]);
+
+    printf("DataSource read path, %u reads per case\n", reads);
+    printf("%-8s %-7s %10s %12s\n", "kind", "path", "ns/read", "allocs/read");
+    for (int k = 0; k < 3; k++) {
+        if (!kinds[k].binding)
+            return 1;
+        const BenchReadResult copy = bench_read_one(kinds[k].binding, 1, reads);
+        const BenchReadResult borrow = bench_read_one(kinds[k].binding, 0, reads);
+        bench_read_print(kinds[k].name, "copy", &copy);
+        bench_read_print(kinds[k].name, "borrow", &borrow);
+    }
+
+    binding_free_all();
+    fleet_clear(&f);
+    return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file bench_startup.c
+ * @brief Benchmark of building the address space of a large fleet.
+ *
+ * Runs `opc_demo --bench-startup [reactors]`. For fleets of 1000,
+ * 2000, 4000, ... reactors up to the given maximum, a fresh server gets
+ * the four ObjectTypes and folders, and then the nodes of every reactor
+ * of the built-in plant
+ * (9 objects, 39 bound variables) are created twice:
+ *   - "per-instance": opc_ua_create_*_instance() for every object, which
+ *                     translates a browse path for each child;
+ *   - "bulk":         opc_ua_create_fleet_instances(), which adds the
+ *                     children bound and with deterministic NodeIds.
+ *
+ * Only the node creation is timed. Logging is limited to warnings while
+ * measuring so the per-object INFO messages do not count.
+ */
+
+#include <stdio.h>
+#include "bench.h"
+#include "binding.h"
+#include "fleet.h"
+#include "log.h"
+#include "opcuaSettings.h"
+#include "platform.h"
+
+typedef struct {
+    UA_Server* server;
+    FleetNodeOptions nodes;
+    ReactorFleet fleet;
+    Plant plant;
+} BenchStartup;
+
+static UA_StatusCode bench_startup_setup(BenchStartup* b, UA_UInt32 reactors) {
+    plant_default(&b->plant, reactors);
+    if (!b->plant.reactors || fleet_init(&b->fleet, reactors) != UA_STATUSCODE_GOOD) {
+        plant_clear(&b->plant);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    for (UA_UInt32 i = 0; i < reactors; i++)
+        fleet_add_reactor(&b->fleet, NULL);
+
+    b->server = UA_Server_new();
+    if (!b->server) {
+        fleet_clear(&b->fleet);
+        plant_clear(&b->plant);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    addSensorType(b->server);
+    addReactorType(b->server);
+    addMathModelType(b->server);
+    addValveHandleControlType(b->server);
+    opc_ua_create_cell_folder(b->server, "Model", &b->nodes.model);
+    opc_ua_create_cell_folder(b->server, "Valves", &b->nodes.valves);
+    opc_ua_create_cell_folder(b->server, "Sensors", &b->nodes.sensors);
+    opc_ua_create_cell_folder(b->server, "Reactors", &b->nodes.reactors);
+    b->nodes.publishMode = SENSOR_PUBLISH_POLL;
+    b->nodes.deadbandType = DEADBAND_NONE;
+    b->nodes.deadband = 0.0;
+    b->nodes.historizing = false;
+    b->nodes.sweeps = NULL;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void bench_startup_teardown(BenchStartup* b) {
+    UA_Server_delete(b->server);
+    binding_free_all();
+    fleet_clear(&b->fleet);
+    plant_clear(&b->plant);
+}
+
+static UA_StatusCode bench_startup_per_instance(BenchStartup* b) {
+    ReactorFleet* f = &b->fleet;
+    UA_StatusCode rc;
+
+    for (UA_UInt32 i = 0; i < f->count; i++) {
+        const PlantReactor* r = &b->plant.reactors[i];
+        rc = opc_ua_create_reactor_instance(b->server, b->nodes.reactors, r->name, f, i); if (rc) return rc;
+        rc = opc_ua_create_math_model_instance(b->server, b->nodes.model, r->model, f, i); if (rc) return rc;
+        for (int s = 0; s < FLEET_SENSOR_COUNT; s++) {
+            rc = opc_ua_create_sensor_instance(b->server, b->nodes.sensors, r->sensor[s], UA_FALSE, f, i,
+                (FleetSensor)s, b->nodes.publishMode, b->nodes.deadbandType, b->nodes.deadband);
+            if (rc) return rc;
+        }
+        for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+            rc = opc_ua_create_valve_handle_control(b->server, b->nodes.valves, r->valve[v], f, i, (FleetValve)v);
+            if (rc) return rc;
+        }
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Builds the nodes of `reactors` reactors and returns the time in ns, 0 on failure.
+ */
+static UA_UInt64 bench_startup_run(UA_UInt32 reactors, UA_Boolean bulk) {
+    BenchStartup b;
+    if (bench_startup_setup(&b, reactors) != UA_STATUSCODE_GOOD)
+        return 0;
+
+    const UA_UInt64 t0 = platform_now_ns();
+    const UA_StatusCode rc = bulk ?
+        opc_ua_create_fleet_instances(b.server, &b.nodes, &b.fleet, b.plant.reactors, 0, b.fleet.count) :
+        bench_startup_per_instance(&b);
+    const UA_UInt64 t1 = platform_now_ns();
+
+    bench_startup_teardown(&b);
+    return rc == UA_STATUSCODE_GOOD ? t1 - t0 : 0;
+}
+
+int bench_startup(UA_UInt32 maxReactors) {
+    if (maxReactors == 0)
+        return 1;
+
+    const LogLevel level = log_get_level();
+    log_set_level(LOG_LEVEL_WARN);
+
+    printf("Address space build, 9 objects and 39 bound variables per reactor\n");
+    printf("%9s %16s %12s %16s %12s %8s\n", "reactors",
+        "per-instance ms", "us/reactor", "bulk ms", "us/reactor", "speedup");
+
+    int rc = 0;
+    UA_UInt32 n = maxReactors < 1000 ? maxReactors : 1000;
+    for (;;) {
+        const UA_UInt64 perInstance = bench_startup_run(n, false);
+        const UA_UInt64 bulk = bench_startup_run(n, true);
+        if (!perInstance || !bulk) {
+            printf("%9u  failed\n", n);
+            rc = 1;
+            break;
+        }
+        printf("%9u %16.1f %12.2f %16.1f %12.2f %7.1fx\n", n,
+            perInstance / 1e6, perInstance / 1e3 / n,
+            bulk / 1e6, bulk / 1e3 / n,
+            (double)perInstance / (double)bulk);
+
+        if (n == maxReactors)
+            break;
+        n = (n > maxReactors / 2) ? maxReactors : n * 2;
+    }
+
+    log_set_level(level);
+    return rc;
+}
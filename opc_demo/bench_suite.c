@@ -0,0 +1,635 @@
+/**
+ * @file bench_suite.c
+ * @brief Benchmark suite with machine-readable results.
+ *
+ * Runs `opc_demo --bench-suite [file.json]` or the `opc_demo_bench`
+ * executable of the CMake build. Every case runs a fixed number of
+ * rounds; the time per operation of each round is one sample, of which
+ * the mean, median and 99th percentile are reported:
+ *   - model:      compute_CB_values() on single reactors, compute_CB_batch()
+ *                 over a batch, valve_curve_value() and valve_curve_eval();
+ *   - datasource: the DataSource callbacks of the address space
+ *                 (opc_ua_binding_data_source()) called directly, as the
+ *                 server does for a Read or Write of one bound variable;
+ *   - roundtrip:  a client Read and Write of REACTOR_VOLUME against an
+ *                 in-process server over loopback, one request per sample;
+ *   - estimate:   estimate_kinetics() fitting BENCH_SUITE_FIT_SAMPLES
+ *                 noisy synthetic samples, on the calling thread alone and
+ *                 on a pool of config_estimate_threads, one fit per sample;
+ *   - sweep:      sweep_run() over a BENCH_SUITE_SWEEP_POINTS^3 grid of
+ *                 one reactor, on the calling thread alone and on a pool of
+ *                 config_estimate_threads, one sweep per sample;
+ *   - optimize:   optimize_run() looking for the highest CB of one reactor
+ *                 from config_optimize_starts starts, on the calling thread
+ *                 alone and on the same pool, one optimization per sample.
+ *
+ * The results are written as JSON to the given file, or to stdout when
+ * there is none. Logging is limited to warnings while measuring so the
+ * INFO message of every accepted write does not count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <open62541/client_config_default.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/server_config_default.h>
+#include "bench.h"
+#include "binding.h"
+#include "config.h"
+#include "estimate.h"
+#include "fleet.h"
+#include "log.h"
+#include "math_batch.h"
+#include "math_model.h"
+#include "opcuaSettings.h"
+#include "platform.h"
+#include "server_loop.h"
+#include "sweep.h"
+#include "optimize.h"
+#include "valve_curve.h"
+
+#define BENCH_SUITE_SCHEMA 1
+#define BENCH_SUITE_BATCH 1024          /* reactors or valves per batch */
+#define BENCH_SUITE_ROUNDS 200          /* samples of the in-process cases */
+#define BENCH_SUITE_ROUNDTRIPS 2000     /* samples of each round-trip case */
+#define BENCH_SUITE_CONNECT_MS 5000     /* how long the client waits for the server */
+#define BENCH_SUITE_FIT_SAMPLES 100000  /* operating points of each estimation */
+#define BENCH_SUITE_FITS 10             /* samples of each estimation case */
+#define BENCH_SUITE_SWEEP_POINTS 100    /* grid points per axis of each sweep */
+#define BENCH_SUITE_SWEEPS 20           /* samples of each sweep case */
+#define BENCH_SUITE_OPTIMIZATIONS 10    /* samples of each optimization case */
+
+/* Runs `reps` repetitions of a case and returns the operations done */
+typedef UA_UInt64 (*BenchSuiteFn)(void* ctx, UA_UInt32 reps);
+
+typedef struct {
+    FILE* out;
+    UA_UInt32 results;
+} BenchSuiteJson;
+
+/* Inputs of the model cases, BENCH_SUITE_BATCH reactors and valves */
+typedef struct {
+    UA_Double T[BENCH_SUITE_BATCH];
+    UA_Double F[BENCH_SUITE_BATCH];
+    UA_Double CA[BENCH_SUITE_BATCH];
+    UA_Double volume[BENCH_SUITE_BATCH];
+    UA_Double k01[BENCH_SUITE_BATCH];
+    UA_Double EA1[BENCH_SUITE_BATCH];
+    UA_Double k02[BENCH_SUITE_BATCH];
+    UA_Double EA2[BENCH_SUITE_BATCH];
+    UA_Double R[BENCH_SUITE_BATCH];
+    UA_Double out[BENCH_SUITE_BATCH];
+    UA_UInt32 curve[BENCH_SUITE_BATCH];
+    UA_Double u[BENCH_SUITE_BATCH];
+} BenchSuiteModel;
+
+/* One bound variable and the callbacks serving it */
+typedef struct {
+    UA_DataSource ds;
+    NodeBinding* binding;
+    UA_UInt32 writes;
+} BenchSuiteNode;
+
+typedef struct {
+    UA_Server* server;
+    UA_StatusCode rc;
+} BenchSuiteServer;
+
+/* Keeps the compiler from discarding the measured results */
+static volatile UA_Double g_benchSink;
+
+static int bench_suite_compare(const void* a, const void* b) {
+    const UA_Double x = *(const UA_Double*)a;
+    const UA_Double y = *(const UA_Double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static UA_Double bench_suite_percentile(const UA_Double* sorted, UA_UInt32 n, UA_Double p) {
+    UA_UInt32 rank = (UA_UInt32)(p / 100.0 * n + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static void bench_suite_result(BenchSuiteJson* j, const char* group, const char* name,
+    const char* unit, UA_Double scale, UA_UInt64 operations, UA_Double* samples, UA_UInt32 n) {
+
+    UA_Double sum = 0.0;
+    for (UA_UInt32 k = 0; k < n; k++)
+        sum += samples[k];
+    qsort(samples, n, sizeof(UA_Double), bench_suite_compare);
+    const UA_Double mean = n ? sum / n / scale : 0.0;
+    const UA_Double p50 = n ? bench_suite_percentile(samples, n, 50.0) / scale : 0.0;
+    const UA_Double p99 = n ? bench_suite_percentile(samples, n, 99.0) / scale : 0.0;
+
+    fprintf(j->out, "%s\n    { \"group\": \"%s\", \"name\": \"%s\", \"unit\": \"%s\", "
+        "\"samples\": %u, \"operations\": %llu, \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f }",
+        j->results ? "," : "", group, name, unit, n, (unsigned long long)operations, mean, p50, p99);
+    j->results++;
+
+    if (j->out != stdout)
+        printf("%-11s %-24s %10.3f %10.3f %10.3f %s\n", group, name, mean, p50, p99, unit);
+}
+
+/* Samples the time per operation of `rounds` rounds of `reps` repetitions */
+static void bench_suite_case(BenchSuiteJson* j, const char* group, const char* name,
+    BenchSuiteFn fn, void* ctx, UA_UInt32 reps, UA_UInt32 rounds) {
+
+    UA_Double* samples = (UA_Double*)malloc(rounds * sizeof(UA_Double));
+    if (!samples)
+        return;
+
+    fn(ctx, reps);      /* warm-up */
+    UA_UInt64 operations = 0;
+    for (UA_UInt32 k = 0; k < rounds; k++) {
+        const UA_UInt64 t0 = platform_now_ns();
+        const UA_UInt64 ops = fn(ctx, reps);
+        const UA_UInt64 t1 = platform_now_ns();
+        samples[k] = ops ? (UA_Double)(t1 - t0) / ops : 0.0;
+        operations += ops;
+    }
+    bench_suite_result(j, group, name, "ns/op", 1.0, operations, samples, rounds);
+    free(samples);
+}
+
+/* --- model ---------------------------------------------------------------- */
+
+static void bench_suite_model_init(BenchSuiteModel* m) {
+    UA_UInt32 curves[3];
+    curves[0] = valve_curve_builtin(FLEET_VALVE_CA, VALVE_CHAR_LINEAR);
+    curves[1] = valve_curve_builtin(FLEET_VALVE_Q, VALVE_CHAR_EQUAL_PERCENTAGE);
+    curves[2] = valve_curve_builtin(FLEET_VALVE_T, VALVE_CHAR_QUICK_OPENING);
+
+    for (UA_UInt32 i = 0; i < BENCH_SUITE_BATCH; i++) {
+        const UA_Double x = (UA_Double)i / BENCH_SUITE_BATCH;
+        m->T[i] = 20.0 + 80.0 * x;
+        m->F[i] = 50.0 + 450.0 * x;
+        m->CA[i] = 0.5 + 1.5 * x;
+        m->volume[i] = 100.0;
+        m->k01[i] = 1.2e5;
+        m->EA1[i] = 4.5e4;
+        m->k02[i] = 2.0e5;
+        m->EA2[i] = 5.5e4;
+        m->R[i] = 8.314;
+        m->curve[i] = curves[i % 3];
+        m->u[i] = 100.0 * x;
+    }
+}
+
+static UA_UInt64 bench_suite_cb_values(void* ctx, UA_UInt32 reps) {
+    const BenchSuiteModel* m = (const BenchSuiteModel*)ctx;
+    UA_Double sum = 0.0;
+    for (UA_UInt32 k = 0; k < reps; k++)
+        for (UA_UInt32 i = 0; i < BENCH_SUITE_BATCH; i++)
+            sum += compute_CB_values(m->T[i], m->F[i], m->CA[i], m->volume[i],
+                m->k01[i], m->EA1[i], m->k02[i], m->EA2[i], m->R[i]);
+    g_benchSink = sum;
+    return (UA_UInt64)reps * BENCH_SUITE_BATCH;
+}
+
+static UA_UInt64 bench_suite_cb_batch(void* ctx, UA_UInt32 reps) {
+    BenchSuiteModel* m = (BenchSuiteModel*)ctx;
+    CbBatchInput in;
+    in.T = m->T;
+    in.F = m->F;
+    in.CA = m->CA;
+    in.volume = m->volume;
+    in.k01 = m->k01;
+    in.EA1 = m->EA1;
+    in.k02 = m->k02;
+    in.EA2 = m->EA2;
+    in.R = m->R;
+    for (UA_UInt32 k = 0; k < reps; k++)
+        compute_CB_batch(&in, m->out, BENCH_SUITE_BATCH);
+    g_benchSink = m->out[BENCH_SUITE_BATCH - 1];
+    return (UA_UInt64)reps * BENCH_SUITE_BATCH;
+}
+
+static UA_UInt64 bench_suite_valve_value(void* ctx, UA_UInt32 reps) {
+    const BenchSuiteModel* m = (const BenchSuiteModel*)ctx;
+    UA_Double sum = 0.0;
+    for (UA_UInt32 k = 0; k < reps; k++)
+        for (UA_UInt32 i = 0; i < BENCH_SUITE_BATCH; i++)
+            sum += valve_curve_value(m->curve[i], m->u[i]);
+    g_benchSink = sum;
+    return (UA_UInt64)reps * BENCH_SUITE_BATCH;
+}
+
+static UA_UInt64 bench_suite_valve_eval(void* ctx, UA_UInt32 reps) {
+    BenchSuiteModel* m = (BenchSuiteModel*)ctx;
+    for (UA_UInt32 k = 0; k < reps; k++)
+        valve_curve_eval(m->curve, m->u, m->out, BENCH_SUITE_BATCH);
+    g_benchSink = m->out[BENCH_SUITE_BATCH - 1];
+    return (UA_UInt64)reps * BENCH_SUITE_BATCH;
+}
+
+/* --- datasource ----------------------------------------------------------- */
+
+static UA_UInt64 bench_suite_ds_read(void* ctx, UA_UInt32 reps) {
+    BenchSuiteNode* n = (BenchSuiteNode*)ctx;
+    UA_DataValue dv;
+    for (UA_UInt32 k = 0; k < reps; k++) {
+        n->ds.read(NULL, NULL, NULL, NULL, n->binding, true, NULL, &dv);
+        UA_DataValue_clear(&dv);
+    }
+    return reps;
+}
+
+static UA_UInt64 bench_suite_ds_write(void* ctx, UA_UInt32 reps) {
+    BenchSuiteNode* n = (BenchSuiteNode*)ctx;
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    dv.hasValue = true;
+    for (UA_UInt32 k = 0; k < reps; k++) {
+        UA_Double v = 100.0 + (UA_Double)((n->writes++) & 63);
+        UA_Variant_setScalar(&dv.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+        n->ds.write(NULL, NULL, NULL, NULL, n->binding, NULL, &dv);
+    }
+    return reps;
+}
+
+static int bench_suite_datasource(BenchSuiteJson* j) {
+    ReactorFleet f;
+    if (fleet_init(&f, 1) != UA_STATUSCODE_GOOD || fleet_add_reactor(&f, NULL) != UA_STATUSCODE_GOOD)
+        return 1;
+    f.volume[0] = 100.0;
+
+    BenchSuiteNode volume, cb;
+    volume.ds = opc_ua_binding_data_source(BINDING_DOUBLE);
+    volume.binding = binding_new(BINDING_DOUBLE, &f.volume[0]);
+    volume.writes = 0;
+    cb.ds = opc_ua_binding_data_source(BINDING_SENSOR);
+    cb.binding = binding_new(BINDING_SENSOR, &f.sensorSlot[FLEET_SENSOR_CB][0]);
+    cb.writes = 0;
+    if (!volume.binding || !cb.binding) {
+        binding_free_all();
+        fleet_clear(&f);
+        return 1;
+    }
+    binding_set_name(volume.binding, "Reactor", "REACTOR_VOLUME");
+    binding_set_limits(volume.binding, 1e-3, 1e6);
+    binding_set_name(cb.binding, "SensorCB", "PROCESS_VALUE");
+
+    bench_suite_case(j, "datasource", "read_double", bench_suite_ds_read, &volume, 10000, BENCH_SUITE_ROUNDS);
+    bench_suite_case(j, "datasource", "read_sensor", bench_suite_ds_read, &cb, 10000, BENCH_SUITE_ROUNDS);
+    bench_suite_case(j, "datasource", "write_double", bench_suite_ds_write, &volume, 10000, BENCH_SUITE_ROUNDS);
+
+    binding_free_all();
+    fleet_clear(&f);
+    return 0;
+}
+
+/* --- roundtrip ------------------------------------------------------------ */
+
+static void bench_suite_server_thread(void* arg) {
+    BenchSuiteServer* s = (BenchSuiteServer*)arg;
+    s->rc = server_loop_run(s->server);
+}
+
+static UA_Server* bench_suite_server_new(UA_UInt16 port, ReactorFleet* f, Plant* plant) {
+    UA_ServerConfig config;
+    memset(&config, 0, sizeof(config));
+    if (UA_ServerConfig_setMinimal(&config, port, NULL) != UA_STATUSCODE_GOOD)
+        return NULL;
+    UA_Server* server = UA_Server_newWithConfig(&config);
+    if (!server)
+        return NULL;
+    UA_Server_getConfig(server)->monitoredItemRegisterCallback = binding_monitored_item_cb;
+
+    FleetNodeOptions nodes;
+    addSensorType(server);
+    addReactorType(server);
+    addMathModelType(server);
+    addValveHandleControlType(server);
+    opc_ua_create_cell_folder(server, "Model", &nodes.model);
+    opc_ua_create_cell_folder(server, "Valves", &nodes.valves);
+    opc_ua_create_cell_folder(server, "Sensors", &nodes.sensors);
+    opc_ua_create_cell_folder(server, "Reactors", &nodes.reactors);
+    nodes.publishMode = SENSOR_PUBLISH_POLL;
+    nodes.deadbandType = DEADBAND_NONE;
+    nodes.deadband = 0.0;
+    nodes.historizing = false;
+    nodes.sweeps = NULL;
+    if (opc_ua_create_fleet_instances(server, &nodes, f, plant->reactors, 0, f->count) != UA_STATUSCODE_GOOD) {
+        UA_Server_delete(server);
+        return NULL;
+    }
+    return server;
+}
+
+static UA_Client* bench_suite_client_connect(UA_UInt16 port) {
+    char url[64];
+    snprintf(url, sizeof(url), "opc.tcp://localhost:%u", (unsigned)port);
+
+    UA_Client* client = UA_Client_new();
+    if (!client)
+        return NULL;
+    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    for (UA_UInt32 waited = 0; waited < BENCH_SUITE_CONNECT_MS; waited += 50) {
+        if (UA_Client_connect(client, url) == UA_STATUSCODE_GOOD)
+            return client;
+        platform_sleep_ms(50);
+    }
+    UA_Client_delete(client);
+    return NULL;
+}
+
+/* Latency of single Reads or Writes of one node, in microseconds */
+static int bench_suite_roundtrip_case(BenchSuiteJson* j, UA_Client* client, UA_NodeId node,
+    UA_Boolean write, const char* name) {
+
+    UA_Double* samples = (UA_Double*)malloc(BENCH_SUITE_ROUNDTRIPS * sizeof(UA_Double));
+    if (!samples)
+        return 1;
+
+    UA_StatusCode rc = UA_STATUSCODE_GOOD;
+    const UA_UInt32 warmup = BENCH_SUITE_ROUNDTRIPS / 10;
+    for (UA_UInt32 k = 0; k < warmup + BENCH_SUITE_ROUNDTRIPS && rc == UA_STATUSCODE_GOOD; k++) {
+        UA_Variant value;
+        UA_Double v = 100.0 + (UA_Double)(k & 63);
+        const UA_UInt64 t0 = platform_now_ns();
+        if (write) {
+            UA_Variant_setScalar(&value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+            rc = UA_Client_writeValueAttribute(client, node, &value);
+        } else {
+            UA_Variant_init(&value);
+            rc = UA_Client_readValueAttribute(client, node, &value);
+            UA_Variant_clear(&value);
+        }
+        const UA_UInt64 t1 = platform_now_ns();
+        if (k >= warmup)
+            samples[k - warmup] = (UA_Double)(t1 - t0);
+    }
+    if (rc == UA_STATUSCODE_GOOD)
+        bench_suite_result(j, "roundtrip", name, "us/op", 1000.0, BENCH_SUITE_ROUNDTRIPS,
+            samples, BENCH_SUITE_ROUNDTRIPS);
+    else
+        LOG_MSG(LOG_LEVEL_ERROR, "bench_suite: round trip failed: %s", UA_StatusCode_name(rc));
+    free(samples);
+    return rc == UA_STATUSCODE_GOOD ? 0 : 1;
+}
+
+static int bench_suite_roundtrip(BenchSuiteJson* j, UA_UInt16 port) {
+    ReactorFleet f;
+    Plant plant;
+    plant_default(&plant, 1);
+    if (!plant.reactors || fleet_init(&f, 1) != UA_STATUSCODE_GOOD) {
+        plant_clear(&plant);
+        return 1;
+    }
+    fleet_add_reactor(&f, NULL);
+    f.volume[0] = 100.0;
+
+    int rc = 1;
+    BenchSuiteServer s;
+    PlatformThread thread;
+    s.server = bench_suite_server_new(port, &f, &plant);
+    s.rc = UA_STATUSCODE_GOOD;
+    if (s.server && platform_thread_start(&thread, bench_suite_server_thread, &s) == UA_STATUSCODE_GOOD) {
+        UA_Client* client = bench_suite_client_connect(port);
+        if (client) {
+            const UA_UInt16 ns = opc_ua_fleet_namespace(s.server);
+            const UA_NodeId volume = opc_ua_fleet_node_id(ns, 0, FLEET_OBJECT_REACTOR, 1);
+            const UA_NodeId cb = opc_ua_fleet_node_id(ns, 0, (FleetObject)(FLEET_OBJECT_SENSOR + FLEET_SENSOR_CB), 1);
+            rc = bench_suite_roundtrip_case(j, client, volume, false, "read_double");
+            rc |= bench_suite_roundtrip_case(j, client, cb, false, "read_sensor");
+            rc |= bench_suite_roundtrip_case(j, client, volume, true, "write_double");
+            UA_Client_disconnect(client);
+            UA_Client_delete(client);
+        } else {
+            LOG_MSG(LOG_LEVEL_ERROR, "bench_suite: no server on port %u", (unsigned)port);
+        }
+        server_loop_stop();
+        platform_thread_join(&thread);
+    }
+    if (s.server)
+        UA_Server_delete(s.server);
+    else
+        LOG_MSG(LOG_LEVEL_ERROR, "bench_suite: cannot create the server on port %u", (unsigned)port);
+    binding_free_all();
+    fleet_clear(&f);
+    plant_clear(&plant);
+    return rc;
+}
+
+/* --- estimate ------------------------------------------------------------- */
+
+/* Times BENCH_SUITE_FITS fits of d from the same start, evaluated on engine (NULL = caller) */
+static int bench_suite_fit_case(BenchSuiteJson* j, ModelEngine* engine, const EstimateData* d,
+    const char* name) {
+    const ConfigMathModel guess = { 1.0e9, 7.0e4, 1.0e11, 9.0e4, 8.314 };
+    EstimateOptions opt;
+    estimate_default_options(&opt);
+    opt.maxIterations = config_estimate_max_iterations;
+
+    UA_Double samples[BENCH_SUITE_FITS];
+    EstimateResult res;
+    for (UA_UInt32 k = 0; k < BENCH_SUITE_FITS; k++) {
+        const UA_UInt64 t0 = platform_now_ns();
+        if (estimate_kinetics(engine, d, &guess, &opt, &res) != UA_STATUSCODE_GOOD)
+            return 1;
+        samples[k] = (UA_Double)(platform_now_ns() - t0);
+    }
+    g_benchSink = res.kinetics.k01;
+    bench_suite_result(j, "estimate", name, "ms/op", 1e6, BENCH_SUITE_FITS, samples, BENCH_SUITE_FITS);
+    return 0;
+}
+
+static int bench_suite_estimate(BenchSuiteJson* j) {
+    EstimateData d;
+    if (estimate_data_init(&d, BENCH_SUITE_FIT_SAMPLES) != UA_STATUSCODE_GOOD)
+        return 1;
+
+    /* Operating points spread over temperature and flow, CB with 0.1 % noise;
+       the flows keep both reactions visible in CB, so all four parameters are identifiable */
+    srand(1);
+    for (UA_UInt32 i = 0; i < BENCH_SUITE_FIT_SAMPLES; i++) {
+        const UA_Double T = 60.0 + 40.0 * rand() / RAND_MAX;
+        const UA_Double F = 5.0 + 50.0 * rand() / RAND_MAX;
+        const UA_Double CB = compute_CB_values(T, F, 2.0, 100.0, 5.0e9, 7.5e4, 3.0e10, 8.5e4, 8.314);
+        estimate_data_add(&d, T, F, 2.0, CB * (1.0 + 1e-3 * (2.0 * rand() / RAND_MAX - 1.0)), 100.0);
+    }
+
+    int rc = bench_suite_fit_case(j, NULL, &d, "fit_100k_1_thread");
+    ModelEngine e;
+    if (engine_init(&e, config_estimate_threads, config_estimate_chunk) == UA_STATUSCODE_GOOD) {
+        rc |= bench_suite_fit_case(j, &e, &d, "fit_100k_pool");
+        engine_clear(&e);
+    }
+    estimate_data_clear(&d);
+    return rc;
+}
+
+/* --- sweep ---------------------------------------------------------------- */
+
+/* One reactor with the kinetics of the estimate cases and the default valves */
+static int bench_suite_reactor_init(ReactorFleet* f) {
+    if (fleet_init(f, 1) != UA_STATUSCODE_GOOD)
+        return 1;
+    if (fleet_add_reactor(f, NULL) != UA_STATUSCODE_GOOD) {
+        fleet_clear(f);
+        return 1;
+    }
+    f->volume[0] = 100.0;
+    f->k01[0] = 5.0e9;
+    f->EA1[0] = 7.5e4;
+    f->k02[0] = 3.0e10;
+    f->EA2[0] = 8.5e4;
+    f->R[0] = 8.314;
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++)
+        f->valveCurve[v][0] = valve_curve_builtin((FleetValve)v, VALVE_CHAR_DEFAULT);
+    return 0;
+}
+
+/* Times BENCH_SUITE_SWEEPS sweeps of p, evaluated on engine (NULL = caller) */
+static void bench_suite_sweep_case(BenchSuiteJson* j, ModelEngine* engine, SweepPlan* p,
+    UA_Double* cb, const char* name) {
+    UA_Double samples[BENCH_SUITE_SWEEPS];
+    for (UA_UInt32 k = 0; k < BENCH_SUITE_SWEEPS; k++) {
+        const UA_UInt64 t0 = platform_now_ns();
+        sweep_run(engine, p, cb);
+        samples[k] = (UA_Double)(platform_now_ns() - t0);
+    }
+    g_benchSink = cb[sweep_grid_cells(&p->grid) / 2];
+    bench_suite_result(j, "sweep", name, "ms/op", 1e6, BENCH_SUITE_SWEEPS, samples, BENCH_SUITE_SWEEPS);
+}
+
+static int bench_suite_sweep(BenchSuiteJson* j) {
+    ReactorFleet f;
+    if (bench_suite_reactor_init(&f))
+        return 1;
+    SweepGrid g;
+    sweep_grid_default(&g);
+    for (int a = 0; a < SWEEP_AXES; a++)
+        g.points[a] = BENCH_SUITE_SWEEP_POINTS;
+    SweepPlan* p = (SweepPlan*)malloc(sizeof(SweepPlan));
+    UA_Double* cb = (UA_Double*)malloc(sizeof(UA_Double) * sweep_grid_cells(&g));
+    if (!p || !cb) {
+        free(p);
+        free(cb);
+        fleet_clear(&f);
+        return 1;
+    }
+    sweep_plan(&f, 0, &g, p);
+
+    bench_suite_sweep_case(j, NULL, p, cb, "sweep_100_cubed_1_thread");
+    ModelEngine e;
+    if (engine_init(&e, config_estimate_threads, config_estimate_chunk) == UA_STATUSCODE_GOOD) {
+        bench_suite_sweep_case(j, &e, p, cb, "sweep_100_cubed_pool");
+        engine_clear(&e);
+    }
+    free(p);
+    free(cb);
+    fleet_clear(&f);
+    return 0;
+}
+
+/* --- optimize ------------------------------------------------------------- */
+
+/* Times BENCH_SUITE_OPTIMIZATIONS runs of p, evaluated on engine (NULL = caller) */
+static int bench_suite_optimize_case(BenchSuiteJson* j, ModelEngine* engine, const OptimizePlan* p,
+    const char* name) {
+    OptimizeOptions opt;
+    optimize_default_options(&opt);
+    opt.starts = config_optimize_starts;
+    opt.maxIterations = config_optimize_max_iterations;
+
+    UA_Double samples[BENCH_SUITE_OPTIMIZATIONS];
+    OptimizeResult res;
+    for (UA_UInt32 k = 0; k < BENCH_SUITE_OPTIMIZATIONS; k++) {
+        const UA_UInt64 t0 = platform_now_ns();
+        if (optimize_run(engine, p, &opt, &res) != UA_STATUSCODE_GOOD)
+            return 1;
+        samples[k] = (UA_Double)(platform_now_ns() - t0);
+    }
+    g_benchSink = res.CB;
+    bench_suite_result(j, "optimize", name, "ms/op", 1e6, BENCH_SUITE_OPTIMIZATIONS, samples,
+        BENCH_SUITE_OPTIMIZATIONS);
+    return 0;
+}
+
+static int bench_suite_optimize(BenchSuiteJson* j) {
+    ReactorFleet f;
+    if (bench_suite_reactor_init(&f))
+        return 1;
+    OptimizePlan* p = (OptimizePlan*)malloc(sizeof(OptimizePlan));
+    if (!p) {
+        fleet_clear(&f);
+        return 1;
+    }
+    OptimizeProblem prob;
+    prob.goal = OPTIMIZE_MAX_CB;
+    prob.target = 0.0;
+    for (int a = 0; a < OPTIMIZE_AXES; a++) {
+        prob.min[a] = 0.0;
+        prob.max[a] = 100.0;
+    }
+    optimize_plan(&f, 0, &prob, p);
+
+    int rc = bench_suite_optimize_case(j, NULL, p, "max_cb_1_thread");
+    ModelEngine e;
+    if (engine_init(&e, config_estimate_threads, config_estimate_chunk) == UA_STATUSCODE_GOOD) {
+        rc |= bench_suite_optimize_case(j, &e, p, "max_cb_pool");
+        engine_clear(&e);
+    }
+    free(p);
+    fleet_clear(&f);
+    return rc;
+}
+
+int bench_suite(const char* jsonPath, UA_UInt16 port) {
+    BenchSuiteJson j;
+    j.out = jsonPath ? fopen(jsonPath, "w") : stdout;
+    j.results = 0;
+    if (!j.out) {
+        LOG_MSG(LOG_LEVEL_ERROR, "bench_suite: cannot create %s", jsonPath);
+        return 1;
+    }
+
+    const LogLevel level = log_get_level();
+    log_set_level(LOG_LEVEL_WARN);
+    compute_CB_batch_init();
+
+    /* fleet_init() sets up the valve curves the model cases use */
+    ReactorFleet f;
+    BenchSuiteModel* m = (BenchSuiteModel*)malloc(sizeof(BenchSuiteModel));
+    if (!m || fleet_init(&f, 1) != UA_STATUSCODE_GOOD) {
+        free(m);
+        if (j.out != stdout)
+            fclose(j.out);
+        log_set_level(level);
+        return 1;
+    }
+    bench_suite_model_init(m);
+
+    const UA_DateTimeStruct now = UA_DateTime_toStruct(UA_DateTime_now());
+    fprintf(j.out, "{\n  \"suite\": \"opc_demo\",\n  \"schema\": %d,\n", BENCH_SUITE_SCHEMA);
+    fprintf(j.out, "  \"timestamp\": \"%04u-%02u-%02uT%02u:%02u:%02uZ\",\n",
+        (unsigned)now.year, (unsigned)now.month, (unsigned)now.day,
+        (unsigned)now.hour, (unsigned)now.min, (unsigned)now.sec);
+    fprintf(j.out, "  \"cpus\": %u,\n  \"cb_batch_isa\": \"%s\",\n  \"results\": [",
+        platform_cpu_count(), compute_CB_batch_isa_name(compute_CB_batch_isa()));
+    if (j.out != stdout)
+        printf("%-11s %-24s %10s %10s %10s\n", "group", "case", "mean", "p50", "p99");
+
+    bench_suite_case(&j, "model", "compute_CB_values", bench_suite_cb_values, m, 10, BENCH_SUITE_ROUNDS);
+    bench_suite_case(&j, "model", "compute_CB_batch", bench_suite_cb_batch, m, 10, BENCH_SUITE_ROUNDS);
+    bench_suite_case(&j, "model", "valve_curve_value", bench_suite_valve_value, m, 10, BENCH_SUITE_ROUNDS);
+    bench_suite_case(&j, "model", "valve_curve_eval", bench_suite_valve_eval, m, 10, BENCH_SUITE_ROUNDS);
+    fleet_clear(&f);
+    free(m);
+
+    int rc = bench_suite_datasource(&j);
+    rc |= bench_suite_roundtrip(&j, port);
+    rc |= bench_suite_estimate(&j);
+    rc |= bench_suite_sweep(&j);
+    rc |= bench_suite_optimize(&j);
+
+    fprintf(j.out, "\n  ]\n}\n");
+    if (j.out != stdout)
+        fclose(j.out);
+    log_set_level(level);
+    return rc;
+}
@@ -0,0 +1,292 @@
+/**
+ * @file binding.c
+ * @brief Node contexts of bound variables and the allocation-free read path.
+ *
+ * Every variable bound to the fleet gets a NodeBinding as its node
+ * context. Bindings are handed out from blocks of BINDING_BLOCK_SIZE
+ * entries that live until binding_free_all() at shutdown, so building a
+ * large address space costs a handful of allocations.
+ *
+ * A binding caches what the callbacks would otherwise look up in the
+ * address space: the log name built from the object and variable browse
+ * names, the engineering range a write must respect, and the per-reactor
+ * dirty flags that tell the model which kind of input (FLEET_DIRTY_*)
+ * changed since its last tick. Reads, accepted writes and rejected writes are counted per node.
+ *
+ * binding_read() fills the UA_DataValue of a DataSource read. If no
+ * monitored item samples the node, the value is stored in the binding's
+ * `served` slot and the variant borrows it (UA_VARIANT_DATA_NODELETE)
+ * instead of allocating a copy: the Read service encodes the response
+ * before the next server iteration, and clearing the response leaves the
+ * slot alone. The slot is lent at most once per server iteration
+ * (server_loop_iterations()); a Read request naming the node twice gets
+ * a copy for the second result, which would otherwise share the slot.
+ * Outside of server_loop_run() every read lends it. Monitored items keep
+ * sampled values beyond the call (for change detection and queued
+ * notifications), so nodes with monitored items fall back to
+ * UA_Variant_setScalarCopy(). The monitored item
+ * count is maintained by binding_monitored_item_cb(), which main.c
+ * installs as the server's monitoredItemRegisterCallback.
+ *
+ * Valve characteristics are bound through the valve's FleetSlot: the
+ * CHARACTERISTIC variable reads the shape of the valve's curve, the
+ * CHARACTERISTIC_TABLE variable its custom breakpoints as an array copy.
+ * The histograms of the diagnostics (diag.c) are read the same way, and
+ * so are the grid and the CB surface of a what-if sweep (sweep.c); the
+ * surface, several megabytes at full resolution, is the one variable
+ * whose reads accept an index range.
+ *
+ * Timestamps come from server_loop_now(): one clock read per server
+ * iteration instead of two per value.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "binding.h"
+#include "diag.h"
+#include "fleet.h"
+#include "server_loop.h"
+#include "valve_curve.h"
+#include "sweep.h"
+
+typedef struct BindingBlock {
+    struct BindingBlock* next;
+    UA_UInt32 used;
+    NodeBinding items[BINDING_BLOCK_SIZE];
+} BindingBlock;
+
+static BindingBlock* g_blocks;
+
+NodeBinding* binding_new(BindingKind kind, void* field) {
+    if (!g_blocks || g_blocks->used == BINDING_BLOCK_SIZE) {
+        BindingBlock* b = (BindingBlock*)UA_malloc(sizeof(BindingBlock));
+        if (!b)
+            return NULL;
+        b->next = g_blocks;
+        b->used = 0;
+        g_blocks = b;
+    }
+
+    NodeBinding* nb = &g_blocks->items[g_blocks->used++];
+    memset(nb, 0, sizeof(*nb));
+    nb->kind = kind;
+    nb->field = field;
+    nb->min = -INFINITY;
+    nb->max = INFINITY;
+    return nb;
+}
+
+/**
+ * @brief Caches "<object>.<variable>" as the binding's name for log messages.
+ *
+ * Truncated to BINDING_NAME_SIZE - 1 characters.
+ */
+void binding_set_name(NodeBinding* b, const char* object, const char* variable) {
+    snprintf(b->name, sizeof(b->name), "%s.%s", object ? object : "", variable ? variable : "");
+}
+
+void binding_set_limits(NodeBinding* b, UA_Double min, UA_Double max) {
+    b->min = min;
+    b->max = max;
+}
+
+UA_Boolean binding_in_range(const NodeBinding* b, UA_Double value) {
+    return value >= b->min && value <= b->max;
+}
+
+/**
+ * @brief Accounts an accepted write and flags the model input as changed.
+ */
+void binding_mark_written(NodeBinding* b) {
+    b->writes++;
+    if (b->dirty)
+        *b->dirty |= b->dirtyMask;
+}
+
+/**
+ * @brief Releases all bindings; call after the server has been deleted.
+ */
+void binding_free_all(void) {
+    while (g_blocks) {
+        BindingBlock* next = g_blocks->next;
+        UA_free(g_blocks);
+        g_blocks = next;
+    }
+}
+
+/**
+ * @brief Tells whether a node context is one of our bindings.
+ */
+UA_Boolean binding_owns(const void* context) {
+    const NodeBinding* p = (const NodeBinding*)context;
+    for (const BindingBlock* b = g_blocks; b; b = b->next) {
+        if (p >= b->items && p < b->items + b->used)
+            return true;
+    }
+    return false;
+}
+
+UA_StatusCode binding_read(NodeBinding* b, UA_Boolean includeSourceTimeStamp,
+    const UA_NumericRange* range, UA_DataValue* out) {
+
+    UA_DataValue_init(out);
+
+    if (!b || !b->field) {
+        out->status = UA_STATUSCODE_BADINTERNALERROR;
+        out->hasStatus = true;
+        return out->status;
+    }
+
+    if (range && range->dimensionsSize > 0 && b->kind != BINDING_SWEEP_SURFACE) {
+        out->status = UA_STATUSCODE_BADINDEXRANGEINVALID;
+        out->hasStatus = true;
+        return out->status;
+    }
+
+    const UA_DataType* type;
+    BindingValue value;
+    UA_DateTime sourceTime = 0;
+    b->reads++;
+    switch (b->kind) {
+    case BINDING_DOUBLE:
+        value.d = *(const UA_Double*)b->field;
+        type = &UA_TYPES[UA_TYPES_DOUBLE];
+        break;
+    case BINDING_UINT32:
+        value.u = *(const UA_UInt32*)b->field;
+        type = &UA_TYPES[UA_TYPES_UINT32];
+        break;
+    case BINDING_UINT64:
+        value.u64 = atomic_u64_load((const volatile UA_UInt64*)b->field);
+        type = &UA_TYPES[UA_TYPES_UINT64];
+        break;
+    case BINDING_SENSOR: {
+        const FleetSlot* slot = (const FleetSlot*)b->field;
+        fleet_read_pv(slot->fleet, (FleetSensor)slot->field, slot->index,
+            &value.d, &sourceTime);
+        type = &UA_TYPES[UA_TYPES_DOUBLE];
+        break;
+    }
+    case BINDING_VALVE_CURVE: {
+        const FleetSlot* slot = (const FleetSlot*)b->field;
+        value.u = (UA_UInt32)valve_curve_kind(slot->fleet->valveCurve[slot->field][slot->index]);
+        type = &UA_TYPES[UA_TYPES_UINT32];
+        break;
+    }
+    case BINDING_VALVE_TABLE: {
+        /* Rarely read and variable in size: always a copy */
+        const FleetSlot* slot = (const FleetSlot*)b->field;
+        const UA_Double* points;
+        const size_t count = valve_curve_points(slot->fleet->valveCurve[slot->field][slot->index], &points);
+        UA_StatusCode rv = UA_Variant_setArrayCopy(&out->value, points, 2 * count,
+            &UA_TYPES[UA_TYPES_DOUBLE]);
+        if (rv != UA_STATUSCODE_GOOD) {
+            out->status = rv;
+            out->hasStatus = true;
+            return rv;
+        }
+        type = NULL;            /* value already set */
+        break;
+    }
+    case BINDING_HISTOGRAM: {
+        const DiagHistogram* h = (const DiagHistogram*)b->field;
+        UA_StatusCode rv = UA_Variant_setArrayCopy(&out->value, h->buckets, DIAG_BUCKETS,
+            &UA_TYPES[UA_TYPES_UINT64]);
+        if (rv != UA_STATUSCODE_GOOD) {
+            out->status = rv;
+            out->hasStatus = true;
+            return rv;
+        }
+        type = NULL;
+        break;
+    }
+    case BINDING_SWEEP_BOUNDS:
+    case BINDING_SWEEP_POINTS: {
+        UA_StatusCode rv = UA_Variant_setArrayCopy(&out->value, b->field, SWEEP_AXES,
+            &UA_TYPES[b->kind == BINDING_SWEEP_BOUNDS ? UA_TYPES_DOUBLE : UA_TYPES_UINT32]);
+        if (rv != UA_STATUSCODE_GOOD) {
+            out->status = rv;
+            out->hasStatus = true;
+            return rv;
+        }
+        type = NULL;
+        break;
+    }
+    case BINDING_SWEEP_SURFACE: {
+        UA_StatusCode rv = sweep_read((Sweep*)b->field, range, &out->value, &sourceTime);
+        if (rv != UA_STATUSCODE_GOOD) {
+            out->status = rv;
+            out->hasStatus = true;
+            return rv;
+        }
+        type = NULL;
+        break;
+    }
+    default:
+        out->status = UA_STATUSCODE_BADINTERNALERROR;
+        out->hasStatus = true;
+        return out->status;
+    }
+
+    /* The slot is lent once per iteration, so a node read twice in one request gets a copy */
+    const UA_UInt64 iteration = server_loop_iterations();
+    if (type && !b->monitored && (iteration == 0 || iteration != b->lentIteration)) {
+        b->served = value;
+        b->lentIteration = iteration;
+        UA_Variant_setScalar(&out->value, &b->served, type);
+        out->value.storageType = UA_VARIANT_DATA_NODELETE;
+    }
+    else if (type) {
+        UA_StatusCode rv = UA_Variant_setScalarCopy(&out->value, &value, type);
+        if (rv != UA_STATUSCODE_GOOD) {
+            out->status = rv;
+            out->hasStatus = true;
+            return rv;
+        }
+    }
+    out->hasValue = true;
+
+    const UA_DateTime now = server_loop_now();
+    out->serverTimestamp = now;
+    out->hasServerTimestamp = true;
+
+    if (includeSourceTimeStamp) {
+        /* Sensors carry the model tick time, sweeps their own; inputs and the initial values the read time */
+        out->sourceTimestamp = sourceTime ? sourceTime : now;
+        out->hasSourceTimestamp = true;
+    }
+
+    out->status = UA_STATUSCODE_GOOD;
+    out->hasStatus = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Counts the monitored items on the value of bound nodes.
+ *
+ * Signature of UA_ServerConfig::monitoredItemRegisterCallback. Contexts
+ * that are not bindings (or other attributes) are ignored.
+ */
+void binding_monitored_item_cb(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* nodeId, void* nodeContext,
+    const UA_UInt32 attributeId, const UA_Boolean removed) {
+
+    (void)server;
+    (void)sessionId;
+    (void)sessionContext;
+    (void)nodeId;
+
+    if (attributeId != UA_ATTRIBUTEID_VALUE || !nodeContext || !binding_owns(nodeContext))
+        return;
+
+    NodeBinding* b = (NodeBinding*)nodeContext;
+    if (removed) {
+        if (b->monitored)
+            b->monitored--;
+    }
+    else {
+        b->monitored++;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <open62541/server.h>
+#include "types.h"
+#include "log.h"
+
+/* What a NodeBinding points to */
+typedef enum {
+    BINDING_DOUBLE,             /* UA_Double field */
+    BINDING_UINT32,             /* UA_UInt32 field */
+    BINDING_SENSOR,             /* FleetSlot, read from the published snapshot */
+    BINDING_VALVE_CURVE,        /* FleetSlot of a valve, its ValveCharacteristic */
+    BINDING_VALVE_TABLE,        /* FleetSlot of a valve, its custom breakpoints */
+    BINDING_UINT64,             /* UA_UInt64 field, read-only */
+    BINDING_HISTOGRAM,          /* DiagHistogram, its buckets as a UInt64 array */
+    BINDING_SWEEP_BOUNDS,       /* UA_Double[SWEEP_AXES] of a SweepGrid */
+    BINDING_SWEEP_POINTS,       /* UA_UInt32[SWEEP_AXES] of a SweepGrid */
+    BINDING_SWEEP_SURFACE,      /* Sweep, its last CB surface, read-only */
+    BINDING_KIND_COUNT
+} BindingKind;
+
+/* Bindings allocated per pool block */
+#define BINDING_BLOCK_SIZE 1024
+
+/* "<object>.<variable>" name of a binding, including the terminating zero */
+#define BINDING_NAME_SIZE 32
+
+/* Scalar value of a read, by BindingKind */
+typedef union {
+    UA_Double d;
+    UA_UInt32 u;
+    UA_UInt64 u64;
+} BindingValue;
+
+/*
+ * Node context of a variable bound to the fleet.
+ *
+ * Everything the DataSource callbacks need is kept here, so reads and
+ * writes never look anything up in the address space. served holds the
+ * value lent out by a read: the first read of a node without monitored
+ * items in a server iteration returns it borrowed (no copy), every other
+ * read a copy, see binding.c.
+ *
+ * A borrowed value points into the binding and is only valid until the
+ * next read of the node in a later iteration. The Read service encodes
+ * it before that; an in-process UA_Server_read() caller must copy the
+ * variant (UA_Variant_copy()) before keeping it beyond the iteration.
+ */
+typedef struct {
+    BindingKind kind;
+    void* field;
+    char name[BINDING_NAME_SIZE];   /* "<object>.<variable>", used in log messages */
+    UA_Double min;              /* engineering range accepted by writes */
+    UA_Double max;
+    UA_Byte* dirty;             /* per-reactor FLEET_DIRTY_* flags or NULL */
+    UA_Byte dirtyMask;          /* bits set in *dirty on write */
+    UA_UInt32 monitored;        /* monitored items sampling this node */
+    UA_UInt32 reads;
+    UA_UInt32 writes;
+    UA_UInt32 rejected;         /* writes refused as out of range */
+    BindingValue served;
+    UA_UInt64 lentIteration;    /* server iteration served was last lent in */
+} NodeBinding;
+
+NodeBinding* binding_new(BindingKind kind, void* field);
+void binding_set_name(NodeBinding* b, const char* object, const char* variable);
+void binding_set_limits(NodeBinding* b, UA_Double min, UA_Double max);
+UA_Boolean binding_in_range(const NodeBinding* b, UA_Double value);
+void binding_mark_written(NodeBinding* b);
+void binding_free_all(void);
+UA_Boolean binding_owns(const void* context);
+
+UA_StatusCode binding_read(NodeBinding* b, UA_Boolean includeSourceTimeStamp,
+    const UA_NumericRange* range, UA_DataValue* out);
+
+void binding_monitored_item_cb(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* nodeId, void* nodeContext,
+    const UA_UInt32 attributeId, const UA_Boolean removed);
@@ -2,22 +2,76 @@
 
 const int config_dt = 1000;  // callback every 1000 ms (1 s)
 
+const UA_Double config_time_scale = 1.0;
+const char* const config_scenario_file = NULL;
+
+const UA_Boolean config_model_thread = false;
+const ModelOverrunPolicy config_model_overrun = MODEL_OVERRUN_SKIP;
+const UA_UInt32 config_model_catch_up_max = 10;
+const UA_Int32 config_model_thread_cpu = -1;
+const UA_Int32 config_model_thread_priority = 0;
+
+const ModelMode config_model_mode = MODEL_MODE_STEADY_STATE;
+
+const UA_Double config_ode_rtol = 1e-6;
+const UA_Double config_ode_atol = 1e-9;
+const UA_UInt32 config_ode_max_steps = 64;
+
+const UA_UInt32 config_model_threads = 0;
+const UA_UInt32 config_model_chunk = 256;
+
+const UA_UInt32 config_estimate_threads = 0;
+const UA_UInt32 config_estimate_chunk = 4096;
+const UA_UInt32 config_estimate_max_iterations = 100;
+
+const UA_UInt32 config_optimize_starts = 256;
+const UA_UInt32 config_optimize_max_iterations = 200;
+
+const SensorPublishMode config_sensor_publish_mode = SENSOR_PUBLISH_POLL;
+const DeadbandType config_deadband_type = DEADBAND_ABSOLUTE;
+const UA_Double config_deadband = 1e-6;
+
+const UA_UInt32 config_history_depth = 3600;   // one hour at config_dt
+const HistoryCompression config_history_compression = HISTORY_COMPRESSION_SWINGING_DOOR;
+const UA_Double config_history_deviation = 1e-4;
+
+const UA_Double config_diag_period_ms = 1000.0;
+
+const char* const config_plant_file = "plant.ini";
+const char* const config_substance_file = "substances.ini";
+const UA_UInt32 config_substance_poll_ms = 1000;
+const char* const config_record_file = NULL;
+const UA_UInt32 config_reactor_count = 1;
+
+const UA_UInt16 config_bench_port = 4850;
+
+const LogLevel config_log_level = LOG_LEVEL_INFO;
+const UA_UInt32 config_log_capacity = 4096;
+
 // open62541 will store actual callback IDs here
 UA_UInt64 cbModelId = 0;
 UA_UInt64 cbTickId = 0;
 
-// Global model objects
-Reactor reactor;
+// All simulated reactors
+ReactorFleet fleet;
+
+// Worker pool stepping the fleet
+ModelEngine engine;
+
+// Sensor history served through HistoryRead
+Historian history;
+
+// Dedicated model thread
+ModelThread modelThread;
+
+// Worker pool evaluating kinetics estimations, sweeps and optimizations
+ModelEngine estimateEngine;
 
-ValveHandleControl
-	valveRegulationQ,
-	valveRegulationT,
-	valveRegulationConcentrationA;
+// Worker answering asynchronous method calls
+AsyncMethodWorker asyncMethods;
 
-ModelCtx modelCtx;
+// Kinetics selected by SUBSTANCE_ID
+SubstanceLibrary substances;
 
-Sensor
-	sensorF,
-	sensorT,
-	sensorConcentrationA,
-	sensorConcentrationB;
\ No newline at end of file
+// What-if sweeps of every reactor
+SweepSet sweeps;
@@ -1,25 +1,128 @@
 ﻿#pragma once
 #include "types.h"
+#include "log.h"
+#include "engine.h"
+#include "historian.h"
+#include "model_thread.h"
+#include "async_method.h"
+#include "substance.h"
+#include "sweep.h"
 
-// Math model call period, ms
+// Math model call period, ms; simulated time advanced by each tick
 extern const int config_dt;
 
+// Simulated seconds per wall second (1 = real time, 0 = as fast as
+// possible); "--time-scale <x>" overrides it
+extern const UA_Double config_time_scale;
+
+// Scenario timeline of scheduled input changes (see scenario.c), NULL =
+// none; "--scenario <file>" overrides it
+extern const char* const config_scenario_file;
+
+// Run the model on a dedicated thread ticking at absolute deadlines
+// instead of a server callback (see model_thread.c); "--model-thread
+// <skip|catch-up|slip>" enables it with that overrun policy
+extern const UA_Boolean config_model_thread;
+extern const ModelOverrunPolicy config_model_overrun;
+
+// Missed ticks the catch-up policy runs late before dropping the rest
+extern const UA_UInt32 config_model_catch_up_max;
+
+// CPU the model thread is pinned to (-1 = any) and its real-time
+// priority (SCHED_FIFO on POSIX, 0 = normal scheduling)
+extern const UA_Int32 config_model_thread_cpu;
+extern const UA_Int32 config_model_thread_priority;
+
+// CB model: closed-form steady state or integrated dynamic model
+extern const ModelMode config_model_mode;
+
+// Dynamic model integrator tolerances and Runge-Kutta step budget per tick
+extern const UA_Double config_ode_rtol;
+extern const UA_Double config_ode_atol;
+extern const UA_UInt32 config_ode_max_steps;
+
+// Model worker threads including the server thread (0 = one per CPU) and
+// reactors claimed per work-stealing chunk
+extern const UA_UInt32 config_model_threads;
+extern const UA_UInt32 config_model_chunk;
+
+// Threads evaluating a kinetics estimation (ESTIMATE_KINETICS, see
+// estimate.c), a sweep (SWEEP, see sweep.c) or an optimization (OPTIMIZE,
+// see optimize.c) including the calling one (0 = one per CPU), samples
+// or cells claimed per chunk, and Levenberg-Marquardt iterations at most
+extern const UA_UInt32 config_estimate_threads;
+extern const UA_UInt32 config_estimate_chunk;
+extern const UA_UInt32 config_estimate_max_iterations;
+
+// Starting points of every OPTIMIZE, spread over the threads above, and
+// compass search polls from each at most
+extern const UA_UInt32 config_optimize_starts;
+extern const UA_UInt32 config_optimize_max_iterations;
+
+// How sensor values reach clients and the deadband applied in push mode
+extern const SensorPublishMode config_sensor_publish_mode;
+extern const DeadbandType config_deadband_type;
+extern const UA_Double config_deadband;
+
+// Samples kept per sensor by the historian (0 = no history) and the
+// compression deciding which ticks are archived
+extern const UA_UInt32 config_history_depth;
+extern const HistoryCompression config_history_compression;
+extern const UA_Double config_history_deviation;
+
+// Refresh period of the published diagnostics summaries, ms
+extern const UA_Double config_diag_period_ms;
+
+// Plant description (see plant.c); "--plant <file>" overrides it
+extern const char* const config_plant_file;
+
+// Substance library mapping SUBSTANCE_ID to kinetics (see substance.c),
+// reloaded when it changes, checked every config_substance_poll_ms;
+// "--substances <file>" overrides it
+extern const char* const config_substance_file;
+extern const UA_UInt32 config_substance_poll_ms;
+
+// Tick recording written from startup (see recorder.c), NULL = none;
+// "--record <file>" overrides it
+extern const char* const config_record_file;
+
+// Number of reactors of the built-in plant used when there is no description
+extern const UA_UInt32 config_reactor_count;
+
+// Port of the in-process server of the round-trip benchmarks, kept apart
+// from the default 4840 so a running server does not interfere
+extern const UA_UInt16 config_bench_port;
+
+// Initial log verbosity; per-tick model output is logged at LOG_LEVEL_TRACE
+extern const LogLevel config_log_level;
+
+// Records held by the asynchronous logger before new ones are dropped
+extern const UA_UInt32 config_log_capacity;
+
 // OPC UA callback identifiers
 extern UA_UInt64 cbModelId;
 extern UA_UInt64 cbTickId;
 
-// Global model objects
-extern Reactor reactor;
+// All simulated reactors
+extern ReactorFleet fleet;
+
+// Worker pool stepping the fleet
+extern ModelEngine engine;
+
+// Sensor history served through HistoryRead
+extern Historian history;
+
+// Dedicated model thread, idle unless config_model_thread
+extern ModelThread modelThread;
+
+// Worker pool evaluating kinetics estimations, sweeps and optimizations
+extern ModelEngine estimateEngine;
 
-extern ValveHandleControl
-	valveRegulationQ,
-	valveRegulationT,
-	valveRegulationConcentrationA;
+// Worker answering asynchronous method calls (ESTIMATE_KINETICS, SWEEP)
+extern AsyncMethodWorker asyncMethods;
 
-extern ModelCtx modelCtx;
+// Kinetics selected by SUBSTANCE_ID, reloaded while running
+extern SubstanceLibrary substances;
 
-extern Sensor
-	sensorF,
-	sensorT,
-	sensorConcentrationA,
-	sensorConcentrationB;
+// What-if sweeps of every reactor, bound to the Reactor objects
+extern SweepSet sweeps;
@@ -0,0 +1,136 @@
+﻿/**
+ * @file cstr_ode.c
+ * @brief Adaptive integration of the dynamic CSTR model.
+ *
+ * The dynamic model keeps the reactor concentrations CA and CB as state
+ * and integrates the mass balances of the A -> 2B -> C reaction:
+ *
+ *     dCA/dt = q (CA_in - CA) - k1 CA
+ *     dCB/dt = -q CB + 2 k1 CA - k2 CB
+ *
+ * with q = Q / Vr. Its steady state is exactly the closed form of
+ * compute_CB(), so both model modes agree once the transient has decayed.
+ *
+ * cstr_integrate() advances the state over one model tick with the
+ * Dormand-Prince 5(4) embedded Runge-Kutta pair and adaptive step size.
+ * The step size found in one tick is handed to the next through *h. To
+ * bound the cost per tick, at most OdeOptions::maxSteps accepted or
+ * rejected steps are taken; if the budget runs out (stiff kinetics) the
+ * remaining interval is closed with a single backward Euler step, which is
+ * unconditionally stable for this linear system and solved in closed form.
+ */
+
+#include <math.h>
+#include "cstr_ode.h"
+
+/* Step size controller limits */
+#define ODE_SAFETY      0.9
+#define ODE_GROW_MAX    5.0
+#define ODE_SHRINK_MIN  0.2
+
+static void cstr_rhs(const CstrRates* p, double ca, double cb, double* dca, double* dcb) {
+    *dca = p->q * (p->caIn - ca) - p->k1 * ca;
+    *dcb = -p->q * cb + 2.0 * p->k1 * ca - p->k2 * cb;
+}
+
+/**
+ * @brief Backward Euler step of length h, solved exactly.
+ */
+static void cstr_implicit_step(const CstrRates* p, double* ca, double* cb, double h) {
+    const double caNew = (*ca + h * p->q * p->caIn) / (1.0 + h * (p->q + p->k1));
+    const double cbNew = (*cb + h * 2.0 * p->k1 * caNew) / (1.0 + h * (p->q + p->k2));
+    *ca = caNew;
+    *cb = cbNew;
+}
+
+void cstr_integrate(const CstrRates* p, UA_Double* ca, UA_Double* cb,
+    UA_Double dt, UA_Double* h, const OdeOptions* opt, OdeResult* res)
+{
+    static const double
+        a21 = 1.0 / 5.0,
+        a31 = 3.0 / 40.0, a32 = 9.0 / 40.0,
+        a41 = 44.0 / 45.0, a42 = -56.0 / 15.0, a43 = 32.0 / 9.0,
+        a51 = 19372.0 / 6561.0, a52 = -25360.0 / 2187.0, a53 = 64448.0 / 6561.0,
+        a54 = -212.0 / 729.0,
+        a61 = 9017.0 / 3168.0, a62 = -355.0 / 33.0, a63 = 46732.0 / 5247.0,
+        a64 = 49.0 / 176.0, a65 = -5103.0 / 18656.0,
+        b1 = 35.0 / 384.0, b3 = 500.0 / 1113.0, b4 = 125.0 / 192.0,
+        b5 = -2187.0 / 6784.0, b6 = 11.0 / 84.0,
+        e1 = 71.0 / 57600.0, e3 = -71.0 / 16695.0, e4 = 71.0 / 1920.0,
+        e5 = -17253.0 / 339200.0, e6 = 22.0 / 525.0, e7 = -1.0 / 40.0;
+
+    res->steps = 0;
+    res->rejected = 0;
+    res->budgetHit = false;
+    res->error = 0.0;
+
+    double y0 = *ca, y1 = *cb;
+    double t = 0.0;
+    double step = (*h > 0.0 && *h <= dt) ? *h : dt;
+
+    /* First stage, reused across steps (FSAL) */
+    double k1a, k1b;
+    cstr_rhs(p, y0, y1, &k1a, &k1b);
+
+    while (t < dt) {
+        if (res->steps + res->rejected >= opt->maxSteps) {
+            cstr_implicit_step(p, &y0, &y1, dt - t);
+            res->budgetHit = true;
+            break;
+        }
+
+        const double hs = (t + step > dt) ? dt - t : step;
+        double k2a, k2b, k3a, k3b, k4a, k4b, k5a, k5b, k6a, k6b, k7a, k7b;
+
+        cstr_rhs(p, y0 + hs * a21 * k1a, y1 + hs * a21 * k1b, &k2a, &k2b);
+        cstr_rhs(p, y0 + hs * (a31 * k1a + a32 * k2a),
+            y1 + hs * (a31 * k1b + a32 * k2b), &k3a, &k3b);
+        cstr_rhs(p, y0 + hs * (a41 * k1a + a42 * k2a + a43 * k3a),
+            y1 + hs * (a41 * k1b + a42 * k2b + a43 * k3b), &k4a, &k4b);
+        cstr_rhs(p, y0 + hs * (a51 * k1a + a52 * k2a + a53 * k3a + a54 * k4a),
+            y1 + hs * (a51 * k1b + a52 * k2b + a53 * k3b + a54 * k4b), &k5a, &k5b);
+        cstr_rhs(p, y0 + hs * (a61 * k1a + a62 * k2a + a63 * k3a + a64 * k4a + a65 * k5a),
+            y1 + hs * (a61 * k1b + a62 * k2b + a63 * k3b + a64 * k4b + a65 * k5b), &k6a, &k6b);
+
+        const double n0 = y0 + hs * (b1 * k1a + b3 * k3a + b4 * k4a + b5 * k5a + b6 * k6a);
+        const double n1 = y1 + hs * (b1 * k1b + b3 * k3b + b4 * k4b + b5 * k5b + b6 * k6b);
+        cstr_rhs(p, n0, n1, &k7a, &k7b);
+
+        const double err0 = hs * (e1 * k1a + e3 * k3a + e4 * k4a + e5 * k5a + e6 * k6a + e7 * k7a);
+        const double err1 = hs * (e1 * k1b + e3 * k3b + e4 * k4b + e5 * k5b + e6 * k6b + e7 * k7b);
+        const double sc0 = opt->atol + opt->rtol * fmax(fabs(y0), fabs(n0));
+        const double sc1 = opt->atol + opt->rtol * fmax(fabs(y1), fabs(n1));
+        const double errNorm = fmax(fabs(err0) / sc0, fabs(err1) / sc1);
+
+        if (!isfinite(errNorm)) {
+            /* Overflow in the explicit stages: fall back to the stable step */
+            cstr_implicit_step(p, &y0, &y1, dt - t);
+            res->budgetHit = true;
+            break;
+        }
+
+        double factor = (errNorm > 0.0) ? ODE_SAFETY * pow(errNorm, -0.2) : ODE_GROW_MAX;
+        factor = fmin(ODE_GROW_MAX, fmax(ODE_SHRINK_MIN, factor));
+
+        if (errNorm <= 1.0) {
+            t += hs;
+            y0 = n0;
+            y1 = n1;
+            k1a = k7a;
+            k1b = k7b;
+            res->steps++;
+            res->error += fmax(fabs(err0), fabs(err1));
+            /* Keep the controller's step, not the one clipped to the tick end */
+            if (hs == step)
+                step *= factor;
+        }
+        else {
+            res->rejected++;
+            step = hs * factor;
+        }
+    }
+
+    *ca = y0;
+    *cb = y1;
+    *h = fmin(step, dt);
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+#include <open62541/types.h>
+
+/* Coefficients of the A -> 2B -> C mass balances of one reactor */
+typedef struct {
+    UA_Double q;        /* dilution rate Q / Vr, 1/s */
+    UA_Double k1;       /* A -> B rate constant, 1/s */
+    UA_Double k2;       /* B -> C rate constant, 1/s */
+    UA_Double caIn;     /* inlet concentration of A */
+} CstrRates;
+
+typedef struct {
+    UA_Double rtol;         /* relative tolerance per step */
+    UA_Double atol;         /* absolute tolerance per step */
+    UA_UInt32 maxSteps;     /* Runge-Kutta step budget per call */
+} OdeOptions;
+
+typedef struct {
+    UA_UInt32 steps;        /* accepted Runge-Kutta steps */
+    UA_UInt32 rejected;     /* rejected Runge-Kutta steps */
+    UA_Boolean budgetHit;   /* rest of the interval done by backward Euler */
+    UA_Double error;        /* sum of local error estimates (max norm) */
+} OdeResult;
+
+void cstr_integrate(const CstrRates* p, UA_Double* ca, UA_Double* cb,
+    UA_Double dt, UA_Double* h, const OdeOptions* opt, OdeResult* res);
@@ -0,0 +1,138 @@
+/**
+ * @file diag.c
+ * @brief Runtime performance diagnostics.
+ *
+ * Collects what the server spends its time on, cheaply enough to stay on:
+ *   - the wall time of every model_cb() call and the jitter of its timer,
+ *     i.e. how far the interval between two calls strays from the period
+ *     the callback is registered with (config_dt, or the period of the
+ *     simulation clock), and the achieved interval itself; calls more than
+ *     half a period late are counted. A dedicated model thread
+ *     (model_thread.c) also counts its overruns and skipped deadlines;
+ *   - per BindingKind, the DataSource reads, writes and writes rejected by
+ *     validation, counted on every call, and the latency of one call in
+ *     2^DIAG_SAMPLE_SHIFT (two clock reads each).
+ *
+ * Durations go into log2 histograms (DIAG_BUCKETS buckets of whole
+ * microseconds), so recording is a few instructions and the memory fixed.
+ * diag_cb(), a repeated server callback, refreshes the published
+ * summaries (mean, interpolated percentiles, max) from them once per
+ * period; the counters and raw buckets are bound directly. The nodes are
+ * created by opc_ua_create_diagnostics() in the "Diagnostics" folder.
+ */
+
+#include <string.h>
+#include "diag.h"
+
+#define DIAG_NS_PER_MS 1000000.0
+
+Diagnostics diag;
+
+void diag_record(DiagHistogram* h, UA_UInt64 ns) {
+    UA_UInt64 us = ns / 1000;
+    UA_UInt32 b = 0;
+    while (us && b < DIAG_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    h->buckets[b]++;
+    diag_count(&h->count, 1);
+    diag_count(&h->sumNs, ns);
+    if (ns > atomic_u64_load(&h->maxNs))
+        atomic_u64_store(&h->maxNs, ns);
+}
+
+/* Duration in us below which a share p of the samples lies, interpolated in its bucket */
+static UA_Double diag_percentile(const DiagHistogram* h, UA_Double p) {
+    const UA_Double target = p * (UA_Double)atomic_u64_load(&h->count);
+    UA_Double below = 0.0;
+    for (UA_UInt32 b = 0; b < DIAG_BUCKETS; b++) {
+        const UA_Double n = (UA_Double)h->buckets[b];
+        if (n > 0.0 && below + n >= target) {
+            const UA_Double lo = b ? (UA_Double)(1ull << (b - 1)) : 0.0;
+            const UA_Double hi = (UA_Double)(1ull << b);
+            const UA_Double us = lo + (hi - lo) * (target - below) / n;
+            const UA_Double max = atomic_u64_load(&h->maxNs) / 1000.0;
+            return us < max ? us : max;
+        }
+        below += n;
+    }
+    return atomic_u64_load(&h->maxNs) / 1000.0;
+}
+
+void diag_summarize(const DiagHistogram* h, DiagSummary* s) {
+    const UA_UInt64 count = atomic_u64_load(&h->count);
+    if (count == 0) {
+        memset(s, 0, sizeof(*s));
+        return;
+    }
+    s->mean = (UA_Double)atomic_u64_load(&h->sumNs) / (UA_Double)count / 1000.0;
+    s->p50 = diag_percentile(h, 0.50);
+    s->p90 = diag_percentile(h, 0.90);
+    s->p99 = diag_percentile(h, 0.99);
+    s->max = atomic_u64_load(&h->maxNs) / 1000.0;
+}
+
+/**
+ * @brief Accounts one model_cb() call that ran from startNs to endNs.
+ *
+ * periodMs is the period the callback is registered with; the interval
+ * since the previous call is compared with it unless it is 0 (ticks run
+ * back to back).
+ */
+void diag_model_call(UA_UInt64 startNs, UA_UInt64 endNs, UA_Double periodMs) {
+    diag_count(&diag.calls, 1);
+    diag_record(&diag.tickNs, endNs - startNs);
+
+    if (diag.lastCallNs) {
+        diag_record(&diag.periodNs, startNs - diag.lastCallNs);
+        if (periodMs > 0.0) {
+            const UA_Double interval = (UA_Double)(startNs - diag.lastCallNs);
+            const UA_Double period = periodMs * DIAG_NS_PER_MS;
+            const UA_Double deviation = interval > period ? interval - period : period - interval;
+            diag_record(&diag.jitterNs, (UA_UInt64)deviation);
+            if (interval > 1.5 * period)
+                diag_count(&diag.lateCalls, 1);
+        }
+    }
+    diag.lastCallNs = startNs;
+}
+
+void diag_refresh(void) {
+    diag_summarize(&diag.tickNs, &diag.tick);
+    diag_summarize(&diag.jitterNs, &diag.jitter);
+    diag_summarize(&diag.periodNs, &diag.period);
+    for (int k = 0; k < BINDING_KIND_COUNT; k++) {
+        DiagDataSource* d = &diag.dataSource[k];
+        diag_summarize(&d->readNs, &d->read);
+        diag_summarize(&d->writeNs, &d->write);
+    }
+}
+
+/**
+ * @brief Repeated server callback refreshing the published summaries.
+ */
+void diag_cb(UA_Server* server, void* data) {
+    (void)server;
+    (void)data;
+    diag_refresh();
+}
+
+/**
+ * @brief Name of a binding kind in the browse names of the diagnostics.
+ */
+const char* diag_kind_name(BindingKind kind) {
+    switch (kind) {
+    case BINDING_DOUBLE: return "Double";
+    case BINDING_UINT32: return "UInt32";
+    case BINDING_UINT64: return "UInt64";
+    case BINDING_SENSOR: return "Sensor";
+    case BINDING_VALVE_CURVE: return "ValveCurve";
+    case BINDING_VALVE_TABLE: return "ValveTable";
+    case BINDING_HISTOGRAM: return "Histogram";
+    case BINDING_SWEEP_BOUNDS: return "SweepBounds";
+    case BINDING_SWEEP_POINTS: return "SweepPoints";
+    case BINDING_SWEEP_SURFACE: return "SweepSurface";
+    default: return "Unknown";
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <open62541/server.h>
+#include "binding.h"
+#include "platform.h"
+
+/* Buckets of a latency histogram: bucket 0 counts durations below 1 us,
+   bucket b > 0 those of [2^(b-1), 2^b) us; the last one everything above */
+#define DIAG_BUCKETS 24
+
+/* DataSource calls are all counted, one in 2^DIAG_SAMPLE_SHIFT is timed */
+#define DIAG_SAMPLE_SHIFT 3
+#define DIAG_SAMPLE_MASK ((1u << DIAG_SAMPLE_SHIFT) - 1)
+
+/* Log2 histogram of durations */
+typedef struct {
+    volatile UA_UInt64 count;
+    volatile UA_UInt64 sumNs;
+    volatile UA_UInt64 maxNs;
+    UA_UInt64 buckets[DIAG_BUCKETS];
+} DiagHistogram;
+
+/* Figures of a histogram in microseconds, as published by diag_refresh() */
+typedef struct {
+    UA_Double mean;
+    UA_Double p50;
+    UA_Double p90;
+    UA_Double p99;
+    UA_Double max;
+} DiagSummary;
+
+/* DataSource callbacks of one BindingKind */
+typedef struct {
+    UA_UInt64 reads;
+    UA_UInt64 writes;
+    UA_UInt64 rejected;         /* writes refused by validation */
+    DiagHistogram readNs;
+    DiagHistogram writeNs;
+    DiagSummary read;
+    DiagSummary write;
+} DiagDataSource;
+
+/*
+ * Runtime instrumentation of the server.
+ *
+ * Each histogram and counter has a single writer: the thread running
+ * model_cb() or the model thread for the tick figures, the server thread
+ * for the DataSource ones. Counters the tick side writes are stored
+ * atomically (diag_count()) and read with atomic_u64_load(), so a reader
+ * on another thread never sees a torn value. Readers may still see a
+ * histogram's buckets in the middle of an update, which is fine for
+ * monitoring.
+ */
+typedef struct {
+    DiagHistogram tickNs;       /* wall time of each model_cb() call */
+    DiagHistogram jitterNs;     /* deviation of the call interval from the period */
+    DiagHistogram periodNs;     /* achieved interval between two calls */
+    DiagSummary tick;
+    DiagSummary jitter;
+    DiagSummary period;
+    volatile UA_UInt64 calls;
+    volatile UA_UInt64 lateCalls;       /* calls more than half a period late */
+    volatile UA_UInt64 overruns;        /* model thread: ticks ending past the next deadline */
+    volatile UA_UInt64 skippedTicks;    /* model thread: deadlines dropped by the overrun policy */
+    UA_UInt64 lastCallNs;
+    DiagDataSource dataSource[BINDING_KIND_COUNT];
+} Diagnostics;
+
+extern Diagnostics diag;
+
+void diag_record(DiagHistogram* h, UA_UInt64 ns);
+void diag_summarize(const DiagHistogram* h, DiagSummary* s);
+void diag_model_call(UA_UInt64 startNs, UA_UInt64 endNs, UA_Double periodMs);
+void diag_refresh(void);
+void diag_cb(UA_Server* server, void* data);
+
+const char* diag_kind_name(BindingKind kind);
+
+/**
+ * @brief Adds n to a counter written by the calling thread only, readable from any.
+ */
+static inline void diag_count(volatile UA_UInt64* counter, UA_UInt64 n) {
+    atomic_u64_store(counter, atomic_u64_load(counter) + n);
+}
+
+/**
+ * @brief Counts a DataSource call; returns its start time if it is timed, else 0.
+ */
+static inline UA_UInt64 diag_call_begin(UA_UInt64* counter) {
+    return ((++*counter) & DIAG_SAMPLE_MASK) == 0 ? platform_now_ns() : 0;
+}
+
+static inline void diag_call_end(DiagHistogram* h, UA_UInt64 startNs) {
+    if (startNs)
+        diag_record(h, platform_now_ns() - startNs);
+}
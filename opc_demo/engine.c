@@ -0,0 +1,260 @@
+/**
+ * @file engine.c
+ * @brief Worker pool that runs one model tick across all cores.
+ *
+ * engine_run() splits the index range [0, count) evenly into one
+ * contiguous range per worker and then lets every worker, including the
+ * calling thread, drain its own range in chunks of `chunk` indices.
+ *
+ * A worker's remaining range lives in a single 64-bit word (head and tail
+ * index), so both the owner taking a chunk from the head and a thief
+ * taking the upper half from the tail are one CAS on the same word. A
+ * worker that runs dry steals half of the first non-empty range it finds,
+ * publishes it as its own range (where it can be stolen again) and goes
+ * on. Reactors in dynamic mode with stiff kinetics, or ranges slowed down
+ * by a preempted thread, are thereby redistributed within the tick.
+ *
+ * The run ends behind a barrier: engine_run() returns once every helper
+ * thread has found all ranges empty and checked in, so the fleet is
+ * consistent when the caller continues.
+ */
+
+#include <string.h>
+#include "engine.h"
+
+/*
+ * Range boundaries are multiples of this many indices: one cache line of
+ * doubles, and a whole number of SIMD vectors, so workers never write to
+ * the same line of a fleet array and the batch kernel splits the fleet
+ * the same way as a single-threaded pass.
+ */
+#define ENGINE_ALIGN 8
+
+static UA_UInt32 align_up(UA_UInt32 i) {
+    return (i + ENGINE_ALIGN - 1) & ~(UA_UInt32)(ENGINE_ALIGN - 1);
+}
+
+static UA_UInt64 range_pack(UA_UInt32 head, UA_UInt32 tail) {
+    return (UA_UInt64)head | ((UA_UInt64)tail << 32);
+}
+
+static UA_UInt32 range_head(UA_UInt64 r) {
+    return (UA_UInt32)r;
+}
+
+static UA_UInt32 range_tail(UA_UInt64 r) {
+    return (UA_UInt32)(r >> 32);
+}
+
+/**
+ * @brief Claims up to `chunk` indices from the head of the worker's range.
+ */
+static UA_Boolean engine_pop(EngineWorker* w, UA_UInt32 chunk, UA_UInt32* begin, UA_UInt32* end) {
+    UA_UInt64 r = atomic_u64_load(&w->range);
+    for (;;) {
+        const UA_UInt32 h = range_head(r);
+        const UA_UInt32 t = range_tail(r);
+        if (h >= t)
+            return false;
+        const UA_UInt32 n = (t - h > chunk) ? h + chunk : t;
+        if (atomic_u64_cas(&w->range, &r, range_pack(n, t))) {
+            *begin = h;
+            *end = n;
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief Moves the upper half of another worker's range into self.
+ *
+ * Victims are probed round-robin starting after self. Returns false when
+ * every range is empty, i.e. all remaining work is already claimed.
+ */
+static UA_Boolean engine_steal(ModelEngine* e, EngineWorker* self) {
+    for (UA_UInt32 k = 1; k < e->workerCount; k++) {
+        EngineWorker* v = &e->workers[(self->index + k) % e->workerCount];
+        UA_UInt64 r = atomic_u64_load(&v->range);
+        for (;;) {
+            const UA_UInt32 h = range_head(r);
+            const UA_UInt32 t = range_tail(r);
+            if (h >= t)
+                break;
+            UA_UInt32 mid = align_up(h + (t - h) / 2);
+            if (mid >= t)
+                mid = h;        /* less than two lines left: take it all */
+            if (atomic_u64_cas(&v->range, &r, range_pack(h, mid))) {
+                /* Own range is empty, nobody else modifies it */
+                atomic_u64_store(&self->range, range_pack(mid, t));
+                self->steals++;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void engine_work(ModelEngine* e, EngineWorker* w) {
+    UA_UInt32 begin, end;
+    for (;;) {
+        if (engine_pop(w, e->runChunk, &begin, &end)) {
+            e->fn(e->ctx, w->index, begin, end);
+            w->chunks++;
+        }
+        else if (!engine_steal(e, w)) {
+            return;
+        }
+    }
+}
+
+static void engine_thread(void* arg) {
+    EngineWorker* w = (EngineWorker*)arg;
+    ModelEngine* e = w->engine;
+    UA_UInt32 seen = 0;
+
+    for (;;) {
+        platform_mutex_lock(&e->lock);
+        while (!e->stop && e->generation == seen)
+            platform_cond_wait(&e->wake, &e->lock);
+        if (e->stop) {
+            platform_mutex_unlock(&e->lock);
+            return;
+        }
+        seen = e->generation;
+        platform_mutex_unlock(&e->lock);
+
+        engine_work(e, w);
+
+        platform_mutex_lock(&e->lock);
+        if (--e->pending == 0)
+            platform_cond_broadcast(&e->done);
+        platform_mutex_unlock(&e->lock);
+    }
+}
+
+/**
+ * @brief Starts the worker pool.
+ *
+ * threads is the total number of workers including the calling thread;
+ * 0 selects one per logical CPU. It is clamped to ENGINE_MAX_WORKERS.
+ */
+UA_StatusCode engine_init(ModelEngine* e, UA_UInt32 threads, UA_UInt32 chunk) {
+    memset(e, 0, sizeof(*e));
+    if (threads == 0)
+        threads = platform_cpu_count();
+    if (threads > ENGINE_MAX_WORKERS)
+        threads = ENGINE_MAX_WORKERS;
+
+    e->chunk = align_up(chunk ? chunk : 1);
+    e->workers = (EngineWorker*)UA_calloc(threads, sizeof(EngineWorker));
+    if (!e->workers)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    platform_mutex_init(&e->lock);
+    platform_cond_init(&e->wake);
+    platform_cond_init(&e->done);
+
+    e->workerCount = 1;
+    e->workers[0].index = 0;
+    e->workers[0].engine = e;
+    for (UA_UInt32 i = 1; i < threads; i++) {
+        EngineWorker* w = &e->workers[i];
+        w->index = i;
+        w->engine = e;
+        if (platform_thread_start(&w->thread, engine_thread, w) != UA_STATUSCODE_GOOD)
+            break;      /* run with the threads we got */
+        e->workerCount++;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+void engine_clear(ModelEngine* e) {
+    if (!e->workers)
+        return;
+
+    platform_mutex_lock(&e->lock);
+    e->stop = true;
+    platform_cond_broadcast(&e->wake);
+    platform_mutex_unlock(&e->lock);
+
+    for (UA_UInt32 i = 1; i < e->workerCount; i++)
+        platform_thread_join(&e->workers[i].thread);
+
+    platform_cond_destroy(&e->done);
+    platform_cond_destroy(&e->wake);
+    platform_mutex_destroy(&e->lock);
+    UA_free(e->workers);
+    memset(e, 0, sizeof(*e));
+}
+
+/**
+ * @brief Calls fn for every index in [0, count) and waits for completion.
+ *
+ * Runs inline on the calling thread when the pool has no helpers or the
+ * range fits into a single chunk, which avoids waking threads for small
+ * fleets.
+ */
+void engine_run(ModelEngine* e, UA_UInt32 count, EngineRangeFn fn, void* ctx) {
+    engine_run_chunked(e, count, e->chunk, fn, ctx);
+}
+
+/**
+ * @brief engine_run() claiming chunk indices per pop instead of the engine's own.
+ *
+ * For runs over few but expensive indices, which the engine's chunk would
+ * keep on one thread. chunk is rounded up to a multiple of 8.
+ */
+void engine_run_chunked(ModelEngine* e, UA_UInt32 count, UA_UInt32 chunk, EngineRangeFn fn,
+    void* ctx) {
+    const UA_UInt32 n = e->workerCount;
+    chunk = align_up(chunk ? chunk : 1);
+
+    for (UA_UInt32 i = 0; i < n; i++) {
+        e->workers[i].chunks = 0;
+        e->workers[i].steals = 0;
+    }
+
+    if (n <= 1 || count <= chunk) {
+        if (count)
+            fn(ctx, 0, 0, count);
+        e->workers[0].chunks = count ? 1 : 0;
+        return;
+    }
+
+    for (UA_UInt32 i = 0; i < n; i++) {
+        UA_UInt32 begin = align_up((UA_UInt32)((UA_UInt64)count * i / n));
+        UA_UInt32 end = align_up((UA_UInt32)((UA_UInt64)count * (i + 1) / n));
+        if (begin > count)
+            begin = count;
+        if (end > count)
+            end = count;
+        atomic_u64_store(&e->workers[i].range, range_pack(begin, end));
+    }
+
+    platform_mutex_lock(&e->lock);
+    e->fn = fn;
+    e->ctx = ctx;
+    e->runChunk = chunk;
+    e->pending = n - 1;
+    e->generation++;
+    platform_cond_broadcast(&e->wake);
+    platform_mutex_unlock(&e->lock);
+
+    engine_work(e, &e->workers[0]);
+
+    platform_mutex_lock(&e->lock);
+    while (e->pending)
+        platform_cond_wait(&e->done, &e->lock);
+    platform_mutex_unlock(&e->lock);
+}
+
+UA_UInt32 engine_worker_count(const ModelEngine* e) {
+    return e->workerCount ? e->workerCount : 1;
+}
+
+UA_UInt32 engine_last_steals(const ModelEngine* e) {
+    UA_UInt32 steals = 0;
+    for (UA_UInt32 i = 0; i < e->workerCount; i++)
+        steals += e->workers[i].steals;
+    return steals;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "platform.h"
+
+/* Upper bound on worker threads, including the thread calling engine_run() */
+#define ENGINE_MAX_WORKERS 64
+
+/*
+ * Processes the index range [begin, end) on behalf of worker `worker`
+ * (0 .. engine_worker_count() - 1). Ranges handed out in one run are
+ * disjoint, so the callback may write per-index data without locking.
+ */
+typedef void (*EngineRangeFn)(void* ctx, UA_UInt32 worker, UA_UInt32 begin, UA_UInt32 end);
+
+typedef struct ModelEngine ModelEngine;
+
+typedef struct {
+    /* Remaining indices of this worker: head in the low, tail in the high half */
+    volatile UA_UInt64 range;
+
+    /* Counters of the last run */
+    UA_UInt32 chunks;
+    UA_UInt32 steals;
+
+    UA_UInt32 index;
+    ModelEngine* engine;
+    PlatformThread thread;
+
+    /* Keeps the ranges of neighbouring workers on separate cache lines */
+    unsigned char pad[64];
+} EngineWorker;
+
+struct ModelEngine {
+    UA_UInt32 workerCount;      /* helper threads + the calling thread */
+    UA_UInt32 chunk;            /* indices claimed per pop, multiple of 8 */
+    EngineWorker* workers;
+
+    PlatformMutex lock;
+    PlatformCond wake;          /* signalled when a run starts or on shutdown */
+    PlatformCond done;          /* signalled when the last helper finishes */
+    UA_UInt32 generation;       /* run counter, guarded by lock */
+    UA_UInt32 pending;          /* helpers still busy, guarded by lock */
+    UA_Boolean stop;
+
+    EngineRangeFn fn;
+    void* ctx;
+    UA_UInt32 runChunk;         /* indices claimed per pop in the current run */
+};
+
+UA_StatusCode engine_init(ModelEngine* e, UA_UInt32 threads, UA_UInt32 chunk);
+void engine_clear(ModelEngine* e);
+void engine_run(ModelEngine* e, UA_UInt32 count, EngineRangeFn fn, void* ctx);
+void engine_run_chunked(ModelEngine* e, UA_UInt32 count, UA_UInt32 chunk, EngineRangeFn fn,
+    void* ctx);
+
+UA_UInt32 engine_worker_count(const ModelEngine* e);
+UA_UInt32 engine_last_steals(const ModelEngine* e);
@@ -0,0 +1,423 @@
+/**
+ * @file estimate.c
+ * @brief Kinetic parameter estimation from recorded operating points.
+ *
+ * estimate_kinetics() fits k01, EA1, k02 and EA2 of one reactor to
+ * samples of (T, F, CA, CB) by nonlinear least squares on the steady-state
+ * model: the residual of a sample is its measured CB minus
+ * compute_CB_rates() at the Arrhenius rates of its temperature. The
+ * samples come from the historian (estimate_data_from_history()) or from
+ * the caller (estimate_data_add()); samples taken during transients of
+ * the dynamic model bias the fit.
+ *
+ * k0 and EA of one reaction are strongly correlated over a narrow band of
+ * temperatures, so the fit works in the centred parameters
+ *
+ *     k(T) = exp(lnKref - e * (Tref / T - 1)),  Tref = mean temperature,
+ *
+ * (rate at Tref, activation energy in units of R * Tref), which are far
+ * better conditioned, and converts back at the end. The solver is
+ * Levenberg-Marquardt with Marquardt's diagonal scaling: each iteration
+ * evaluates the residuals and the analytic Jacobian at every sample,
+ * reduced to the 4x4 normal equations J'J and J'r, and solves
+ * (J'J + lambda diag(J'J)) d = J'r by Cholesky. The sample loop is split
+ * over a ModelEngine (engine.c); every worker sums into a slot of its own
+ * and the slots are added up afterwards, so the evaluation scales with
+ * the cores and nothing is locked.
+ *
+ * The confidence of each parameter is the half-width of its 95 % interval
+ * from the linearized covariance s^2 (J'J)^-1 at the optimum, propagated
+ * to k0 and EA. Parameters the data cannot separate (a single
+ * temperature, say) get an infinite confidence.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "estimate.h"
+#include "historian.h"
+#include "math_model.h"
+
+#define ESTIMATE_T_OFFSET 273.15
+#define ESTIMATE_LAMBDA_START 1e-3
+#define ESTIMATE_LAMBDA_MAX 1e12
+#define ESTIMATE_DEFAULT_EA 50000.0     /* J/mol, start when no guess is given */
+
+/* Index of (r, c), r <= c, in a packed upper triangle of the 4x4 normal matrix */
+#define ESTIMATE_TRI(r, c) ((r) * ESTIMATE_PARAMS - (r) * ((r) - 1) / 2 + (c) - (r))
+#define ESTIMATE_TRI_COUNT (ESTIMATE_PARAMS * (ESTIMATE_PARAMS + 1) / 2)
+
+/* Normal equations summed by one worker */
+typedef struct {
+    UA_Double A[ESTIMATE_TRI_COUNT];    /* J'J */
+    UA_Double g[ESTIMATE_PARAMS];       /* J'r */
+    UA_Double ssr;                      /* sum of squared residuals */
+    UA_UInt32 n;
+    /* Keeps the sums of neighbouring workers on separate cache lines */
+    unsigned char pad[64];
+} EstimateSums;
+
+typedef struct {
+    const EstimateData* d;
+    UA_Double p[ESTIMATE_PARAMS];       /* lnKref1, e1, lnKref2, e2 */
+    UA_Double Tref;
+    EstimateSums sums[ENGINE_MAX_WORKERS];
+} EstimatePass;
+
+UA_StatusCode estimate_data_init(EstimateData* d, UA_UInt32 capacity) {
+    memset(d, 0, sizeof(*d));
+    if (capacity == 0)
+        return UA_STATUSCODE_GOOD;
+    d->arena = UA_malloc((size_t)capacity * 5 * sizeof(UA_Double));
+    if (!d->arena)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    d->capacity = capacity;
+    d->T = (UA_Double*)d->arena;
+    d->F = d->T + capacity;
+    d->CA = d->F + capacity;
+    d->CB = d->CA + capacity;
+    d->volume = d->CB + capacity;
+    return UA_STATUSCODE_GOOD;
+}
+
+void estimate_data_clear(EstimateData* d) {
+    UA_free(d->arena);
+    memset(d, 0, sizeof(*d));
+}
+
+UA_StatusCode estimate_data_add(EstimateData* d, UA_Double T, UA_Double F, UA_Double CA,
+    UA_Double CB, UA_Double volume) {
+    if (d->count == d->capacity)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    const UA_UInt32 i = d->count++;
+    d->T[i] = T;
+    d->F[i] = F;
+    d->CA[i] = CA;
+    d->CB[i] = CB;
+    d->volume[i] = volume;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Samples of tag up to `to`, oldest first; *times and *values are UA_malloc'ed */
+static size_t history_tag(const Historian* h, UA_UInt32 tag, UA_DateTime from, UA_DateTime to,
+    UA_DateTime** times, UA_Double** values) {
+    UA_DateTime next;
+    const size_t n = historian_read(h, tag, from, to, false, 0, NULL, NULL, &next);
+    *times = (UA_DateTime*)UA_malloc((n ? n : 1) * sizeof(UA_DateTime));
+    *values = (UA_Double*)UA_malloc((n ? n : 1) * sizeof(UA_Double));
+    if (!*times || !*values) {
+        UA_free(*times);
+        UA_free(*values);
+        *times = NULL;
+        *values = NULL;
+        return 0;
+    }
+    return historian_read(h, tag, from, to, false, 0, *times, *values, &next);
+}
+
+/**
+ * @brief Collects the operating points of a reactor from the historian.
+ *
+ * One sample per archived CB value with from <= time <= to (0 = open, as
+ * historian_read()); T, F and CA are the last values archived at or before
+ * it, as compression keeps a value until it changes. CB values older than
+ * the first of the others are dropped. volume is the reactor volume in l.
+ */
+UA_StatusCode estimate_data_from_history(EstimateData* d, Historian* h, UA_UInt32 reactor,
+    UA_Double volume, UA_DateTime from, UA_DateTime to) {
+    static const FleetSensor inputs[3] = { FLEET_SENSOR_T, FLEET_SENSOR_F, FLEET_SENSOR_CA };
+    memset(d, 0, sizeof(*d));
+    if (!h->arena || reactor >= h->tagCount / FLEET_SENSOR_COUNT)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    const UA_UInt32 base = reactor * FLEET_SENSOR_COUNT;
+    UA_DateTime* cbTime;
+    UA_Double* cbValue;
+    UA_DateTime* inTime[3] = { NULL, NULL, NULL };
+    UA_Double* inValue[3] = { NULL, NULL, NULL };
+    size_t inCount[3];
+
+    platform_mutex_lock(&h->lock);
+    const size_t n = history_tag(h, base + FLEET_SENSOR_CB, from, to, &cbTime, &cbValue);
+    for (int s = 0; s < 3; s++)
+        inCount[s] = history_tag(h, base + inputs[s], 0, to, &inTime[s], &inValue[s]);
+    platform_mutex_unlock(&h->lock);
+
+    UA_StatusCode rc = cbTime ? estimate_data_init(d, (UA_UInt32)n) : UA_STATUSCODE_BADOUTOFMEMORY;
+    for (int s = 0; s < 3; s++)
+        if (!inTime[s])
+            rc = UA_STATUSCODE_BADOUTOFMEMORY;
+
+    size_t k[3] = { 0, 0, 0 };
+    for (size_t j = 0; rc == UA_STATUSCODE_GOOD && j < n; j++) {
+        UA_Double v[3];
+        UA_Boolean held = true;
+        for (int s = 0; s < 3; s++) {
+            while (k[s] < inCount[s] && inTime[s][k[s]] <= cbTime[j])
+                k[s]++;
+            held = held && k[s] > 0;
+            v[s] = k[s] ? inValue[s][k[s] - 1] : 0.0;
+        }
+        if (held)
+            estimate_data_add(d, v[0], v[1], v[2], cbValue[j], volume);
+    }
+
+    UA_free(cbTime);
+    UA_free(cbValue);
+    for (int s = 0; s < 3; s++) {
+        UA_free(inTime[s]);
+        UA_free(inValue[s]);
+    }
+    if (rc != UA_STATUSCODE_GOOD)
+        estimate_data_clear(d);
+    return rc;
+}
+
+void estimate_default_options(EstimateOptions* opt) {
+    opt->maxIterations = 100;
+    opt->tolerance = 1e-10;
+}
+
+/* Residuals and Jacobian of samples [begin, end) at pass->p, summed into the worker's slot */
+static void estimate_range(void* ctx, UA_UInt32 worker, UA_UInt32 begin, UA_UInt32 end) {
+    EstimatePass* pass = (EstimatePass*)ctx;
+    const EstimateData* d = pass->d;
+    const UA_Double* p = pass->p;
+    EstimateSums* s = &pass->sums[worker];
+
+    for (UA_UInt32 i = begin; i < end; i++) {
+        const double T_K = d->T[i] + ESTIMATE_T_OFFSET;
+        const double Q = d->F[i] * 1e-3 / 60.0;
+        const double Vr = d->volume[i] * 1e-3;
+        if (!(T_K > 0.0) || !isfinite(d->CB[i]))
+            continue;
+
+        const double x = pass->Tref / T_K - 1.0;
+        const double k1 = exp(p[0] - p[1] * x);
+        const double k2 = exp(p[2] - p[3] * x);
+        const double CB = compute_CB_rates(d->F[i], d->CA[i], d->volume[i], k1, k2);
+        if (!isfinite(CB))
+            continue;
+
+        /* dCB/dlnK1 = CB Q / a, dCB/dlnK2 = -CB Vr k2 / b, dlnK/de = -x */
+        double J[ESTIMATE_PARAMS];
+        J[0] = CB * Q / (Vr * k1 + Q);
+        J[1] = -x * J[0];
+        J[2] = -CB * Vr * k2 / (Vr * k2 + Q);
+        J[3] = -x * J[2];
+        const double r = d->CB[i] - CB;
+
+        for (int a = 0; a < ESTIMATE_PARAMS; a++) {
+            for (int b = a; b < ESTIMATE_PARAMS; b++)
+                s->A[ESTIMATE_TRI(a, b)] += J[a] * J[b];
+            s->g[a] += J[a] * r;
+        }
+        s->ssr += r * r;
+        s->n++;
+    }
+}
+
+/* Evaluates the normal equations at pass->p over all samples */
+static void estimate_evaluate(ModelEngine* engine, EstimatePass* pass, EstimateSums* out) {
+    const UA_UInt32 workers = engine ? engine_worker_count(engine) : 1;
+    memset(pass->sums, 0, workers * sizeof(EstimateSums));
+    if (engine)
+        engine_run(engine, pass->d->count, estimate_range, pass);
+    else
+        estimate_range(pass, 0, 0, pass->d->count);
+
+    memset(out, 0, sizeof(*out));
+    for (UA_UInt32 w = 0; w < workers; w++) {
+        const EstimateSums* s = &pass->sums[w];
+        for (int k = 0; k < ESTIMATE_TRI_COUNT; k++)
+            out->A[k] += s->A[k];
+        for (int k = 0; k < ESTIMATE_PARAMS; k++)
+            out->g[k] += s->g[k];
+        out->ssr += s->ssr;
+        out->n += s->n;
+    }
+}
+
+/* Cholesky factor L (row-major, lower) of the packed symmetric A; false if not positive definite */
+static UA_Boolean estimate_cholesky(const UA_Double* A, UA_Double L[ESTIMATE_PARAMS][ESTIMATE_PARAMS]) {
+    memset(L, 0, sizeof(UA_Double) * ESTIMATE_PARAMS * ESTIMATE_PARAMS);
+    for (int i = 0; i < ESTIMATE_PARAMS; i++) {
+        for (int j = 0; j <= i; j++) {
+            double s = A[ESTIMATE_TRI(j, i)];
+            for (int k = 0; k < j; k++)
+                s -= L[i][k] * L[j][k];
+            if (i == j) {
+                if (!(s > 0.0))
+                    return false;
+                L[i][i] = sqrt(s);
+            } else {
+                L[i][j] = s / L[j][j];
+            }
+        }
+    }
+    return true;
+}
+
+/* Solves L L' x = b */
+static void estimate_solve(UA_Double L[ESTIMATE_PARAMS][ESTIMATE_PARAMS], const UA_Double* b,
+    UA_Double* x) {
+    UA_Double y[ESTIMATE_PARAMS];
+    for (int i = 0; i < ESTIMATE_PARAMS; i++) {
+        double s = b[i];
+        for (int k = 0; k < i; k++)
+            s -= L[i][k] * y[k];
+        y[i] = s / L[i][i];
+    }
+    for (int i = ESTIMATE_PARAMS - 1; i >= 0; i--) {
+        double s = y[i];
+        for (int k = i + 1; k < ESTIMATE_PARAMS; k++)
+            s -= L[k][i] * x[k];
+        x[i] = s / L[i][i];
+    }
+}
+
+/* Start of the fit in centred parameters: the guess if complete, else a rate of the order of Q / Vr */
+static void estimate_start(const EstimateData* d, const ConfigMathModel* guess, UA_Double R,
+    UA_Double Tref, UA_Double* p) {
+    const UA_Double RT = R * Tref;
+    if (guess && guess->k01 > 0.0 && guess->k02 > 0.0 && guess->EA1 >= 0.0 && guess->EA2 >= 0.0) {
+        p[1] = guess->EA1 / RT;
+        p[3] = guess->EA2 / RT;
+        p[0] = log(guess->k01 / 60.0) - p[1];
+        p[2] = log(guess->k02 / 60.0) - p[3];
+        return;
+    }
+    double sum = 0.0;
+    UA_UInt32 n = 0;
+    for (UA_UInt32 i = 0; i < d->count; i++) {
+        const double rate = (d->F[i] / 60.0) / d->volume[i];   /* Q / Vr, 1/s */
+        if (rate > 0.0 && isfinite(rate)) {
+            sum += rate;
+            n++;
+        }
+    }
+    const double lnRate = log(n ? sum / n : 1.0);
+    p[0] = lnRate + 1.0;
+    p[2] = lnRate - 1.0;
+    p[1] = p[3] = ESTIMATE_DEFAULT_EA / RT;
+}
+
+/**
+ * @brief Fits the kinetics of one reactor to the samples of d.
+ *
+ * guess is where the fit starts (the current kinetics, say) and supplies
+ * R; without a complete guess it starts from rates of the order of the
+ * residence time and R of 8.314. engine splits the evaluation over its
+ * workers, NULL evaluates on the calling thread. Needs more samples the
+ * model can evaluate than parameters.
+ */
+UA_StatusCode estimate_kinetics(ModelEngine* engine, const EstimateData* d,
+    const ConfigMathModel* guess, const EstimateOptions* opt, EstimateResult* out) {
+    memset(out, 0, sizeof(*out));
+    const UA_Double R = guess && guess->R > 0.0 ? guess->R : 8.314;
+
+    double sumT = 0.0;
+    UA_UInt32 nT = 0;
+    for (UA_UInt32 i = 0; i < d->count; i++) {
+        const double T_K = d->T[i] + ESTIMATE_T_OFFSET;
+        if (T_K > 0.0 && isfinite(T_K) && isfinite(d->CB[i])) {
+            sumT += T_K;
+            nT++;
+        }
+    }
+    if (nT <= ESTIMATE_PARAMS)
+        return UA_STATUSCODE_BADNODATA;
+
+    EstimatePass* pass = (EstimatePass*)UA_malloc(sizeof(EstimatePass));
+    if (!pass)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    pass->d = d;
+    pass->Tref = sumT / nT;
+    estimate_start(d, guess, R, pass->Tref, pass->p);
+
+    EstimateSums cur;
+    EstimateSums trial;
+    estimate_evaluate(engine, pass, &cur);
+    UA_Double lambda = ESTIMATE_LAMBDA_START;
+    UA_Double L[ESTIMATE_PARAMS][ESTIMATE_PARAMS];
+
+    while (cur.n > ESTIMATE_PARAMS && cur.ssr > 0.0 && out->iterations < opt->maxIterations) {
+        out->iterations++;
+        UA_Double M[ESTIMATE_TRI_COUNT];
+        memcpy(M, cur.A, sizeof(M));
+        for (int k = 0; k < ESTIMATE_PARAMS; k++) {
+            const int kk = ESTIMATE_TRI(k, k);
+            M[kk] += lambda * (cur.A[kk] > 0.0 ? cur.A[kk] : 1.0);
+        }
+
+        UA_Double step[ESTIMATE_PARAMS];
+        UA_Double saved[ESTIMATE_PARAMS];
+        UA_Boolean accepted = false;
+        if (estimate_cholesky(M, L)) {
+            estimate_solve(L, cur.g, step);
+            memcpy(saved, pass->p, sizeof(saved));
+            for (int k = 0; k < ESTIMATE_PARAMS; k++)
+                pass->p[k] += step[k];
+            estimate_evaluate(engine, pass, &trial);
+            accepted = trial.n == cur.n && trial.ssr < cur.ssr;
+            if (!accepted)
+                memcpy(pass->p, saved, sizeof(saved));
+        }
+
+        if (!accepted) {
+            lambda *= 10.0;
+            if (lambda > ESTIMATE_LAMBDA_MAX) {
+                out->converged = true;      /* no step decreases the residuals any more */
+                break;
+            }
+            continue;
+        }
+
+        const UA_Double decrease = (cur.ssr - trial.ssr) / cur.ssr;
+        double size = 0.0;
+        for (int k = 0; k < ESTIMATE_PARAMS; k++)
+            size = fmax(size, fabs(step[k]) / (1.0 + fabs(pass->p[k])));
+        cur = trial;
+        lambda = fmax(lambda / 10.0, 1e-15);
+        if (decrease < opt->tolerance || size < opt->tolerance) {
+            out->converged = true;
+            break;
+        }
+    }
+    if (cur.ssr == 0.0)
+        out->converged = true;
+
+    /* Covariance of the centred parameters, s^2 (J'J)^-1 */
+    UA_Double C[ESTIMATE_PARAMS][ESTIMATE_PARAMS];
+    UA_Boolean identified = cur.n > ESTIMATE_PARAMS && estimate_cholesky(cur.A, L);
+    const UA_Double s2 = cur.n > ESTIMATE_PARAMS ? cur.ssr / (cur.n - ESTIMATE_PARAMS) : INFINITY;
+    for (int c = 0; identified && c < ESTIMATE_PARAMS; c++) {
+        UA_Double e[ESTIMATE_PARAMS] = { 0.0, 0.0, 0.0, 0.0 };
+        UA_Double col[ESTIMATE_PARAMS];
+        e[c] = 1.0;
+        estimate_solve(L, e, col);
+        for (int r = 0; r < ESTIMATE_PARAMS; r++)
+            C[r][c] = s2 * col[r];
+    }
+
+    /* Back to k0 = 60 exp(lnKref + e) and EA = e R Tref */
+    const UA_Double RT = R * pass->Tref;
+    const UA_Double* p = pass->p;
+    out->kinetics.k01 = 60.0 * exp(p[0] + p[1]);
+    out->kinetics.EA1 = p[1] * RT;
+    out->kinetics.k02 = 60.0 * exp(p[2] + p[3]);
+    out->kinetics.EA2 = p[3] * RT;
+    out->kinetics.R = R;
+    for (int j = 0; j < 2; j++) {
+        const int l = 2 * j;
+        const UA_Double k0 = j ? out->kinetics.k02 : out->kinetics.k01;
+        const UA_Double varLnK0 = identified ? C[l][l] + 2.0 * C[l][l + 1] + C[l + 1][l + 1] : INFINITY;
+        const UA_Double varE = identified ? C[l + 1][l + 1] : INFINITY;
+        /* k0 underflows when the data drive a rate to zero */
+        out->confidence[l] = k0 > 0.0 ? ESTIMATE_Z95 * k0 * sqrt(fmax(varLnK0, 0.0)) : INFINITY;
+        out->confidence[l + 1] = ESTIMATE_Z95 * RT * sqrt(fmax(varE, 0.0));
+    }
+    out->samples = cur.n;
+    out->rmse = cur.n ? sqrt(cur.ssr / cur.n) : NAN;
+    UA_free(pass);
+    return UA_STATUSCODE_GOOD;
+}
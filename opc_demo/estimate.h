@@ -0,0 +1,49 @@
+#pragma once
+#include <open62541/types.h>
+#include "types.h"
+#include "engine.h"
+
+struct Historian;
+
+/* Fitted parameters: k01, EA1, k02, EA2 */
+#define ESTIMATE_PARAMS 4
+
+/* Two-sided 95 % quantile of the normal distribution */
+#define ESTIMATE_Z95 1.959963984540054
+
+/* Steady-state operating points of one reactor, struct-of-arrays */
+typedef struct {
+    UA_UInt32 count;
+    UA_UInt32 capacity;
+    UA_Double* T;               /* reactor temperature, degC */
+    UA_Double* F;               /* flow rate, l/min */
+    UA_Double* CA;              /* inlet concentration */
+    UA_Double* CB;              /* measured outlet concentration */
+    UA_Double* volume;          /* reactor volume, l */
+    void* arena;
+} EstimateData;
+
+typedef struct {
+    UA_UInt32 maxIterations;
+    UA_Double tolerance;        /* relative decrease of the squared residuals that ends the fit */
+} EstimateOptions;
+
+typedef struct {
+    ConfigMathModel kinetics;   /* fitted k01, EA1, k02, EA2; R as given */
+    UA_Double confidence[ESTIMATE_PARAMS];  /* 95 % half-widths, INFINITY if not identifiable */
+    UA_Double rmse;
+    UA_UInt32 samples;          /* samples the model could evaluate */
+    UA_UInt32 iterations;
+    UA_Boolean converged;
+} EstimateResult;
+
+UA_StatusCode estimate_data_init(EstimateData* d, UA_UInt32 capacity);
+void estimate_data_clear(EstimateData* d);
+UA_StatusCode estimate_data_add(EstimateData* d, UA_Double T, UA_Double F, UA_Double CA,
+    UA_Double CB, UA_Double volume);
+UA_StatusCode estimate_data_from_history(EstimateData* d, struct Historian* h, UA_UInt32 reactor,
+    UA_Double volume, UA_DateTime from, UA_DateTime to);
+
+void estimate_default_options(EstimateOptions* opt);
+UA_StatusCode estimate_kinetics(ModelEngine* engine, const EstimateData* d,
+    const ConfigMathModel* guess, const EstimateOptions* opt, EstimateResult* out);
@@ -0,0 +1,300 @@
+﻿/**
+ * @file fleet.c
+ * @brief Reactor registry with struct-of-arrays storage.
+ *
+ * The fleet replaces the former global Reactor / Sensor / ValveHandleControl
+ * singletons. All per-reactor fields are stored in separate contiguous
+ * arrays that are carved out of one arena allocation:
+ *
+ *   - fleet_init()        allocates the arena for `capacity` reactors;
+ *   - fleet_add_reactor() hands out the next free index and applies the
+ *                         defaults from fleet_reactor_init();
+ *   - fleet_clear()       releases the arena and the custom valve
+ *                         characteristics its valves still refer to.
+ *
+ * The sensor values seen by OPC UA clients are published through two
+ * snapshot copies (FleetSnapshot). A model tick brackets its writes with
+ * fleet_publish_begin() / fleet_publish_end(), copies each stepped range
+ * with fleet_publish_range() and flips the front copy at the end.
+ * fleet_pin() copies a whole tick to the view of the server thread, and
+ * the server serves every sensor from that view: the DataSource callbacks
+ * read it through fleet_read_pv(), which pins once per server iteration
+ * (server_loop_iterations()), and the push sensors are published from it.
+ * A Read request, or one round of monitored item samples, is handled
+ * within one iteration, so a client reads all sensors of one tick.
+ *
+ * A whole kinetic configuration can be staged with fleet_stage_kinetics()
+ * instead of writing its fields one by one; the model swaps all staged
+ * configurations in at the start of its next tick (fleet_apply_staged()),
+ * so no tick sees some of the new values and some of the old.
+ *
+ * Reactors are never removed, so indices stay stable for the lifetime of
+ * the fleet and may be used as OPC UA node contexts.
+ */
+
+#include <string.h>
+#include "fleet.h"
+#include "init.h"
+#include "platform.h"
+#include "server_loop.h"
+#include "valve_curve.h"
+
+/**
+ * @brief Reserves `bytes` from the arena cursor, aligned to a cache line.
+ *
+ * When base is NULL only the cursor is advanced, which lets the same
+ * layout routine compute the total arena size.
+ */
+static void* arena_take(unsigned char* base, size_t* cursor, size_t bytes) {
+    size_t off = (*cursor + FLEET_ARENA_ALIGN - 1) & ~(size_t)(FLEET_ARENA_ALIGN - 1);
+    *cursor = off + bytes;
+    return base ? base + off : NULL;
+}
+
+/**
+ * @brief Assigns every fleet array to its slice of the arena.
+ *
+ * @return number of bytes the layout occupies.
+ */
+static size_t fleet_layout(ReactorFleet* f, unsigned char* base) {
+    const size_t n = f->capacity;
+    size_t cur = 0;
+
+    f->volume = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->k01 = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->EA1 = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->k02 = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->EA2 = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->R = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->substanceId = arena_take(base, &cur, n * sizeof(UA_UInt32));
+    f->inputDirty = arena_take(base, &cur, n * sizeof(UA_Byte));
+
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++)
+        f->manualoutput[v] = arena_take(base, &cur, n * sizeof(UA_Double));
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++)
+        f->valveCurve[v] = arena_take(base, &cur, n * sizeof(UA_UInt32));
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+        f->pv[s] = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->cbResult = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->rateK1 = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->rateK2 = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->rateT = arena_take(base, &cur, n * sizeof(UA_Double));
+
+    f->stateCA = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->stateCB = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->odeStep = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->odeError = arena_take(base, &cur, n * sizeof(UA_Double));
+    f->odeSteps = arena_take(base, &cur, n * sizeof(UA_UInt32));
+
+    /* Written once per tick by the model, read by the server thread */
+    for (int b = 0; b < 2; b++) {
+        for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+            f->snapshot[b].pv[s] = arena_take(base, &cur, n * sizeof(UA_Double));
+    }
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+        f->view.pv[s] = arena_take(base, &cur, n * sizeof(UA_Double));
+
+    /* Cold data last so it does not share lines with the hot streams */
+    f->reactorObjId = arena_take(base, &cur, n * sizeof(UA_NodeId));
+    f->modelObjId = arena_take(base, &cur, n * sizeof(UA_NodeId));
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+        f->sensorObjId[s] = arena_take(base, &cur, n * sizeof(UA_NodeId));
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++)
+        f->valveObjId[v] = arena_take(base, &cur, n * sizeof(UA_NodeId));
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+        f->sensorSlot[s] = arena_take(base, &cur, n * sizeof(FleetSlot));
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++)
+        f->valveSlot[v] = arena_take(base, &cur, n * sizeof(FleetSlot));
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+        f->publish[s] = arena_take(base, &cur, n * sizeof(SensorPublish));
+    f->stagedKinetics = arena_take(base, &cur, n * sizeof(FleetKinetics));
+    f->stagedIndex = arena_take(base, &cur, n * sizeof(UA_UInt32));
+    f->kineticsStaged = arena_take(base, &cur, n * sizeof(UA_Byte));
+    f->substanceApplied = arena_take(base, &cur, n * sizeof(UA_UInt32));
+
+    return cur;
+}
+
+UA_StatusCode fleet_init(ReactorFleet* f, UA_UInt32 capacity) {
+    memset(f, 0, sizeof(*f));
+    if (capacity == 0)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    valve_curve_init();
+
+    f->capacity = capacity;
+    const size_t bytes = fleet_layout(f, NULL);
+
+    /* Over-allocate so the first array can be aligned by hand */
+    void* raw = UA_calloc(1, bytes + FLEET_ARENA_ALIGN);
+    if (!raw) {
+        memset(f, 0, sizeof(*f));
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    uintptr_t aligned = ((uintptr_t)raw + FLEET_ARENA_ALIGN - 1) &
+        ~(uintptr_t)(FLEET_ARENA_ALIGN - 1);
+    f->arena = raw;
+    fleet_layout(f, (unsigned char*)aligned);
+    return UA_STATUSCODE_GOOD;
+}
+
+void fleet_clear(ReactorFleet* f) {
+    if (!f->arena)
+        return;
+    for (UA_UInt32 i = 0; i < f->count; i++) {
+        UA_NodeId_clear(&f->reactorObjId[i]);
+        UA_NodeId_clear(&f->modelObjId[i]);
+        for (int s = 0; s < FLEET_SENSOR_COUNT; s++) {
+            UA_NodeId_clear(&f->sensorObjId[s][i]);
+            UA_NodeId_clear(&f->publish[s][i].valueId);
+        }
+        for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+            UA_NodeId_clear(&f->valveObjId[v][i]);
+            valve_curve_release(f->valveCurve[v][i]);
+        }
+    }
+    UA_free(f->arena);
+    memset(f, 0, sizeof(*f));
+}
+
+UA_StatusCode fleet_add_reactor(ReactorFleet* f, UA_UInt32* outIndex) {
+    if (f->count >= f->capacity)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    const UA_UInt32 i = f->count++;
+    fleet_reactor_init(f, i);
+    if (outIndex)
+        *outIndex = i;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Opens the back snapshot for writing by the current tick.
+ *
+ * Must be followed by fleet_publish_end(); only one tick may publish at
+ * a time.
+ */
+void fleet_publish_begin(ReactorFleet* f) {
+    FleetSnapshot* back = &f->snapshot[atomic_u32_load(&f->snapshotFront) ^ 1u];
+    atomic_u64_store(&back->seq, back->seq + 1);      /* odd: being written */
+    atomic_fence();
+}
+
+/**
+ * @brief Copies the stepped sensor values of [begin, end) into the back snapshot.
+ *
+ * Called by every worker for the ranges it stepped; ranges are disjoint.
+ */
+void fleet_publish_range(ReactorFleet* f, UA_UInt32 begin, UA_UInt32 end) {
+    FleetSnapshot* back = &f->snapshot[atomic_u32_load(&f->snapshotFront) ^ 1u];
+    if (end <= begin)
+        return;
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+        memcpy(back->pv[s] + begin, f->pv[s] + begin, (end - begin) * sizeof(UA_Double));
+}
+
+/**
+ * @brief Stamps the back snapshot with the tick time and makes it the front.
+ */
+void fleet_publish_end(ReactorFleet* f, UA_DateTime tickTime) {
+    const UA_UInt32 b = atomic_u32_load(&f->snapshotFront) ^ 1u;
+    FleetSnapshot* back = &f->snapshot[b];
+    back->tickTime = tickTime;
+    back->tick = f->snapshot[b ^ 1u].tick + 1;
+    atomic_fence();
+    atomic_u64_store(&back->seq, back->seq + 1);      /* even: complete */
+    atomic_u32_store(&f->snapshotFront, b);
+}
+
+/**
+ * @brief Reads one published sensor value without taking a lock.
+ *
+ * Returns the value of the tick pinned for the current server iteration
+ * together with its tick time (0 before the first tick). The first read
+ * of an iteration pins the last completed tick (fleet_pin()); outside of
+ * server_loop_run() every read does. Server thread only.
+ */
+void fleet_read_pv(ReactorFleet* f, FleetSensor sensor, UA_UInt32 index,
+    UA_Double* value, UA_DateTime* tickTime)
+{
+    const UA_UInt64 iteration = server_loop_iterations();
+    if (iteration == 0 || iteration != f->viewIteration) {
+        fleet_pin(f);
+        f->viewIteration = iteration;
+    }
+    *value = f->view.pv[sensor][index];
+    if (tickTime)
+        *tickTime = f->view.tickTime;
+}
+
+/**
+ * @brief Copies the front snapshot to the view of the server thread.
+ *
+ * Copies only when the model completed a tick since the view was taken,
+ * and retries when the model overwrote the copy meanwhile, so the view
+ * always holds every sensor of one tick. Server thread only.
+ *
+ * @return true if the view moved on to a newer tick.
+ */
+UA_Boolean fleet_pin(ReactorFleet* f) {
+    for (;;) {
+        const FleetSnapshot* snap = &f->snapshot[atomic_u32_load(&f->snapshotFront)];
+        const UA_UInt64 seq = atomic_u64_load(&snap->seq);
+        if (seq & 1u)
+            continue;
+
+        const UA_UInt64 tick = snap->tick;
+        const UA_DateTime t = snap->tickTime;
+        const UA_Boolean fresh = tick != f->view.tick;
+        if (fresh) {
+            for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+                memcpy(f->view.pv[s], snap->pv[s], f->count * sizeof(UA_Double));
+        }
+        atomic_fence();
+        if (atomic_u64_load(&snap->seq) != seq)
+            continue;
+
+        f->view.tick = tick;
+        f->view.tickTime = t;
+        return fresh;
+    }
+}
+
+/**
+ * @brief Stages the kinetic configuration of reactor i for the next tick.
+ *
+ * Staging the same reactor again before that tick replaces the values.
+ * Not synchronized with the model: callers on another thread than the
+ * model's hold the model thread's lock.
+ */
+void fleet_stage_kinetics(ReactorFleet* f, UA_UInt32 i, const FleetKinetics* k) {
+    if (!f->kineticsStaged[i]) {
+        f->kineticsStaged[i] = 1;
+        f->stagedIndex[f->stagedCount++] = i;
+    }
+    f->stagedKinetics[i] = *k;
+}
+
+/**
+ * @brief Swaps the staged kinetic configurations in; returns the reactors changed.
+ */
+UA_UInt32 fleet_apply_staged(ReactorFleet* f) {
+    const UA_UInt32 n = f->stagedCount;
+    for (UA_UInt32 s = 0; s < n; s++) {
+        const UA_UInt32 i = f->stagedIndex[s];
+        const FleetKinetics* k = &f->stagedKinetics[i];
+        f->k01[i] = k->config.k01;
+        f->EA1[i] = k->config.EA1;
+        f->k02[i] = k->config.k02;
+        f->EA2[i] = k->config.EA2;
+        f->R[i] = k->config.R;
+        f->substanceId[i] = k->substanceId;
+        /* Explicit kinetics win over the library until SUBSTANCE_ID changes */
+        f->substanceApplied[i] = k->substanceId;
+        f->inputDirty[i] |= FLEET_DIRTY_KINETICS;
+        f->kineticsStaged[i] = 0;
+    }
+    f->stagedCount = 0;
+    return n;
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+#include "types.h"
+
+/* Arrays inside the fleet arena start on a cache line boundary */
+#define FLEET_ARENA_ALIGN 64
+
+UA_StatusCode fleet_init(ReactorFleet* f, UA_UInt32 capacity);
+void fleet_clear(ReactorFleet* f);
+UA_StatusCode fleet_add_reactor(ReactorFleet* f, UA_UInt32* outIndex);
+
+void fleet_publish_begin(ReactorFleet* f);
+void fleet_publish_range(ReactorFleet* f, UA_UInt32 begin, UA_UInt32 end);
+void fleet_publish_end(ReactorFleet* f, UA_DateTime tickTime);
+void fleet_read_pv(ReactorFleet* f, FleetSensor sensor, UA_UInt32 index,
+    UA_Double* value, UA_DateTime* tickTime);
+UA_Boolean fleet_pin(ReactorFleet* f);
+
+void fleet_stage_kinetics(ReactorFleet* f, UA_UInt32 i, const FleetKinetics* k);
+UA_UInt32 fleet_apply_staged(ReactorFleet* f);
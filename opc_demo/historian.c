@@ -0,0 +1,419 @@
+/**
+ * @file historian.c
+ * @brief In-memory sample history of the sensors, served through HistoryRead.
+ *
+ * The historian keeps the recent samples of every sensor of the fleet
+ * (FRA-1, TRA-1, CRA-1 and CRA-2 of each reactor) in fixed-size ring
+ * buffers, one per tag, carved out of a single arena allocated by
+ * historian_init(). Nothing is allocated while recording; when a ring is
+ * full the oldest sample is overwritten.
+ *
+ * historian_record() runs after each model tick and offers the values of
+ * the published snapshot to historian_add(), which archives them subject
+ * to the configured compression:
+ *
+ *   - HISTORY_COMPRESSION_NONE:          every sample;
+ *   - HISTORY_COMPRESSION_DEADBAND:      samples deviating from the last
+ *                                        archived one by more than the
+ *                                        deviation;
+ *   - HISTORY_COMPRESSION_SWINGING_DOOR: the classic swinging door
+ *     trending algorithm. A corridor of +-deviation around the line from
+ *     the last archived sample narrows with every new sample; when it
+ *     closes, the previous sample is archived and becomes the new pivot.
+ *
+ * The newest sample is always kept in the tag, archived or not, and reads
+ * return it after the archived ones, so the history reaches up to the
+ * current value even when compression held samples back.
+ *
+ * historian_database() wraps the historian as the server's
+ * UA_HistoryDatabase (open62541 built with UA_ENABLE_HISTORIZING).
+ * HistoryRead of raw values is answered straight from the rings for
+ * PROCESS_VALUE nodes, identified by their NodeBinding; reads longer than
+ * numValuesPerNode return a continuation point holding the timestamp to
+ * resume at. Modified, processed, at-time and event reads are not
+ * supported. historian_record() and HistoryRead hold the historian's
+ * lock, so the model may record on a thread of its own (model_thread.c).
+ */
+
+#include <string.h>
+#include <math.h>
+#include "historian.h"
+#include "binding.h"
+#include "fleet.h"
+
+UA_StatusCode historian_init(Historian* h, UA_UInt32 reactors, UA_UInt32 depth,
+    HistoryCompression compression, UA_Double deviation) {
+    memset(h, 0, sizeof(*h));
+    if (reactors == 0 || depth == 0)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    const size_t tags = (size_t)reactors * FLEET_SENSOR_COUNT;
+    const size_t samples = tags * depth;
+    h->arena = UA_calloc(1, tags * sizeof(HistoryTag) +
+        samples * (sizeof(UA_DateTime) + sizeof(UA_Double)));
+    if (!h->arena)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    h->depth = depth;
+    h->tagCount = (UA_UInt32)tags;
+    h->compression = compression;
+    h->deviation = deviation;
+    h->time = (UA_DateTime*)h->arena;
+    h->value = (UA_Double*)(h->time + samples);
+    h->tags = (HistoryTag*)(h->value + samples);
+    platform_mutex_init(&h->lock);
+    return UA_STATUSCODE_GOOD;
+}
+
+void historian_clear(Historian* h) {
+    if (h->arena)
+        platform_mutex_destroy(&h->lock);
+    UA_free(h->arena);
+    memset(h, 0, sizeof(*h));
+}
+
+/**
+ * @brief Memory held per tag: its ring slots and its state.
+ */
+size_t historian_tag_bytes(const Historian* h) {
+    return sizeof(HistoryTag) + (size_t)h->depth * (sizeof(UA_DateTime) + sizeof(UA_Double));
+}
+
+static void tag_archive(Historian* h, UA_UInt32 tag, UA_DateTime time, UA_Double value) {
+    HistoryTag* g = &h->tags[tag];
+    const size_t slot = (size_t)tag * h->depth + g->head;
+    h->time[slot] = time;
+    h->value[slot] = value;
+    g->head = (g->head + 1 == h->depth) ? 0 : g->head + 1;
+    if (g->count < h->depth)
+        g->count++;
+    g->archived++;
+    g->slopeLow = -INFINITY;
+    g->slopeHigh = INFINITY;
+}
+
+/* Newest archived sample; only valid while count > 0 */
+static void tag_pivot(const Historian* h, UA_UInt32 tag, UA_DateTime* time, UA_Double* value) {
+    const HistoryTag* g = &h->tags[tag];
+    const size_t slot = (size_t)tag * h->depth + (g->head ? g->head - 1 : h->depth - 1);
+    *time = h->time[slot];
+    *value = h->value[slot];
+}
+
+/**
+ * @brief Offers one sample of a tag to the historian.
+ *
+ * Samples not newer than the last one are ignored. Non-finite values are
+ * always archived, as is the first sample of a tag.
+ */
+void historian_add(Historian* h, UA_UInt32 tag, UA_DateTime time, UA_Double value) {
+    HistoryTag* g = &h->tags[tag];
+    if (g->received && time <= g->lastTime)
+        return;
+    g->received++;
+
+    const UA_DateTime prevTime = g->lastTime;
+    const UA_Double prevValue = g->lastValue;
+    const UA_Boolean prevPending = g->pending;
+    g->lastTime = time;
+    g->lastValue = value;
+    g->pending = false;
+
+    if (g->count == 0 || h->compression == HISTORY_COMPRESSION_NONE || !isfinite(value)) {
+        tag_archive(h, tag, time, value);
+        return;
+    }
+
+    UA_DateTime pivotTime;
+    UA_Double pivotValue;
+    tag_pivot(h, tag, &pivotTime, &pivotValue);
+
+    if (h->compression == HISTORY_COMPRESSION_DEADBAND || !isfinite(pivotValue)) {
+        if (!(fabs(value - pivotValue) <= h->deviation))
+            tag_archive(h, tag, time, value);
+        else
+            g->pending = true;
+        return;
+    }
+
+    /* Swinging door: slopes in value per second from the pivot */
+    double dt = (double)(time - pivotTime) / UA_DATETIME_SEC;
+    double low = (value - h->deviation - pivotValue) / dt;
+    double high = (value + h->deviation - pivotValue) / dt;
+    if (low > g->slopeLow)
+        g->slopeLow = low;
+    if (high < g->slopeHigh)
+        g->slopeHigh = high;
+
+    if (g->slopeLow > g->slopeHigh && prevPending) {
+        /* Corridor closed: the previous sample ends the segment */
+        tag_archive(h, tag, prevTime, prevValue);
+        dt = (double)(time - prevTime) / UA_DATETIME_SEC;
+        g->slopeLow = (value - h->deviation - prevValue) / dt;
+        g->slopeHigh = (value + h->deviation - prevValue) / dt;
+    }
+    g->pending = true;
+}
+
+/**
+ * @brief Records the published values of the fleet's last tick.
+ *
+ * Does nothing if that tick has already been recorded.
+ */
+void historian_record(Historian* h, const ReactorFleet* f) {
+    const FleetSnapshot* snap = &f->snapshot[f->snapshotFront];
+    if (snap->tick == 0 || snap->tick == h->lastTick)
+        return;
+
+    platform_mutex_lock(&h->lock);
+    h->lastTick = snap->tick;
+
+    UA_UInt32 reactors = h->tagCount / FLEET_SENSOR_COUNT;
+    if (reactors > f->count)
+        reactors = f->count;
+    for (UA_UInt32 i = 0; i < reactors; i++) {
+        for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+            historian_add(h, i * FLEET_SENSOR_COUNT + (UA_UInt32)s, snap->tickTime, snap->pv[s][i]);
+    }
+    platform_mutex_unlock(&h->lock);
+}
+
+/* Samples of a tag in time order: the archived ones, then the pending one */
+static UA_UInt32 tag_length(const HistoryTag* g) {
+    return g->count + (g->pending ? 1 : 0);
+}
+
+static void tag_sample(const Historian* h, UA_UInt32 tag, UA_UInt32 k,
+    UA_DateTime* time, UA_Double* value) {
+    const HistoryTag* g = &h->tags[tag];
+    if (k == g->count) {
+        *time = g->lastTime;
+        *value = g->lastValue;
+        return;
+    }
+    UA_UInt32 slot = g->head + h->depth - g->count + k;
+    if (slot >= h->depth)
+        slot -= h->depth;
+    *time = h->time[(size_t)tag * h->depth + slot];
+    *value = h->value[(size_t)tag * h->depth + slot];
+}
+
+/* First sample k with time > t (strict) or >= t */
+static UA_UInt32 tag_search(const Historian* h, UA_UInt32 tag, UA_DateTime t, UA_Boolean strict) {
+    UA_UInt32 lo = 0, hi = tag_length(&h->tags[tag]);
+    while (lo < hi) {
+        const UA_UInt32 mid = lo + (hi - lo) / 2;
+        UA_DateTime mt;
+        UA_Double mv;
+        tag_sample(h, tag, mid, &mt, &mv);
+        if (strict ? (mt <= t) : (mt < t))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief Copies the samples of a tag within a time range.
+ *
+ * Forward reads return samples with from <= time <= to, oldest first;
+ * reverse reads those with to <= time <= from, newest first. A zero from
+ * starts at the oldest (forward) or newest (reverse) sample, a zero to
+ * leaves the range open. At most maxValues samples are returned (0 = no
+ * limit); if more follow, *next receives the time to continue from,
+ * otherwise 0. times and values may be NULL to only count.
+ *
+ * @return number of samples returned.
+ */
+size_t historian_read(const Historian* h, UA_UInt32 tag, UA_DateTime from, UA_DateTime to,
+    UA_Boolean reverse, size_t maxValues, UA_DateTime* times, UA_Double* values,
+    UA_DateTime* next) {
+
+    const UA_UInt32 length = tag_length(&h->tags[tag]);
+    size_t n = 0;
+    UA_DateTime t;
+    UA_Double v;
+    *next = 0;
+
+    if (!reverse) {
+        for (UA_UInt32 k = from ? tag_search(h, tag, from, false) : 0; k < length; k++) {
+            tag_sample(h, tag, k, &t, &v);
+            if (to && t > to)
+                break;
+            if (maxValues && n == maxValues) {
+                *next = t;
+                break;
+            }
+            if (times) {
+                times[n] = t;
+                values[n] = v;
+            }
+            n++;
+        }
+        return n;
+    }
+
+    for (UA_UInt32 k = from ? tag_search(h, tag, from, true) : length; k-- > 0; ) {
+        tag_sample(h, tag, k, &t, &v);
+        if (to && t < to)
+            break;
+        if (maxValues && n == maxValues) {
+            *next = t;
+            break;
+        }
+        if (times) {
+            times[n] = t;
+            values[n] = v;
+        }
+        n++;
+    }
+    return n;
+}
+
+#ifdef UA_ENABLE_HISTORIZING
+
+/* Continuation point of a raw read: where and in which direction to resume */
+typedef struct {
+    UA_DateTime from;
+    UA_Byte reverse;
+} HistoryContinuation;
+
+/**
+ * @brief Maps a PROCESS_VALUE node to its tag through the node's binding.
+ */
+static UA_Boolean historian_tag_of(UA_Server* server, const Historian* h,
+    const UA_NodeId* nodeId, UA_UInt32* tag) {
+    void* context = NULL;
+    if (UA_Server_getNodeContext(server, *nodeId, &context) != UA_STATUSCODE_GOOD ||
+        !context || !binding_owns(context))
+        return false;
+
+    const NodeBinding* b = (const NodeBinding*)context;
+    if (b->kind != BINDING_SENSOR)
+        return false;
+    const FleetSlot* slot = (const FleetSlot*)b->field;
+    *tag = slot->index * FLEET_SENSOR_COUNT + slot->field;
+    return *tag < h->tagCount;
+}
+
+/**
+ * @brief Answers one node of a raw HistoryRead.
+ */
+static UA_StatusCode historian_read_node(UA_Server* server, const Historian* h,
+    const UA_ReadRawModifiedDetails* details, UA_TimestampsToReturn timestamps,
+    const UA_HistoryReadValueId* node, UA_HistoryReadResult* result, UA_HistoryData* data) {
+
+    UA_UInt32 tag;
+    if (!historian_tag_of(server, h, &node->nodeId, &tag))
+        return UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
+    if (!details->startTime && !details->endTime)
+        return UA_STATUSCODE_BADHISTORYOPERATIONINVALID;
+
+    /* Without a start time, or with the start after the end, read backwards */
+    HistoryContinuation cp;
+    cp.reverse = !details->startTime || (details->endTime && details->startTime > details->endTime);
+    cp.from = details->startTime ? details->startTime : details->endTime;
+    const UA_DateTime to = details->startTime ? details->endTime : 0;
+
+    if (node->continuationPoint.length) {
+        if (node->continuationPoint.length != sizeof(cp))
+            return UA_STATUSCODE_BADCONTINUATIONPOINTINVALID;
+        memcpy(&cp, node->continuationPoint.data, sizeof(cp));
+    }
+
+    UA_DateTime next;
+    const size_t n = historian_read(h, tag, cp.from, to, cp.reverse,
+        details->numValuesPerNode, NULL, NULL, &next);
+    if (n == 0)
+        return UA_STATUSCODE_GOODNODATA;
+
+    UA_DateTime* times = (UA_DateTime*)UA_malloc(n * (sizeof(UA_DateTime) + sizeof(UA_Double)));
+    UA_DataValue* dv = (UA_DataValue*)UA_Array_new(n, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    if (!times || !dv) {
+        UA_free(times);
+        UA_Array_delete(dv, n, &UA_TYPES[UA_TYPES_DATAVALUE]);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    UA_Double* values = (UA_Double*)(times + n);
+    historian_read(h, tag, cp.from, to, cp.reverse, details->numValuesPerNode, times, values, &next);
+
+    UA_StatusCode rc = UA_STATUSCODE_GOOD;
+    for (size_t k = 0; k < n && rc == UA_STATUSCODE_GOOD; k++) {
+        rc = UA_Variant_setScalarCopy(&dv[k].value, &values[k], &UA_TYPES[UA_TYPES_DOUBLE]);
+        dv[k].hasValue = true;
+        if (timestamps == UA_TIMESTAMPSTORETURN_SOURCE || timestamps == UA_TIMESTAMPSTORETURN_BOTH) {
+            dv[k].sourceTimestamp = times[k];
+            dv[k].hasSourceTimestamp = true;
+        }
+        if (timestamps == UA_TIMESTAMPSTORETURN_SERVER || timestamps == UA_TIMESTAMPSTORETURN_BOTH) {
+            dv[k].serverTimestamp = times[k];
+            dv[k].hasServerTimestamp = true;
+        }
+    }
+    UA_free(times);
+
+    if (rc == UA_STATUSCODE_GOOD && next) {
+        cp.from = next;
+        rc = UA_ByteString_allocBuffer(&result->continuationPoint, sizeof(cp));
+        if (rc == UA_STATUSCODE_GOOD)
+            memcpy(result->continuationPoint.data, &cp, sizeof(cp));
+    }
+    if (rc != UA_STATUSCODE_GOOD) {
+        UA_Array_delete(dv, n, &UA_TYPES[UA_TYPES_DATAVALUE]);
+        return rc;
+    }
+
+    data->dataValues = dv;
+    data->dataValuesSize = n;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void historian_read_raw(UA_Server* server, void* hdbContext,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_RequestHeader* requestHeader,
+    const UA_ReadRawModifiedDetails* historyReadDetails,
+    UA_TimestampsToReturn timestampsToReturn,
+    UA_Boolean releaseContinuationPoints,
+    size_t nodesToReadSize, const UA_HistoryReadValueId* nodesToRead,
+    UA_HistoryReadResponse* response, UA_HistoryData* const* const historyData) {
+
+    (void)sessionId;
+    (void)sessionContext;
+    (void)requestHeader;
+
+    Historian* h = (Historian*)hdbContext;
+    platform_mutex_lock(&h->lock);
+    for (size_t i = 0; i < nodesToReadSize && i < response->resultsSize; i++) {
+        UA_HistoryReadResult* result = &response->results[i];
+        if (releaseContinuationPoints)
+            result->statusCode = UA_STATUSCODE_GOOD;
+        else if (historyReadDetails->isReadModified)
+            result->statusCode = UA_STATUSCODE_BADHISTORYOPERATIONUNSUPPORTED;
+        else
+            result->statusCode = historian_read_node(server, h, historyReadDetails,
+                timestampsToReturn, &nodesToRead[i], result, historyData[i]);
+    }
+    platform_mutex_unlock(&h->lock);
+}
+
+static void historian_database_clear(UA_HistoryDatabase* hdb) {
+    /* The historian is owned by main() and cleared after the server */
+    hdb->context = NULL;
+}
+
+/**
+ * @brief History backend answering raw reads from the historian.
+ *
+ * Assign to UA_ServerConfig::historyDatabase; h must outlive the server.
+ */
+UA_HistoryDatabase historian_database(Historian* h) {
+    UA_HistoryDatabase hdb;
+    memset(&hdb, 0, sizeof(hdb));
+    hdb.context = h;
+    hdb.clear = historian_database_clear;
+    hdb.readRaw = historian_read_raw;
+    return hdb;
+}
+
+#endif /* UA_ENABLE_HISTORIZING */
@@ -0,0 +1,57 @@
+#pragma once
+#include <open62541/server.h>
+#include "types.h"
+#include "platform.h"
+
+#ifdef UA_ENABLE_HISTORIZING
+#include <open62541/plugin/historydatabase.h>
+#endif
+
+/* Ring buffer and compression state of one sensor (tag) */
+typedef struct {
+    UA_UInt32 head;             /* next ring slot to write */
+    UA_UInt32 count;            /* archived samples in the ring */
+    UA_Boolean pending;         /* newest sample not archived (yet) */
+    UA_DateTime lastTime;       /* newest sample, archived or not */
+    UA_Double lastValue;
+    UA_Double slopeLow;         /* swinging door corridor from the newest archived sample */
+    UA_Double slopeHigh;
+    UA_UInt64 received;
+    UA_UInt64 archived;
+} HistoryTag;
+
+/*
+ * Sample history of every sensor of a fleet.
+ *
+ * Tag i * FLEET_SENSOR_COUNT + s is sensor s of reactor i. Each tag owns
+ * `depth` slots of the time and value arrays, allocated once in an arena.
+ */
+typedef struct Historian {
+    UA_UInt32 depth;
+    UA_UInt32 tagCount;
+    HistoryCompression compression;
+    UA_Double deviation;
+    UA_UInt64 lastTick;         /* fleet snapshot recorded last */
+    PlatformMutex lock;         /* recording vs. HistoryRead on another thread */
+
+    HistoryTag* tags;
+    UA_DateTime* time;
+    UA_Double* value;
+    void* arena;
+} Historian;
+
+UA_StatusCode historian_init(Historian* h, UA_UInt32 reactors, UA_UInt32 depth,
+    HistoryCompression compression, UA_Double deviation);
+void historian_clear(Historian* h);
+size_t historian_tag_bytes(const Historian* h);
+
+void historian_add(Historian* h, UA_UInt32 tag, UA_DateTime time, UA_Double value);
+void historian_record(Historian* h, const ReactorFleet* f);
+
+size_t historian_read(const Historian* h, UA_UInt32 tag, UA_DateTime from, UA_DateTime to,
+    UA_Boolean reverse, size_t maxValues, UA_DateTime* times, UA_Double* values,
+    UA_DateTime* next);
+
+#ifdef UA_ENABLE_HISTORIZING
+UA_HistoryDatabase historian_database(Historian* h);
+#endif
@@ -1,56 +1,84 @@
 ﻿/**
  * @file init.c
- * @brief Initialization helpers for reactor, sensors, valves and model context.
+ * @brief Default values for a reactor slot of the fleet.
  *
- * This module provides utility functions to initialize the basic data
- * structures used by the OPC UA server and the mathematical model:
+ * fleet_reactor_init() puts one reactor of a ReactorFleet into its initial
+ * state:
  *
- *   - reactor_init() sets a default reactor volume and clears its OPC UA NodeId.
- *   - valve_handle_control_init() resets valve handle control state and NodeId.
- *   - sensor_init() clears sensor process value and NodeId.
- *   - model_init() wires together all pointers in ModelCtx and sets default
- *     kinetic parameters (R, k01, k02, EA1, EA2) and the substance ID.
+ *   - reactor volume is set to its default and the object NodeIds are cleared;
+ *   - valves are closed and use their default characteristic, the valve
+ *     node contexts (FleetSlot) are pointed at this reactor;
+ *   - sensor process values and both published
+ *     snapshots of them are reset to zero, and the sensor node contexts
+ *     (FleetSlot) are pointed at this reactor;
+ *   - sensors start in poll mode without deadband and with zeroed push
+ *     counters;
+ *   - kinetic parameters (R, k01, k02, EA1, EA2) and the substance ID get
+ *     their defaults, and all inputs are flagged dirty with no cached
+ *     rate constants;
+ *   - the dynamic model state and integrator statistics are cleared.
  *
- * All functions only initialize existing objects provided by the caller;
- * they do not allocate or free memory.
+ * The function only initializes storage that already belongs to the fleet;
+ * it does not allocate or free memory.
  */
 
+#include <math.h>
 #include "init.h"
+#include "valve_curve.h"
 
-void reactor_init(Reactor* r) {
-    r->objId = UA_NODEID_NULL;
-    r->volume = 100;
-}
+void fleet_reactor_init(ReactorFleet* f, UA_UInt32 i) {
+    f->reactorObjId[i] = UA_NODEID_NULL;
+    f->modelObjId[i] = UA_NODEID_NULL;
+    f->volume[i] = 100;
 
-void valve_handle_control_init(ValveHandleControl* vhc) {
-    vhc->objId = UA_NODEID_NULL;
-    vhc->manualoutput = 0.0;
-}
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+        f->valveObjId[v][i] = UA_NODEID_NULL;
+        f->manualoutput[v][i] = 0.0;
+        f->valveCurve[v][i] = valve_curve_builtin((FleetValve)v, VALVE_CHAR_DEFAULT);
+        f->valveSlot[v][i].fleet = f;
+        f->valveSlot[v][i].index = i;
+        f->valveSlot[v][i].field = (UA_UInt32)v;
+    }
 
-void sensor_init(Sensor* s) {
-    s->objId = UA_NODEID_NULL;
-    s->pv = 0.0;
-}
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++) {
+        f->sensorObjId[s][i] = UA_NODEID_NULL;
+        f->pv[s][i] = 0.0;
+        f->snapshot[0].pv[s][i] = 0.0;
+        f->snapshot[1].pv[s][i] = 0.0;
+        f->view.pv[s][i] = 0.0;
+        f->sensorSlot[s][i].fleet = f;
+        f->sensorSlot[s][i].index = i;
+        f->sensorSlot[s][i].field = (UA_UInt32)s;
+
+        SensorPublish* p = &f->publish[s][i];
+        p->mode = SENSOR_PUBLISH_POLL;
+        p->deadbandType = DEADBAND_NONE;
+        p->deadband = 0.0;
+        p->lastValue = NAN;
+        p->published = 0;
+        p->suppressed = 0;
+        p->valueId = UA_NODEID_NULL;
+    }
 
-void model_init(ModelCtx* m, Sensor* sensorTemperature, Sensor* sensorF,
-    Sensor* sensorConcentrationA, Sensor* sensorConcentrationB,
-    Reactor* reactor, ValveHandleControl* valveRegulationConcentrationA,
-    ValveHandleControl* valveRegulationQ, ValveHandleControl* valveRegulationT)
-{
-    m->reactor = reactor;
-    m->valveRegulationQ = valveRegulationQ;
-    m->valveRegulationConcentrationA = valveRegulationConcentrationA;
-    m->valveRegulationT = valveRegulationT;
-    m->sensorF = sensorF;
-    m->sensorConcentrationA = sensorConcentrationA;
-    m->sensorConcentrationB = sensorConcentrationB;
-    m->sensorT = sensorTemperature;
-
-    m->cfg.R = 8.314;
-    m->cfg.k01 = 0;
-    m->cfg.k02 = 0;
-    m->cfg.EA1 = 0;
-    m->cfg.EA2 = 0;
-
-    m->substanceId = 0;
-}
\ No newline at end of file
+    f->R[i] = 8.314;
+    f->k01[i] = 0;
+    f->k02[i] = 0;
+    f->EA1[i] = 0;
+    f->EA2[i] = 0;
+
+    f->substanceId[i] = 0;
+    f->substanceApplied[i] = 0;
+
+    /* A new reactor has never been computed */
+    f->inputDirty[i] = FLEET_DIRTY_ALL;
+    f->rateK1[i] = 0.0;
+    f->rateK2[i] = 0.0;
+    f->rateT[i] = NAN;
+
+    /* Dynamic model starts from a reactor filled with pure solvent */
+    f->stateCA[i] = 0.0;
+    f->stateCB[i] = 0.0;
+    f->odeStep[i] = 0.0;
+    f->odeError[i] = 0.0;
+    f->odeSteps[i] = 0;
+}
@@ -0,0 +1,495 @@
+/**
+ * @file loadgen.c
+ * @brief OPC UA load generator for sizing the server.
+ *
+ * Drives a running opc_demo server the way a plant of HMIs would, over
+ * the open62541 client on one machine:
+ *   - every session runs on its own thread with its own UA_Client, one
+ *     subscription and itemsPerSession monitored items that alternate
+ *     between PROCESS_VALUE and MANUAL_OUTPUT nodes of the fleet, spread
+ *     over the reactors so sessions overlap only when they must;
+ *   - the first `writers` sessions write the MANUAL_OUTPUT of one valve
+ *     each (shared round-robin when there are more writers than valves)
+ *     at writeRate, every session reads a monitored node at readRate;
+ *   - nothing is counted until all sessions are connected and subscribed,
+ *     then the measured window runs for durationS seconds.
+ *
+ * The nodes are addressed by their deterministic NodeIds
+ * (opc_ua_fleet_node_id()) in the fleet namespace, whose index is looked
+ * up once by a probe session.
+ *
+ * Two notification latencies are reported:
+ *   - sample: from the source timestamp the server stamped on the value
+ *             to its arrival, which includes waiting for the publishing
+ *             interval;
+ *   - write:  from sending a Write to the arrival of a notification with
+ *             the written value, which adds the sampling interval. Each
+ *             write of a valve sets a distinct value, slot / 10 with
+ *             slot = sequence % LOADGEN_WRITE_SLOTS, so a notification
+ *             finds its write through the slot alone.
+ * Both rely on client and server sharing the clock, i.e. one machine.
+ *
+ * The CPU use of the server is its process CPU time over the measured
+ * window (platform_process_cpu_ns()), in % of one CPU; the generator
+ * reports its own the same way to show whether it was the bottleneck.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <open62541/client_config_default.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include "loadgen.h"
+#include "log.h"
+#include "opcuaSettings.h"
+#include "platform.h"
+
+/* Distinct values written per valve before a value is reused */
+#define LOADGEN_WRITE_SLOTS 1000
+
+/* Latency samples kept per session and kind; later ones are only counted */
+#define LOADGEN_SAMPLES_MAX (1u << 20)
+
+/* How long sessions may take to connect and subscribe */
+#define LOADGEN_SETUP_TIMEOUT_MS 30000
+
+typedef enum {
+    LOADGEN_SETUP,
+    LOADGEN_MEASURE,
+    LOADGEN_STOP
+} LoadGenPhase;
+
+/* A written valve and when each of its values was sent */
+typedef struct {
+    UA_NodeId node;
+    volatile UA_UInt64 seq;
+    volatile UA_UInt64 sentAt[LOADGEN_WRITE_SLOTS];     /* UA_DateTime, 0 = never */
+} LoadGenValve;
+
+typedef struct {
+    UA_Double* ms;
+    UA_UInt32 size;
+    UA_UInt32 capacity;
+    UA_UInt64 count;
+} LoadGenSamples;
+
+struct LoadGen;
+
+typedef struct LoadGenSession LoadGenSession;
+
+/* Context of one monitored item */
+typedef struct {
+    LoadGenSession* session;
+    LoadGenValve* valve;        /* MANUAL_OUTPUT being written, else NULL */
+    UA_NodeId node;
+} LoadGenItem;
+
+struct LoadGenSession {
+    struct LoadGen* lg;
+    UA_UInt32 index;
+    UA_Client* client;
+    PlatformThread thread;
+    LoadGenItem* items;
+    UA_UInt32 itemCount;        /* created on the server */
+    LoadGenValve* writes;       /* valve written by this session or NULL */
+    UA_StatusCode rc;
+    UA_UInt64 notifications;
+    UA_UInt64 reads;
+    UA_UInt64 writeCount;
+    UA_UInt64 errors;
+    LoadGenSamples sample;
+    LoadGenSamples write;
+};
+
+typedef struct LoadGen {
+    const LoadGenOptions* opt;
+    UA_UInt16 ns;
+    volatile UA_UInt32 phase;
+    volatile UA_UInt32 ready;   /* sessions done with their setup */
+    UA_UInt32 valveCount;
+    LoadGenValve* valves;       /* every MANUAL_OUTPUT of the spread reactors */
+    LoadGenSession* sessions;
+} LoadGen;
+
+void loadgen_default_options(LoadGenOptions* opt) {
+    memset(opt, 0, sizeof(*opt));
+    snprintf(opt->url, sizeof(opt->url), "opc.tcp://localhost:4840");
+    opt->sessions = 10;
+    opt->itemsPerSession = 20;
+    opt->reactors = 1;
+    opt->writers = 1;
+    opt->writeRate = 10.0;
+    opt->readRate = 10.0;
+    opt->publishingInterval = 100.0;
+    opt->samplingInterval = 50.0;
+    opt->durationS = 30;
+    opt->serverPid = 0;
+}
+
+static void loadgen_samples_add(LoadGenSamples* s, UA_Double ms) {
+    s->count++;
+    if (s->size == s->capacity) {
+        if (s->capacity == LOADGEN_SAMPLES_MAX)
+            return;
+        const UA_UInt32 capacity = s->capacity ? 2 * s->capacity : 1024;
+        UA_Double* grown = (UA_Double*)realloc(s->ms, capacity * sizeof(UA_Double));
+        if (!grown)
+            return;
+        s->ms = grown;
+        s->capacity = capacity;
+    }
+    s->ms[s->size++] = ms;
+}
+
+static int loadgen_compare(const void* a, const void* b) {
+    const UA_Double x = *(const UA_Double*)a;
+    const UA_Double y = *(const UA_Double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static UA_Double loadgen_percentile(const UA_Double* sorted, size_t n, UA_Double p) {
+    size_t rank = (size_t)ceil(p / 100.0 * (UA_Double)n);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+/**
+ * @brief Merges the samples of one kind of every session into a latency.
+ *
+ * `offset` selects the LoadGenSamples member of LoadGenSession.
+ */
+static void loadgen_latency(const LoadGen* lg, size_t offset, LoadGenLatency* out) {
+    size_t total = 0;
+    memset(out, 0, sizeof(*out));
+    for (UA_UInt32 k = 0; k < lg->opt->sessions; k++) {
+        const LoadGenSamples* s = (const LoadGenSamples*)((const char*)&lg->sessions[k] + offset);
+        total += s->size;
+        out->count += s->count;
+    }
+    if (total == 0)
+        return;
+
+    UA_Double* all = (UA_Double*)malloc(total * sizeof(UA_Double));
+    if (!all)
+        return;
+    size_t n = 0;
+    for (UA_UInt32 k = 0; k < lg->opt->sessions; k++) {
+        const LoadGenSamples* s = (const LoadGenSamples*)((const char*)&lg->sessions[k] + offset);
+        if (s->size)
+            memcpy(all + n, s->ms, s->size * sizeof(UA_Double));
+        n += s->size;
+    }
+    qsort(all, n, sizeof(UA_Double), loadgen_compare);
+    out->p50 = loadgen_percentile(all, n, 50.0);
+    out->p90 = loadgen_percentile(all, n, 90.0);
+    out->p99 = loadgen_percentile(all, n, 99.0);
+    out->max = all[n - 1];
+    free(all);
+}
+
+static void loadgen_data_change(UA_Client* client, UA_UInt32 subId, void* subContext,
+    UA_UInt32 monId, void* monContext, UA_DataValue* value) {
+
+    (void)client;
+    (void)subId;
+    (void)subContext;
+    (void)monId;
+
+    LoadGenItem* item = (LoadGenItem*)monContext;
+    LoadGenSession* s = item->session;
+    if (atomic_u32_load(&s->lg->phase) != LOADGEN_MEASURE)
+        return;
+
+    const UA_DateTime now = UA_DateTime_now();
+    s->notifications++;
+    if (value->hasSourceTimestamp)
+        loadgen_samples_add(&s->sample, (UA_Double)(now - value->sourceTimestamp) / UA_DATETIME_MSEC);
+
+    if (item->valve && value->hasValue && value->value.type == &UA_TYPES[UA_TYPES_DOUBLE]) {
+        const UA_Double v = *(const UA_Double*)value->value.data;
+        const long slot = lround(v * 10.0);
+        if (slot >= 0 && slot < LOADGEN_WRITE_SLOTS) {
+            const UA_DateTime sent = (UA_DateTime)atomic_u64_load(&item->valve->sentAt[slot]);
+            if (sent != 0 && now >= sent)
+                loadgen_samples_add(&s->write, (UA_Double)(now - sent) / UA_DATETIME_MSEC);
+        }
+    }
+}
+
+static UA_Client* loadgen_connect(const char* url) {
+    UA_Client* client = UA_Client_new();
+    if (!client)
+        return NULL;
+    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    if (UA_Client_connect(client, url) != UA_STATUSCODE_GOOD) {
+        UA_Client_delete(client);
+        return NULL;
+    }
+    return client;
+}
+
+/**
+ * @brief Connects a session and creates its subscription and items.
+ *
+ * Item k of session s is the n/2-th PROCESS_VALUE (k even) or
+ * MANUAL_OUTPUT (k odd) of the spread reactors, n = s * items + k, so
+ * consecutive sessions continue where the previous one stopped.
+ */
+static UA_StatusCode loadgen_session_setup(LoadGenSession* s) {
+    LoadGen* lg = s->lg;
+    const LoadGenOptions* opt = lg->opt;
+
+    s->client = loadgen_connect(opt->url);
+    if (!s->client)
+        return UA_STATUSCODE_BADCONNECTIONREJECTED;
+
+    UA_CreateSubscriptionRequest req = UA_CreateSubscriptionRequest_default();
+    req.requestedPublishingInterval = opt->publishingInterval;
+    UA_CreateSubscriptionResponse resp = UA_Client_Subscriptions_create(s->client, req, NULL, NULL, NULL);
+    if (resp.responseHeader.serviceResult != UA_STATUSCODE_GOOD)
+        return resp.responseHeader.serviceResult;
+
+    s->items = (LoadGenItem*)calloc(opt->itemsPerSession ? opt->itemsPerSession : 1, sizeof(LoadGenItem));
+    if (!s->items)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    const UA_UInt32 pvCount = opt->reactors * FLEET_SENSOR_COUNT;
+    for (UA_UInt32 k = 0; k < opt->itemsPerSession; k++) {
+        const UA_UInt32 n = (s->index * opt->itemsPerSession + k) / 2;
+        LoadGenItem* item = &s->items[s->itemCount];
+        item->session = s;
+        if (k % 2 == 0) {
+            const UA_UInt32 pv = n % pvCount;
+            item->node = opc_ua_fleet_node_id(lg->ns, pv / FLEET_SENSOR_COUNT,
+                (FleetObject)(FLEET_OBJECT_SENSOR + pv % FLEET_SENSOR_COUNT), 1);
+        } else {
+            item->valve = &lg->valves[n % lg->valveCount];
+            item->node = item->valve->node;
+        }
+
+        UA_MonitoredItemCreateRequest mreq = UA_MonitoredItemCreateRequest_default(item->node);
+        mreq.requestedParameters.samplingInterval = opt->samplingInterval;
+        UA_MonitoredItemCreateResult mres = UA_Client_MonitoredItems_createDataChange(s->client,
+            resp.subscriptionId, UA_TIMESTAMPSTORETURN_BOTH, mreq, item, loadgen_data_change, NULL);
+        if (mres.statusCode != UA_STATUSCODE_GOOD)
+            return mres.statusCode;
+        s->itemCount++;
+    }
+
+    if (s->index < opt->writers && opt->writeRate > 0.0)
+        s->writes = &lg->valves[s->index % lg->valveCount];
+    return UA_STATUSCODE_GOOD;
+}
+
+static void loadgen_write(LoadGenSession* s) {
+    LoadGenValve* v = s->writes;
+    const UA_UInt32 slot = (UA_UInt32)(atomic_u64_add(&v->seq, 1) % LOADGEN_WRITE_SLOTS);
+    UA_Double value = slot / 10.0;
+    UA_Variant var;
+    UA_Variant_setScalar(&var, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+
+    atomic_u64_store(&v->sentAt[slot], (UA_UInt64)UA_DateTime_now());
+    if (UA_Client_writeValueAttribute(s->client, v->node, &var) == UA_STATUSCODE_GOOD)
+        s->writeCount++;
+    else
+        s->errors++;
+}
+
+static void loadgen_read(LoadGenSession* s) {
+    const LoadGenItem* item = &s->items[s->reads % s->itemCount];
+    UA_Variant var;
+    UA_Variant_init(&var);
+    if (UA_Client_readValueAttribute(s->client, item->node, &var) == UA_STATUSCODE_GOOD)
+        s->reads++;
+    else
+        s->errors++;
+    UA_Variant_clear(&var);
+}
+
+/* Next due time of a periodic action that must not build up a backlog */
+static UA_UInt64 loadgen_next(UA_UInt64 due, UA_UInt64 period, UA_UInt64 now) {
+    due += period;
+    return due < now ? now : due;
+}
+
+static void loadgen_session_thread(void* arg) {
+    LoadGenSession* s = (LoadGenSession*)arg;
+    LoadGen* lg = s->lg;
+    const LoadGenOptions* opt = lg->opt;
+
+    s->rc = loadgen_session_setup(s);
+    atomic_u32_add(&lg->ready, 1);
+    if (s->rc != UA_STATUSCODE_GOOD)
+        return;
+
+    const UA_UInt64 writePeriod = s->writes ? (UA_UInt64)(1e9 / opt->writeRate) : 0;
+    const UA_UInt64 readPeriod = opt->readRate > 0.0 && s->itemCount ? (UA_UInt64)(1e9 / opt->readRate) : 0;
+    UA_UInt64 nextWrite = 0, nextRead = 0;
+    UA_Boolean measuring = false;
+
+    for (;;) {
+        const UA_UInt32 phase = atomic_u32_load(&lg->phase);
+        if (phase == LOADGEN_STOP)
+            break;
+        if (phase == LOADGEN_MEASURE) {
+            const UA_UInt64 now = platform_now_ns();
+            if (!measuring) {
+                measuring = true;
+                nextWrite = nextRead = now;
+            }
+            if (writePeriod && now >= nextWrite) {
+                loadgen_write(s);
+                nextWrite = loadgen_next(nextWrite, writePeriod, now);
+            }
+            if (readPeriod && now >= nextRead) {
+                loadgen_read(s);
+                nextRead = loadgen_next(nextRead, readPeriod, now);
+            }
+        }
+        UA_Client_run_iterate(s->client, 1);
+    }
+}
+
+/* Index of the fleet namespace on the server, 0 if it cannot be found */
+static UA_UInt16 loadgen_namespace(const char* url) {
+    UA_Client* client = loadgen_connect(url);
+    if (!client)
+        return 0;
+    UA_String uri = UA_STRING((char*)FLEET_NAMESPACE_URI);
+    UA_UInt16 ns = 0;
+    if (UA_Client_NamespaceGetIndex(client, &uri, &ns) != UA_STATUSCODE_GOOD)
+        ns = 0;
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    return ns;
+}
+
+static UA_StatusCode loadgen_init(LoadGen* lg, const LoadGenOptions* opt) {
+    memset(lg, 0, sizeof(*lg));
+    lg->opt = opt;
+    lg->ns = loadgen_namespace(opt->url);
+    if (lg->ns == 0) {
+        LOG_MSG(LOG_LEVEL_ERROR, "loadgen: no fleet namespace at %s", opt->url);
+        return UA_STATUSCODE_BADCONNECTIONREJECTED;
+    }
+
+    lg->valveCount = opt->reactors * FLEET_VALVE_COUNT;
+    lg->valves = (LoadGenValve*)calloc(lg->valveCount, sizeof(LoadGenValve));
+    lg->sessions = (LoadGenSession*)calloc(opt->sessions, sizeof(LoadGenSession));
+    if (!lg->valves || !lg->sessions)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for (UA_UInt32 v = 0; v < lg->valveCount; v++)
+        lg->valves[v].node = opc_ua_fleet_node_id(lg->ns, v / FLEET_VALVE_COUNT,
+            (FleetObject)(FLEET_OBJECT_VALVE + v % FLEET_VALVE_COUNT), 1);
+    return UA_STATUSCODE_GOOD;
+}
+
+static void loadgen_clear(LoadGen* lg) {
+    if (lg->sessions) {
+        for (UA_UInt32 k = 0; k < lg->opt->sessions; k++) {
+            LoadGenSession* s = &lg->sessions[k];
+            if (s->client) {
+                UA_Client_disconnect(s->client);
+                UA_Client_delete(s->client);
+            }
+            free(s->items);
+            free(s->sample.ms);
+            free(s->write.ms);
+        }
+    }
+    free(lg->sessions);
+    free(lg->valves);
+}
+
+static UA_Double loadgen_cpu_percent(UA_UInt64 before, UA_UInt64 after, UA_UInt64 wallNs) {
+    return wallNs ? 100.0 * (UA_Double)(after - before) / (UA_Double)wallNs : 0.0;
+}
+
+UA_StatusCode loadgen_run(const LoadGenOptions* opt, LoadGenReport* report) {
+    memset(report, 0, sizeof(*report));
+    report->serverCpu = -1.0;
+    if (opt->sessions == 0 || opt->reactors == 0 || opt->durationS == 0)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    LoadGen lg;
+    UA_StatusCode rc = loadgen_init(&lg, opt);
+    if (rc != UA_STATUSCODE_GOOD) {
+        loadgen_clear(&lg);
+        return rc;
+    }
+
+    UA_UInt32 started = 0;
+    for (; started < opt->sessions; started++) {
+        LoadGenSession* s = &lg.sessions[started];
+        s->lg = &lg;
+        s->index = started;
+        if (platform_thread_start(&s->thread, loadgen_session_thread, s) != UA_STATUSCODE_GOOD) {
+            rc = UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+            break;
+        }
+    }
+
+    /* Wait for every session to connect and subscribe */
+    UA_UInt32 waited = 0;
+    while (rc == UA_STATUSCODE_GOOD && atomic_u32_load(&lg.ready) < started) {
+        if (waited >= LOADGEN_SETUP_TIMEOUT_MS) {
+            rc = UA_STATUSCODE_BADTIMEOUT;
+            break;
+        }
+        platform_sleep_ms(10);
+        waited += 10;
+    }
+    for (UA_UInt32 k = 0; k < started && rc == UA_STATUSCODE_GOOD; k++) {
+        const LoadGenSession* s = &lg.sessions[k];
+        if (s->rc == UA_STATUSCODE_GOOD) {
+            report->sessions++;
+            report->items += s->itemCount;
+        } else {
+            LOG_MSG(LOG_LEVEL_WARN, "loadgen: session %u failed: %s", k, UA_StatusCode_name(s->rc));
+        }
+    }
+
+    if (rc == UA_STATUSCODE_GOOD && report->sessions > 0) {
+        const UA_UInt32 pid = opt->serverPid ? opt->serverPid : platform_find_process("opc_demo");
+        UA_UInt64 serverBefore = 0, serverAfter = 0, selfBefore = 0, selfAfter = 0;
+        const UA_Boolean serverKnown = pid != 0 &&
+            platform_process_cpu_ns(pid, &serverBefore) == UA_STATUSCODE_GOOD;
+        platform_process_cpu_ns(0, &selfBefore);
+
+        const UA_UInt64 t0 = platform_now_ns();
+        atomic_u32_store(&lg.phase, LOADGEN_MEASURE);
+        platform_sleep_ms(opt->durationS * 1000);
+        atomic_u32_store(&lg.phase, LOADGEN_STOP);
+        const UA_UInt64 t1 = platform_now_ns();
+
+        platform_process_cpu_ns(0, &selfAfter);
+        if (serverKnown && platform_process_cpu_ns(pid, &serverAfter) == UA_STATUSCODE_GOOD)
+            report->serverCpu = loadgen_cpu_percent(serverBefore, serverAfter, t1 - t0);
+        report->clientCpu = loadgen_cpu_percent(selfBefore, selfAfter, t1 - t0);
+        report->seconds = (UA_Double)(t1 - t0) / 1e9;
+    } else if (rc == UA_STATUSCODE_GOOD) {
+        rc = UA_STATUSCODE_BADCONNECTIONREJECTED;
+    }
+
+    atomic_u32_store(&lg.phase, LOADGEN_STOP);
+    for (UA_UInt32 k = 0; k < started; k++)
+        platform_thread_join(&lg.sessions[k].thread);
+
+    for (UA_UInt32 k = 0; k < started; k++) {
+        const LoadGenSession* s = &lg.sessions[k];
+        report->notifications += s->notifications;
+        report->reads += s->reads;
+        report->writes += s->writeCount;
+        report->errors += s->errors;
+    }
+    loadgen_latency(&lg, offsetof(LoadGenSession, sample), &report->sampleLatency);
+    loadgen_latency(&lg, offsetof(LoadGenSession, write), &report->writeLatency);
+
+    loadgen_clear(&lg);
+    return rc;
+}
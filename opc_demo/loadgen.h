@@ -0,0 +1,47 @@
+#pragma once
+#include <open62541/types.h>
+
+/* Longest endpoint URL, including the terminating zero */
+#define LOADGEN_URL_SIZE 256
+
+/* What the load generator puts on a running server */
+typedef struct {
+    char url[LOADGEN_URL_SIZE];
+    UA_UInt32 sessions;
+    UA_UInt32 itemsPerSession;      /* PROCESS_VALUE and MANUAL_OUTPUT, alternating */
+    UA_UInt32 reactors;             /* reactors of the server the items are spread over */
+    UA_UInt32 writers;              /* sessions that also write valve positions */
+    UA_Double writeRate;            /* writes per second of each writer */
+    UA_Double readRate;             /* reads per second of each session, 0 = none */
+    UA_Double publishingInterval;   /* ms */
+    UA_Double samplingInterval;     /* ms */
+    UA_UInt32 durationS;            /* measured seconds, after every session is set up */
+    UA_UInt32 serverPid;            /* 0 = the local process named opc_demo */
+} LoadGenOptions;
+
+/* Distribution of one latency, in milliseconds */
+typedef struct {
+    UA_UInt64 count;
+    UA_Double p50;
+    UA_Double p90;
+    UA_Double p99;
+    UA_Double max;
+} LoadGenLatency;
+
+/* Outcome of a run, counted over the measured window only */
+typedef struct {
+    UA_UInt32 sessions;             /* sessions that connected and subscribed */
+    UA_UInt32 items;                /* monitored items created */
+    UA_Double seconds;
+    UA_UInt64 notifications;
+    UA_UInt64 reads;
+    UA_UInt64 writes;
+    UA_UInt64 errors;               /* failed reads and writes */
+    LoadGenLatency sampleLatency;   /* source timestamp to notification */
+    LoadGenLatency writeLatency;    /* Write request to the notification of its value */
+    UA_Double serverCpu;            /* % of one CPU, negative if unknown */
+    UA_Double clientCpu;            /* % of one CPU used by the load generator */
+} LoadGenReport;
+
+void loadgen_default_options(LoadGenOptions* opt);
+UA_StatusCode loadgen_run(const LoadGenOptions* opt, LoadGenReport* report);
@@ -0,0 +1,81 @@
+/**
+ * @file loadgen_main.c
+ * @brief Entry point of the opc_demo_load executable.
+ *
+ * `opc_demo_load [--url u] [--sessions n] [--items n] [--reactors n]
+ * [--writers n] [--write-rate hz] [--read-rate hz] [--publish-ms ms]
+ * [--sample-ms ms] [--duration s] [--server-pid pid]` puts the load of
+ * loadgen.c on a running server, opc.tcp://localhost:4840 by default,
+ * and prints what it measured. --reactors must not exceed the reactors
+ * of the server's plant. The exit code is 0 when the run completed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "loadgen.h"
+#include "log.h"
+
+static void print_latency(const char* name, const LoadGenLatency* l) {
+	printf("%-22s %10llu %9.2f %9.2f %9.2f %9.2f\n", name, (unsigned long long)l->count,
+		l->p50, l->p90, l->p99, l->max);
+}
+
+int main(int argc, char** argv) {
+	LoadGenOptions opt;
+	loadgen_default_options(&opt);
+	for (int a = 1; a + 1 < argc; a += 2) {
+		const char* v = argv[a + 1];
+		if (strcmp(argv[a], "--url") == 0)
+			snprintf(opt.url, sizeof(opt.url), "%s", v);
+		else if (strcmp(argv[a], "--sessions") == 0)
+			opt.sessions = (UA_UInt32)strtoul(v, NULL, 10);
+		else if (strcmp(argv[a], "--items") == 0)
+			opt.itemsPerSession = (UA_UInt32)strtoul(v, NULL, 10);
+		else if (strcmp(argv[a], "--reactors") == 0)
+			opt.reactors = (UA_UInt32)strtoul(v, NULL, 10);
+		else if (strcmp(argv[a], "--writers") == 0)
+			opt.writers = (UA_UInt32)strtoul(v, NULL, 10);
+		else if (strcmp(argv[a], "--write-rate") == 0)
+			opt.writeRate = strtod(v, NULL);
+		else if (strcmp(argv[a], "--read-rate") == 0)
+			opt.readRate = strtod(v, NULL);
+		else if (strcmp(argv[a], "--publish-ms") == 0)
+			opt.publishingInterval = strtod(v, NULL);
+		else if (strcmp(argv[a], "--sample-ms") == 0)
+			opt.samplingInterval = strtod(v, NULL);
+		else if (strcmp(argv[a], "--duration") == 0)
+			opt.durationS = (UA_UInt32)strtoul(v, NULL, 10);
+		else if (strcmp(argv[a], "--server-pid") == 0)
+			opt.serverPid = (UA_UInt32)strtoul(v, NULL, 10);
+	}
+
+	log_init(config_log_capacity, LOG_LEVEL_WARN);
+	printf("Load on %s: %u sessions x %u items over %u reactors, %u writers at %.1f/s, reads at %.1f/s, %u s\n",
+		opt.url, opt.sessions, opt.itemsPerSession, opt.reactors, opt.writers, opt.writeRate,
+		opt.readRate, opt.durationS);
+
+	LoadGenReport r;
+	const UA_StatusCode rc = loadgen_run(&opt, &r);
+	if (rc == UA_STATUSCODE_GOOD) {
+		printf("%u sessions, %u monitored items, %.1f s measured\n", r.sessions, r.items, r.seconds);
+		printf("%-22s %10s %9s %9s %9s %9s\n", "latency (ms)", "count", "p50", "p90", "p99", "max");
+		print_latency("sample -> notification", &r.sampleLatency);
+		print_latency("write -> notification", &r.writeLatency);
+		printf("notifications/s %10.1f\n", r.notifications / r.seconds);
+		printf("reads/s         %10.1f\n", r.reads / r.seconds);
+		printf("writes/s        %10.1f\n", r.writes / r.seconds);
+		printf("errors          %10llu\n", (unsigned long long)r.errors);
+		if (r.serverCpu >= 0.0)
+			printf("server CPU      %10.1f %%\n", r.serverCpu);
+		else
+			printf("server CPU             n/a (no opc_demo process, see --server-pid)\n");
+		printf("generator CPU   %10.1f %%\n", r.clientCpu);
+	} else {
+		printf("Load run failed: %s\n", UA_StatusCode_name(rc));
+	}
+
+	log_shutdown();
+	return rc == UA_STATUSCODE_GOOD ? 0 : 1;
+}
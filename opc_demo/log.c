@@ -0,0 +1,226 @@
+﻿/**
+ * @file log.c
+ * @brief Asynchronous logger fed through a lock-free ring buffer.
+ *
+ * Producers (model tick, DataSource callbacks, startup code) never touch
+ * stdout. log_push() formats the message straight into a fixed-size
+ * record of a bounded multi-producer ring buffer and returns. A
+ * background thread drains the ring and writes the records to stdout.
+ * Formatting on the caller's side keeps every argument type printf
+ * knows, strings of any lifetime included, and lets the compiler check
+ * the arguments against the format (LOG_PRINTF).
+ *
+ * The ring follows the bounded MPMC queue design where every cell carries
+ * a sequence number: a producer claims a cell with one CAS on the enqueue
+ * position, fills it and publishes it by storing pos + 1 into the cell's
+ * sequence. When the ring is full the record is discarded and counted in
+ * log_dropped(), so a stalled terminal or pipe can never block a producer.
+ *
+ * Records below the current level are rejected by the LOG_MSG macro
+ * before any argument is evaluated. Before log_init() and after
+ * log_shutdown() records are formatted synchronously.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "log.h"
+#include "platform.h"
+
+/* Consumer sleep when the ring is empty */
+#define LOG_IDLE_SLEEP_MS 5
+
+/* Records formatted between two flushes of stdout */
+#define LOG_FLUSH_BATCH 256
+
+typedef struct {
+    volatile UA_UInt64 seq;
+    UA_DateTime time;
+    UA_Byte level;
+    char text[LOG_LINE_SIZE];
+} LogRecord;
+
+typedef struct {
+    LogRecord* cells;
+    UA_UInt64 mask;
+    volatile UA_UInt64 enqueuePos;
+    UA_UInt64 dequeuePos;       /* consumer thread only */
+    volatile UA_UInt64 dropped;
+    UA_UInt64 droppedReported;  /* consumer thread only */
+    volatile UA_UInt32 running;
+    UA_Boolean started;
+    PlatformThread thread;
+} LogRing;
+
+volatile int log_level_current = LOG_LEVEL_INFO;
+
+static LogRing g_log;
+
+static void log_write(const LogRecord* r) {
+    if (r->level <= LOG_LEVEL_WARN)
+        fputs(r->level == LOG_LEVEL_ERROR ? "ERROR: " : "WARNING: ", stdout);
+    fputs(r->text, stdout);
+    fputc('\n', stdout);
+}
+
+static void log_fill(LogRecord* r, LogLevel level, const char* fmt, va_list args) {
+    r->time = UA_DateTime_now();
+    r->level = (UA_Byte)level;
+    if (vsnprintf(r->text, sizeof(r->text), fmt, args) < 0)
+        r->text[0] = '\0';
+}
+
+/**
+ * @brief Formats a printf-style message into the next free record.
+ */
+void log_push(LogLevel level, const char* fmt, ...) {
+    if (!LOG_ENABLED(level) || level == LOG_LEVEL_OFF)
+        return;
+
+    va_list args;
+    if (!atomic_u32_load(&g_log.running)) {
+        LogRecord r;
+        va_start(args, fmt);
+        log_fill(&r, level, fmt, args);
+        va_end(args);
+        log_write(&r);
+        fflush(stdout);
+        return;
+    }
+
+    UA_UInt64 pos = atomic_u64_load(&g_log.enqueuePos);
+    LogRecord* cell;
+    for (;;) {
+        cell = &g_log.cells[pos & g_log.mask];
+        const UA_UInt64 seq = atomic_u64_load(&cell->seq);
+        const int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (atomic_u64_cas(&g_log.enqueuePos, &pos, pos + 1))
+                break;
+        }
+        else if (diff < 0) {
+            atomic_u64_add(&g_log.dropped, 1);   /* ring full */
+            return;
+        }
+        else {
+            pos = atomic_u64_load(&g_log.enqueuePos);
+        }
+    }
+
+    va_start(args, fmt);
+    log_fill(cell, level, fmt, args);
+    va_end(args);
+    atomic_u64_store(&cell->seq, pos + 1);
+}
+
+/**
+ * @brief Drains every published record; returns the number written.
+ */
+static size_t log_drain(void) {
+    size_t written = 0;
+    for (;;) {
+        LogRecord* cell = &g_log.cells[g_log.dequeuePos & g_log.mask];
+        if (atomic_u64_load(&cell->seq) != g_log.dequeuePos + 1)
+            break;
+
+        log_write(cell);
+        atomic_u64_store(&cell->seq, g_log.dequeuePos + g_log.mask + 1);
+        g_log.dequeuePos++;
+
+        if (++written % LOG_FLUSH_BATCH == 0)
+            fflush(stdout);
+    }
+
+    const UA_UInt64 dropped = atomic_u64_load(&g_log.dropped);
+    if (dropped != g_log.droppedReported) {
+        printf("WARNING: log: %llu records dropped (ring full)\n",
+            (unsigned long long)(dropped - g_log.droppedReported));
+        g_log.droppedReported = dropped;
+        written++;
+    }
+
+    if (written)
+        fflush(stdout);
+    return written;
+}
+
+static void log_thread(void* arg) {
+    (void)arg;
+    while (atomic_u32_load(&g_log.running)) {
+        if (log_drain() == 0)
+            platform_sleep_ms(LOG_IDLE_SLEEP_MS);
+    }
+    log_drain();
+}
+
+/**
+ * @brief Starts the background writer.
+ *
+ * capacity is rounded up to a power of two. The initial level can be
+ * overridden with the OPC_DEMO_LOG_LEVEL environment variable
+ * (0 = off ... 5 = trace).
+ */
+UA_StatusCode log_init(UA_UInt32 capacity, LogLevel level) {
+    if (g_log.started)
+        return UA_STATUSCODE_GOOD;
+
+    UA_UInt64 cap = 2;
+    while (cap < capacity)
+        cap <<= 1;
+
+    g_log.cells = (LogRecord*)UA_calloc((size_t)cap, sizeof(LogRecord));
+    if (!g_log.cells)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    for (UA_UInt64 i = 0; i < cap; i++)
+        g_log.cells[i].seq = i;
+
+    g_log.mask = cap - 1;
+    g_log.enqueuePos = 0;
+    g_log.dequeuePos = 0;
+    g_log.dropped = 0;
+    g_log.droppedReported = 0;
+
+    const char* env = getenv("OPC_DEMO_LOG_LEVEL");
+    if (env && *env >= '0' && *env <= '0' + LOG_LEVEL_TRACE)
+        level = (LogLevel)(*env - '0');
+    log_set_level(level);
+
+    atomic_u32_store(&g_log.running, 1);
+    UA_StatusCode rc = platform_thread_start(&g_log.thread, log_thread, NULL);
+    if (rc != UA_STATUSCODE_GOOD) {
+        atomic_u32_store(&g_log.running, 0);
+        UA_free(g_log.cells);
+        g_log.cells = NULL;
+        return rc;
+    }
+    g_log.started = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Stops the writer after it has drained all pending records.
+ *
+ * Must be called once all producer threads have stopped; records pushed
+ * afterwards are written synchronously.
+ */
+void log_shutdown(void) {
+    if (!g_log.started)
+        return;
+    atomic_u32_store(&g_log.running, 0);
+    platform_thread_join(&g_log.thread);
+    g_log.started = false;
+    UA_free(g_log.cells);
+    g_log.cells = NULL;
+}
+
+void log_set_level(LogLevel level) {
+    log_level_current = (int)level;
+}
+
+LogLevel log_get_level(void) {
+    return (LogLevel)log_level_current;
+}
+
+UA_UInt64 log_dropped(void) {
+    return atomic_u64_load(&g_log.dropped);
+}
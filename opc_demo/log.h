@@ -0,0 +1,46 @@
+#pragma once
+#include <open62541/types.h>
+
+typedef enum {
+    LOG_LEVEL_OFF,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_TRACE     /* per-tick model output */
+} LogLevel;
+
+/* Formatted text of one record, including the terminating zero */
+#define LOG_LINE_SIZE 384
+
+/* Lets the compiler check the arguments of printf-style functions */
+#if defined(__GNUC__)
+#define LOG_PRINTF(fmtIndex, argIndex) __attribute__((format(printf, fmtIndex, argIndex)))
+#else
+#define LOG_PRINTF(fmtIndex, argIndex)
+#endif
+
+UA_StatusCode log_init(UA_UInt32 capacity, LogLevel level);
+void log_shutdown(void);
+
+void log_set_level(LogLevel level);
+LogLevel log_get_level(void);
+UA_UInt64 log_dropped(void);
+
+void log_push(LogLevel level, const char* fmt, ...) LOG_PRINTF(2, 3);
+
+extern volatile int log_level_current;
+
+#define LOG_ENABLED(level) ((int)(level) <= log_level_current)
+
+/*
+ * Records a printf-style message: LOG_MSG(level, fmt, ...).
+ *
+ * The arguments are evaluated only when level is enabled. They are
+ * formatted into the record by the caller, so strings may be
+ * temporaries; text past LOG_LINE_SIZE - 1 characters is cut off.
+ */
+#define LOG_MSG(level, ...) do { \
+        if (LOG_ENABLED(level)) \
+            log_push((level), __VA_ARGS__); \
+    } while (0)
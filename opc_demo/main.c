@@ -4,54 +4,208 @@
  *
  * This program creates and runs an OPC UA server using open62541.
  * It performs the following steps:
- *   1. Creates a UA_Server instance.
- *   2. Initializes in-memory objects: sensors, valves, reactor, and the
- *      mathematical model context.
+ *   1. Starts the asynchronous logger and creates a UA_Server instance
+ *      whose monitored item registrations are tracked per NodeBinding.
+ *   2. Loads the plant description (config_plant_file or `--plant <file>`,
+ *      through its binary cache, see plant.c) or, if there is none, the
+ *      built-in plant of config_reactor_count reactors; allocates the
+ *      reactor fleet (struct-of-arrays registry) for it, selects the
+ *      vectorized CB kernel for this CPU and starts the model worker pool.
  *   3. Registers custom OPC UA types for sensors, reactor, math model,
  *      and valve handle control in the server’s address space.
- *   4. Creates logical folders ("Model", "Valves", "Sensors", "Reactors")
- *      and instantiates the corresponding OPC UA nodes bound to the
- *      initialized C objects.
- *   5. Registers a periodic callback (model_cb) with period config_dt
- *      to execute the mathematical model and update tags.
- *   6. Starts the server’s main loop and runs it until an interrupt
- *      (e.g. SIGINT) is received, then shuts down and frees resources.
+ *   4. Creates the folders of the plant ("Model", "Valves", "Sensors",
+ *      "Reactors" by default) and instantiates the OPC UA nodes of every
+ *      reactor, named as in the plant description and bound to its slot
+ *      in the fleet, in one bulk pass (opc_ua_create_fleet_instances) with
+ *      deterministic NodeIds in the fleet namespace. On top of that:
+ *      - SET_KINETICS methods on every MathModel object and on its folder
+ *        replace whole kinetic configurations at the next tick.
+ *      - ESTIMATE_KINETICS fits them to the history of the reactor on a
+ *        worker thread (estimate.c, async_method.c).
+ *      - SWEEP on every Reactor object evaluates CB over a grid of valve
+ *        openings set in its SWEEP_* variables, in parallel and off the
+ *        live model, into the array SWEEP_CB (sweep.c).
+ *      - OPTIMIZE searches the openings with the highest CB, or a target
+ *        CB at the lowest flow, from many starts in parallel (optimize.c).
+ *      - Writing SUBSTANCE_ID switches a reactor to the kinetics of that
+ *        substance in the substance library (config_substance_file or
+ *        `--substances <file>`, see substance.c) at the next tick; the
+ *        library is reloaded while the model runs whenever its file
+ *        changes.
+ *      - A "Diagnostics" folder next to them holds the runtime
+ *        diagnostics (diag.c): model_cb duration and timer jitter,
+ *        DataSource calls per kind, refreshed every config_diag_period_ms.
+ *   5. Registers a periodic callback (model_cb) to execute the
+ *      mathematical model for the whole fleet. Each tick advances the
+ *      simulation clock by config_dt; the clock runs config_time_scale
+ *      (`--time-scale <x>`, 0 = as fast as possible) times faster than
+ *      real time, values are stamped with simulated time and the
+ *      "Simulation" object reports the achieved pace. A scenario
+ *      (config_scenario_file or `--scenario <file>`) changes inputs at
+ *      given simulated times. The tick is split across the worker pool
+ *      and completes before the callback returns; sensors in push mode
+ *      (config_sensor_publish_mode) are then written to their
+ *      value-backed nodes when they leave the deadband.
+ *      Every tick is offered to the historian (config_history_depth
+ *      samples per sensor, compressed as config_history_compression),
+ *      which answers HistoryRead requests on the PROCESS_VALUE nodes.
+ *      With a recording file (config_record_file or `--record <file>`)
+ *      the inputs and outputs of every tick are appended to it.
+ *      With config_model_thread (`--model-thread <skip|catch-up|slip>`)
+ *      the ticks run on a dedicated thread at absolute deadlines instead,
+ *      optionally pinned and at real-time priority, handling overruns as
+ *      the given policy says (model_thread.c).
+ *   6. Starts the server’s main loop (server_loop_run) and runs it until
+ *      an interrupt (SIGINT / SIGTERM) is received, then shuts down and
+ *      frees resources.
  *
  * The process runs in the foreground and terminates only on interrupt
- * or fatal error from UA_Server_runUntilInterrupt.
+ * or fatal error from the server loop. `opc_demo --plant <file>` starts
+ * the server with another plant description. `opc_demo --replay <file>`
+ * replays a recording at full speed and verifies every tick bit for bit
+ * (exit code 0 if all outputs match, 2 if not). Instead of the server,
+ * `opc_demo --bench-read [reads]` runs the DataSource read
+ * microbenchmark, `opc_demo --bench-startup [reactors]` the address space
+ * build benchmark, `opc_demo --bench-history [tags]` the historian
+ * benchmark and `opc_demo --bench-suite [file.json]` the whole benchmark
+ * suite.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <open62541/server.h>
 #include "init.h"
 #include "types.h"
 #include "config.h"
+#include "fleet.h"
 #include "math_model.h"
+#include "math_batch.h"
 #include "opcuaSettings.h"
+#include "log.h"
+#include "binding.h"
+#include "server_loop.h"
+#include "bench.h"
+#include "plant.h"
+#include "historian.h"
+#include "recorder.h"
+#include "sim_clock.h"
+#include "scenario.h"
+#include "substance.h"
+#include "sweep.h"
+#include "model_thread.h"
+#include "diag.h"
+#include "platform.h"
 
-int main(void) {
-    UA_Server* server = UA_Server_new();
+int main(int argc, char** argv) {
+	log_init(config_log_capacity, config_log_level);
 
-	sensor_init(&sensorT);
-	sensor_init(&sensorF);
-	sensor_init(&sensorConcentrationA);
-	sensor_init(&sensorConcentrationB);
+	if (argc > 1 && strcmp(argv[1], "--bench-read") == 0) {
+		int rc = bench_read(argc > 2 ? (UA_UInt32)strtoul(argv[2], NULL, 10) : 10000000u);
+		log_shutdown();
+		return rc;
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-startup") == 0) {
+		int rc = bench_startup(argc > 2 ? (UA_UInt32)strtoul(argv[2], NULL, 10) : 10000u);
+		log_shutdown();
+		return rc;
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-history") == 0) {
+		int rc = bench_history(argc > 2 ? (UA_UInt32)strtoul(argv[2], NULL, 10) : 1000u);
+		log_shutdown();
+		return rc;
+	}
 
-	valve_handle_control_init(&valveRegulationQ);
-	valve_handle_control_init(&valveRegulationT);
-	valve_handle_control_init(&valveRegulationConcentrationA);
+	if (argc > 1 && strcmp(argv[1], "--bench-suite") == 0) {
+		int rc = bench_suite(argc > 2 ? argv[2] : NULL, config_bench_port);
+		log_shutdown();
+		return rc;
+	}
 
-	reactor_init(&reactor);
+	if (argc > 2 && strcmp(argv[1], "--replay") == 0) {
+		ReplayResult res;
+		int rc = 1;
+		if (recorder_replay(argv[2], &res) == UA_STATUSCODE_GOOD) {
+			printf("Replayed %llu ticks in %.3f s (%.1f us/tick): %llu ticks, %llu values differ\n",
+				(unsigned long long)res.ticks, res.elapsedNs / 1e9,
+				res.ticks ? res.elapsedNs / 1e3 / res.ticks : 0.0,
+				(unsigned long long)res.mismatchedTicks, (unsigned long long)res.mismatchedValues);
+			if (res.firstTick)
+				printf("First difference: tick %llu, reactor %u, sensor %u\n",
+					(unsigned long long)res.firstTick, res.firstReactor, res.firstSensor);
+			rc = res.mismatchedTicks ? 2 : 0;
+		}
+		log_shutdown();
+		return rc;
+	}
 
-	model_init(&modelCtx,
-		&sensorT,
-		&sensorF,
-		&sensorConcentrationA,
-		&sensorConcentrationB,
-		&reactor,
-		&valveRegulationConcentrationA,
-		&valveRegulationQ,
-		&valveRegulationT);
+	const char* plantFile = config_plant_file;
+	const char* recordFile = config_record_file;
+	const char* scenarioFile = config_scenario_file;
+	const char* substanceFile = config_substance_file;
+	UA_Double timeScale = config_time_scale;
+	UA_Boolean modelThreaded = config_model_thread;
+	ModelOverrunPolicy overrun = config_model_overrun;
+	for (int a = 1; a + 1 < argc; a += 2) {
+		if (strcmp(argv[a], "--plant") == 0)
+			plantFile = argv[a + 1];
+		else if (strcmp(argv[a], "--record") == 0)
+			recordFile = argv[a + 1];
+		else if (strcmp(argv[a], "--scenario") == 0)
+			scenarioFile = argv[a + 1];
+		else if (strcmp(argv[a], "--substances") == 0)
+			substanceFile = argv[a + 1];
+		else if (strcmp(argv[a], "--time-scale") == 0)
+			timeScale = strtod(argv[a + 1], NULL);
+		else if (strcmp(argv[a], "--model-thread") == 0) {
+			modelThreaded = model_overrun_policy_parse(argv[a + 1], &overrun) == UA_STATUSCODE_GOOD;
+			if (!modelThreaded)
+				LOG_MSG(LOG_LEVEL_WARN,
+					"Unknown overrun policy %s (skip, catch-up, slip), model runs as a server callback",
+					argv[a + 1]);
+		}
+	}
+	if (!(timeScale >= 0.0 && timeScale <= SIM_CLOCK_SCALE_MAX)) {
+		LOG_MSG(LOG_LEVEL_WARN, "Time scale out of range, running in real time (max %g)",
+			SIM_CLOCK_SCALE_MAX);
+		timeScale = 1.0;
+	}
 
+	Plant plant;
+	UA_StatusCode rc = plant_load(&plant, plantFile);
+	if (rc == UA_STATUSCODE_BADNOTFOUND) {
+		LOG_MSG(LOG_LEVEL_INFO, "No plant description %s, using the built-in plant of %u reactors",
+			plantFile, config_reactor_count);
+		plant_default(&plant, config_reactor_count);
+	}
+	else if (rc != UA_STATUSCODE_GOOD) {
+		log_shutdown();
+		return 1;
+	}
+
+	UA_Server* server = UA_Server_new();
+	UA_Server_getConfig(server)->monitoredItemRegisterCallback = binding_monitored_item_cb;
+
+	if (fleet_init(&fleet, plant.reactorCount) != UA_STATUSCODE_GOOD) {
+		LOG_MSG(LOG_LEVEL_ERROR, "Failed to allocate fleet of %u reactors", plant.reactorCount);
+		UA_Server_delete(server);
+		plant_clear(&plant);
+		log_shutdown();
+		return 1;
+	}
+
+	fleet.mode = config_model_mode;
+	fleet.ode.rtol = config_ode_rtol;
+	fleet.ode.atol = config_ode_atol;
+	fleet.ode.maxSteps = config_ode_max_steps;
+
+	compute_CB_batch_init();
+
+	if (engine_init(&engine, config_model_threads, config_model_chunk) != UA_STATUSCODE_GOOD)
+		LOG_MSG(LOG_LEVEL_WARN, "Model worker pool unavailable, stepping on the server thread");
+	else
+		LOG_MSG(LOG_LEVEL_INFO, "Model engine: %u workers, chunk %u",
+			engine_worker_count(&engine), config_model_chunk);
 
 	addSensorType(server);
 	addReactorType(server);        
@@ -63,23 +217,118 @@ int main(void) {
 	UA_NodeId SENSORS = UA_NODEID_NULL;
 	UA_NodeId REACTORS = UA_NODEID_NULL;
 
-	opc_ua_create_cell_folder(server, "Model", &MODEL);
-	opc_ua_create_cell_folder(server, "Valves", &VALVES);
-	opc_ua_create_cell_folder(server, "Sensors", &SENSORS);
-	opc_ua_create_cell_folder(server, "Reactors", &REACTORS);
-
-	opc_ua_create_reactor_instance(server, REACTORS, "1-F", &reactor);
-	opc_ua_create_math_model_instance(server, MODEL, "Config", &modelCtx);
-	opc_ua_create_sensor_instance(server, SENSORS, "FRA-1", UA_FALSE, &sensorF);
-	opc_ua_create_sensor_instance(server, SENSORS, "TRA-1", UA_FALSE, &sensorT);
-	opc_ua_create_sensor_instance(server, SENSORS, "CRA-1", UA_FALSE, &sensorConcentrationA);
-	opc_ua_create_sensor_instance(server, SENSORS, "CRA-2", UA_FALSE, &sensorConcentrationB);
-	opc_ua_create_valve_handle_control(server, VALVES, "HC-1", &valveRegulationConcentrationA);
-	opc_ua_create_valve_handle_control(server, VALVES, "HC-2", &valveRegulationQ);
-	opc_ua_create_valve_handle_control(server, VALVES, "HC-3", &valveRegulationT);
-
-	UA_Server_addRepeatedCallback(server, model_cb, &modelCtx, config_dt, &cbModelId);
-	UA_Server_runUntilInterrupt(server);
+	opc_ua_create_cell_folder(server, plant.folder[PLANT_FOLDER_MODEL], &MODEL);
+	opc_ua_create_cell_folder(server, plant.folder[PLANT_FOLDER_VALVES], &VALVES);
+	opc_ua_create_cell_folder(server, plant.folder[PLANT_FOLDER_SENSORS], &SENSORS);
+	opc_ua_create_cell_folder(server, plant.folder[PLANT_FOLDER_REACTORS], &REACTORS);
+
+	UA_NodeId DIAGNOSTICS = UA_NODEID_NULL;
+	opc_ua_create_cell_folder(server, "Diagnostics", &DIAGNOSTICS);
+	if (opc_ua_create_diagnostics(server, DIAGNOSTICS) != UA_STATUSCODE_GOOD)
+		LOG_MSG(LOG_LEVEL_WARN, "Diagnostics nodes are incomplete");
+
+	for (UA_UInt32 n = 0; n < plant.reactorCount; n++) {
+		UA_UInt32 i;
+		if (fleet_add_reactor(&fleet, &i) != UA_STATUSCODE_GOOD)
+			break;
+		plant_apply(&plant.reactors[n], &fleet, i);
+	}
+
+	Historian* hist = NULL;
+	if (config_history_depth) {
+		if (historian_init(&history, fleet.count, config_history_depth,
+			config_history_compression, config_history_deviation) == UA_STATUSCODE_GOOD) {
+			hist = &history;
+			LOG_MSG(LOG_LEVEL_INFO, "Historian: %u samples per sensor, %zu bytes per tag",
+				config_history_depth, historian_tag_bytes(&history));
+		}
+		else
+			LOG_MSG(LOG_LEVEL_WARN, "Historian unavailable, HistoryRead is not served");
+	}
+	UA_Boolean historizing = false;
+#ifdef UA_ENABLE_HISTORIZING
+	if (hist) {
+		UA_Server_getConfig(server)->historyDatabase = historian_database(hist);
+		historizing = true;
+	}
+#endif
+
+	SweepSet* sweepSet = NULL;
+	if (sweep_set_init(&sweeps, fleet.capacity) == UA_STATUSCODE_GOOD)
+		sweepSet = &sweeps;
+	else
+		LOG_MSG(LOG_LEVEL_WARN, "No memory for the sweeps, SWEEP is not served");
+
+	FleetNodeOptions nodes = { MODEL, VALVES, SENSORS, REACTORS,
+		config_sensor_publish_mode, config_deadband_type, config_deadband, historizing, sweepSet };
+	if (opc_ua_create_fleet_instances(server, &nodes, &fleet, plant.reactors, 0, fleet.count) != UA_STATUSCODE_GOOD)
+		LOG_MSG(LOG_LEVEL_ERROR, "Address space of the fleet is incomplete");
+	opc_ua_create_kinetics_method(server, MODEL);
+
+	ModelEngine* analysis = NULL;
+	if (engine_init(&estimateEngine, config_estimate_threads, config_estimate_chunk) == UA_STATUSCODE_GOOD)
+		analysis = &estimateEngine;
+	/* The worker answering methods reads the model while model_cb and the writers change it */
+	model_thread_share(&modelThread);
+	const UA_Boolean async = async_method_start(&asyncMethods, server) == UA_STATUSCODE_GOOD;
+	if (!async) {
+		model_thread_clear(&modelThread);
+		LOG_MSG(LOG_LEVEL_WARN, "No asynchronous methods, ESTIMATE_KINETICS, SWEEP and OPTIMIZE run on the server thread");
+	}
+	if (hist)
+		opc_ua_enable_estimation(server, hist, analysis, async);
+	opc_ua_enable_reactor_methods(server, analysis, async);
+
+	Scenario scenario;
+	Scenario* scen = NULL;
+	if (scenarioFile && scenario_load(&scenario, scenarioFile, &plant) == UA_STATUSCODE_GOOD)
+		scen = &scenario;
+	plant_clear(&plant);
+
+	if (substanceFile) {
+		if (substance_library_open(&substances, substanceFile) == UA_STATUSCODE_BADNOTFOUND)
+			LOG_MSG(LOG_LEVEL_INFO, "No substance library %s yet, loaded once it appears", substanceFile);
+		fleet.substances = &substances;
+		UA_Server_addRepeatedCallback(server, substance_poll_cb, &substances, config_substance_poll_ms, NULL);
+	}
+
+	SimClock clock;
+	sim_clock_init(&clock, (UA_UInt32)config_dt, timeScale, UA_DateTime_now(), platform_now_ns());
+	opc_ua_create_simulation_object(server, &clock);
+
+	TickRecorder recorder;
+	TickRecorder* rec = NULL;
+	if (recordFile && recorder_open(&recorder, recordFile, &fleet, config_dt) == UA_STATUSCODE_GOOD)
+		rec = &recorder;
+
+	ModelRunner runner = { &fleet, &engine, hist, rec, &clock, scen, { 0 } };
+	if (modelThreaded && model_thread_start(&modelThread, server, &runner, overrun,
+		config_model_catch_up_max, config_model_thread_cpu, config_model_thread_priority) != UA_STATUSCODE_GOOD) {
+		LOG_MSG(LOG_LEVEL_WARN, "Model thread unavailable, running the model as a server callback");
+		modelThreaded = false;
+	}
+	if (!modelThreaded) {
+		UA_Server_addRepeatedCallback(server, model_cb, &runner, sim_clock_period_ms(&clock), &cbModelId);
+		clock.callbackId = cbModelId;
+	}
+	UA_Server_addRepeatedCallback(server, diag_cb, NULL, config_diag_period_ms, NULL);
+	server_loop_run(server);
+	model_thread_stop(&modelThread);
+	async_method_stop(&asyncMethods);
+	model_thread_clear(&modelThread);
 	UA_Server_delete(server);
+	binding_free_all();
+	engine_clear(&engine);
+	if (analysis)
+		engine_clear(analysis);
+	sweep_set_clear(&sweeps);
+	historian_clear(&history);
+	if (rec)
+		recorder_close(rec);
+	if (scen)
+		scenario_clear(scen);
+	fleet_clear(&fleet);
+	substance_library_clear(&substances);
+	log_shutdown();
     return 0;
 }
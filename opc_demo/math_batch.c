@@ -0,0 +1,447 @@
+﻿/**
+ * @file math_batch.c
+ * @brief Batched, vectorized evaluation of the steady-state CB model.
+ *
+ * compute_CB_batch() evaluates compute_CB_values() for a whole column of
+ * reactors at once. Three implementations are provided:
+ *
+ *   - scalar  – plain loop over compute_CB_values(), always available;
+ *   - AVX2    – 4 reactors per iteration;
+ *   - AVX-512 – 8 reactors per iteration.
+ *
+ * The vector paths use their own exp() (Cody-Waite range reduction and a
+ * degree 13 polynomial, accurate to about one ulp) and IEEE division, and
+ * reproduce the NaN results of the scalar model for an invalid temperature
+ * and for a == 0 or b == 0.
+ *
+ * compute_CB_batch_rates() additionally hands out the Arrhenius rate
+ * constants of every reactor, which the model caches so that later
+ * ticks can recompute CB without exp() (see model_step()).
+ *
+ * compute_CB_batch_init() picks the widest instruction set supported by
+ * the CPU and the operating system. compute_CB_batch_verify() checks a
+ * vector path against the scalar one on a fixed set of inputs, within
+ * CB_BATCH_MAX_REL_ERROR; the math_batch_verify test of the CMake build
+ * (math_batch_test.c) runs it for every path the CPU supports, so the
+ * server does not repeat it on each startup.
+ */
+
+#include <string.h>
+#include <float.h>
+#include "math_batch.h"
+#include "math_model.h"
+#include "log.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CB_BATCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CB_TARGET_AVX2
+#define CB_TARGET_AVX512
+#else
+#include <cpuid.h>
+#define CB_TARGET_AVX2 __attribute__((target("avx2")))
+#define CB_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#endif
+
+/* Largest relative deviation from the scalar path accepted by the check */
+#define CB_BATCH_MAX_REL_ERROR 1e-12
+
+/* Number of generated inputs used by compute_CB_batch_verify() */
+#define CB_BATCH_VERIFY_COUNT 1027
+
+static CbBatchIsa g_isa = CB_BATCH_SCALAR;
+
+static void cb_batch_scalar(const CbBatchInput* in, UA_Double* out,
+    UA_Double* k1Out, UA_Double* k2Out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (!k1Out) {
+            out[i] = compute_CB_values(in->T[i], in->F[i], in->CA[i], in->volume[i],
+                in->k01[i], in->EA1[i], in->k02[i], in->EA2[i], in->R[i]);
+            continue;
+        }
+        const double T_K = in->T[i] + 273.15;
+        k1Out[i] = arrhenius_rate(in->k01[i], in->EA1[i], in->R[i], T_K);
+        k2Out[i] = arrhenius_rate(in->k02[i], in->EA2[i], in->R[i], T_K);
+        out[i] = (!isfinite(T_K) || T_K <= 0.0) ? NAN :
+            compute_CB_rates(in->F[i], in->CA[i], in->volume[i], k1Out[i], k2Out[i]);
+    }
+}
+
+#ifdef CB_BATCH_X86
+
+/* exp() constants shared by both vector paths */
+#define EXP_MAGIC   6755399441055744.0          /* 1.5 * 2^52 */
+#define EXP_LOG2E   1.4426950408889634
+#define EXP_LN2_HI  6.93147180369123816490e-01  /* low 32 bits zero */
+#define EXP_LN2_LO  1.90821492927058770002e-10
+#define EXP_X_MIN   -746.0
+#define EXP_X_MAX   710.0
+
+static const double exp_poly[] = {
+    1.0 / 6227020800.0,  /* 1/13! */
+    1.0 / 479001600.0,
+    1.0 / 39916800.0,
+    1.0 / 3628800.0,
+    1.0 / 362880.0,
+    1.0 / 40320.0,
+    1.0 / 5040.0,
+    1.0 / 720.0,
+    1.0 / 120.0,
+    1.0 / 24.0,
+    1.0 / 6.0,
+    1.0 / 2.0,
+    1.0,
+    1.0                  /* 1/0! */
+};
+
+static void cpuid(int leaf, int sub, unsigned int r[4]) {
+#if defined(_MSC_VER)
+    int x[4];
+    __cpuidex(x, leaf, sub);
+    memcpy(r, x, sizeof(x));
+#else
+    __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+static unsigned long long xgetbv0(void) {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+/**
+ * @brief Returns the widest instruction set usable on this machine.
+ *
+ * Checks both the CPUID feature bits and XCR0, so a CPU with AVX-512
+ * under an OS that does not save the ZMM state is treated as AVX2.
+ */
+static CbBatchIsa detect_isa(void) {
+    unsigned int r[4];
+    cpuid(0, 0, r);
+    if (r[0] < 7)
+        return CB_BATCH_SCALAR;
+
+    cpuid(1, 0, r);
+    const unsigned int osxsave = 1u << 27, avx = 1u << 28;
+    if ((r[2] & (osxsave | avx)) != (osxsave | avx))
+        return CB_BATCH_SCALAR;
+
+    const unsigned long long xcr0 = xgetbv0();
+    if ((xcr0 & 0x6) != 0x6)        /* XMM and YMM state */
+        return CB_BATCH_SCALAR;
+
+    cpuid(7, 0, r);
+    const UA_Boolean hasAvx2 = (r[1] & (1u << 5)) != 0;
+    const UA_Boolean hasAvx512f = (r[1] & (1u << 16)) != 0;
+
+    if (hasAvx512f && (xcr0 & 0xE6) == 0xE6)  /* opmask and ZMM state */
+        return CB_BATCH_AVX512;
+    if (hasAvx2)
+        return CB_BATCH_AVX2;
+    return CB_BATCH_SCALAR;
+}
+
+/* 2^n for integral n in [-1022, 1023] stored as double */
+CB_TARGET_AVX2 static __m256d pow2_avx2(__m256d n) {
+    const __m256d magic = _mm256_set1_pd(EXP_MAGIC);
+    __m256i i = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n, magic)),
+        _mm256_castpd_si256(magic));
+    i = _mm256_slli_epi64(_mm256_add_epi64(i, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_castsi256_pd(i);
+}
+
+CB_TARGET_AVX2 static __m256d exp_avx2(__m256d x) {
+    __m256d xc = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(EXP_X_MIN)),
+        _mm256_set1_pd(EXP_X_MAX));
+
+    const __m256d magic = _mm256_set1_pd(EXP_MAGIC);
+    __m256d n = _mm256_sub_pd(
+        _mm256_add_pd(_mm256_mul_pd(xc, _mm256_set1_pd(EXP_LOG2E)), magic), magic);
+    __m256d r = _mm256_sub_pd(
+        _mm256_sub_pd(xc, _mm256_mul_pd(n, _mm256_set1_pd(EXP_LN2_HI))),
+        _mm256_mul_pd(n, _mm256_set1_pd(EXP_LN2_LO)));
+
+    __m256d p = _mm256_set1_pd(exp_poly[0]);
+    for (size_t k = 1; k < sizeof(exp_poly) / sizeof(exp_poly[0]); k++)
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(exp_poly[k]));
+
+    /* Split 2^n in two factors so results down to the subnormal range work */
+    __m256d n1 = _mm256_floor_pd(_mm256_mul_pd(n, _mm256_set1_pd(0.5)));
+    __m256d n2 = _mm256_sub_pd(n, n1);
+    __m256d y = _mm256_mul_pd(_mm256_mul_pd(p, pow2_avx2(n1)), pow2_avx2(n2));
+
+    __m256d isNan = _mm256_cmp_pd(x, x, _CMP_UNORD_Q);
+    return _mm256_blendv_pd(y, x, isNan);
+}
+
+CB_TARGET_AVX2 static void cb_batch_avx2(const CbBatchInput* in, UA_Double* out,
+    UA_Double* k1Out, UA_Double* k2Out, size_t n) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d inf = _mm256_set1_pd(INFINITY);
+    const __m256d nan = _mm256_set1_pd(NAN);
+    const __m256d signBit = _mm256_set1_pd(-0.0);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d T_K = _mm256_add_pd(_mm256_loadu_pd(in->T + i), _mm256_set1_pd(273.15));
+        __m256d valid = _mm256_and_pd(_mm256_cmp_pd(T_K, zero, _CMP_GT_OQ),
+            _mm256_cmp_pd(_mm256_andnot_pd(signBit, T_K), inf, _CMP_LT_OQ));
+
+        __m256d Q = _mm256_div_pd(
+            _mm256_mul_pd(_mm256_loadu_pd(in->F + i), _mm256_set1_pd(1e-3)),
+            _mm256_set1_pd(60.0));
+        __m256d Vr = _mm256_mul_pd(_mm256_loadu_pd(in->volume + i), _mm256_set1_pd(1e-3));
+        __m256d RT = _mm256_mul_pd(_mm256_loadu_pd(in->R + i), T_K);
+
+        __m256d e1 = exp_avx2(_mm256_div_pd(
+            _mm256_xor_pd(_mm256_loadu_pd(in->EA1 + i), signBit), RT));
+        __m256d e2 = exp_avx2(_mm256_div_pd(
+            _mm256_xor_pd(_mm256_loadu_pd(in->EA2 + i), signBit), RT));
+        __m256d k1 = _mm256_mul_pd(
+            _mm256_div_pd(_mm256_loadu_pd(in->k01 + i), _mm256_set1_pd(60.0)), e1);
+        __m256d k2 = _mm256_mul_pd(
+            _mm256_div_pd(_mm256_loadu_pd(in->k02 + i), _mm256_set1_pd(60.0)), e2);
+        if (k1Out) {
+            _mm256_storeu_pd(k1Out + i, k1);
+            _mm256_storeu_pd(k2Out + i, k2);
+        }
+
+        __m256d a = _mm256_add_pd(_mm256_mul_pd(Vr, k1), Q);
+        __m256d b = _mm256_add_pd(_mm256_mul_pd(Vr, k2), Q);
+        valid = _mm256_and_pd(valid, _mm256_and_pd(
+            _mm256_cmp_pd(a, zero, _CMP_NEQ_UQ), _mm256_cmp_pd(b, zero, _CMP_NEQ_UQ)));
+
+        __m256d num = _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(
+            _mm256_mul_pd(_mm256_set1_pd(2.0), Vr), k1), Q), _mm256_loadu_pd(in->CA + i));
+        __m256d cb = _mm256_div_pd(num, _mm256_mul_pd(a, b));
+
+        _mm256_storeu_pd(out + i, _mm256_blendv_pd(nan, cb, valid));
+    }
+
+    if (i < n) {
+        CbBatchInput tail = {
+            in->T + i, in->F + i, in->CA + i, in->volume + i,
+            in->k01 + i, in->EA1 + i, in->k02 + i, in->EA2 + i, in->R + i
+        };
+        cb_batch_scalar(&tail, out + i, k1Out ? k1Out + i : NULL, k2Out ? k2Out + i : NULL, n - i);
+    }
+}
+
+CB_TARGET_AVX512 static __m512d pow2_avx512(__m512d n) {
+    const __m512d magic = _mm512_set1_pd(EXP_MAGIC);
+    __m512i i = _mm512_sub_epi64(_mm512_castpd_si512(_mm512_add_pd(n, magic)),
+        _mm512_castpd_si512(magic));
+    i = _mm512_slli_epi64(_mm512_add_epi64(i, _mm512_set1_epi64(1023)), 52);
+    return _mm512_castsi512_pd(i);
+}
+
+CB_TARGET_AVX512 static __m512d exp_avx512(__m512d x) {
+    __m512d xc = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(EXP_X_MIN)),
+        _mm512_set1_pd(EXP_X_MAX));
+
+    const __m512d magic = _mm512_set1_pd(EXP_MAGIC);
+    __m512d n = _mm512_sub_pd(
+        _mm512_add_pd(_mm512_mul_pd(xc, _mm512_set1_pd(EXP_LOG2E)), magic), magic);
+    __m512d r = _mm512_sub_pd(
+        _mm512_sub_pd(xc, _mm512_mul_pd(n, _mm512_set1_pd(EXP_LN2_HI))),
+        _mm512_mul_pd(n, _mm512_set1_pd(EXP_LN2_LO)));
+
+    __m512d p = _mm512_set1_pd(exp_poly[0]);
+    for (size_t k = 1; k < sizeof(exp_poly) / sizeof(exp_poly[0]); k++)
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(exp_poly[k]));
+
+    __m512d n1 = _mm512_roundscale_pd(_mm512_mul_pd(n, _mm512_set1_pd(0.5)),
+        _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    __m512d n2 = _mm512_sub_pd(n, n1);
+    __m512d y = _mm512_mul_pd(_mm512_mul_pd(p, pow2_avx512(n1)), pow2_avx512(n2));
+
+    __mmask8 isNan = _mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q);
+    return _mm512_mask_blend_pd(isNan, y, x);
+}
+
+CB_TARGET_AVX512 static void cb_batch_avx512(const CbBatchInput* in, UA_Double* out,
+    UA_Double* k1Out, UA_Double* k2Out, size_t n) {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d inf = _mm512_set1_pd(INFINITY);
+    const __m512d nan = _mm512_set1_pd(NAN);
+    const __m512i signBit = _mm512_set1_epi64((long long)0x8000000000000000ULL);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d T_K = _mm512_add_pd(_mm512_loadu_pd(in->T + i), _mm512_set1_pd(273.15));
+        __m512d absT = _mm512_castsi512_pd(_mm512_andnot_si512(signBit, _mm512_castpd_si512(T_K)));
+        __mmask8 valid = _mm512_cmp_pd_mask(T_K, zero, _CMP_GT_OQ) &
+            _mm512_cmp_pd_mask(absT, inf, _CMP_LT_OQ);
+
+        __m512d Q = _mm512_div_pd(
+            _mm512_mul_pd(_mm512_loadu_pd(in->F + i), _mm512_set1_pd(1e-3)),
+            _mm512_set1_pd(60.0));
+        __m512d Vr = _mm512_mul_pd(_mm512_loadu_pd(in->volume + i), _mm512_set1_pd(1e-3));
+        __m512d RT = _mm512_mul_pd(_mm512_loadu_pd(in->R + i), T_K);
+
+        __m512d negEA1 = _mm512_castsi512_pd(_mm512_xor_si512(
+            _mm512_castpd_si512(_mm512_loadu_pd(in->EA1 + i)), signBit));
+        __m512d negEA2 = _mm512_castsi512_pd(_mm512_xor_si512(
+            _mm512_castpd_si512(_mm512_loadu_pd(in->EA2 + i)), signBit));
+        __m512d k1 = _mm512_mul_pd(
+            _mm512_div_pd(_mm512_loadu_pd(in->k01 + i), _mm512_set1_pd(60.0)),
+            exp_avx512(_mm512_div_pd(negEA1, RT)));
+        __m512d k2 = _mm512_mul_pd(
+            _mm512_div_pd(_mm512_loadu_pd(in->k02 + i), _mm512_set1_pd(60.0)),
+            exp_avx512(_mm512_div_pd(negEA2, RT)));
+        if (k1Out) {
+            _mm512_storeu_pd(k1Out + i, k1);
+            _mm512_storeu_pd(k2Out + i, k2);
+        }
+
+        __m512d a = _mm512_add_pd(_mm512_mul_pd(Vr, k1), Q);
+        __m512d b = _mm512_add_pd(_mm512_mul_pd(Vr, k2), Q);
+        valid &= _mm512_cmp_pd_mask(a, zero, _CMP_NEQ_UQ) &
+            _mm512_cmp_pd_mask(b, zero, _CMP_NEQ_UQ);
+
+        __m512d num = _mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(
+            _mm512_mul_pd(_mm512_set1_pd(2.0), Vr), k1), Q), _mm512_loadu_pd(in->CA + i));
+        __m512d cb = _mm512_div_pd(num, _mm512_mul_pd(a, b));
+
+        _mm512_storeu_pd(out + i, _mm512_mask_blend_pd(valid, nan, cb));
+    }
+
+    if (i < n) {
+        CbBatchInput tail = {
+            in->T + i, in->F + i, in->CA + i, in->volume + i,
+            in->k01 + i, in->EA1 + i, in->k02 + i, in->EA2 + i, in->R + i
+        };
+        cb_batch_scalar(&tail, out + i, k1Out ? k1Out + i : NULL, k2Out ? k2Out + i : NULL, n - i);
+    }
+}
+
+#endif /* CB_BATCH_X86 */
+
+UA_Boolean compute_CB_batch_isa_supported(CbBatchIsa isa) {
+    if (isa == CB_BATCH_SCALAR)
+        return true;
+#ifdef CB_BATCH_X86
+    return isa <= detect_isa();
+#else
+    return false;
+#endif
+}
+
+const char* compute_CB_batch_isa_name(CbBatchIsa isa) {
+    switch (isa) {
+    case CB_BATCH_AVX2: return "AVX2";
+    case CB_BATCH_AVX512: return "AVX-512";
+    default: return "scalar";
+    }
+}
+
+static void cb_batch_run(CbBatchIsa isa, const CbBatchInput* in, UA_Double* out,
+    UA_Double* k1, UA_Double* k2, size_t n) {
+    switch (isa) {
+#ifdef CB_BATCH_X86
+    case CB_BATCH_AVX2: cb_batch_avx2(in, out, k1, k2, n); break;
+    case CB_BATCH_AVX512: cb_batch_avx512(in, out, k1, k2, n); break;
+#endif
+    default: cb_batch_scalar(in, out, k1, k2, n); break;
+    }
+}
+
+void compute_CB_batch_isa_run(CbBatchIsa isa, const CbBatchInput* in, UA_Double* out, size_t n) {
+    cb_batch_run(isa, in, out, NULL, NULL, n);
+}
+
+void compute_CB_batch(const CbBatchInput* in, UA_Double* out, size_t n) {
+    cb_batch_run(g_isa, in, out, NULL, NULL, n);
+}
+
+/**
+ * @brief compute_CB_batch() that also stores the rate constants k1 and k2 (1/s).
+ *
+ * The rates are those of arrhenius_rate(), so a later compute_CB_rates()
+ * with them reproduces out[] without evaluating exp() again.
+ */
+void compute_CB_batch_rates(const CbBatchInput* in, UA_Double* out,
+    UA_Double* k1, UA_Double* k2, size_t n) {
+    cb_batch_run(g_isa, in, out, k1, k2, n);
+}
+
+CbBatchIsa compute_CB_batch_isa(void) {
+    return g_isa;
+}
+
+/**
+ * @brief Compares one instruction set against the scalar path.
+ *
+ * Generates a deterministic spread of inputs that also covers invalid
+ * temperatures, closed valves and extreme activation energies, and
+ * requires identical NaN results and a relative error of at most
+ * CB_BATCH_MAX_REL_ERROR everywhere else.
+ */
+UA_Boolean compute_CB_batch_verify(CbBatchIsa isa, double* maxRelError) {
+    enum { N = CB_BATCH_VERIFY_COUNT };
+    static UA_Double col[9][N], ref[N], got[N];
+
+    UA_UInt32 seed = 12345u;
+    for (size_t i = 0; i < N; i++) {
+        double u[9];
+        for (int c = 0; c < 9; c++) {
+            seed = seed * 1664525u + 1013904223u;
+            u[c] = (seed >> 8) / 16777216.0;
+        }
+        col[0][i] = -300.0 + 700.0 * u[0];                   /* T, some invalid */
+        col[1][i] = (i % 17 == 0) ? 0.0 : 160.0 * u[1];       /* F, some closed */
+        col[2][i] = 0.9 * u[2];                               /* CA */
+        col[3][i] = 1.0 + 999.0 * u[3];                       /* volume */
+        col[4][i] = pow(10.0, 12.0 * u[4]);                   /* k01 */
+        col[5][i] = (i % 13 == 0) ? 0.0 : 1.5e5 * u[5];       /* EA1 */
+        col[6][i] = pow(10.0, 12.0 * u[6]);                   /* k02 */
+        col[7][i] = (i % 11 == 0) ? 2.0e6 * u[7] : 1.5e5 * u[7]; /* EA2 */
+        col[8][i] = 8.314;                                    /* R */
+    }
+
+    CbBatchInput in = {
+        col[0], col[1], col[2], col[3], col[4], col[5], col[6], col[7], col[8]
+    };
+    cb_batch_scalar(&in, ref, NULL, NULL, N);
+    compute_CB_batch_isa_run(isa, &in, got, N);
+
+    double worst = 0.0;
+    UA_Boolean ok = true;
+    for (size_t i = 0; i < N; i++) {
+        if (isnan(ref[i]) || isnan(got[i])) {
+            if (isnan(ref[i]) != isnan(got[i]))
+                ok = false;
+            continue;
+        }
+        double scale = fabs(ref[i]) > DBL_MIN ? fabs(ref[i]) : DBL_MIN;
+        double rel = fabs(got[i] - ref[i]) / scale;
+        if (rel > worst)
+            worst = rel;
+    }
+
+    if (maxRelError)
+        *maxRelError = worst;
+    return ok && worst <= CB_BATCH_MAX_REL_ERROR;
+}
+
+/**
+ * @brief Selects the widest instruction set the CPU and the OS support.
+ */
+CbBatchIsa compute_CB_batch_init(void) {
+    CbBatchIsa isa = CB_BATCH_SCALAR;
+#ifdef CB_BATCH_X86
+    isa = detect_isa();
+#endif
+
+    LOG_MSG(LOG_LEVEL_INFO, "compute_CB_batch: using %s path", compute_CB_batch_isa_name(isa));
+    g_isa = isa;
+    return isa;
+}
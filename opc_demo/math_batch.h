@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include "types.h"
+
+/* Instruction set used by compute_CB_batch() */
+typedef enum {
+    CB_BATCH_SCALAR,
+    CB_BATCH_AVX2,
+    CB_BATCH_AVX512
+} CbBatchIsa;
+
+/*
+ * Column pointers of one batch. Element i of every array describes one
+ * reactor, in the same units as the fleet: T in degC, F in l/min,
+ * volume in l, EA in J/mol.
+ */
+typedef struct {
+    const UA_Double* T;
+    const UA_Double* F;
+    const UA_Double* CA;
+    const UA_Double* volume;
+    const UA_Double* k01;
+    const UA_Double* EA1;
+    const UA_Double* k02;
+    const UA_Double* EA2;
+    const UA_Double* R;
+} CbBatchInput;
+
+CbBatchIsa compute_CB_batch_init(void);
+CbBatchIsa compute_CB_batch_isa(void);
+const char* compute_CB_batch_isa_name(CbBatchIsa isa);
+UA_Boolean compute_CB_batch_isa_supported(CbBatchIsa isa);
+UA_Boolean compute_CB_batch_verify(CbBatchIsa isa, double* maxRelError);
+
+void compute_CB_batch(const CbBatchInput* in, UA_Double* out, size_t n);
+void compute_CB_batch_rates(const CbBatchInput* in, UA_Double* out,
+    UA_Double* k1, UA_Double* k2, size_t n);
+void compute_CB_batch_isa_run(CbBatchIsa isa, const CbBatchInput* in, UA_Double* out, size_t n);
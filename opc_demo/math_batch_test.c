@@ -0,0 +1,29 @@
+/**
+ * @file math_batch_test.c
+ * @brief Entry point of the opc_demo_test_math_batch test.
+ *
+ * Checks every vector path of compute_CB_batch() the CPU supports against
+ * the scalar path with compute_CB_batch_verify(). Registered with ctest
+ * as math_batch_verify; the exit code is 0 when every supported path
+ * matches. Paths the CPU lacks are skipped.
+ */
+
+#include <stdio.h>
+#include "math_batch.h"
+
+int main(void) {
+	int failed = 0;
+	for (int isa = CB_BATCH_AVX2; isa <= CB_BATCH_AVX512; isa++) {
+		const char* name = compute_CB_batch_isa_name((CbBatchIsa)isa);
+		if (!compute_CB_batch_isa_supported((CbBatchIsa)isa)) {
+			printf("%s: not supported by this CPU, skipped\n", name);
+			continue;
+		}
+		double err = 0.0;
+		const UA_Boolean ok = compute_CB_batch_verify((CbBatchIsa)isa, &err);
+		printf("%s: %s, max rel. error %.3g\n", name, ok ? "ok" : "FAILED", err);
+		if (!ok)
+			failed++;
+	}
+	return failed ? 1 : 0;
+}
@@ -6,138 +6,530 @@
  *   - The steady-state mathematical model compute_CB(), which calculates the
  *     outlet concentration CB based on reactor configuration, temperature,
  *     volumetric flow rate, and inlet concentration CA.
+ *   - model_step(), which advances a contiguous index range of the reactor
+ *     fleet in one pass over its struct-of-arrays storage:
+ *       * consumes the per-reactor inputDirty flags set by client writes
+ *         (see binding.c) and counts the reactors whose inputs changed;
+ *       * updates sensor process values of changed reactors from the
+ *         valve opening degree through the characteristic of every
+ *         valve (valve_curve.h), a whole block at a time;
+ *       * keeps the Arrhenius rate constants k1/k2 of every reactor in
+ *         the fleet and re-evaluates them only when the temperature or
+ *         the kinetic inputs changed;
+ *       * in steady-state mode evaluates the CB model only for reactors
+ *         whose inputs changed, blocks of 8 that need new rates throughout
+ *         with compute_CB_batch_rates(); in dynamic mode integrates the
+ *         CA/CB mass balances of each reactor over the tick with
+ *         cstr_integrate();
+ *       * writes each result to the CB sensor if valid;
+ *       * counts the rate and CB evaluations done and skipped.
+ *   - model_run_tick(), which spreads model_step() over the worker pool
+ *     of a ModelEngine (see engine.c) in disjoint index ranges, copies
+ *     every stepped range into the back snapshot and publishes it once
+ *     the whole fleet has been stepped.
  *   - The periodic callback model_cb(), which is registered in the OPC UA
- *     server and:
- *       * updates sensor process values according to valve opening degree
- *         using valve_characteristic*() functions;
- *       * calls compute_CB() and writes the result to the CB sensor if valid.
- *   - Nonlinear valve characteristic functions that map manual output
- *     (0–100 %) of valves to physical quantities:
- *       * valve_characteristic()   – flow rate sensor (Q),
- *       * valve_characteristicCA() – inlet concentration CA,
- *       * valve_characteristicT()  – temperature offset for the reactor.
+ *     server, runs the ticks its ModelRunner's simulation clock has due
+ *     (see sim_clock.c; one tick per call without a clock). Each tick
+ *     first swaps in the kinetic configurations staged since the last
+ *     one (fleet_apply_staged()), applies the scenario events that
+ *     have become due and switches reactors whose SUBSTANCE_ID changed
+ *     to the kinetics of the substance library (substance_apply()), and is
+ *     followed by pushing the changed values of push mode sensors
+ *     (publish_tick()), recording it in the historian and the tick
+ *     recorder and, at trace log level, queueing the per-reactor trace in
+ *     the asynchronous logger. The wall time of every call and the
+ *     jitter of its timer go to the diagnostics (diag.c). The ticks run
+ *     under model_thread_lock(), which guards the model against methods
+ *     answered off the server thread (model_thread_share()). model_tick(),
+ *     one such tick, is what a dedicated model thread (model_thread.c)
+ *     runs instead.
  *
- * All functions operate on structures provided by the caller; no dynamic
- * memory allocation is performed.
+ * The model mode and integrator tolerances are taken from the fleet
+ * (config_model_mode, config_ode_*). All functions operate on structures
+ * provided by the caller; no dynamic memory allocation is performed.
  */
 
+#include <string.h>
 #include "math_model.h"
+#include "math_batch.h"
+#include "fleet.h"
+#include "publish.h"
+#include "log.h"
+#include "config.h"
+#include "cstr_ode.h"
+#include "valve_curve.h"
+#include "historian.h"
+#include "recorder.h"
+#include "sim_clock.h"
+#include "scenario.h"
+#include "substance.h"
+#include "diag.h"
+#include "platform.h"
 
 double compute_CB(Reactor reactor, Sensor sensorTemperature,
     ConfigMathModel config, Sensor sensorQ, Sensor sensorConcentrationA)
 {
-    printf("\nStarting mathematical model:\n\n");
-    const double R = config.R;
-    const double T_K = sensorTemperature.pv + 273.15;
-    if (!isfinite(T_K) || T_K <= 0.0) {
-        printf("Invalid temperature T=%.2f\n", T_K);
-        return NAN;
+    return compute_CB_values(sensorTemperature.pv, sensorQ.pv, sensorConcentrationA.pv,
+        reactor.volume, config.k01, config.EA1, config.k02, config.EA2, config.R);
+}
+
+void model_step_stats_merge(ModelStepStats* into, const ModelStepStats* from) {
+    into->inputsChanged += from->inputsChanged;
+    into->ratesComputed += from->ratesComputed;
+    into->ratesSkipped += from->ratesSkipped;
+    into->cbComputed += from->cbComputed;
+    into->cbSkipped += from->cbSkipped;
+    into->odeSteps += from->odeSteps;
+    into->odeRejected += from->odeRejected;
+    into->odeBudgetHits += from->odeBudgetHits;
+    if (from->odeMaxError > into->odeMaxError)
+        into->odeMaxError = from->odeMaxError;
+}
+
+/* Reactors per block of the steady-state pass; engine ranges are aligned to it */
+#define MODEL_BLOCK 8
+
+/**
+ * @brief Consumes the dirty flags of reactor i and refreshes its valve process values.
+ *
+ * @return the FLEET_DIRTY_* bits that were set.
+ */
+static inline UA_Byte model_take_inputs(ReactorFleet* f, UA_UInt32 i) {
+    const UA_Byte d = f->inputDirty[i];
+    if (!d)
+        return 0;
+
+    /* The inputs of this tick are consumed; later writes set the flags again */
+    f->inputDirty[i] = 0;
+    const double hcCA = f->manualoutput[FLEET_VALVE_CA][i];
+    f->pv[FLEET_SENSOR_F][i] = valve_curve_value(f->valveCurve[FLEET_VALVE_Q][i],
+        f->manualoutput[FLEET_VALVE_Q][i]);
+    f->pv[FLEET_SENSOR_CA][i] = valve_curve_value(f->valveCurve[FLEET_VALVE_CA][i], hcCA);
+    f->pv[FLEET_SENSOR_T][i] = (hcCA == 0.0) ? 0.0 :
+        valve_curve_value(f->valveCurve[FLEET_VALVE_T][i], f->manualoutput[FLEET_VALVE_T][i]);
+    return d;
+}
+
+/**
+ * @brief Refreshes the valve process values of reactors [begin, end) in one sweep.
+ *
+ * Same values as model_take_inputs(), evaluated valve by valve over the
+ * block. Reactors whose inputs did not change get the values they
+ * already had.
+ */
+static void model_valves_block(ReactorFleet* f, UA_UInt32 begin, UA_UInt32 end) {
+    const size_t n = end - begin;
+    const UA_Double* hcCA = f->manualoutput[FLEET_VALVE_CA] + begin;
+    UA_Double* pvT = f->pv[FLEET_SENSOR_T] + begin;
+
+    valve_curve_eval(f->valveCurve[FLEET_VALVE_Q] + begin,
+        f->manualoutput[FLEET_VALVE_Q] + begin, f->pv[FLEET_SENSOR_F] + begin, n);
+    valve_curve_eval(f->valveCurve[FLEET_VALVE_CA] + begin, hcCA, f->pv[FLEET_SENSOR_CA] + begin, n);
+    valve_curve_eval(f->valveCurve[FLEET_VALVE_T] + begin,
+        f->manualoutput[FLEET_VALVE_T] + begin, pvT, n);
+    for (size_t k = 0; k < n; k++)
+        pvT[k] = (hcCA[k] == 0.0) ? 0.0 : pvT[k];
+}
+
+/**
+ * @brief Tells whether the cached rate constants of reactor i are out of date.
+ *
+ * They are when a kinetic input was written or the temperature moved;
+ * rateT is NAN until the first evaluation, which never compares equal.
+ */
+static inline UA_Boolean model_rates_stale(const ReactorFleet* f, UA_UInt32 i, UA_Byte dirty) {
+    return (dirty & FLEET_DIRTY_KINETICS) || !(f->pv[FLEET_SENSOR_T][i] == f->rateT[i]);
+}
+
+static inline void model_update_rates(ReactorFleet* f, UA_UInt32 i) {
+    const double T_C = f->pv[FLEET_SENSOR_T][i];
+    const double T_K = T_C + 273.15;
+    f->rateK1[i] = arrhenius_rate(f->k01[i], f->EA1[i], f->R[i], T_K);
+    f->rateK2[i] = arrhenius_rate(f->k02[i], f->EA2[i], f->R[i], T_K);
+    f->rateT[i] = T_C;
+}
+
+/**
+ * @brief Integrates the dynamic model of reactors [begin, end) over dt seconds.
+ *
+ * The rate constants are frozen for the tick; they come from the cache
+ * unless the temperature or the kinetics changed. A reactor with an
+ * invalid temperature or volume keeps its state.
+ * Counters are summed locally and merged into stats once, so workers
+ * stepping neighbouring ranges do not contend on the same cache line.
+ */
+static void model_step_dynamic(ReactorFleet* f, UA_UInt32 begin, UA_UInt32 end,
+    UA_Double dt, ModelStepStats* stats)
+{
+    const UA_Double* pvF = f->pv[FLEET_SENSOR_F];
+    const UA_Double* pvT = f->pv[FLEET_SENSOR_T];
+    const UA_Double* pvCA = f->pv[FLEET_SENSOR_CA];
+    UA_Double* pvCB = f->pv[FLEET_SENSOR_CB];
+    ModelStepStats local = { 0 };
+
+    for (UA_UInt32 i = begin; i < end; i++) {
+        const UA_Byte dirty = model_take_inputs(f, i);
+        local.inputsChanged += dirty ? 1 : 0;
+
+        const double T_K = pvT[i] + 273.15;
+        const double Vr = f->volume[i] * 1e-3;
+        if (!isfinite(T_K) || T_K <= 0.0 || !(Vr > 0.0))
+            continue;
+
+        if (model_rates_stale(f, i, dirty)) {
+            model_update_rates(f, i);
+            local.ratesComputed++;
+        }
+        else {
+            local.ratesSkipped++;
+        }
+
+        CstrRates rates;
+        rates.q = (pvF[i] * 1e-3 / 60.0) / Vr;
+        rates.k1 = f->rateK1[i];
+        rates.k2 = f->rateK2[i];
+        rates.caIn = pvCA[i];
+
+        OdeResult r;
+        cstr_integrate(&rates, &f->stateCA[i], &f->stateCB[i], dt,
+            &f->odeStep[i], &f->ode, &r);
+
+        f->odeSteps[i] = r.steps;
+        f->odeError[i] = r.error;
+        local.odeSteps += r.steps;
+        local.odeRejected += r.rejected;
+        local.odeBudgetHits += r.budgetHit ? 1 : 0;
+        if (r.error > local.odeMaxError)
+            local.odeMaxError = r.error;
+
+        const double y = f->stateCB[i];
+        if (isfinite(y) && y >= 0.0)
+            pvCB[i] = y;
     }
 
-    const double Q = sensorQ.pv * 1e-3 / 60.0; // m^3/s
-    const double Vr = reactor.volume * 1e-3;   // m^3
-    const double CA = sensorConcentrationA.pv;
+    if (stats)
+        model_step_stats_merge(stats, &local);
+}
 
-    const double k1 = (config.k01 / 60.0) * exp(-config.EA1 / (R * T_K));
-    const double k2 = (config.k02 / 60.0) * exp(-config.EA2 / (R * T_K));
+/**
+ * @brief Evaluates the steady-state CB of the changed reactors of one block.
+ *
+ * Blocks are aligned to absolute reactor indices, so how the fleet is
+ * split over workers does not change which kernel computes a reactor.
+ * A block whose reactors all need new rates (every reactor on the first
+ * tick, a plant-wide change) goes through the vectorised kernel, which
+ * also refills the rate cache. Otherwise only the changed reactors are
+ * recomputed, from the cached rates unless those are stale.
+ */
+static void model_step_block(ReactorFleet* f, UA_UInt32 begin, UA_UInt32 end,
+    ModelStepStats* local)
+{
+    UA_Byte dirty[MODEL_BLOCK];
+    UA_UInt32 changed = 0;
+    UA_UInt32 stale = 0;
 
-    const double a = Vr * k1 + Q;
-    const double b = Vr * k2 + Q;
+    for (UA_UInt32 i = begin; i < end; i++) {
+        dirty[i - begin] = f->inputDirty[i];
+        f->inputDirty[i] = 0;
+        changed += dirty[i - begin] ? 1 : 0;
+    }
+    if (changed) {
+        model_valves_block(f, begin, end);
+        for (UA_UInt32 i = begin; i < end; i++) {
+            if (dirty[i - begin] && model_rates_stale(f, i, dirty[i - begin]))
+                stale++;
+        }
+    }
 
-    if (a == 0.0 || b == 0.0) {
-        printf("Values a or b are zero: a=%.1f b=%.1f\n", a, b);
-        printf("Mathematical model stopped.\n");
-        printf("Possibly all valves are closed.\n");
-        return NAN;
+    const UA_UInt32 n = end - begin;
+    local->inputsChanged += changed;
+    local->cbComputed += changed;
+    local->cbSkipped += n - changed;
+    local->ratesComputed += stale;
+    local->ratesSkipped += n - stale;
+    if (!changed)
+        return;
+
+    UA_Double* pvCB = f->pv[FLEET_SENSOR_CB];
+    UA_Double* cb = f->cbResult;
+
+    if (stale == n) {
+        CbBatchInput in = {
+            f->pv[FLEET_SENSOR_T] + begin, f->pv[FLEET_SENSOR_F] + begin,
+            f->pv[FLEET_SENSOR_CA] + begin, f->volume + begin,
+            f->k01 + begin, f->EA1 + begin, f->k02 + begin, f->EA2 + begin, f->R + begin
+        };
+        compute_CB_batch_rates(&in, cb + begin, f->rateK1 + begin, f->rateK2 + begin, n);
+        memcpy(f->rateT + begin, f->pv[FLEET_SENSOR_T] + begin, n * sizeof(UA_Double));
     }
+    else {
+        for (UA_UInt32 i = begin; i < end; i++) {
+            const UA_Byte d = dirty[i - begin];
+            if (!d)
+                continue;
+            if (model_rates_stale(f, i, d))
+                model_update_rates(f, i);
 
+            const double T_K = f->pv[FLEET_SENSOR_T][i] + 273.15;
+            cb[i] = (!isfinite(T_K) || T_K <= 0.0) ? NAN :
+                compute_CB_rates(f->pv[FLEET_SENSOR_F][i], f->pv[FLEET_SENSOR_CA][i],
+                    f->volume[i], f->rateK1[i], f->rateK2[i]);
+        }
+    }
 
-    const double num = 2.0 * Vr * k1 * Q * CA;
-    printf("---------------------------------------------------------------\n");
-    printf("Setpoints:\n\n");
-    printf("T=%.2f\nQ=%.2f\nVr=%.2f\nCA=%.2f\n", T_K, Q, Vr, CA);
-    printf("k01= %.2f\n", config.k01);
-    printf("k02= %.2f\n\n", config.k02);
-    printf("Result:\n\n");
-    printf("k1=%.9f\nk2=%.9f\na=%.9f\nb=%.9f\nnum=%.9f\nCB=%.12f\n",
-        k1, k2, a, b, num, num / (a * b));
-    printf("---------------------------------------------------------------\n");
+    for (UA_UInt32 i = begin; i < end; i++) {
+        const double y = cb[i];
+        if (dirty[i - begin] && isfinite(y) && y >= 0.0)
+            pvCB[i] = y;
+    }
+}
 
-    return num / (a * b);
-   }
+void model_step(ReactorFleet* f, UA_UInt32 begin, UA_UInt32 end, UA_Double dt,
+    ModelStepStats* stats)
+{
+    if (f->mode == MODEL_MODE_DYNAMIC) {
+        model_step_dynamic(f, begin, end, dt, stats);
+        return;
+    }
 
-void model_cb(UA_Server* server, void* data) {
-    printf("+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
+    ModelStepStats local = { 0 };
+    for (UA_UInt32 b = begin; b < end; ) {
+        UA_UInt32 next = (b / MODEL_BLOCK + 1) * MODEL_BLOCK;
+        if (next > end)
+            next = end;
+        model_step_block(f, b, next, &local);
+        b = next;
+    }
+
+    if (stats)
+        model_step_stats_merge(stats, &local);
+}
+
+/**
+ * @brief Logs valve positions and model internals of one reactor.
+ *
+ * Recomputes the intermediate values from the already stepped fleet so
+ * the hot loop in model_step() stays free of I/O. Records go to the
+ * asynchronous logger at trace level; with a lower level the function
+ * returns before doing any work.
+ */
+static void model_trace_reactor(const ReactorFleet* f, UA_UInt32 i) {
+    if (!LOG_ENABLED(LOG_LEVEL_TRACE))
+        return;
+
+    LOG_MSG(LOG_LEVEL_TRACE,
+        "+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n"
+        "Reactor #%u valve opening degree:\n\n"
+        "HC-1 %.2f\nHC-2 %.2f\nHC-3 %.2f\n\n"
+        "Starting mathematical model:\n",
+        i + 1,
+        f->manualoutput[FLEET_VALVE_CA][i],
+        f->manualoutput[FLEET_VALVE_Q][i],
+        f->manualoutput[FLEET_VALVE_T][i]);
 
-    (void)server;
-    ModelCtx* m = (ModelCtx*)data;
-    printf("Valve opening degree:\n\n");
-	m->sensorF->pv = valve_characteristic(m->valveRegulationQ->manualoutput);
-    m->sensorConcentrationA->pv = valve_characteristicCA(m->valveRegulationConcentrationA->manualoutput);
-    if (m->valveRegulationConcentrationA->manualoutput == 0.0) {
-        m->sensorT->pv = 0.0;
+    const double R = f->R[i];
+    const double T_K = f->pv[FLEET_SENSOR_T][i] + 273.15;
+    if (!isfinite(T_K) || T_K <= 0.0) {
+        LOG_MSG(LOG_LEVEL_TRACE, "Invalid temperature T=%.2f", T_K);
+        return;
     }
-    else m->sensorT->pv = valve_characteristicT(m->valveRegulationT->manualoutput);
 
-    printf("HC-1 %.2f\n", m->valveRegulationConcentrationA->manualoutput);
-    printf("HC-2 %.2f\n", m->valveRegulationQ->manualoutput);
-    printf("HC-3 %.2f\n", m->valveRegulationT->manualoutput);
+    const double Q = f->pv[FLEET_SENSOR_F][i] * 1e-3 / 60.0;
+    const double Vr = f->volume[i] * 1e-3;
+    const double CA = f->pv[FLEET_SENSOR_CA][i];
+    const double k1 = (f->k01[i] / 60.0) * exp(-f->EA1[i] / (R * T_K));
+    const double k2 = (f->k02[i] / 60.0) * exp(-f->EA2[i] / (R * T_K));
+    const double a = Vr * k1 + Q;
+    const double b = Vr * k2 + Q;
 
-    double y = compute_CB(*m->reactor, *m->sensorT, m->cfg, *m->sensorF, *m->sensorConcentrationA);
+    if (a == 0.0 || b == 0.0) {
+        LOG_MSG(LOG_LEVEL_TRACE,
+            "Values a or b are zero: a=%.1f b=%.1f\n"
+            "Mathematical model stopped.\n"
+            "Possibly all valves are closed.", a, b);
+        return;
+    }
 
-    if (isfinite(y) && y >= 0.0)
-        m->sensorConcentrationB->pv = y;
-    printf("+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n\n");
+    const double num = 2.0 * Vr * k1 * Q * CA;
+    LOG_MSG(LOG_LEVEL_TRACE,
+        "---------------------------------------------------------------\n"
+        "Setpoints:\n\n"
+        "T=%.2f\nQ=%.2f\nVr=%.2f\nCA=%.2f\nk01= %.2f\nk02= %.2f\n",
+        T_K, Q, Vr, CA, f->k01[i], f->k02[i]);
+    LOG_MSG(LOG_LEVEL_TRACE,
+        "Result:\n\n"
+        "k1=%.9f\nk2=%.9f\na=%.9f\nb=%.9f\nnum=%.9f\nCB=%.12f\n"
+        "---------------------------------------------------------------",
+        k1, k2, a, b, num, num / (a * b));
+}
+
+/* Arguments of one parallel tick, shared by all workers */
+typedef struct {
+    ReactorFleet* fleet;
+    UA_Double dt;
+    ModelStepStats stats[ENGINE_MAX_WORKERS];
+} ModelTick;
 
+static void model_tick_range(void* ctx, UA_UInt32 worker, UA_UInt32 begin, UA_UInt32 end) {
+    ModelTick* t = (ModelTick*)ctx;
+    model_step(t->fleet, begin, end, t->dt, &t->stats[worker]);
+    fleet_publish_range(t->fleet, begin, end);
 }
 
-// Functions to emulate influence of valve opening degree on sensor readings
-double valve_characteristic(double u) {
-    if (u <= 0.0)
-        return 0.0;
-    if (u >= 100.0)
-        return 160.0;
+/**
+ * @brief Steps the whole fleet by dt seconds on the runner's engine.
+ *
+ * Returns after every reactor has been stepped and the new sensor values
+ * have been published as the front snapshot, stamped with the simulated
+ * time the tick ends at, or with the wall time it completed if the runner
+ * has no clock. Without an engine the fleet is stepped on the calling
+ * thread. total receives the summed per-worker counters and may be NULL.
+ */
+void model_run_tick(ModelRunner* r, UA_Double dt, ModelStepStats* total) {
+    ReactorFleet* f = r->fleet;
+    const UA_DateTime tickTime = r->clock ? sim_clock_next(r->clock) : 0;
 
-    if (u <= 70.0) {
+    fleet_publish_begin(f);
 
-        double x = u / 70.0;       
-        return 144.0 * x * x;
+    if (!r->engine || !r->engine->workers) {
+        ModelStepStats stats = { 0 };
+        model_step(f, 0, f->count, dt, &stats);
+        fleet_publish_range(f, 0, f->count);
+        fleet_publish_end(f, r->clock ? tickTime : UA_DateTime_now());
+        if (total)
+            *total = stats;
+        return;
     }
-    else { 
 
-        double x = (u - 70.0) / 30.0; 
-        return 144.0 + 16.0 * x;     
+    ModelTick tick;
+    const UA_UInt32 workers = engine_worker_count(r->engine);
+    tick.fleet = f;
+    tick.dt = dt;
+    memset(tick.stats, 0, workers * sizeof(ModelStepStats));
+
+    engine_run(r->engine, f->count, model_tick_range, &tick);
+    fleet_publish_end(f, r->clock ? tickTime : UA_DateTime_now());
+
+    if (total) {
+        memset(total, 0, sizeof(*total));
+        for (UA_UInt32 w = 0; w < workers; w++)
+            model_step_stats_merge(total, &tick.stats[w]);
     }
 }
 
-static double valve_characteristicCA(double u) {
-    if (u <= 0.0)
-        return 0.0;
-    if (u >= 100.0)
-        return 0.9;
+/**
+ * @brief Runs one tick and everything that follows it.
+ *
+ * With a NULL server, as on the model thread, push sensors are not
+ * written; the server thread publishes them (model_thread_publish_cb()).
+ */
+void model_tick(UA_Server* server, ModelRunner* r) {
+    ReactorFleet* f = r->fleet;
 
-    if (u <= 70.0) {
-        double x = u / 70.0;
-        return 0.7 * x * x;
+    if (f->stagedCount) {
+        const UA_UInt32 swapped = fleet_apply_staged(f);
+        LOG_MSG(LOG_LEVEL_DEBUG, "Model tick: staged kinetics of %u reactors applied", swapped);
     }
-    else {
-        double x = (u - 70.0) / 30.0;
-        return 0.7 + 0.2 * x;
+    if (r->scenario && r->clock)
+        scenario_apply(r->scenario, f, r->clock->elapsed);
+    if (f->substances) {
+        SubstanceStats sub;
+        substance_apply(f->substances, f, r->engine, &sub);
+        if (sub.applied) {
+            LOG_MSG(LOG_LEVEL_INFO, "Model tick: substance kinetics applied to %u reactors",
+                sub.applied);
+        }
+        if (sub.unknown) {
+            LOG_MSG(LOG_LEVEL_WARN, "Model tick: %u reactors select a substance not in the library",
+                sub.unknown);
+        }
+    }
+
+    ModelStepStats stats;
+    if (r->recorder)
+        recorder_begin_tick(r->recorder, f);
+    model_run_tick(r, config_dt / 1000.0, &stats);
+    if (r->recorder)
+        recorder_end_tick(r->recorder, f);
+
+    PublishStats pub = { 0 };
+    if (server)
+        publish_tick(server, f, &pub);
+    if (r->history)
+        historian_record(r->history, f);
+    if (pub.published || pub.suppressed) {
+        LOG_MSG(LOG_LEVEL_DEBUG, "Push: %u values published, %u suppressed by deadband",
+            pub.published, pub.suppressed);
+    }
+
+    r->last = stats;
+    if (stats.inputsChanged) {
+        LOG_MSG(LOG_LEVEL_DEBUG, "Model tick: inputs of %u reactors changed",
+            stats.inputsChanged);
+    }
+    LOG_MSG(LOG_LEVEL_DEBUG,
+        "Model tick: %u rate pairs computed, %u cached; %u CB evaluations, %u skipped",
+        stats.ratesComputed, stats.ratesSkipped,
+        stats.cbComputed, stats.cbSkipped);
+    if (f->mode == MODEL_MODE_DYNAMIC) {
+        LOG_MSG(LOG_LEVEL_DEBUG,
+            "Model tick: %llu RK steps, %llu rejected, %u reactors hit the step budget, "
+            "max error %.3e",
+            (unsigned long long)stats.odeSteps, (unsigned long long)stats.odeRejected,
+            stats.odeBudgetHits, stats.odeMaxError);
+    }
+    if (r->engine && r->engine->workerCount > 1) {
+        LOG_MSG(LOG_LEVEL_DEBUG, "Model tick: %u reactors on %u workers, %u steals",
+            f->count, r->engine->workerCount,
+            engine_last_steals(r->engine));
     }
+
+    if (LOG_ENABLED(LOG_LEVEL_TRACE)) {
+        for (UA_UInt32 i = 0; i < f->count; i++)
+            model_trace_reactor(f, i);
+    }
+    if (r->clock)
+        sim_clock_advance(r->clock);
 }
 
-static double valve_characteristicT(double u) {
-    if (u <= 0.0)
-        return -8.0;
-    if (u >= 100.0)
-        return 16.0;
+/**
+ * @brief Runs the ticks the clock has due, or one tick without a clock.
+ */
+static void model_run_due(UA_Server* server, ModelRunner* r) {
+    SimClock* c = r->clock;
+    if (!c) {
+        model_tick(server, r);
+        return;
+    }
 
-    if (u <= 70.0) {
-        double x = u / 70.0;       
-        return -8.0 + 20.0 * x * x;  
+    UA_Boolean rescaled;
+    const UA_UInt64 due = sim_clock_due(c, platform_now_ns(), &rescaled);
+    if (rescaled) {
+        LOG_MSG(LOG_LEVEL_INFO, "Simulation clock: time scale %g (0 = as fast as possible)",
+            c->timeScale);
+        if (server)
+            UA_Server_changeRepeatedCallbackInterval(server, c->callbackId, sim_clock_period_ms(c));
     }
-    else {
-        double x = (u - 70.0) / 30.0;
-        return 12.0 + 4.0 * x;       
+
+    for (UA_UInt64 k = 0; k < due; k++) {
+        model_tick(server, r);
+        if (sim_clock_over_budget(c, platform_now_ns()))
+            break;
     }
+
+    if (sim_clock_report(c, platform_now_ns())) {
+        LOG_MSG(c->timeScale == 1.0 ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO,
+            "Simulation clock: %.1f ticks per wall second, %.2fx real time, %.0f s simulated",
+            c->tickRate, c->speed, c->elapsed);
+    }
+}
+
+void model_cb(UA_Server* server, void* data) {
+    ModelRunner* r = (ModelRunner*)data;
+    const UA_Double periodMs = r->clock ? sim_clock_period_ms(r->clock) : (UA_Double)config_dt;
+    const UA_UInt64 t0 = platform_now_ns();
+    model_thread_lock(&modelThread);
+    model_run_due(server, r);
+    model_thread_unlock(&modelThread);
+    diag_model_call(t0, platform_now_ns(), periodMs);
 }
@@ -1,13 +1,57 @@
 ﻿#pragma once
 #include "types.h"
+#include "engine.h"
 #include <open62541/server.h>
 #include <math.h>
 #include <stdio.h>
 #include <float.h>
 
-static double valve_characteristic(double u);
-static double valve_characteristicCA(double u);
-static double valve_characteristicT(double u);
+/**
+ * @brief Arrhenius rate constant in 1/s from k0 in 1/min, EA in J/mol and T in K.
+ */
+static inline double arrhenius_rate(double k0, double EA, double R, double T_K)
+{
+    return (k0 / 60.0) * exp(-EA / (R * T_K));
+}
+
+/**
+ * @brief Steady-state CB of one reactor from its rate constants.
+ *
+ * Everything of compute_CB_values() except the Arrhenius terms, for
+ * reactors whose k1 and k2 (1/s) are cached. Returns NAN when a or b is
+ * zero (all valves closed).
+ */
+static inline double compute_CB_rates(double F, double CA_in, double volume,
+    double k1, double k2)
+{
+    const double Q = F * 1e-3 / 60.0;   // m^3/s
+    const double Vr = volume * 1e-3;    // m^3
+
+    const double a = Vr * k1 + Q;
+    const double b = Vr * k2 + Q;
+    if (a == 0.0 || b == 0.0)
+        return NAN;
+
+    return 2.0 * Vr * k1 * Q * CA_in / (a * b);
+}
+
+/**
+ * @brief Steady-state CB of one reactor from plain values.
+ *
+ * Scalar reference kernel shared by compute_CB(), the fleet loop and the
+ * scalar fallback of compute_CB_batch(). Returns NAN for a non-physical
+ * temperature or when a or b is zero (all valves closed).
+ */
+static inline double compute_CB_values(double T_C, double F, double CA_in,
+    double volume, double k01, double EA1, double k02, double EA2, double R)
+{
+    const double T_K = T_C + 273.15;
+    if (!isfinite(T_K) || T_K <= 0.0)
+        return NAN;
+
+    return compute_CB_rates(F, CA_in, volume,
+        arrhenius_rate(k01, EA1, R, T_K), arrhenius_rate(k02, EA2, R, T_K));
+}
 
 double compute_CB(Reactor reactor,
     Sensor sensorPIDTemperature,
@@ -15,4 +59,34 @@ double compute_CB(Reactor reactor,
     Sensor sensorQ,
     Sensor sensorConcentrationA);
 
+/* Work counters of one model_step() call, summed over its reactors */
+typedef struct {
+    UA_UInt32 inputsChanged;    /* reactors whose inputs were written since the last tick */
+    UA_UInt32 ratesComputed;    /* k1/k2 pairs evaluated with exp() */
+    UA_UInt32 ratesSkipped;     /* k1/k2 pairs taken from the cache */
+    UA_UInt32 cbComputed;       /* steady-state CB evaluations */
+    UA_UInt32 cbSkipped;        /* steady-state reactors left as they were */
+    UA_UInt64 odeSteps;
+    UA_UInt64 odeRejected;
+    UA_UInt32 odeBudgetHits;
+    UA_Double odeMaxError;
+} ModelStepStats;
+
+void model_step_stats_merge(ModelStepStats* into, const ModelStepStats* from);
+void model_step(ReactorFleet* f, UA_UInt32 begin, UA_UInt32 end, UA_Double dt,
+    ModelStepStats* stats);
+/* What model_cb() steps each period: the fleet, the pool running it,
+   what keeps its results and the clock pacing it */
+typedef struct {
+    ReactorFleet* fleet;
+    ModelEngine* engine;
+    struct Historian* history;  /* records the published values, or NULL */
+    struct TickRecorder* recorder;  /* appends every tick to a recording, or NULL */
+    struct SimClock* clock;     /* paces the ticks in simulated time, or NULL for one tick per call */
+    struct Scenario* scenario;  /* input changes applied at their simulated time, or NULL */
+    ModelStepStats last;        /* counters of the last tick */
+} ModelRunner;
+
+void model_run_tick(ModelRunner* r, UA_Double dt, ModelStepStats* total);
+void model_tick(UA_Server* server, ModelRunner* r);
 void model_cb(UA_Server* server, void* data);
@@ -0,0 +1,334 @@
+/**
+ * @file model_thread.c
+ * @brief Dedicated model thread paced by absolute deadlines.
+ *
+ * model_cb() runs as a repeated callback of the server, between network
+ * events: a busy server delays the tick, and the delay carries over to
+ * every following one. Started by model_thread_start(), the model runs on
+ * a thread of its own instead, one model_tick() per period. Tick k is
+ * due at start + k * period, and the thread sleeps until that absolute
+ * time (platform_sleep_until_ns()), so neither the length of a tick nor
+ * the error of one wakeup shifts the ones after it. The period is
+ * config_dt, or dt / scale of the simulation clock; as fast as possible
+ * (scale 0) the ticks run back to back. The thread may be pinned to a
+ * CPU and given a real-time priority; both are best effort, the thread
+ * logs a warning and runs on without them.
+ *
+ * A tick that ends past the next deadline is an overrun. What happens to
+ * the deadlines it missed is the overrun policy:
+ *
+ *   - MODEL_OVERRUN_SKIP:     they are dropped, the next tick waits for
+ *                             the first deadline still ahead;
+ *   - MODEL_OVERRUN_CATCH_UP: the missed ticks run at once, back to back,
+ *                             but at most catchUpMax of them; beyond that
+ *                             the oldest are dropped;
+ *   - MODEL_OVERRUN_SLIP:     the next tick runs at once and the deadlines
+ *                             are counted from it, no tick is dropped.
+ *
+ * Dropped ticks are not simulated, simulated time then lags behind the
+ * scale. Overruns and dropped deadlines are counted in the diagnostics
+ * (diag.c), next to the achieved period and its jitter, which every tick
+ * reports through diag_model_call() like model_cb() does.
+ *
+ * Sharing with the server thread: sensor values are read lock-free from
+ * a copy of the published snapshot pinned per server iteration
+ * (fleet_read_pv()), and the historian locks itself.
+ * Client writes to model inputs and the time scale hold the thread's
+ * lock (model_thread_lock() in writeBindingDS). The same lock guards the
+ * model against the worker answering methods off the server thread
+ * (async_method.c): after model_thread_share() it is taken even without
+ * the model thread, by model_cb() around its ticks as well. publish_tick() calls into
+ * the server, so push sensors are published by model_thread_publish_cb(),
+ * a server callback at the model period, from the latest snapshot.
+ */
+
+#include <string.h>
+#include "model_thread.h"
+#include "config.h"
+#include "diag.h"
+#include "fleet.h"
+#include "log.h"
+#include "publish.h"
+#include "sim_clock.h"
+
+#define MODEL_THREAD_NS_PER_MS 1000000.0
+
+/* Period of one tick in ms; 0 as fast as possible */
+static UA_Double model_thread_period_ms(const ModelRunner* r) {
+    const SimClock* c = r->clock;
+    if (!c)
+        return (UA_Double)config_dt;
+    return c->appliedScale > 0.0 ? c->dtMs / c->appliedScale : 0.0;
+}
+
+/* Deadline of the tick after the one due at deadline, which ended at now */
+static UA_UInt64 model_thread_next(const ModelThread* t, UA_UInt64 deadline, UA_UInt64 now,
+    UA_UInt64 periodNs) {
+    const UA_UInt64 next = deadline + periodNs;
+    if (periodNs == 0)
+        return now;
+    if (now <= next)
+        return next;
+
+    diag_count(&diag.overruns, 1);
+    const UA_UInt64 missed = (now - next) / periodNs + 1;
+    switch (t->policy) {
+    case MODEL_OVERRUN_CATCH_UP:
+        if (missed <= t->catchUpMax)
+            return next;
+        diag_count(&diag.skippedTicks, missed - t->catchUpMax);
+        return next + (missed - t->catchUpMax) * periodNs;
+    case MODEL_OVERRUN_SLIP:
+        return now;
+    case MODEL_OVERRUN_SKIP:
+    default:
+        diag_count(&diag.skippedTicks, missed);
+        return next + missed * periodNs;
+    }
+}
+
+static void model_thread_lock_init(ModelThread* t) {
+    platform_mutex_init(&t->lock);
+    platform_cond_init(&t->turn);
+    t->ticketNext = 0;
+    t->ticketServing = 0;
+}
+
+static void model_thread_lock_destroy(ModelThread* t) {
+    platform_cond_destroy(&t->turn);
+    platform_mutex_destroy(&t->lock);
+}
+
+/* Takes the next ticket and waits for its turn to hold the model */
+static void model_thread_acquire(ModelThread* t) {
+    platform_mutex_lock(&t->lock);
+    const UA_UInt32 ticket = t->ticketNext++;
+    while (t->ticketServing != ticket)
+        platform_cond_wait(&t->turn, &t->lock);
+    platform_mutex_unlock(&t->lock);
+}
+
+/* Passes the model on to the next ticket */
+static void model_thread_release(ModelThread* t) {
+    platform_mutex_lock(&t->lock);
+    t->ticketServing++;
+    platform_cond_broadcast(&t->turn);
+    platform_mutex_unlock(&t->lock);
+}
+
+/* Sleeps until deadline, waking up in between to notice a stop */
+static void model_thread_wait(ModelThread* t, UA_UInt64 deadline) {
+    const UA_UInt64 wake = (UA_UInt64)(MODEL_THREAD_WAKE_MS * MODEL_THREAD_NS_PER_MS);
+    while (atomic_u32_load(&t->running)) {
+        const UA_UInt64 now = platform_now_ns();
+        if (now >= deadline)
+            return;
+        platform_sleep_until_ns(deadline - now > wake ? now + wake : deadline);
+    }
+}
+
+static void model_thread_main(void* arg) {
+    ModelThread* t = (ModelThread*)arg;
+    ModelRunner* r = t->runner;
+
+    if (t->cpu >= 0 && platform_thread_set_affinity((UA_UInt32)t->cpu) != UA_STATUSCODE_GOOD)
+        LOG_MSG(LOG_LEVEL_WARN, "Model thread: cannot pin to CPU %d, running unpinned", t->cpu);
+    if (t->priority > 0 && platform_thread_set_realtime(t->priority) != UA_STATUSCODE_GOOD)
+        LOG_MSG(LOG_LEVEL_WARN,
+            "Model thread: real-time priority %d refused, running at normal priority",
+            t->priority);
+
+    UA_Double periodMs = model_thread_period_ms(r);
+    UA_UInt64 deadline = platform_now_ns();
+    for (;;) {
+        model_thread_wait(t, deadline);
+        if (!atomic_u32_load(&t->running))
+            break;
+
+        /* Queues behind the writers already waiting, ahead of later ones */
+        model_thread_acquire(t);
+        const UA_UInt64 start = platform_now_ns();
+        if (r->clock && sim_clock_rescale(r->clock, start)) {
+            LOG_MSG(LOG_LEVEL_INFO, "Simulation clock: time scale %g (0 = as fast as possible)",
+                r->clock->timeScale);
+            periodMs = model_thread_period_ms(r);
+            deadline = start;
+        }
+        model_tick(NULL, r);
+        model_thread_release(t);
+
+        const UA_UInt64 end = platform_now_ns();
+        diag_model_call(start, end, periodMs);
+        if (r->clock && sim_clock_report(r->clock, end)) {
+            LOG_MSG(r->clock->timeScale == 1.0 ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO,
+                "Simulation clock: %.1f ticks per wall second, %.2fx real time, %.0f s simulated",
+                r->clock->tickRate, r->clock->speed, r->clock->elapsed);
+        }
+        deadline = model_thread_next(t, deadline, end,
+            (UA_UInt64)(periodMs * MODEL_THREAD_NS_PER_MS));
+    }
+}
+
+/**
+ * @brief Starts ticking r on a dedicated thread.
+ *
+ * Also registers model_thread_publish_cb() with the server. cpu < 0
+ * leaves the thread unpinned, priority 0 at normal scheduling.
+ */
+UA_StatusCode model_thread_start(ModelThread* t, UA_Server* server, ModelRunner* r,
+    ModelOverrunPolicy policy, UA_UInt32 catchUpMax, UA_Int32 cpu, UA_Int32 priority) {
+    /* A shared lock stays as it is, it may be held by the method worker */
+    if (!t->shared)
+        model_thread_lock_init(t);
+    atomic_u32_store(&t->running, 0);
+    t->started = false;
+    t->publishCallbackId = 0;
+    t->publishedTick = 0;
+    t->runner = r;
+    t->server = server;
+    t->policy = policy;
+    t->catchUpMax = catchUpMax;
+    t->cpu = cpu;
+    t->priority = priority;
+    t->publishPeriodMs = r->clock ? sim_clock_period_ms(r->clock) : (UA_Double)config_dt;
+
+    UA_StatusCode rc = UA_Server_addRepeatedCallback(server, model_thread_publish_cb, t,
+        t->publishPeriodMs, &t->publishCallbackId);
+    if (rc != UA_STATUSCODE_GOOD) {
+        if (!t->shared)
+            model_thread_lock_destroy(t);
+        return rc;
+    }
+
+    atomic_u32_store(&t->running, 1);
+    t->started = true;
+    rc = platform_thread_start(&t->thread, model_thread_main, t);
+    if (rc != UA_STATUSCODE_GOOD) {
+        t->started = false;
+        UA_Server_removeRepeatedCallback(server, t->publishCallbackId);
+        if (!t->shared)
+            model_thread_lock_destroy(t);
+        return rc;
+    }
+    LOG_MSG(LOG_LEVEL_INFO,
+        "Model thread: period %.3f ms, overrun policy %s, catch-up %u, CPU %d, priority %d",
+        model_thread_period_ms(r), model_overrun_policy_name(policy), catchUpMax, cpu, priority);
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Stops the thread after its current tick and logs the achieved period.
+ */
+void model_thread_stop(ModelThread* t) {
+    if (!t->started)
+        return;
+    atomic_u32_store(&t->running, 0);
+    platform_thread_join(&t->thread);
+    UA_Server_removeRepeatedCallback(t->server, t->publishCallbackId);
+    t->started = false;
+    if (!t->shared)
+        model_thread_lock_destroy(t);
+
+    DiagSummary period;
+    DiagSummary jitter;
+    diag_summarize(&diag.periodNs, &period);
+    diag_summarize(&diag.jitterNs, &jitter);
+    LOG_MSG(LOG_LEVEL_INFO,
+        "Model thread stopped: %llu ticks, %llu overruns, %llu deadlines skipped; "
+        "period mean %.3f ms, max %.3f ms; jitter mean %.3f ms, p99 %.3f ms",
+        (unsigned long long)atomic_u64_load(&diag.calls),
+        (unsigned long long)atomic_u64_load(&diag.overruns),
+        (unsigned long long)atomic_u64_load(&diag.skippedTicks),
+        period.mean / 1000.0, period.max / 1000.0, jitter.mean / 1000.0, jitter.p99 / 1000.0);
+}
+
+/**
+ * @brief Makes model_thread_lock() effective even while the model runs as model_cb().
+ *
+ * For a thread other than the server's that reads the model, like the
+ * worker of async_method.c. Call before that thread and the model start;
+ * model_thread_clear() releases the lock once both have stopped.
+ */
+void model_thread_share(ModelThread* t) {
+    if (t->shared || t->started)
+        return;
+    model_thread_lock_init(t);
+    t->shared = true;
+}
+
+void model_thread_clear(ModelThread* t) {
+    if (!t->shared || t->started)
+        return;
+    model_thread_lock_destroy(t);
+    t->shared = false;
+}
+
+/**
+ * @brief Keeps the model from ticking until model_thread_unlock().
+ *
+ * Waits for the holders queued ahead, at most the tick in progress and
+ * the writers before it. Does nothing unless the thread runs or the
+ * model is shared (model_thread_share()), so callers need not know.
+ */
+void model_thread_lock(ModelThread* t) {
+    if (!t->started && !t->shared)
+        return;
+    model_thread_acquire(t);
+}
+
+void model_thread_unlock(ModelThread* t) {
+    if (t->started || t->shared)
+        model_thread_release(t);
+}
+
+/**
+ * @brief Server callback publishing the push sensors of the latest tick.
+ *
+ * Follows the period of the model, and does nothing until the model
+ * thread has published a new snapshot.
+ */
+void model_thread_publish_cb(UA_Server* server, void* data) {
+    ModelThread* t = (ModelThread*)data;
+    ModelRunner* r = t->runner;
+
+    const UA_Double periodMs = r->clock ? sim_clock_period_ms(r->clock) : (UA_Double)config_dt;
+    if (periodMs != t->publishPeriodMs) {
+        t->publishPeriodMs = periodMs;
+        UA_Server_changeRepeatedCallbackInterval(server, t->publishCallbackId, periodMs);
+    }
+
+    ReactorFleet* f = r->fleet;
+    fleet_pin(f);
+    if (f->view.tick == t->publishedTick)
+        return;
+
+    PublishStats pub;
+    publish_tick(server, f, &pub);
+    t->publishedTick = f->view.tick;
+    if (pub.published || pub.suppressed) {
+        LOG_MSG(LOG_LEVEL_DEBUG, "Push: %u values published, %u suppressed by deadband",
+            pub.published, pub.suppressed);
+    }
+}
+
+const char* model_overrun_policy_name(ModelOverrunPolicy policy) {
+    switch (policy) {
+    case MODEL_OVERRUN_SKIP: return "skip";
+    case MODEL_OVERRUN_CATCH_UP: return "catch-up";
+    case MODEL_OVERRUN_SLIP: return "slip";
+    default: return "unknown";
+    }
+}
+
+/**
+ * @brief Parses "skip", "catch-up" or "slip".
+ */
+UA_StatusCode model_overrun_policy_parse(const char* name, ModelOverrunPolicy* policy) {
+    for (int p = MODEL_OVERRUN_SKIP; p <= MODEL_OVERRUN_SLIP; p++) {
+        if (strcmp(name, model_overrun_policy_name((ModelOverrunPolicy)p)) == 0) {
+            *policy = (ModelOverrunPolicy)p;
+            return UA_STATUSCODE_GOOD;
+        }
+    }
+    return UA_STATUSCODE_BADINVALIDARGUMENT;
+}
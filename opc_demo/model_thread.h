@@ -0,0 +1,57 @@
+#pragma once
+#include <open62541/server.h>
+#include "types.h"
+#include "math_model.h"
+#include "platform.h"
+
+/* Longest sleep of the model thread, so a stop request is noticed in time */
+#define MODEL_THREAD_WAKE_MS 100
+
+/*
+ * The model on a thread of its own, ticking at absolute deadlines.
+ *
+ * Every tick holds the model lock. Client writes to bound variables take
+ * it as well (model_thread_lock()), so inputs change between two ticks.
+ * The lock is handed over in arrival order (tickets under mutex, turn
+ * signalled), the model thread queueing like any writer: writers already
+ * waiting when a tick falls due go first, later ones wait for the tick,
+ * so neither side waits longer than the holders queued ahead of it.
+ * Without the thread the lock is only taken once model_thread_share()
+ * says that another thread reads the model.
+ */
+typedef struct {
+    ModelRunner* runner;
+    UA_Server* server;
+    ModelOverrunPolicy policy;
+    UA_UInt32 catchUpMax;       /* missed ticks MODEL_OVERRUN_CATCH_UP runs late */
+    UA_Int32 cpu;               /* CPU the thread is pinned to, -1 = any */
+    UA_Int32 priority;          /* real-time priority, 0 = normal scheduling */
+
+    PlatformThread thread;
+    PlatformMutex lock;         /* guards the tickets, held only to take or pass a turn */
+    PlatformCond turn;          /* broadcast whenever ticketServing moves on */
+    UA_UInt32 ticketNext;       /* next ticket handed out */
+    UA_UInt32 ticketServing;    /* ticket holding the model */
+    volatile UA_UInt32 running;
+    UA_Boolean started;
+    UA_Boolean shared;          /* lock taken without the thread, see model_thread_share() */
+
+    /* Push sensors, published on the server thread */
+    UA_UInt64 publishCallbackId;
+    UA_Double publishPeriodMs;
+    UA_UInt64 publishedTick;
+} ModelThread;
+
+UA_StatusCode model_thread_start(ModelThread* t, UA_Server* server, ModelRunner* r,
+    ModelOverrunPolicy policy, UA_UInt32 catchUpMax, UA_Int32 cpu, UA_Int32 priority);
+void model_thread_stop(ModelThread* t);
+
+void model_thread_share(ModelThread* t);
+void model_thread_clear(ModelThread* t);
+void model_thread_lock(ModelThread* t);
+void model_thread_unlock(ModelThread* t);
+
+void model_thread_publish_cb(UA_Server* server, void* data);
+
+const char* model_overrun_policy_name(ModelOverrunPolicy policy);
+UA_StatusCode model_overrun_policy_parse(const char* name, ModelOverrunPolicy* policy);
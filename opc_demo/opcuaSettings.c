@@ -6,14 +6,45 @@
  * open62541 OPC UA server address space. It provides:
  *
  *   - DataSource callbacks for Double and UInt32 values
- *     (readDoubleDS, writeDoubleDS, readUInt32DS, writeUInt32DS) to expose
- *     struct fields as OPC UA variables with custom validation and logging.
+ *     (readBindingDS, writeDoubleDS, writeUInt32DS) and for the valve
+ *     characteristics (writeValveCurveDS, writeValveTableDS) to expose fleet fields
+ *     as OPC UA variables with custom validation and logging. Writes are
+ *     dispatched by writeBindingDS, which like readBindingDS feeds the
+ *     per-kind counters of the diagnostics (diag.c). Every bound
+ *     node carries a NodeBinding (binding.h) as context holding the field,
+ *     its log name, engineering range and dirty flag, so no callback has to
+ *     look anything up in the address space; reads go through
+ *     the allocation-free binding_read(), sensor process values come
+ *     lock-free from the tick pinned for the server iteration (fleet_pin()).
+ *     Logging goes through the asynchronous logger (log.h), so a slow
+ *     console never delays a client write.
+ *
+ *   - Method callbacks setting a whole kinetic configuration at once,
+ *     SET_KINETICS of a MathModel object (setKineticsMethod) and of the
+ *     model folder for many objects (setKineticsBatchMethod). They stage
+ *     the values (fleet_stage_kinetics()) for the next model tick.
+ *     ESTIMATE_KINETICS of a MathModel object (estimateKineticsMethod)
+ *     fits them to the history of its reactor instead (estimate.c); with
+ *     opc_ua_enable_estimation() it runs on the worker of async_method.c,
+ *     so a long fit does not hold up the server loop.
+ *
+ *   - SWEEP of a Reactor object (sweepReactorMethod) evaluating the what-if
+ *     sweep of its reactor (sweep.c) over the grid set in its SWEEP_MIN,
+ *     SWEEP_MAX and SWEEP_POINTS; the surface is read from SWEEP_CB
+ *     (writeSweepGridDS, BINDING_SWEEP_*). OPTIMIZE of a Reactor object
+ *     (optimizeReactorMethod) searching the valve openings with the
+ *     highest CB, or a target CB at the lowest flow (optimize.c). Like
+ *     ESTIMATE_KINETICS both run on the worker of async_method.c after
+ *     opc_ua_enable_reactor_methods().
  *
  *   - Utility functions to locate child variable nodes by browse name and
  *     bind them to C fields using UA_DataSource:
  *       * find_child_var()
  *       * attach_child_double()
  *       * attach_child_UInt32()
+ *       * attach_child_sensor()
+ *       * attach_child_valve()
+ *       * attach_child_push() (value-backed push mode, see publish.c)
  *
  *   - Registration of custom ObjectTypes used by the application:
  *       * SensorType
@@ -28,25 +59,61 @@
  *       * opc_ua_create_valve_handle_control()
  *       * opc_ua_create_math_model_instance()
  *       * opc_ua_create_cell_folder()
+ *       * opc_ua_create_kinetics_method()
+ *       * opc_ua_create_simulation_object()
+ *       * opc_ua_create_diagnostics()
+ *     Each of them lets the server instantiate the type and then resolves
+ *     every child by browse path to attach its DataSource.
+ *
+ *   - Bulk instantiation of whole reactors, opc_ua_create_fleet_instances(),
+ *     named after the records of the plant description (plant.h). Objects get deterministic NodeIds in the
+ *     FLEET_NAMESPACE_URI namespace (opc_ua_fleet_node_id()) and are built
+ *     with UA_Server_addNode_begin() / UA_Server_addNode_finish(): the
+ *     child variables are added in between, already bound to the fleet,
+ *     so instantiation finds them in place and no browse path has to be
+ *     translated.
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include "opcuaSettings.h"
 #include "types.h"
+#include "fleet.h"
+#include "binding.h"
+#include "valve_curve.h"
+#include "sim_clock.h"
+#include "diag.h"
+#include "config.h"
+#include "model_thread.h"
+#include "estimate.h"
+#include "historian.h"
+#include "async_method.h"
+#include "sweep.h"
+#include "optimize.h"
+#include "log.h"
 #include <open62541/plugin/log_stdout.h>
 #include <open62541/types.h>
 #include <open62541/server.h>
 #include <open62541/server_config_default.h>
 
+/* Engineering ranges accepted by writes to bound variables, besides the
+   model input ranges of types.h */
+#define LIMIT_DEADBAND_MAX      1e12
+
+#define ACCESS_RO UA_ACCESSLEVELMASK_READ
+#define ACCESS_RW (UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE)
+
  /**
-  * @brief DataSource read callback for Double variables.
-  *
-  * Reads the Double value from nodeContext, fills UA_DataValue
-  * with scalar value and timestamps, and performs basic range
-  * / index checks.
-  */
-static UA_StatusCode readDoubleDS(UA_Server* server,
+ * @brief DataSource read callback for all bound variables.
+ *
+ * nodeContext is the node's NodeBinding. binding_read() fills the
+ * DataValue without a heap allocation unless the node is monitored;
+ * sensor values come from the snapshot of the last model tick with the
+ * tick time as source timestamp. Reads are counted per binding kind in
+ * the diagnostics, and some of them timed.
+ */
+static UA_StatusCode readBindingDS(UA_Server* server,
     const UA_NodeId* sessionId,
     void* sessionContext,
     const UA_NodeId* nodeId,
@@ -55,55 +122,29 @@ static UA_StatusCode readDoubleDS(UA_Server* server,
     const UA_NumericRange* range,
     UA_DataValue* out) {
 
+    (void)server;
     (void)sessionId;
     (void)sessionContext;
+    (void)nodeId;
 
-    UA_DataValue_init(out);
-
-    if (!nodeContext) {
-        out->status = UA_STATUSCODE_BADINTERNALERROR;
-        out->hasStatus = true;
-        return out->status;
-    }
-
-    if (range && range->dimensionsSize > 0) {
-        out->status = UA_STATUSCODE_BADINDEXRANGEINVALID;
-        out->hasStatus = true;
-        return out->status;
-    }
-
-    const UA_Double v = *(const UA_Double*)nodeContext;
-
-    UA_StatusCode rv =
-        UA_Variant_setScalarCopy(&out->value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
-    if (rv != UA_STATUSCODE_GOOD) {
-        out->status = rv;
-        out->hasStatus = true;
-        return rv;
-    }
-
-    out->hasValue = true;
-
-    if (includeSourceTimeStamp) {
-        out->sourceTimestamp = UA_DateTime_now();
-        out->hasSourceTimestamp = true;
-    }
-
-    out->serverTimestamp = UA_DateTime_now();
-    out->hasServerTimestamp = true;
-
-    out->status = UA_STATUSCODE_GOOD;
-    out->hasStatus = true;
+    NodeBinding* b = (NodeBinding*)nodeContext;
+    if (!b || b->kind >= BINDING_KIND_COUNT)
+        return binding_read(b, includeSourceTimeStamp, range, out);
 
-    return UA_STATUSCODE_GOOD;
+    DiagDataSource* d = &diag.dataSource[b->kind];
+    const UA_UInt64 t0 = diag_call_begin(&d->reads);
+    const UA_StatusCode rc = binding_read(b, includeSourceTimeStamp, range, out);
+    diag_call_end(&d->readNs, t0);
+    return rc;
 }
 
 /**
  * @brief DataSource write callback for Double variables.
  *
- * Validates the incoming value (type, rank, finite), writes it
- * into nodeContext, and logs the new value together with the
- * node's browse name or numeric NodeId.
+ * Validates the incoming value (type, rank, finite, engineering range of
+ * the node's NodeBinding), writes it into the bound field, marks the
+ * model input dirty and logs the new value under the binding's cached
+ * name. Out-of-range writes are refused with BadOutOfRange.
  */
 static UA_StatusCode writeDoubleDS(UA_Server* server,
     const UA_NodeId* sessionId,
@@ -118,7 +159,8 @@ static UA_StatusCode writeDoubleDS(UA_Server* server,
     (void)sessionContext;
     (void)nodeId;
 
-    if (!nodeContext)
+    NodeBinding* b = (NodeBinding*)nodeContext;
+    if (!b || !b->field || b->kind != BINDING_DOUBLE)
         return UA_STATUSCODE_BADINTERNALERROR;
 
     if (!data || !data->hasValue)
@@ -137,35 +179,25 @@ static UA_StatusCode writeDoubleDS(UA_Server* server,
     if (!isfinite(v))
         return UA_STATUSCODE_BADOUTOFRANGE;
 
-    *(UA_Double*)nodeContext = v;
-    if (server && nodeId) {
-        UA_QualifiedName bn;
-        UA_StatusCode rc = UA_Server_readBrowseName(server, *nodeId, &bn);
-        if (rc == UA_STATUSCODE_GOOD) {
-            printf("writeDoubleDS: %.*s = %.3f\n",
-                (int)bn.name.length, bn.name.data, v);
-            UA_QualifiedName_clear(&bn);
-        }
-        else {
-            if (nodeId->identifierType == UA_NODEIDTYPE_NUMERIC) {
-                printf("writeDoubleDS: ns=%u;i=%u = %.3f\n",
-                    nodeId->namespaceIndex,
-                    nodeId->identifier.numeric,
-                    v);
-            }
-            else {
-                printf("writeDoubleDS: <unknown node> = % .3f\n", v);
-            }
-        }
+    if (!binding_in_range(b, v)) {
+        b->rejected++;
+        LOG_MSG(LOG_LEVEL_WARN, "writeDoubleDS: %s = %.3f outside [%g, %g]",
+            b->name, v, b->min, b->max);
+        return UA_STATUSCODE_BADOUTOFRANGE;
     }
+
+    *(UA_Double*)b->field = v;
+    binding_mark_written(b);
+    LOG_MSG(LOG_LEVEL_INFO, "writeDoubleDS: %s = %.3f", b->name, v);
     return UA_STATUSCODE_GOOD;
 }
 
 /**
  * @brief DataSource write callback for UInt32 variables.
  *
- * Validates the incoming UInt32 value and writes it into
- * nodeContext. No logging is performed here.
+ * Validates the incoming UInt32 value against the engineering range of
+ * the node's NodeBinding, writes it into the bound field, marks the model
+ * input dirty and logs it under the binding's cached name.
  */
 static UA_StatusCode writeUInt32DS(UA_Server* server,
     const UA_NodeId* sessionId, void* sessionContext,
@@ -178,7 +210,8 @@ static UA_StatusCode writeUInt32DS(UA_Server* server,
     (void)sessionContext;
     (void)nodeId;
 
-    if (!nodeContext)
+    NodeBinding* b = (NodeBinding*)nodeContext;
+    if (!b || !b->field || b->kind != BINDING_UINT32)
         return UA_STATUSCODE_BADINTERNALERROR;
 
     if (!data || !data->hasValue)
@@ -194,65 +227,177 @@ static UA_StatusCode writeUInt32DS(UA_Server* server,
         return UA_STATUSCODE_BADTYPEMISMATCH;
 
     const UA_UInt32 v = *(const UA_UInt32*)data->value.data;
-    *(UA_UInt32*)nodeContext = v;
+    if (!binding_in_range(b, (UA_Double)v)) {
+        b->rejected++;
+        LOG_MSG(LOG_LEVEL_WARN, "writeUInt32DS: %s = %u outside [%g, %g]",
+            b->name, v, b->min, b->max);
+        return UA_STATUSCODE_BADOUTOFRANGE;
+    }
+
+    *(UA_UInt32*)b->field = v;
+    binding_mark_written(b);
+    LOG_MSG(LOG_LEVEL_INFO, "writeUInt32DS: %s = %u", b->name, v);
     return UA_STATUSCODE_GOOD;
 }
 
 /**
- * @brief DataSource read callback for UInt32 variables.
+ * @brief DataSource write callback for the CHARACTERISTIC of a valve.
  *
- * Reads the UInt32 value from nodeContext, returns it as a
- * scalar Variant in UA_DataValue and sets timestamps.
+ * Switches the valve to the built-in curve of the written
+ * ValveCharacteristic. VALVE_CHAR_CUSTOM is only accepted while the valve
+ * already has a custom curve; a new one is set through
+ * CHARACTERISTIC_TABLE.
  */
-static UA_StatusCode readUInt32DS(UA_Server* server,
-    const UA_NodeId* sessionId,
-    void* sessionContext,
-    const UA_NodeId* nodeId,
-    void* nodeContext,
-    UA_Boolean includeSourceTimeStamp,
+static UA_StatusCode writeValveCurveDS(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* nodeId, void* nodeContext,
     const UA_NumericRange* range,
-    UA_DataValue* out) {
+    const UA_DataValue* data) {
 
     (void)server;
     (void)sessionId;
     (void)sessionContext;
     (void)nodeId;
 
-    UA_DataValue_init(out);
+    NodeBinding* b = (NodeBinding*)nodeContext;
+    if (!b || !b->field || b->kind != BINDING_VALVE_CURVE)
+        return UA_STATUSCODE_BADINTERNALERROR;
 
-    if (!nodeContext) {
-        out->status = UA_STATUSCODE_BADINTERNALERROR;
-        out->hasStatus = true;
-        return out->status;
-    }
+    if (!data || !data->hasValue)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
 
-    if (range && range->dimensionsSize > 0) {
-        out->status = UA_STATUSCODE_BADINDEXRANGEINVALID;
-        out->hasStatus = true;
-        return out->status;
-    }
+    if (range && range->dimensionsSize > 0)
+        return UA_STATUSCODE_BADINDEXRANGEINVALID;
 
-    const UA_UInt32 v = *(const UA_UInt32*)nodeContext;
+    if (data->value.type != &UA_TYPES[UA_TYPES_UINT32] ||
+        data->value.data == NULL ||
+        data->value.arrayLength != 0 ||
+        data->value.arrayDimensionsSize != 0)
+        return UA_STATUSCODE_BADTYPEMISMATCH;
 
-    UA_StatusCode rv = UA_Variant_setScalarCopy(&out->value, &v, &UA_TYPES[UA_TYPES_UINT32]);
-    if (rv != UA_STATUSCODE_GOOD) {
-        out->status = rv;
-        out->hasStatus = true;
-        return rv;
+    const FleetSlot* slot = (const FleetSlot*)b->field;
+    UA_UInt32* curve = &slot->fleet->valveCurve[slot->field][slot->index];
+    const UA_UInt32 v = *(const UA_UInt32*)data->value.data;
+    if (v == VALVE_CHAR_CUSTOM && valve_curve_kind(*curve) == VALVE_CHAR_CUSTOM)
+        return UA_STATUSCODE_GOOD;
+    if (v >= VALVE_CHAR_CUSTOM) {
+        b->rejected++;
+        LOG_MSG(LOG_LEVEL_WARN, "writeValveCurveDS: %s = %u is not a built-in characteristic",
+            b->name, v);
+        return UA_STATUSCODE_BADOUTOFRANGE;
     }
 
-    out->hasValue = true;
+    valve_curve_assign(curve, valve_curve_builtin((FleetValve)slot->field, (ValveCharacteristic)v));
+    binding_mark_written(b);
+    LOG_MSG(LOG_LEVEL_INFO, "writeValveCurveDS: %s = %u", b->name, v);
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief DataSource write callback for the CHARACTERISTIC_TABLE of a valve.
+ *
+ * Takes a Double array of (opening %, value) pairs, see
+ * valve_curve_add_custom(), and switches the valve to it; CHARACTERISTIC
+ * then reads VALVE_CHAR_CUSTOM. Invalid tables are refused with
+ * BadOutOfRange, a full curve registry with BadResourceUnavailable.
+ * A table whose slot cannot be allocated gets BadOutOfMemory.
+ */
+static UA_StatusCode writeValveTableDS(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* nodeId, void* nodeContext,
+    const UA_NumericRange* range,
+    const UA_DataValue* data) {
+
+    (void)server;
+    (void)sessionId;
+    (void)sessionContext;
+    (void)nodeId;
+
+    NodeBinding* b = (NodeBinding*)nodeContext;
+    if (!b || !b->field || b->kind != BINDING_VALVE_TABLE)
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    if (!data || !data->hasValue)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
 
-    if (includeSourceTimeStamp) {
-        out->sourceTimestamp = UA_DateTime_now();
-        out->hasSourceTimestamp = true;
+    if (range && range->dimensionsSize > 0)
+        return UA_STATUSCODE_BADINDEXRANGEINVALID;
+
+    if (data->value.type != &UA_TYPES[UA_TYPES_DOUBLE] ||
+        UA_Variant_isScalar(&data->value) ||
+        data->value.arrayDimensionsSize > 1)
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+
+    const size_t length = data->value.arrayLength;
+    UA_UInt32 id = 0;
+    UA_StatusCode rc = (length % 2) ? UA_STATUSCODE_BADOUTOFRANGE :
+        valve_curve_add_custom((const UA_Double*)data->value.data, length / 2, &id);
+    if (rc != UA_STATUSCODE_GOOD) {
+        b->rejected++;
+        LOG_MSG(LOG_LEVEL_WARN, "writeValveTableDS: %s table of %zu values refused",
+            b->name, length);
+        return rc;
     }
 
-    out->serverTimestamp = UA_DateTime_now();
-    out->hasServerTimestamp = true;
+    const FleetSlot* slot = (const FleetSlot*)b->field;
+    valve_curve_assign(&slot->fleet->valveCurve[slot->field][slot->index], id);
+    binding_mark_written(b);
+    LOG_MSG(LOG_LEVEL_INFO, "writeValveTableDS: %s custom characteristic of %zu points",
+        b->name, length / 2);
+    return UA_STATUSCODE_GOOD;
+}
 
-    out->status = UA_STATUSCODE_GOOD;
-    out->hasStatus = true;
+/**
+ * @brief DataSource write callback for the grid of a sweep.
+ *
+ * Takes SWEEP_AXES values, Double bounds or UInt32 point counts by the
+ * binding kind, each within the engineering range of the binding. That
+ * min does not exceed max is checked when the sweep runs, so the two can
+ * be written in any order.
+ */
+static UA_StatusCode writeSweepGridDS(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* nodeId, void* nodeContext,
+    const UA_NumericRange* range,
+    const UA_DataValue* data) {
+
+    (void)server;
+    (void)sessionId;
+    (void)sessionContext;
+    (void)nodeId;
+
+    NodeBinding* b = (NodeBinding*)nodeContext;
+    if (!b || !b->field || (b->kind != BINDING_SWEEP_BOUNDS && b->kind != BINDING_SWEEP_POINTS))
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    if (!data || !data->hasValue)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+
+    if (range && range->dimensionsSize > 0)
+        return UA_STATUSCODE_BADINDEXRANGEINVALID;
+
+    const UA_Boolean bounds = b->kind == BINDING_SWEEP_BOUNDS;
+    if (data->value.type != &UA_TYPES[bounds ? UA_TYPES_DOUBLE : UA_TYPES_UINT32] ||
+        UA_Variant_isScalar(&data->value) ||
+        data->value.arrayLength != SWEEP_AXES ||
+        data->value.arrayDimensionsSize > 1)
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+
+    UA_Double v[SWEEP_AXES];
+    for (int a = 0; a < SWEEP_AXES; a++) {
+        v[a] = bounds ? ((const UA_Double*)data->value.data)[a] :
+            (UA_Double)((const UA_UInt32*)data->value.data)[a];
+        if (!binding_in_range(b, v[a])) {
+            b->rejected++;
+            LOG_MSG(LOG_LEVEL_WARN, "writeSweepGridDS: %s[%d] = %g outside [%g, %g]",
+                b->name, a, v[a], b->min, b->max);
+            return UA_STATUSCODE_BADOUTOFRANGE;
+        }
+    }
+
+    memcpy(b->field, data->value.data, SWEEP_AXES * (bounds ? sizeof(UA_Double) : sizeof(UA_UInt32)));
+    binding_mark_written(b);
+    LOG_MSG(LOG_LEVEL_INFO, "writeSweepGridDS: %s = [%g, %g, %g]", b->name, v[0], v[1], v[2]);
     return UA_STATUSCODE_GOOD;
 }
 
@@ -297,14 +442,20 @@ static UA_StatusCode find_child_var(UA_Server* server,
 /**
  * @brief Binds a Double field to a child variable node and installs DataSource.
  *
- * Resolves the child variable under parent by browse name, sets the
- * node context pointer to ptrToField, and attaches readDoubleDS /
- * writeDoubleDS as its DataSource.
+ * Resolves the child variable under parent by browse name, sets a
+ * NodeBinding for ptrToField as node context, and attaches
+ * readBindingDS / writeDoubleDS as its DataSource. The binding is tagged
+ * "<objectName>.<browseName>" for logging, accepts writes within
+ * [min, max] and sets dirtyMask in *dirty on every accepted write (dirty
+ * may be NULL).
  */
 static UA_StatusCode attach_child_double(UA_Server* server,
     const UA_NodeId parent,
+    const char* objectName,
     const char* browseName,
-    void* ptrToField) {
+    void* ptrToField,
+    UA_Double min, UA_Double max,
+    UA_Byte* dirty, UA_Byte dirtyMask) {
 
     UA_NodeId childId = UA_NODEID_NULL;
 
@@ -314,14 +465,21 @@ static UA_StatusCode attach_child_double(UA_Server* server,
         return ret;
     }
 
-    ret = UA_Server_setNodeContext(server, childId, ptrToField);
+    NodeBinding* binding = binding_new(BINDING_DOUBLE, ptrToField);
+    if (!binding) {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    binding_set_name(binding, objectName, browseName);
+    binding_set_limits(binding, min, max);
+    binding->dirty = dirty;
+    binding->dirtyMask = dirtyMask;
+
+    ret = UA_Server_setNodeContext(server, childId, binding);
     if (ret != UA_STATUSCODE_GOOD) {
         return ret;
     }
 
-    UA_DataSource ds;
-    ds.read = readDoubleDS;
-    ds.write = writeDoubleDS;
+    UA_DataSource ds = opc_ua_binding_data_source(BINDING_DOUBLE);
 
     ret = UA_Server_setVariableNode_dataSource(server, childId, ds);
     if (ret != UA_STATUSCODE_GOOD) {
@@ -334,14 +492,20 @@ static UA_StatusCode attach_child_double(UA_Server* server,
 /**
  * @brief Binds a UInt32 field to a child variable node and installs DataSource.
  *
- * Resolves the child variable under parent by browse name, sets the
- * node context pointer to ptrToField, and attaches readUInt32DS /
- * writeUInt32DS as its DataSource.
+ * Resolves the child variable under parent by browse name, sets a
+ * NodeBinding for ptrToField as node context, and attaches
+ * readBindingDS / writeUInt32DS as its DataSource. The binding is tagged
+ * "<objectName>.<browseName>" for logging, accepts writes within
+ * [min, max] and sets dirtyMask in *dirty on every accepted write (dirty
+ * may be NULL).
  */
 static UA_StatusCode attach_child_UInt32(UA_Server* server,
     const UA_NodeId parent,
+    const char* objectName,
     const char* browseName,
-    void* ptrToField) {
+    void* ptrToField,
+    UA_Double min, UA_Double max,
+    UA_Byte* dirty, UA_Byte dirtyMask) {
 
     UA_NodeId childId = UA_NODEID_NULL;
 
@@ -350,14 +514,21 @@ static UA_StatusCode attach_child_UInt32(UA_Server* server,
         return ret;
     }
 
-    ret = UA_Server_setNodeContext(server, childId, ptrToField);
+    NodeBinding* binding = binding_new(BINDING_UINT32, ptrToField);
+    if (!binding) {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    binding_set_name(binding, objectName, browseName);
+    binding_set_limits(binding, min, max);
+    binding->dirty = dirty;
+    binding->dirtyMask = dirtyMask;
+
+    ret = UA_Server_setNodeContext(server, childId, binding);
     if (ret != UA_STATUSCODE_GOOD) {
         return ret;
     }
 
-    UA_DataSource ds;
-    ds.read = readUInt32DS;
-    ds.write = writeUInt32DS;
+    UA_DataSource ds = opc_ua_binding_data_source(BINDING_UINT32);
 
     ret = UA_Server_setVariableNode_dataSource(server, childId, ds);
     if (ret != UA_STATUSCODE_GOOD) {
@@ -368,6 +539,91 @@ static UA_StatusCode attach_child_UInt32(UA_Server* server,
     return UA_STATUSCODE_GOOD;
 }
 
+/**
+ * @brief Binds a sensor slot to a child variable node and installs DataSource.
+ *
+ * Resolves the child variable under parent by browse name, sets a
+ * NodeBinding for the sensor's FleetSlot as node context and attaches
+ * readBindingDS as its read-only DataSource.
+ */
+static UA_StatusCode attach_child_sensor(UA_Server* server,
+    const UA_NodeId parent,
+    const char* objectName,
+    const char* browseName,
+    FleetSlot* slot) {
+
+    UA_NodeId childId = UA_NODEID_NULL;
+
+    UA_StatusCode ret = find_child_var(server, parent, browseName, &childId);
+    if (ret != UA_STATUSCODE_GOOD) {
+        return ret;
+    }
+
+    NodeBinding* binding = binding_new(BINDING_SENSOR, slot);
+    if (!binding) {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    binding_set_name(binding, objectName, browseName);
+
+    ret = UA_Server_setNodeContext(server, childId, binding);
+    if (ret != UA_STATUSCODE_GOOD) {
+        return ret;
+    }
+
+    UA_DataSource ds = opc_ua_binding_data_source(BINDING_SENSOR);
+
+    ret = UA_Server_setVariableNode_dataSource(server, childId, ds);
+    if (ret != UA_STATUSCODE_GOOD) {
+        UA_Server_setNodeContext(server, childId, NULL);
+        return ret;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Binds a valve characteristic variable and installs its DataSource.
+ *
+ * kind is BINDING_VALVE_CURVE or BINDING_VALVE_TABLE; slot is the
+ * valve's FleetSlot. Accepted writes set dirtyMask in *dirty.
+ */
+static UA_StatusCode attach_child_valve(UA_Server* server,
+    const UA_NodeId parent,
+    const char* objectName,
+    const char* browseName,
+    BindingKind kind,
+    FleetSlot* slot,
+    UA_Byte* dirty, UA_Byte dirtyMask) {
+
+    UA_NodeId childId = UA_NODEID_NULL;
+
+    UA_StatusCode ret = find_child_var(server, parent, browseName, &childId);
+    if (ret != UA_STATUSCODE_GOOD) {
+        return ret;
+    }
+
+    NodeBinding* binding = binding_new(kind, slot);
+    if (!binding) {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    binding_set_name(binding, objectName, browseName);
+    binding->dirty = dirty;
+    binding->dirtyMask = dirtyMask;
+
+    ret = UA_Server_setNodeContext(server, childId, binding);
+    if (ret != UA_STATUSCODE_GOOD) {
+        return ret;
+    }
+
+    UA_DataSource ds = opc_ua_binding_data_source(kind);
+
+    ret = UA_Server_setVariableNode_dataSource(server, childId, ds);
+    if (ret != UA_STATUSCODE_GOOD) {
+        UA_Server_setNodeContext(server, childId, NULL);
+        return ret;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
 /**
  * @brief Adds ModellingRule Mandatory reference to a variable node.
  *
@@ -381,6 +637,490 @@ static UA_StatusCode add_reference_mandatory(UA_Server* server, UA_NodeId nodeId
         true);
 }
 
+/**
+ * @brief Adds a mandatory scalar variable to an ObjectType.
+ */
+static UA_StatusCode add_mandatory_variable(UA_Server* server, UA_NodeId typeId,
+    char* name, const UA_DataType* dataType, UA_Byte accessLevel) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", name);
+    attr.dataType = dataType->typeId;
+    attr.accessLevel = accessLevel;
+    UA_NodeId varId;
+    UA_StatusCode rc = UA_Server_addVariableNode(server, UA_NODEID_NULL, typeId,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(1, name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+        attr, NULL, &varId);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+    return add_reference_mandatory(server, varId);
+}
+
+/**
+ * @brief Adds a mandatory one-dimensional array variable to an ObjectType.
+ */
+static UA_StatusCode add_mandatory_array_variable(UA_Server* server, UA_NodeId typeId,
+    char* name, const UA_DataType* dataType, UA_Byte accessLevel) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", name);
+    attr.dataType = dataType->typeId;
+    attr.valueRank = UA_VALUERANK_ONE_DIMENSION;
+    attr.accessLevel = accessLevel;
+    UA_NodeId varId;
+    UA_StatusCode rc = UA_Server_addVariableNode(server, UA_NODEID_NULL, typeId,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(1, name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+        attr, NULL, &varId);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+    return add_reference_mandatory(server, varId);
+}
+
+/* Inputs of the SET_KINETICS methods, in this order */
+static const struct { char* name; UA_UInt32 type; } kineticsArgs[] = {
+    { "SUBSTANCE_ID", UA_TYPES_UINT32 },
+    { "K01", UA_TYPES_DOUBLE },
+    { "EA1", UA_TYPES_DOUBLE },
+    { "K02", UA_TYPES_DOUBLE },
+    { "EA2", UA_TYPES_DOUBLE },
+    { "R", UA_TYPES_DOUBLE },
+};
+#define KINETICS_ARG_COUNT (sizeof(kineticsArgs) / sizeof(kineticsArgs[0]))
+
+/* Outputs of ESTIMATE_KINETICS, in this order */
+static const struct { char* name; UA_UInt32 type; UA_Int32 valueRank; } estimateOutputs[] = {
+    { "K01", UA_TYPES_DOUBLE, UA_VALUERANK_SCALAR },
+    { "EA1", UA_TYPES_DOUBLE, UA_VALUERANK_SCALAR },
+    { "K02", UA_TYPES_DOUBLE, UA_VALUERANK_SCALAR },
+    { "EA2", UA_TYPES_DOUBLE, UA_VALUERANK_SCALAR },
+    { "CONFIDENCE", UA_TYPES_DOUBLE, UA_VALUERANK_ONE_DIMENSION },
+    { "RMSE", UA_TYPES_DOUBLE, UA_VALUERANK_SCALAR },
+    { "SAMPLES", UA_TYPES_UINT32, UA_VALUERANK_SCALAR },
+    { "ITERATIONS", UA_TYPES_UINT32, UA_VALUERANK_SCALAR },
+    { "CONVERGED", UA_TYPES_BOOLEAN, UA_VALUERANK_SCALAR },
+};
+#define ESTIMATE_OUTPUT_COUNT (sizeof(estimateOutputs) / sizeof(estimateOutputs[0]))
+
+/* Context of the kinetics methods: the fleet and namespace of the
+   MathModel objects, and for ESTIMATE_KINETICS the history and the
+   engine evaluating the fit (opc_ua_enable_estimation()) */
+typedef struct {
+    ReactorFleet* fleet;
+    UA_UInt16 ns;
+    Historian* history;
+    ModelEngine* engine;
+} KineticsMethod;
+
+static KineticsMethod kineticsMethod;
+
+/* ESTIMATE_KINETICS of MathModelType, shared by every MathModel object */
+static UA_NodeId estimateMethodId;
+
+static void kinetics_arguments(UA_Argument* args, UA_Int32 valueRank) {
+    for (size_t k = 0; k < KINETICS_ARG_COUNT; k++) {
+        UA_Argument_init(&args[k]);
+        args[k].name = UA_STRING(kineticsArgs[k].name);
+        args[k].dataType = UA_TYPES[kineticsArgs[k].type].typeId;
+        args[k].valueRank = valueRank;
+    }
+}
+
+/* True if every input has the type of its argument, scalars or arrays of n */
+static UA_Boolean kinetics_inputs_valid(const UA_Variant* input, UA_Boolean array, size_t n) {
+    for (size_t k = 0; k < KINETICS_ARG_COUNT; k++) {
+        const UA_Variant* v = &input[k];
+        if (v->type != &UA_TYPES[kineticsArgs[k].type])
+            return false;
+        if (array ? v->arrayLength != n : !UA_Variant_isScalar(v))
+            return false;
+    }
+    return true;
+}
+
+/* Configuration e of the inputs; e = 0 for scalars */
+static void kinetics_from_inputs(const UA_Variant* input, size_t e, FleetKinetics* k) {
+    k->substanceId = ((const UA_UInt32*)input[0].data)[e];
+    k->config.k01 = ((const UA_Double*)input[1].data)[e];
+    k->config.EA1 = ((const UA_Double*)input[2].data)[e];
+    k->config.k02 = ((const UA_Double*)input[3].data)[e];
+    k->config.EA2 = ((const UA_Double*)input[4].data)[e];
+    k->config.R = ((const UA_Double*)input[5].data)[e];
+}
+
+/* Reactor of the MathModel object objectId */
+static UA_StatusCode kinetics_reactor(const KineticsMethod* m, const UA_NodeId* objectId,
+    UA_UInt32* index) {
+    FleetObject object;
+    if (!m->fleet)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    if (opc_ua_fleet_node_index(m->ns, objectId, index, &object) != UA_STATUSCODE_GOOD ||
+        object != FLEET_OBJECT_MODEL || *index >= m->fleet->count)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Stages k for the reactor of the MathModel object objectId, if it is in range */
+static UA_StatusCode kinetics_stage(const KineticsMethod* m, const UA_NodeId* objectId,
+    const FleetKinetics* k) {
+    UA_UInt32 i;
+    const UA_StatusCode rc = kinetics_reactor(m, objectId, &i);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+
+    const ConfigMathModel* c = &k->config;
+    if (!(c->k01 >= 0.0 && c->k01 <= LIMIT_K0_MAX) || !(c->k02 >= 0.0 && c->k02 <= LIMIT_K0_MAX) ||
+        !(c->EA1 >= 0.0 && c->EA1 <= LIMIT_EA_MAX) || !(c->EA2 >= 0.0 && c->EA2 <= LIMIT_EA_MAX) ||
+        !(c->R > 0.0 && c->R <= LIMIT_R_MAX))
+        return UA_STATUSCODE_BADOUTOFRANGE;
+
+    fleet_stage_kinetics(m->fleet, i, k);
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief SET_KINETICS of a MathModel object: stages its whole configuration.
+ *
+ * The values replace SUBSTANCE_ID, K01, EA1, K02, EA2 and R together at
+ * the start of the next model tick, so no tick computes with a half
+ * updated set. Returns before that tick.
+ */
+static UA_StatusCode setKineticsMethod(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* methodId, void* methodContext,
+    const UA_NodeId* objectId, void* objectContext,
+    size_t inputSize, const UA_Variant* input,
+    size_t outputSize, UA_Variant* output) {
+
+    if (inputSize != KINETICS_ARG_COUNT)
+        return UA_STATUSCODE_BADARGUMENTSMISSING;
+    if (!kinetics_inputs_valid(input, false, 0))
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+
+    FleetKinetics k;
+    kinetics_from_inputs(input, 0, &k);
+    model_thread_lock(&modelThread);
+    const UA_StatusCode rc = kinetics_stage((const KineticsMethod*)methodContext, objectId, &k);
+    model_thread_unlock(&modelThread);
+    return rc;
+}
+
+/**
+ * @brief SET_KINETICS of the model folder: stages many MathModel objects at once.
+ *
+ * MATH_MODELS[e] gets element e of the other inputs. All configurations
+ * accepted are applied by the same tick; RESULTS holds the status of each.
+ */
+static UA_StatusCode setKineticsBatchMethod(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* methodId, void* methodContext,
+    const UA_NodeId* objectId, void* objectContext,
+    size_t inputSize, const UA_Variant* input,
+    size_t outputSize, UA_Variant* output) {
+
+    if (inputSize != 1 + KINETICS_ARG_COUNT || outputSize != 1)
+        return UA_STATUSCODE_BADARGUMENTSMISSING;
+    const UA_Variant* models = &input[0];
+    const size_t n = models->arrayLength;
+    if (models->type != &UA_TYPES[UA_TYPES_NODEID] || !kinetics_inputs_valid(&input[1], true, n))
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+
+    UA_StatusCode* results = (UA_StatusCode*)UA_Array_new(n, &UA_TYPES[UA_TYPES_STATUSCODE]);
+    if (!results)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+
+    const UA_NodeId* ids = (const UA_NodeId*)models->data;
+    UA_UInt32 staged = 0;
+    model_thread_lock(&modelThread);
+    for (size_t e = 0; e < n; e++) {
+        FleetKinetics k;
+        kinetics_from_inputs(&input[1], e, &k);
+        results[e] = kinetics_stage((const KineticsMethod*)methodContext, &ids[e], &k);
+        staged += results[e] == UA_STATUSCODE_GOOD ? 1 : 0;
+    }
+    model_thread_unlock(&modelThread);
+
+    UA_Variant_setArray(&output[0], results, n, &UA_TYPES[UA_TYPES_STATUSCODE]);
+    LOG_MSG(LOG_LEVEL_INFO, "Kinetics of %u reactors staged, %zu rejected", staged, n - staged);
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief ESTIMATE_KINETICS of a MathModel object: fits its kinetics to the history.
+ *
+ * Takes the samples of its reactor between FROM and TO (0 = the whole
+ * history) and returns the fitted K01, EA1, K02 and EA2, the 95 %
+ * confidence half-width of each in CONFIDENCE, the RMSE of CB, the
+ * samples used, the iterations and whether the fit converged. The fit
+ * starts from the current kinetics and changes nothing; SET_KINETICS
+ * applies the result.
+ */
+static UA_StatusCode estimateKineticsMethod(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* methodId, void* methodContext,
+    const UA_NodeId* objectId, void* objectContext,
+    size_t inputSize, const UA_Variant* input,
+    size_t outputSize, UA_Variant* output) {
+
+    if (inputSize != 2 || outputSize != ESTIMATE_OUTPUT_COUNT)
+        return UA_STATUSCODE_BADARGUMENTSMISSING;
+    for (size_t k = 0; k < 2; k++)
+        if (!UA_Variant_hasScalarType(&input[k], &UA_TYPES[UA_TYPES_DATETIME]))
+            return UA_STATUSCODE_BADTYPEMISMATCH;
+
+    const KineticsMethod* m = (const KineticsMethod*)methodContext;
+    UA_UInt32 i;
+    UA_StatusCode rc = kinetics_reactor(m, objectId, &i);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+    if (!m->history)
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+
+    ReactorFleet* f = m->fleet;
+    model_thread_lock(&modelThread);
+    const ConfigMathModel guess = { f->k01[i], f->EA1[i], f->k02[i], f->EA2[i], f->R[i] };
+    const UA_Double volume = f->volume[i];
+    model_thread_unlock(&modelThread);
+
+    EstimateData data;
+    rc = estimate_data_from_history(&data, m->history, i, volume,
+        *(const UA_DateTime*)input[0].data, *(const UA_DateTime*)input[1].data);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+
+    EstimateOptions opt;
+    estimate_default_options(&opt);
+    opt.maxIterations = config_estimate_max_iterations;
+    EstimateResult res;
+    const UA_UInt64 start = platform_now_ns();
+    rc = estimate_kinetics(m->engine, &data, &guess, &opt, &res);
+    estimate_data_clear(&data);
+    if (rc == UA_STATUSCODE_BADNODATA) {
+        LOG_MSG(LOG_LEVEL_WARN, "Kinetics of reactor %u: too few samples to estimate", i + 1);
+        return rc;
+    }
+    if (rc != UA_STATUSCODE_GOOD) {
+        LOG_MSG(LOG_LEVEL_WARN, "Kinetics of reactor %u: estimation failed (%s)",
+            i + 1, UA_StatusCode_name(rc));
+        return rc;
+    }
+
+    UA_Variant_setScalarCopy(&output[0], &res.kinetics.k01, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setScalarCopy(&output[1], &res.kinetics.EA1, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setScalarCopy(&output[2], &res.kinetics.k02, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setScalarCopy(&output[3], &res.kinetics.EA2, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setArrayCopy(&output[4], res.confidence, ESTIMATE_PARAMS, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setScalarCopy(&output[5], &res.rmse, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setScalarCopy(&output[6], &res.samples, &UA_TYPES[UA_TYPES_UINT32]);
+    UA_Variant_setScalarCopy(&output[7], &res.iterations, &UA_TYPES[UA_TYPES_UINT32]);
+    UA_Variant_setScalarCopy(&output[8], &res.converged, &UA_TYPES[UA_TYPES_BOOLEAN]);
+
+    LOG_MSG(LOG_LEVEL_INFO,
+        "Kinetics of reactor %u estimated from %u samples in %u iterations (%.1f ms), RMSE %g",
+        i + 1, res.samples, res.iterations,
+        (platform_now_ns() - start) / 1e6, res.rmse);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Inputs of OPTIMIZE, in this order */
+static const struct { char* name; UA_UInt32 type; UA_Int32 valueRank; } optimizeInputs[] = {
+    { "GOAL", UA_TYPES_UINT32, UA_VALUERANK_SCALAR },
+    { "TARGET_CB", UA_TYPES_DOUBLE, UA_VALUERANK_SCALAR },
+    { "MIN", UA_TYPES_DOUBLE, UA_VALUERANK_ONE_DIMENSION },
+    { "MAX", UA_TYPES_DOUBLE, UA_VALUERANK_ONE_DIMENSION },
+};
+#define OPTIMIZE_INPUT_COUNT (sizeof(optimizeInputs) / sizeof(optimizeInputs[0]))
+
+/* Outputs of OPTIMIZE, in this order */
+static const struct { char* name; UA_UInt32 type; UA_Int32 valueRank; } optimizeOutputs[] = {
+    { "OPENINGS", UA_TYPES_DOUBLE, UA_VALUERANK_ONE_DIMENSION },
+    { "CB", UA_TYPES_DOUBLE, UA_VALUERANK_SCALAR },
+    { "F", UA_TYPES_DOUBLE, UA_VALUERANK_SCALAR },
+    { "FEASIBLE", UA_TYPES_BOOLEAN, UA_VALUERANK_SCALAR },
+    { "EVALUATIONS", UA_TYPES_UINT32, UA_VALUERANK_SCALAR },
+};
+#define OPTIMIZE_OUTPUT_COUNT (sizeof(optimizeOutputs) / sizeof(optimizeOutputs[0]))
+
+/* Context of the methods of ReactorType: the fleet and namespace of the
+   Reactor objects, their sweeps (opc_ua_create_fleet_instances()) and the
+   engine evaluating SWEEP and OPTIMIZE (opc_ua_enable_reactor_methods()) */
+typedef struct {
+    ReactorFleet* fleet;
+    UA_UInt16 ns;
+    SweepSet* sweeps;
+    ModelEngine* engine;
+} ReactorMethod;
+
+static ReactorMethod reactorMethod;
+
+/* SWEEP and OPTIMIZE of ReactorType, shared by every Reactor object */
+static UA_NodeId sweepMethodId;
+static UA_NodeId optimizeMethodId;
+
+/* Reactor of the Reactor object objectId */
+static UA_StatusCode reactor_method_index(const ReactorMethod* m, const UA_NodeId* objectId,
+    UA_UInt32* index) {
+    FleetObject object;
+    if (!m->fleet)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    if (opc_ua_fleet_node_index(m->ns, objectId, index, &object) != UA_STATUSCODE_GOOD ||
+        object != FLEET_OBJECT_REACTOR || *index >= m->fleet->count)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief SWEEP of a Reactor object: evaluates CB over the grid of its SWEEP_* variables.
+ *
+ * Captures the current kinetics, volume and valve characteristics, fills
+ * SWEEP_CB with the steady-state CB of every combination of HC-1, HC-2
+ * and HC-3 openings and returns the cells evaluated. Changes nothing of
+ * the running model. BadOutOfRange if the grid is not valid.
+ */
+static UA_StatusCode sweepReactorMethod(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* methodId, void* methodContext,
+    const UA_NodeId* objectId, void* objectContext,
+    size_t inputSize, const UA_Variant* input,
+    size_t outputSize, UA_Variant* output) {
+
+    if (outputSize != 1)
+        return UA_STATUSCODE_BADARGUMENTSMISSING;
+
+    const ReactorMethod* m = (const ReactorMethod*)methodContext;
+    if (!m->sweeps)
+        return UA_STATUSCODE_BADNOTSUPPORTED;
+    UA_UInt32 i;
+    UA_StatusCode rc = reactor_method_index(m, objectId, &i);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+    if (i >= m->sweeps->capacity)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+
+    Sweep* s = &m->sweeps->items[i];
+    /* The plan holds three lookup tables, too large for the stack */
+    SweepPlan* plan = (SweepPlan*)UA_malloc(sizeof(SweepPlan));
+    if (!plan)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    model_thread_lock(&modelThread);
+    const SweepGrid grid = s->grid;
+    rc = sweep_grid_check(&grid);
+    if (rc == UA_STATUSCODE_GOOD)
+        sweep_plan(m->fleet, i, &grid, plan);
+    model_thread_unlock(&modelThread);
+    if (rc != UA_STATUSCODE_GOOD) {
+        UA_free(plan);
+        LOG_MSG(LOG_LEVEL_WARN, "Sweep of reactor %u: grid out of range", i + 1);
+        return rc;
+    }
+
+    const UA_UInt32 cells = sweep_grid_cells(&grid);
+    UA_Double* cb = (UA_Double*)UA_malloc((size_t)cells * sizeof(UA_Double));
+    if (!cb) {
+        UA_free(plan);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    const UA_UInt64 start = platform_now_ns();
+    sweep_run(m->engine, plan, cb);
+    UA_free(plan);
+    sweep_publish(s, &grid, cb);
+    UA_Variant_setScalarCopy(&output[0], &cells, &UA_TYPES[UA_TYPES_UINT32]);
+
+    LOG_MSG(LOG_LEVEL_INFO, "Sweep of reactor %u: %u cells in %.1f ms",
+        i + 1, cells, (platform_now_ns() - start) / 1e6);
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief OPTIMIZE of a Reactor object: searches the valve openings reaching GOAL.
+ *
+ * GOAL (OptimizeGoal) 0 looks for the highest steady-state CB, 1 for CB
+ * equal to TARGET_CB at the lowest flow. MIN and MAX bound the HC-1,
+ * HC-2 and HC-3 openings (%), empty for the whole range. Returns the
+ * OPENINGS found with their CB and flow F, whether they reach the goal
+ * (FEASIBLE, else they come closest) and the CB evaluations it took.
+ * Evaluates the current kinetics, volume and valve characteristics and
+ * changes nothing; writing MANUAL_OUTPUT of the valves applies the result.
+ */
+static UA_StatusCode optimizeReactorMethod(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* methodId, void* methodContext,
+    const UA_NodeId* objectId, void* objectContext,
+    size_t inputSize, const UA_Variant* input,
+    size_t outputSize, UA_Variant* output) {
+
+    if (inputSize != OPTIMIZE_INPUT_COUNT || outputSize != OPTIMIZE_OUTPUT_COUNT)
+        return UA_STATUSCODE_BADARGUMENTSMISSING;
+    if (!UA_Variant_hasScalarType(&input[0], &UA_TYPES[UA_TYPES_UINT32]) ||
+        !UA_Variant_hasScalarType(&input[1], &UA_TYPES[UA_TYPES_DOUBLE]))
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+
+    OptimizeProblem prob;
+    prob.goal = (OptimizeGoal)*(const UA_UInt32*)input[0].data;
+    prob.target = *(const UA_Double*)input[1].data;
+    for (int a = 0; a < OPTIMIZE_AXES; a++) {
+        prob.min[a] = 0.0;
+        prob.max[a] = 100.0;
+    }
+    for (size_t k = 2; k < 4; k++) {
+        const UA_Variant* v = &input[k];
+        if (v->type != &UA_TYPES[UA_TYPES_DOUBLE] || UA_Variant_isScalar(v))
+            return UA_STATUSCODE_BADTYPEMISMATCH;
+        if (v->arrayLength == 0)
+            continue;
+        if (v->arrayLength != OPTIMIZE_AXES)
+            return UA_STATUSCODE_BADOUTOFRANGE;
+        memcpy(k == 2 ? prob.min : prob.max, v->data, sizeof(prob.min));
+    }
+
+    const ReactorMethod* m = (const ReactorMethod*)methodContext;
+    UA_UInt32 i;
+    UA_StatusCode rc = reactor_method_index(m, objectId, &i);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+    rc = optimize_check(&prob);
+    if (rc != UA_STATUSCODE_GOOD) {
+        LOG_MSG(LOG_LEVEL_WARN, "Optimization of reactor %u: goal or bounds out of range", i + 1);
+        return rc;
+    }
+
+    /* The plan holds three lookup tables, too large for the stack */
+    OptimizePlan* plan = (OptimizePlan*)UA_malloc(sizeof(OptimizePlan));
+    if (!plan)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    /* Runs on the method worker: the lock is shared with model_cb() and the writers */
+    model_thread_lock(&modelThread);
+    optimize_plan(m->fleet, i, &prob, plan);
+    model_thread_unlock(&modelThread);
+
+    OptimizeOptions opt;
+    optimize_default_options(&opt);
+    opt.starts = config_optimize_starts;
+    opt.maxIterations = config_optimize_max_iterations;
+    OptimizeResult res;
+    const UA_UInt64 start = platform_now_ns();
+    rc = optimize_run(m->engine, plan, &opt, &res);
+    UA_free(plan);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+
+    UA_Variant_setArrayCopy(&output[0], res.opening, OPTIMIZE_AXES, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setScalarCopy(&output[1], &res.CB, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setScalarCopy(&output[2], &res.F, &UA_TYPES[UA_TYPES_DOUBLE]);
+    UA_Variant_setScalarCopy(&output[3], &res.feasible, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    UA_Variant_setScalarCopy(&output[4], &res.evaluations, &UA_TYPES[UA_TYPES_UINT32]);
+
+    if (!res.feasible)
+        LOG_MSG(LOG_LEVEL_WARN, "Optimization of reactor %u: goal not reached, closest CB %g",
+            i + 1, res.CB);
+    LOG_MSG(LOG_LEVEL_INFO,
+        "Optimization of reactor %u: CB %g at F %g l/min, %u evaluations in %.1f ms",
+        i + 1, res.CB, res.F, res.evaluations,
+        (platform_now_ns() - start) / 1e6);
+    return UA_STATUSCODE_GOOD;
+}
+
 UA_NodeId sensorTypeId = { 1, UA_NODEIDTYPE_NUMERIC, { 1002 } };
 UA_NodeId reactorTypeId = { 1, UA_NODEIDTYPE_NUMERIC, { 1004 } };
 UA_NodeId valveHandleControlType = { 1, UA_NODEIDTYPE_NUMERIC, { 1005 } };
@@ -390,7 +1130,9 @@ UA_NodeId mathModelTypeId = { 1, UA_NODEIDTYPE_NUMERIC, { 1006 } };
  * @brief Declares the ValveHandleControlType ObjectType in namespace 1.
  *
  * Creates a custom ObjectType with a mandatory Double variable
- * MANUAL_OUTPUT to represent manual valve position (0–100 %).
+ * MANUAL_OUTPUT to represent manual valve position (0–100 %), the
+ * UInt32 CHARACTERISTIC (ValveCharacteristic) and the Double array
+ * CHARACTERISTIC_TABLE holding the breakpoints of a custom one.
  */
 UA_NodeId addValveHandleControlType(UA_Server* server) {
     UA_ObjectTypeAttributes varAttr = UA_ObjectTypeAttributes_default;
@@ -413,6 +1155,10 @@ UA_NodeId addValveHandleControlType(UA_Server* server) {
         UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
         manualOutputAttr, NULL, &manualOutputId);
     add_reference_mandatory(server, manualOutputId);
+    add_mandatory_variable(server, valveHandleControlType, "CHARACTERISTIC",
+        &UA_TYPES[UA_TYPES_UINT32], UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE);
+    add_mandatory_array_variable(server, valveHandleControlType, "CHARACTERISTIC_TABLE",
+        &UA_TYPES[UA_TYPES_DOUBLE], UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE);
     return valveHandleControlType;
 }
 
@@ -420,7 +1166,10 @@ UA_NodeId addValveHandleControlType(UA_Server* server) {
  * @brief Declares the ReactorType ObjectType in namespace 1.
  *
  * Creates a custom ObjectType with a mandatory Double variable
- * REACTOR_VOLUME to represent reactor volume.
+ * REACTOR_VOLUME to represent reactor volume, the method SWEEP
+ * evaluating the what-if sweep of the reactor (sweepReactorMethod) and
+ * the method OPTIMIZE(GOAL, TARGET_CB, MIN, MAX) searching its valve
+ * openings (optimizeReactorMethod).
  */
 UA_NodeId addReactorType(UA_Server* server) {
     UA_ObjectTypeAttributes varAttr = UA_ObjectTypeAttributes_default;
@@ -443,6 +1192,46 @@ UA_NodeId addReactorType(UA_Server* server) {
         UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
         reactorAttr, NULL, &reactorId);
     add_reference_mandatory(server, reactorId);
+
+    UA_Argument out;
+    UA_Argument_init(&out);
+    out.name = UA_STRING("CELLS");
+    out.dataType = UA_TYPES[UA_TYPES_UINT32].typeId;
+    out.valueRank = UA_VALUERANK_SCALAR;
+    UA_MethodAttributes mAttr = UA_MethodAttributes_default;
+    mAttr.displayName = UA_LOCALIZEDTEXT("en-US", "SWEEP");
+    mAttr.executable = true;
+    mAttr.userExecutable = true;
+    UA_Server_addMethodNode(server, UA_NODEID_NULL, reactorTypeId,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(1, "SWEEP"),
+        mAttr, sweepReactorMethod, 0, NULL, 1, &out, &reactorMethod, &sweepMethodId);
+    add_reference_mandatory(server, sweepMethodId);
+
+    UA_Argument optIn[OPTIMIZE_INPUT_COUNT];
+    for (size_t k = 0; k < OPTIMIZE_INPUT_COUNT; k++) {
+        UA_Argument_init(&optIn[k]);
+        optIn[k].name = UA_STRING(optimizeInputs[k].name);
+        optIn[k].dataType = UA_TYPES[optimizeInputs[k].type].typeId;
+        optIn[k].valueRank = optimizeInputs[k].valueRank;
+    }
+    UA_Argument optOut[OPTIMIZE_OUTPUT_COUNT];
+    for (size_t k = 0; k < OPTIMIZE_OUTPUT_COUNT; k++) {
+        UA_Argument_init(&optOut[k]);
+        optOut[k].name = UA_STRING(optimizeOutputs[k].name);
+        optOut[k].dataType = UA_TYPES[optimizeOutputs[k].type].typeId;
+        optOut[k].valueRank = optimizeOutputs[k].valueRank;
+    }
+    UA_MethodAttributes oAttr = UA_MethodAttributes_default;
+    oAttr.displayName = UA_LOCALIZEDTEXT("en-US", "OPTIMIZE");
+    oAttr.executable = true;
+    oAttr.userExecutable = true;
+    UA_Server_addMethodNode(server, UA_NODEID_NULL, reactorTypeId,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(1, "OPTIMIZE"),
+        oAttr, optimizeReactorMethod, OPTIMIZE_INPUT_COUNT, optIn, OPTIMIZE_OUTPUT_COUNT, optOut,
+        &reactorMethod, &optimizeMethodId);
+    add_reference_mandatory(server, optimizeMethodId);
     return reactorTypeId;
 }
 
@@ -450,7 +1239,11 @@ UA_NodeId addReactorType(UA_Server* server) {
  * @brief Declares the MathModelType ObjectType in namespace 1.
  *
  * Creates a custom ObjectType for kinetic model configuration with
- * variables: SUBSTANCE_ID, K01, K02, EA1, EA2.
+ * variables: SUBSTANCE_ID (selecting the kinetics of the substance
+ * library at the next tick, see substance.c), K01, K02, EA1, EA2, and the method
+ * SET_KINETICS(SUBSTANCE_ID, K01, EA1, K02, EA2, R) setting them all in
+ * one call (setKineticsMethod), and the method ESTIMATE_KINETICS(FROM, TO)
+ * fitting them to the history (estimateKineticsMethod).
  */
 UA_NodeId addMathModelType(UA_Server* server) {
     UA_ObjectTypeAttributes attr = UA_ObjectTypeAttributes_default;
@@ -521,6 +1314,46 @@ UA_NodeId addMathModelType(UA_Server* server) {
         UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
         E2Attr, NULL, &E2Id);
     add_reference_mandatory(server, E2Id);
+
+    UA_Argument in[KINETICS_ARG_COUNT];
+    kinetics_arguments(in, UA_VALUERANK_SCALAR);
+    UA_MethodAttributes mAttr = UA_MethodAttributes_default;
+    mAttr.displayName = UA_LOCALIZEDTEXT("en-US", "SET_KINETICS");
+    mAttr.executable = true;
+    mAttr.userExecutable = true;
+    UA_NodeId setId;
+    UA_Server_addMethodNode(server, UA_NODEID_NULL, mathModelTypeId,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(1, "SET_KINETICS"),
+        mAttr, setKineticsMethod, KINETICS_ARG_COUNT, in, 0, NULL, &kineticsMethod, &setId);
+    add_reference_mandatory(server, setId);
+
+    UA_Argument range[2];
+    UA_Argument_init(&range[0]);
+    range[0].name = UA_STRING("FROM");
+    range[0].dataType = UA_TYPES[UA_TYPES_DATETIME].typeId;
+    range[0].valueRank = UA_VALUERANK_SCALAR;
+    UA_Argument_init(&range[1]);
+    range[1].name = UA_STRING("TO");
+    range[1].dataType = UA_TYPES[UA_TYPES_DATETIME].typeId;
+    range[1].valueRank = UA_VALUERANK_SCALAR;
+    UA_Argument out[ESTIMATE_OUTPUT_COUNT];
+    for (size_t k = 0; k < ESTIMATE_OUTPUT_COUNT; k++) {
+        UA_Argument_init(&out[k]);
+        out[k].name = UA_STRING(estimateOutputs[k].name);
+        out[k].dataType = UA_TYPES[estimateOutputs[k].type].typeId;
+        out[k].valueRank = estimateOutputs[k].valueRank;
+    }
+    UA_MethodAttributes eAttr = UA_MethodAttributes_default;
+    eAttr.displayName = UA_LOCALIZEDTEXT("en-US", "ESTIMATE_KINETICS");
+    eAttr.executable = true;
+    eAttr.userExecutable = true;
+    UA_Server_addMethodNode(server, UA_NODEID_NULL, mathModelTypeId,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(1, "ESTIMATE_KINETICS"),
+        eAttr, estimateKineticsMethod, 2, range, ESTIMATE_OUTPUT_COUNT, out, &kineticsMethod,
+        &estimateMethodId);
+    add_reference_mandatory(server, estimateMethodId);
     return mathModelTypeId;
 }
 
@@ -528,7 +1361,9 @@ UA_NodeId addMathModelType(UA_Server* server) {
  * @brief Declares the SensorType ObjectType in namespace 1.
  *
  * Creates a custom ObjectType with a mandatory Double variable
- * PROCESS_VALUE to represent the measured value.
+ * PROCESS_VALUE to represent the measured value, and the push mode
+ * variables: PUBLISH_MODE (read-only), DEADBAND_TYPE, DEADBAND and the
+ * read-only PUBLISHED_COUNT / SUPPRESSED_COUNT counters.
  */
 UA_NodeId addSensorType(UA_Server* server) {
     UA_ObjectTypeAttributes varAttr = UA_ObjectTypeAttributes_default;
@@ -551,18 +1386,31 @@ UA_NodeId addSensorType(UA_Server* server) {
         UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
         pvAttr, NULL, &pvId);
     add_reference_mandatory(server, pvId);
+
+    add_mandatory_variable(server, sensorTypeId, "PUBLISH_MODE",
+        &UA_TYPES[UA_TYPES_UINT32], UA_ACCESSLEVELMASK_READ);
+    add_mandatory_variable(server, sensorTypeId, "DEADBAND_TYPE",
+        &UA_TYPES[UA_TYPES_UINT32], UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE);
+    add_mandatory_variable(server, sensorTypeId, "DEADBAND",
+        &UA_TYPES[UA_TYPES_DOUBLE], UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE);
+    add_mandatory_variable(server, sensorTypeId, "PUBLISHED_COUNT",
+        &UA_TYPES[UA_TYPES_UINT32], UA_ACCESSLEVELMASK_READ);
+    add_mandatory_variable(server, sensorTypeId, "SUPPRESSED_COUNT",
+        &UA_TYPES[UA_TYPES_UINT32], UA_ACCESSLEVELMASK_READ);
     return sensorTypeId;
 }
 
 /**
- * @brief Creates a ValveHandleControl instance object and binds MANUAL_OUTPUT.
+ * @brief Creates a ValveHandleControl instance object and binds its variables.
  *
  * Adds an Object of type ValveHandleControlType under parentFolder,
- * stores its NodeId into valveHandleControl->objId and attaches the
- * MANUAL_OUTPUT variable to valveHandleControl->manualoutput.
+ * stores its NodeId into the fleet slot of the given valve, attaches
+ * the MANUAL_OUTPUT variable to fleet->manualoutput[valve][index] and
+ * the characteristic variables to the valve's curve.
  */
 UA_StatusCode opc_ua_create_valve_handle_control(UA_Server* server,
-    UA_NodeId parentFolder, const char* valveHandleControlName, ValveHandleControl* valveHandleControl) {
+    UA_NodeId parentFolder, const char* valveHandleControlName,
+    ReactorFleet* fleet, UA_UInt32 index, FleetValve valve) {
     UA_NodeId valveHandleControlObjId;
     UA_StatusCode rc = UA_Server_addObjectNode(server,
         UA_NODEID_NULL,
@@ -572,14 +1420,22 @@ UA_StatusCode opc_ua_create_valve_handle_control(UA_Server* server,
         valveHandleControlType,
         UA_ObjectAttributes_default, NULL, &valveHandleControlObjId);
     if (rc != UA_STATUSCODE_GOOD) {
-        printf("Failed to add object valve handle control %s\n", valveHandleControlName);
+        LOG_MSG(LOG_LEVEL_ERROR, "Failed to add object valve handle control %s", valveHandleControlName);
         return rc;
     }
     else {
-        printf("Valve Handle Control %s created successfully\n", valveHandleControlName);
+        LOG_MSG(LOG_LEVEL_INFO, "Valve Handle Control %s created successfully", valveHandleControlName);
     }
-    valveHandleControl->objId = valveHandleControlObjId;
-    rc = attach_child_double(server, valveHandleControlObjId, "MANUAL_OUTPUT", &valveHandleControl->manualoutput); if (rc) return rc;
+    fleet->valveObjId[valve][index] = valveHandleControlObjId;
+    rc = attach_child_double(server, valveHandleControlObjId, valveHandleControlName, "MANUAL_OUTPUT",
+        &fleet->manualoutput[valve][index], LIMIT_MANUAL_OUTPUT_MIN, LIMIT_MANUAL_OUTPUT_MAX,
+        &fleet->inputDirty[index], FLEET_DIRTY_PROCESS); if (rc) return rc;
+    rc = attach_child_valve(server, valveHandleControlObjId, valveHandleControlName, "CHARACTERISTIC",
+        BINDING_VALVE_CURVE, &fleet->valveSlot[valve][index],
+        &fleet->inputDirty[index], FLEET_DIRTY_PROCESS); if (rc) return rc;
+    rc = attach_child_valve(server, valveHandleControlObjId, valveHandleControlName, "CHARACTERISTIC_TABLE",
+        BINDING_VALVE_TABLE, &fleet->valveSlot[valve][index],
+        &fleet->inputDirty[index], FLEET_DIRTY_PROCESS); if (rc) return rc;
     return UA_STATUSCODE_GOOD;
 }
 
@@ -587,11 +1443,12 @@ UA_StatusCode opc_ua_create_valve_handle_control(UA_Server* server,
  * @brief Creates a Reactor instance object and binds REACTOR_VOLUME.
  *
  * Adds an Object of type ReactorType under parentFolder, stores its
- * NodeId into reactor->objId and attaches the REACTOR_VOLUME variable
- * to reactor->volume.
+ * NodeId into fleet->reactorObjId[index] and attaches the REACTOR_VOLUME
+ * variable to fleet->volume[index].
  */
 UA_StatusCode opc_ua_create_reactor_instance(UA_Server* server,
-    UA_NodeId parentFolder, const char* reactorName, Reactor* reactor) {
+    UA_NodeId parentFolder, const char* reactorName,
+    ReactorFleet* fleet, UA_UInt32 index) {
     UA_NodeId reactorObjId;
     UA_StatusCode rc = UA_Server_addObjectNode(server,
         UA_NODEID_NULL,
@@ -601,27 +1458,75 @@ UA_StatusCode opc_ua_create_reactor_instance(UA_Server* server,
         reactorTypeId,
         UA_ObjectAttributes_default, NULL, &reactorObjId);
     if (rc != UA_STATUSCODE_GOOD) {
-        printf("Failed to add object reactor %s\n", reactorName);
+        LOG_MSG(LOG_LEVEL_ERROR, "Failed to add object reactor %s", reactorName);
         return rc;
     }
     else {
-        printf("Reactor %s created successfully\n", reactorName);
+        LOG_MSG(LOG_LEVEL_INFO, "Reactor %s created successfully", reactorName);
     }
-    reactor->objId = reactorObjId;
-    rc = attach_child_double(server, reactorObjId, "REACTOR_VOLUME", &reactor->volume); if (rc) return rc;
+    fleet->reactorObjId[index] = reactorObjId;
+    rc = attach_child_double(server, reactorObjId, reactorName, "REACTOR_VOLUME",
+        &fleet->volume[index], LIMIT_VOLUME_MIN, LIMIT_VOLUME_MAX,
+        &fleet->inputDirty[index], FLEET_DIRTY_PROCESS); if (rc) return rc;
     return UA_STATUSCODE_GOOD;
 }
 
+/**
+ * @brief Turns PROCESS_VALUE into a value-backed node fed by publish_tick().
+ *
+ * Keeps the NodeId in the sensor's push state and writes the current
+ * snapshot value as the initial node value. The node still gets a sensor
+ * binding as context, which identifies it to the historian; reads do not
+ * go through it.
+ */
+static UA_StatusCode attach_child_push(UA_Server* server,
+    const UA_NodeId parent,
+    const char* objectName,
+    const char* browseName,
+    ReactorFleet* fleet, UA_UInt32 index, FleetSensor sensor) {
+
+    SensorPublish* p = &fleet->publish[sensor][index];
+
+    UA_StatusCode ret = find_child_var(server, parent, browseName, &p->valueId);
+    if (ret != UA_STATUSCODE_GOOD) {
+        return ret;
+    }
+
+    UA_Double v;
+    fleet_read_pv(fleet, sensor, index, &v, NULL);
+
+    UA_Variant value;
+    UA_Variant_setScalar(&value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+    ret = UA_Server_writeValue(server, p->valueId, value);
+    if (ret != UA_STATUSCODE_GOOD) {
+        return ret;
+    }
+    p->lastValue = v;
+
+    NodeBinding* binding = binding_new(BINDING_SENSOR, &fleet->sensorSlot[sensor][index]);
+    if (!binding) {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    binding_set_name(binding, objectName, browseName);
+    return UA_Server_setNodeContext(server, p->valueId, binding);
+}
+
 /**
  * @brief Creates a Sensor instance object and binds PROCESS_VALUE.
  *
- * Adds an Object of type SensorType under parentFolder, stores its
- * NodeId into sensor->objId and attaches the PROCESS_VALUE variable
- * to sensor->pv.
+ * Adds an Object of type SensorType under parentFolder and stores its
+ * NodeId into the fleet slot of the given sensor. In poll mode the
+ * PROCESS_VALUE variable is attached to the published snapshot of
+ * fleet->pv[sensor][index]; in push mode it stays value-backed and is
+ * written by publish_tick() when the value leaves the deadband.
+ * The publish mode, deadband settings and push counters are bound to
+ * fleet->publish[sensor][index].
  */
 UA_StatusCode opc_ua_create_sensor_instance(UA_Server* server,
     UA_NodeId parentFolder, const char* sensorName,
-    UA_Boolean enableAlarms, Sensor* sensor)
+    UA_Boolean enableAlarms, ReactorFleet* fleet, UA_UInt32 index,
+    FleetSensor sensor, SensorPublishMode mode, DeadbandType deadbandType,
+    UA_Double deadband)
 {
     (void)enableAlarms; /* alarms not used in this version */
 
@@ -634,16 +1539,36 @@ UA_StatusCode opc_ua_create_sensor_instance(UA_Server* server,
         sensorTypeId,
         UA_ObjectAttributes_default, NULL, &sensorObjId);
     if (rc != UA_STATUSCODE_GOOD) {
-        printf("Failed to add object sensor %s\n", sensorName);
+        LOG_MSG(LOG_LEVEL_ERROR, "Failed to add object sensor %s", sensorName);
         return rc;
     }
     else {
-        printf("Sensor %s created successfully\n", sensorName);
+        LOG_MSG(LOG_LEVEL_INFO, "Sensor %s created successfully", sensorName);
     }
 
-    sensor->objId = sensorObjId;
+    fleet->sensorObjId[sensor][index] = sensorObjId;
+
+    SensorPublish* pub = &fleet->publish[sensor][index];
+    pub->mode = mode;
+    pub->deadbandType = deadbandType;
+    pub->deadband = deadband;
 
-    rc = attach_child_double(server, sensorObjId, "PROCESS_VALUE", &sensor->pv); if (rc) return rc;
+    if (mode == SENSOR_PUBLISH_PUSH) {
+        rc = attach_child_push(server, sensorObjId, sensorName, "PROCESS_VALUE", fleet, index, sensor); if (rc) return rc;
+    }
+    else {
+        rc = attach_child_sensor(server, sensorObjId, sensorName, "PROCESS_VALUE", &fleet->sensorSlot[sensor][index]); if (rc) return rc;
+    }
+    rc = attach_child_UInt32(server, sensorObjId, sensorName, "PUBLISH_MODE", &pub->mode,
+        SENSOR_PUBLISH_POLL, SENSOR_PUBLISH_PUSH, NULL, 0); if (rc) return rc;
+    rc = attach_child_UInt32(server, sensorObjId, sensorName, "DEADBAND_TYPE", &pub->deadbandType,
+        DEADBAND_NONE, DEADBAND_PERCENT, NULL, 0); if (rc) return rc;
+    rc = attach_child_double(server, sensorObjId, sensorName, "DEADBAND", &pub->deadband,
+        0.0, LIMIT_DEADBAND_MAX, NULL, 0); if (rc) return rc;
+    rc = attach_child_UInt32(server, sensorObjId, sensorName, "PUBLISHED_COUNT", &pub->published,
+        0.0, UA_UINT32_MAX, NULL, 0); if (rc) return rc;
+    rc = attach_child_UInt32(server, sensorObjId, sensorName, "SUPPRESSED_COUNT", &pub->suppressed,
+        0.0, UA_UINT32_MAX, NULL, 0); if (rc) return rc;
     return UA_STATUSCODE_GOOD;
 }
 
@@ -651,11 +1576,11 @@ UA_StatusCode opc_ua_create_sensor_instance(UA_Server* server,
  * @brief Creates a MathModelType instance and binds configuration fields.
  *
  * Adds an Object of type MathModelType under parentFolder and binds
- * SUBSTANCE_ID, K01, K02, EA1, EA2 to the corresponding fields in
- * the ModelCtx structure.
+ * SUBSTANCE_ID, K01, K02, EA1, EA2 to the kinetic arrays of the fleet
+ * at the given reactor index.
  */
 UA_StatusCode opc_ua_create_math_model_instance(UA_Server* server,
-    UA_NodeId parentFolder, const char* name, ModelCtx* m)
+    UA_NodeId parentFolder, const char* name, ReactorFleet* fleet, UA_UInt32 index)
 {
     UA_NodeId objId;
     UA_StatusCode rc = UA_Server_addObjectNode(server,
@@ -665,16 +1590,75 @@ UA_StatusCode opc_ua_create_math_model_instance(UA_Server* server,
         mathModelTypeId,
         UA_ObjectAttributes_default, NULL, &objId);
     if (rc) return rc;
+    fleet->modelObjId[index] = objId;
 
-    rc = attach_child_UInt32(server, objId, "SUBSTANCE_ID", &m->substanceId); if (rc) return rc;
-    rc = attach_child_double(server, objId, "K01", &m->cfg.k01); if (rc) return rc;
-    rc = attach_child_double(server, objId, "K02", &m->cfg.k02); if (rc) return rc;
-    rc = attach_child_double(server, objId, "EA1", &m->cfg.EA1); if (rc) return rc;
-    rc = attach_child_double(server, objId, "EA2", &m->cfg.EA2); if (rc) return rc;
+    UA_Byte* dirty = &fleet->inputDirty[index];
+    rc = attach_child_UInt32(server, objId, name, "SUBSTANCE_ID", &fleet->substanceId[index],
+        0.0, UA_UINT32_MAX, dirty, FLEET_DIRTY_KINETICS); if (rc) return rc;
+    rc = attach_child_double(server, objId, name, "K01", &fleet->k01[index], 0.0, LIMIT_K0_MAX, dirty, FLEET_DIRTY_KINETICS); if (rc) return rc;
+    rc = attach_child_double(server, objId, name, "K02", &fleet->k02[index], 0.0, LIMIT_K0_MAX, dirty, FLEET_DIRTY_KINETICS); if (rc) return rc;
+    rc = attach_child_double(server, objId, name, "EA1", &fleet->EA1[index], 0.0, LIMIT_EA_MAX, dirty, FLEET_DIRTY_KINETICS); if (rc) return rc;
+    rc = attach_child_double(server, objId, name, "EA2", &fleet->EA2[index], 0.0, LIMIT_EA_MAX, dirty, FLEET_DIRTY_KINETICS); if (rc) return rc;
 
     return UA_STATUSCODE_GOOD;
 }
 
+/* Write callback of each binding kind, NULL for read-only kinds */
+static UA_StatusCode (*const bindingWriteDS[BINDING_KIND_COUNT])(UA_Server*, const UA_NodeId*,
+    void*, const UA_NodeId*, void*, const UA_NumericRange*, const UA_DataValue*) = {
+    writeDoubleDS,              /* BINDING_DOUBLE */
+    writeUInt32DS,              /* BINDING_UINT32 */
+    NULL,                       /* BINDING_SENSOR */
+    writeValveCurveDS,          /* BINDING_VALVE_CURVE */
+    writeValveTableDS,          /* BINDING_VALVE_TABLE */
+    NULL,                       /* BINDING_UINT64 */
+    NULL,                       /* BINDING_HISTOGRAM */
+    writeSweepGridDS,           /* BINDING_SWEEP_BOUNDS */
+    writeSweepGridDS,           /* BINDING_SWEEP_POINTS */
+    NULL,                       /* BINDING_SWEEP_SURFACE */
+};
+
+/**
+ * @brief DataSource write callback for all writable bound variables.
+ *
+ * Dispatches on the binding kind and counts the write, and whether
+ * validation rejected it, in the diagnostics; some writes are timed.
+ */
+static UA_StatusCode writeBindingDS(UA_Server* server,
+    const UA_NodeId* sessionId, void* sessionContext,
+    const UA_NodeId* nodeId, void* nodeContext,
+    const UA_NumericRange* range,
+    const UA_DataValue* data) {
+
+    NodeBinding* b = (NodeBinding*)nodeContext;
+    if (!b || b->kind >= BINDING_KIND_COUNT || !bindingWriteDS[b->kind])
+        return UA_STATUSCODE_BADINTERNALERROR;
+
+    DiagDataSource* d = &diag.dataSource[b->kind];
+    const UA_UInt64 t0 = diag_call_begin(&d->writes);
+    model_thread_lock(&modelThread);
+    const UA_StatusCode rc = bindingWriteDS[b->kind](server, sessionId, sessionContext,
+        nodeId, nodeContext, range, data);
+    model_thread_unlock(&modelThread);
+    if (rc != UA_STATUSCODE_GOOD)
+        d->rejected++;
+    diag_call_end(&d->writeNs, t0);
+    return rc;
+}
+
+/**
+ * @brief DataSource callbacks of a variable bound with the given kind.
+ *
+ * Read-only kinds get no write callback. Also used by the benchmarks to
+ * call the callbacks directly.
+ */
+UA_DataSource opc_ua_binding_data_source(BindingKind kind) {
+    UA_DataSource ds;
+    ds.read = readBindingDS;
+    ds.write = (kind < BINDING_KIND_COUNT && bindingWriteDS[kind]) ? writeBindingDS : NULL;
+    return ds;
+}
+
 /**
  * @brief Creates a top-level folder under Objects for grouping instances.
  *
@@ -687,7 +1671,7 @@ UA_StatusCode opc_ua_create_cell_folder(UA_Server* server,
     UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
     oAttr.displayName = UA_LOCALIZEDTEXT("en-US", (char*)cellName);
 
-    printf("create");
+    LOG_MSG(LOG_LEVEL_DEBUG, "Creating folder %s", cellName);
     return UA_Server_addObjectNode(server,
         UA_NODEID_NULL,
         UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
@@ -696,3 +1680,489 @@ UA_StatusCode opc_ua_create_cell_folder(UA_Server* server,
         UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE),
         oAttr, NULL, outFolderId);
 }
+
+/**
+ * @brief Returns the index of the fleet namespace, registering it on first use.
+ */
+UA_UInt16 opc_ua_fleet_namespace(UA_Server* server) {
+    return UA_Server_addNamespace(server, FLEET_NAMESPACE_URI);
+}
+
+/**
+ * @brief NodeId of a bulk-created fleet node.
+ *
+ * Every object of every reactor owns FLEET_NODE_STRIDE consecutive
+ * numeric identifiers: child 0 is the object itself, child c > 0 its
+ * c-th bound variable in declaration order. Clients can thus address
+ * e.g. the CB process value of reactor i without browsing.
+ */
+UA_NodeId opc_ua_fleet_node_id(UA_UInt16 ns, UA_UInt32 index, FleetObject object, UA_UInt32 child) {
+    const UA_UInt32 slot = index * FLEET_OBJECT_COUNT + (UA_UInt32)object;
+    return UA_NODEID_NUMERIC(ns, 1 + slot * FLEET_NODE_STRIDE + child);
+}
+
+/**
+ * @brief Reactor index and object of a bulk-created object, the inverse of opc_ua_fleet_node_id().
+ *
+ * Fails for NodeIds of children and of anything else.
+ */
+UA_StatusCode opc_ua_fleet_node_index(UA_UInt16 ns, const UA_NodeId* id, UA_UInt32* index,
+    FleetObject* object) {
+    if (id->namespaceIndex != ns || id->identifierType != UA_NODEIDTYPE_NUMERIC ||
+        id->identifier.numeric == 0 || (id->identifier.numeric - 1) % FLEET_NODE_STRIDE != 0)
+        return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    const UA_UInt32 slot = (id->identifier.numeric - 1) / FLEET_NODE_STRIDE;
+    *index = slot / FLEET_OBJECT_COUNT;
+    *object = (FleetObject)(slot % FLEET_OBJECT_COUNT);
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Child variable of a bulk-created object */
+typedef struct {
+    const char* browseName;     /* browse name of the child in the ObjectType */
+    BindingKind kind;
+    void* field;                /* bound field, FleetSlot for sensors */
+    UA_Byte accessLevel;
+    UA_Double min;              /* engineering range of writes */
+    UA_Double max;
+    UA_Byte* dirty;             /* model input flags or NULL */
+    UA_Byte dirtyMask;          /* FLEET_DIRTY_* bits a write sets */
+    SensorPublish* push;        /* push mode PROCESS_VALUE: value-backed, binding only as context */
+} FleetChild;
+
+/**
+ * @brief Adds one child variable of a bulk-created object.
+ *
+ * Bound children become DataSource variables with their NodeBinding as
+ * context. A push mode process value becomes a value-backed variable
+ * holding the current snapshot value; its NodeId goes to the sensor's
+ * push state for publish_tick() and its binding, unused by reads, only
+ * identifies the sensor to the historian. Children readable as history
+ * are flagged as historizing.
+ */
+static UA_StatusCode add_fleet_child(UA_Server* server, UA_NodeId objId,
+    UA_NodeId childId, const char* objectName, const FleetChild* c) {
+
+    const UA_DataType* type = (c->kind == BINDING_UINT32 || c->kind == BINDING_VALVE_CURVE ||
+        c->kind == BINDING_SWEEP_POINTS) ? &UA_TYPES[UA_TYPES_UINT32] : &UA_TYPES[UA_TYPES_DOUBLE];
+    if (c->kind == BINDING_UINT64 || c->kind == BINDING_HISTOGRAM)
+        type = &UA_TYPES[UA_TYPES_UINT64];
+
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char*)c->browseName);
+    attr.dataType = type->typeId;
+    attr.accessLevel = c->accessLevel;
+    attr.historizing = (c->accessLevel & UA_ACCESSLEVELMASK_HISTORYREAD) != 0;
+    if (c->kind == BINDING_VALVE_TABLE || c->kind == BINDING_HISTOGRAM)
+        attr.valueRank = UA_VALUERANK_ONE_DIMENSION;
+    UA_UInt32 axes = SWEEP_AXES;
+    if (c->kind == BINDING_SWEEP_BOUNDS || c->kind == BINDING_SWEEP_POINTS) {
+        attr.valueRank = UA_VALUERANK_ONE_DIMENSION;
+        attr.arrayDimensions = &axes;
+        attr.arrayDimensionsSize = 1;
+    }
+    if (c->kind == BINDING_SWEEP_SURFACE)
+        attr.valueRank = UA_VALUERANK_THREE_DIMENSIONS;
+
+    NodeBinding* binding = binding_new(c->kind, c->field);
+    if (!binding) {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    binding_set_name(binding, objectName, c->browseName);
+    binding_set_limits(binding, c->min, c->max);
+    binding->dirty = c->dirty;
+    binding->dirtyMask = c->dirtyMask;
+
+    if (c->push) {
+        const FleetSlot* slot = (const FleetSlot*)c->field;
+        UA_Double v;
+        fleet_read_pv(slot->fleet, (FleetSensor)slot->field, slot->index, &v, NULL);
+        UA_Variant_setScalar(&attr.value, &v, type);
+
+        UA_StatusCode rc = UA_Server_addVariableNode(server, childId, objId,
+            UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+            UA_QUALIFIEDNAME(1, (char*)c->browseName),
+            UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+            attr, binding, NULL);
+        if (rc != UA_STATUSCODE_GOOD)
+            return rc;
+        c->push->valueId = childId;
+        c->push->lastValue = v;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    return UA_Server_addDataSourceVariableNode(server, childId, objId,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(1, (char*)c->browseName),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+        attr, opc_ua_binding_data_source(c->kind), binding, NULL);
+}
+
+/**
+ * @brief Creates an object of typeId with its bound children in one pass.
+ *
+ * The children get the NodeIds following objId. They are added between
+ * UA_Server_addNode_begin() and UA_Server_addNode_finish(), so the
+ * instantiation of the type finds every mandatory child present under
+ * its browse name and leaves it as it is. On failure the partially
+ * built object is removed again.
+ */
+static UA_StatusCode add_fleet_object(UA_Server* server, UA_NodeId objId,
+    UA_NodeId parent, UA_NodeId typeId, const char* name,
+    const FleetChild* children, size_t childCount) {
+
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    oAttr.displayName = UA_LOCALIZEDTEXT("en-US", (char*)name);
+
+    UA_StatusCode rc = UA_Server_addNode_begin(server, UA_NODECLASS_OBJECT, objId,
+        parent,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+        UA_QUALIFIEDNAME(1, (char*)name),
+        typeId, &oAttr, &UA_TYPES[UA_TYPES_OBJECTATTRIBUTES], NULL, NULL);
+    if (rc != UA_STATUSCODE_GOOD) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Failed to add object %s", name);
+        return rc;
+    }
+
+    for (size_t c = 0; c < childCount && rc == UA_STATUSCODE_GOOD; c++) {
+        UA_NodeId childId = objId;
+        childId.identifier.numeric += 1 + (UA_UInt32)c;
+        rc = add_fleet_child(server, objId, childId, name, &children[c]);
+    }
+    if (rc == UA_STATUSCODE_GOOD)
+        rc = UA_Server_addNode_finish(server, objId);
+
+    if (rc != UA_STATUSCODE_GOOD) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Failed to bind children of object %s", name);
+        UA_Server_deleteNode(server, objId, true);
+    }
+    return rc;
+}
+
+/**
+ * @brief Creates all OPC UA objects of one reactor, named as in its plant record.
+ */
+static UA_StatusCode create_fleet_reactor(UA_Server* server, const FleetNodeOptions* opt,
+    UA_UInt16 ns, ReactorFleet* fleet, UA_UInt32 i, const PlantReactor* names) {
+
+    UA_Byte* dirty = &fleet->inputDirty[i];
+    const UA_Byte pvAccess = ACCESS_RO | (opt->historizing ? UA_ACCESSLEVELMASK_HISTORYREAD : 0);
+    UA_NodeId id;
+    UA_StatusCode rc;
+
+    /* The sweep variables follow REACTOR_VOLUME if the reactor has a sweep */
+    Sweep* sweep = (opt->sweeps && i < opt->sweeps->capacity) ? &opt->sweeps->items[i] : NULL;
+    const FleetChild reactor[] = {
+        { "REACTOR_VOLUME", BINDING_DOUBLE, &fleet->volume[i], ACCESS_RW,
+            LIMIT_VOLUME_MIN, LIMIT_VOLUME_MAX, dirty, FLEET_DIRTY_PROCESS, NULL },
+        { "SWEEP_MIN", BINDING_SWEEP_BOUNDS, sweep ? sweep->grid.min : NULL, ACCESS_RW,
+            LIMIT_MANUAL_OUTPUT_MIN, LIMIT_MANUAL_OUTPUT_MAX, NULL, 0, NULL },
+        { "SWEEP_MAX", BINDING_SWEEP_BOUNDS, sweep ? sweep->grid.max : NULL, ACCESS_RW,
+            LIMIT_MANUAL_OUTPUT_MIN, LIMIT_MANUAL_OUTPUT_MAX, NULL, 0, NULL },
+        { "SWEEP_POINTS", BINDING_SWEEP_POINTS, sweep ? sweep->grid.points : NULL, ACCESS_RW,
+            1.0, SWEEP_POINTS_MAX, NULL, 0, NULL },
+        { "SWEEP_CB", BINDING_SWEEP_SURFACE, sweep, ACCESS_RO, -INFINITY, INFINITY, NULL, 0, NULL },
+    };
+    id = opc_ua_fleet_node_id(ns, i, FLEET_OBJECT_REACTOR, 0);
+    rc = add_fleet_object(server, id, opt->reactors, reactorTypeId, names->name, reactor, sweep ? 5 : 1);
+    if (rc) return rc;
+    fleet->reactorObjId[i] = id;
+
+    const FleetChild model[] = {
+        { "SUBSTANCE_ID", BINDING_UINT32, &fleet->substanceId[i], ACCESS_RW, 0.0, UA_UINT32_MAX, dirty, FLEET_DIRTY_KINETICS, NULL },
+        { "K01", BINDING_DOUBLE, &fleet->k01[i], ACCESS_RW, 0.0, LIMIT_K0_MAX, dirty, FLEET_DIRTY_KINETICS, NULL },
+        { "K02", BINDING_DOUBLE, &fleet->k02[i], ACCESS_RW, 0.0, LIMIT_K0_MAX, dirty, FLEET_DIRTY_KINETICS, NULL },
+        { "EA1", BINDING_DOUBLE, &fleet->EA1[i], ACCESS_RW, 0.0, LIMIT_EA_MAX, dirty, FLEET_DIRTY_KINETICS, NULL },
+        { "EA2", BINDING_DOUBLE, &fleet->EA2[i], ACCESS_RW, 0.0, LIMIT_EA_MAX, dirty, FLEET_DIRTY_KINETICS, NULL },
+    };
+    id = opc_ua_fleet_node_id(ns, i, FLEET_OBJECT_MODEL, 0);
+    rc = add_fleet_object(server, id, opt->model, mathModelTypeId, names->model, model, 5);
+    if (rc) return rc;
+    fleet->modelObjId[i] = id;
+
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++) {
+        SensorPublish* pub = &fleet->publish[s][i];
+        pub->mode = opt->publishMode;
+        pub->deadbandType = opt->deadbandType;
+        pub->deadband = opt->deadband;
+
+        const FleetChild sensor[] = {
+            { "PROCESS_VALUE", BINDING_SENSOR, &fleet->sensorSlot[s][i], pvAccess, -INFINITY, INFINITY, NULL, 0,
+                opt->publishMode == SENSOR_PUBLISH_PUSH ? pub : NULL },
+            { "PUBLISH_MODE", BINDING_UINT32, &pub->mode, ACCESS_RO,
+                SENSOR_PUBLISH_POLL, SENSOR_PUBLISH_PUSH, NULL, 0, NULL },
+            { "DEADBAND_TYPE", BINDING_UINT32, &pub->deadbandType, ACCESS_RW,
+                DEADBAND_NONE, DEADBAND_PERCENT, NULL, 0, NULL },
+            { "DEADBAND", BINDING_DOUBLE, &pub->deadband, ACCESS_RW, 0.0, LIMIT_DEADBAND_MAX, NULL, 0, NULL },
+            { "PUBLISHED_COUNT", BINDING_UINT32, &pub->published, ACCESS_RO, 0.0, UA_UINT32_MAX, NULL, 0, NULL },
+            { "SUPPRESSED_COUNT", BINDING_UINT32, &pub->suppressed, ACCESS_RO, 0.0, UA_UINT32_MAX, NULL, 0, NULL },
+        };
+        id = opc_ua_fleet_node_id(ns, i, (FleetObject)(FLEET_OBJECT_SENSOR + s), 0);
+        rc = add_fleet_object(server, id, opt->sensors, sensorTypeId, names->sensor[s], sensor, 6);
+        if (rc) return rc;
+        fleet->sensorObjId[s][i] = id;
+    }
+
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+        const FleetChild valve[] = {
+            { "MANUAL_OUTPUT", BINDING_DOUBLE, &fleet->manualoutput[v][i], ACCESS_RW,
+                LIMIT_MANUAL_OUTPUT_MIN, LIMIT_MANUAL_OUTPUT_MAX, dirty, FLEET_DIRTY_PROCESS, NULL },
+            { "CHARACTERISTIC", BINDING_VALVE_CURVE, &fleet->valveSlot[v][i], ACCESS_RW,
+                0.0, VALVE_CHAR_CUSTOM, dirty, FLEET_DIRTY_PROCESS, NULL },
+            { "CHARACTERISTIC_TABLE", BINDING_VALVE_TABLE, &fleet->valveSlot[v][i], ACCESS_RW,
+                -INFINITY, INFINITY, dirty, FLEET_DIRTY_PROCESS, NULL },
+        };
+        id = opc_ua_fleet_node_id(ns, i, (FleetObject)(FLEET_OBJECT_VALVE + v), 0);
+        rc = add_fleet_object(server, id, opt->valves, valveHandleControlType, names->valve[v], valve, 3);
+        if (rc) return rc;
+        fleet->valveObjId[v][i] = id;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Creates and binds the OPC UA objects of reactors [begin, end).
+ *
+ * Produces the same objects, browse names and bindings as calling the
+ * opc_ua_create_*_instance() helpers for every reactor, without a single
+ * browse path translation. Reactor i is named after plant[i]. NodeIds
+ * follow opc_ua_fleet_node_id() in the FLEET_NAMESPACE_URI namespace.
+ * With opt->sweeps the Reactor objects further get SWEEP_MIN, SWEEP_MAX,
+ * SWEEP_POINTS and SWEEP_CB, bound to the sweep of their reactor.
+ * Stops at the first reactor that fails.
+ */
+UA_StatusCode opc_ua_create_fleet_instances(UA_Server* server, const FleetNodeOptions* opt,
+    ReactorFleet* fleet, const PlantReactor* plant, UA_UInt32 begin, UA_UInt32 end) {
+
+    /* Highest identifier must fit into the numeric NodeId */
+    const UA_UInt32 maxReactors = (UA_UINT32_MAX - 1) / (FLEET_OBJECT_COUNT * FLEET_NODE_STRIDE);
+    if (end > fleet->count || begin > end || end > maxReactors)
+        return UA_STATUSCODE_BADOUTOFRANGE;
+
+    const UA_UInt16 ns = opc_ua_fleet_namespace(server);
+    kineticsMethod.fleet = fleet;
+    kineticsMethod.ns = ns;
+    reactorMethod.fleet = fleet;
+    reactorMethod.ns = ns;
+    reactorMethod.sweeps = opt->sweeps;
+    for (UA_UInt32 i = begin; i < end; i++) {
+        UA_StatusCode rc = create_fleet_reactor(server, opt, ns, fleet, i, &plant[i]);
+        if (rc != UA_STATUSCODE_GOOD) {
+            LOG_MSG(LOG_LEVEL_ERROR, "Creating the nodes of reactor %u failed", i + 1);
+            return rc;
+        }
+    }
+    LOG_MSG(LOG_LEVEL_INFO, "Created the nodes of %u reactors in namespace %u",
+        end - begin, ns);
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Adds the batch SET_KINETICS method to folder, the model folder of the fleet.
+ *
+ * Its inputs are the arrays MATH_MODELS (NodeIds of MathModel objects
+ * created by opc_ua_create_fleet_instances()), SUBSTANCE_ID, K01, EA1,
+ * K02, EA2 and R, element e of each belonging to the same object; its
+ * output RESULTS the status of each element. One call updates any
+ * number of reactors in a single round trip and tick.
+ */
+UA_StatusCode opc_ua_create_kinetics_method(UA_Server* server, UA_NodeId folder) {
+    UA_Argument in[1 + KINETICS_ARG_COUNT];
+    UA_Argument_init(&in[0]);
+    in[0].name = UA_STRING("MATH_MODELS");
+    in[0].dataType = UA_TYPES[UA_TYPES_NODEID].typeId;
+    in[0].valueRank = UA_VALUERANK_ONE_DIMENSION;
+    kinetics_arguments(&in[1], UA_VALUERANK_ONE_DIMENSION);
+
+    UA_Argument out;
+    UA_Argument_init(&out);
+    out.name = UA_STRING("RESULTS");
+    out.dataType = UA_TYPES[UA_TYPES_STATUSCODE].typeId;
+    out.valueRank = UA_VALUERANK_ONE_DIMENSION;
+
+    UA_MethodAttributes mAttr = UA_MethodAttributes_default;
+    mAttr.displayName = UA_LOCALIZEDTEXT("en-US", "SET_KINETICS");
+    mAttr.executable = true;
+    mAttr.userExecutable = true;
+    UA_StatusCode rc = UA_Server_addMethodNode(server,
+        UA_NODEID_STRING(opc_ua_fleet_namespace(server), "SET_KINETICS"), folder,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+        UA_QUALIFIEDNAME(1, "SET_KINETICS"),
+        mAttr, setKineticsBatchMethod, 1 + KINETICS_ARG_COUNT, in, 1, &out, &kineticsMethod, NULL);
+    if (rc != UA_STATUSCODE_GOOD)
+        LOG_MSG(LOG_LEVEL_ERROR, "Failed to add method SET_KINETICS");
+    return rc;
+}
+
+/**
+ * @brief Lets ESTIMATE_KINETICS fit to history, evaluated on engine.
+ *
+ * engine may be NULL to evaluate on the calling thread. With async the
+ * method is answered by the worker of async_method.c (which must run),
+ * otherwise on the server thread. Call after addMathModelType().
+ */
+UA_StatusCode opc_ua_enable_estimation(UA_Server* server, Historian* history, ModelEngine* engine,
+    UA_Boolean async) {
+    kineticsMethod.history = history;
+    kineticsMethod.engine = engine;
+    return async ? async_method_set(server, estimateMethodId) : UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Lets SWEEP and OPTIMIZE evaluate on engine (NULL = the calling thread).
+ *
+ * With async the methods are answered by the worker of async_method.c
+ * (which must run), otherwise on the server thread. Call after
+ * addReactorType().
+ */
+UA_StatusCode opc_ua_enable_reactor_methods(UA_Server* server, ModelEngine* engine,
+    UA_Boolean async) {
+    reactorMethod.engine = engine;
+    if (!async)
+        return UA_STATUSCODE_GOOD;
+    const UA_StatusCode rc = async_method_set(server, sweepMethodId);
+    return rc != UA_STATUSCODE_GOOD ? rc : async_method_set(server, optimizeMethodId);
+}
+
+/**
+ * @brief Creates the "Simulation" object exposing the simulation clock.
+ *
+ * Adds a BaseObjectType object under Objects with TIME_SCALE (writable,
+ * simulated seconds per wall second, 0 = as fast as possible),
+ * ELAPSED (simulated seconds since start), TICKS_PER_SECOND and SPEED
+ * (achieved ticks and simulated seconds per wall second), all bound to
+ * the fields of the clock.
+ */
+UA_StatusCode opc_ua_create_simulation_object(UA_Server* server, SimClock* clock) {
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    oAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Simulation");
+
+    UA_NodeId objId;
+    UA_StatusCode rc = UA_Server_addObjectNode(server, UA_NODEID_NULL,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+        UA_QUALIFIEDNAME(1, "Simulation"),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+        oAttr, NULL, &objId);
+    if (rc != UA_STATUSCODE_GOOD) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Failed to add object Simulation");
+        return rc;
+    }
+
+    const FleetChild children[] = {
+        { "TIME_SCALE", BINDING_DOUBLE, &clock->timeScale, ACCESS_RW, 0.0, SIM_CLOCK_SCALE_MAX, NULL, 0, NULL },
+        { "ELAPSED", BINDING_DOUBLE, &clock->elapsed, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+        { "TICKS_PER_SECOND", BINDING_DOUBLE, &clock->tickRate, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+        { "SPEED", BINDING_DOUBLE, &clock->speed, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+    };
+    for (size_t c = 0; c < sizeof(children) / sizeof(children[0]); c++) {
+        rc = add_fleet_child(server, objId, UA_NODEID_NULL, "Simulation", &children[c]);
+        if (rc != UA_STATUSCODE_GOOD)
+            return rc;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Adds the summary and raw buckets of one diagnostics histogram, "<prefix>_..." */
+static UA_StatusCode add_diag_histogram(UA_Server* server, UA_NodeId objId, const char* objectName,
+    const char* prefix, DiagHistogram* h, DiagSummary* s) {
+
+    struct { const char* suffix; BindingKind kind; void* field; } items[] = {
+        { "MEAN_US", BINDING_DOUBLE, &s->mean },
+        { "P50_US", BINDING_DOUBLE, &s->p50 },
+        { "P90_US", BINDING_DOUBLE, &s->p90 },
+        { "P99_US", BINDING_DOUBLE, &s->p99 },
+        { "MAX_US", BINDING_DOUBLE, &s->max },
+        { "HISTOGRAM", BINDING_HISTOGRAM, h },
+    };
+    for (size_t k = 0; k < sizeof(items) / sizeof(items[0]); k++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s_%s", prefix, items[k].suffix);
+        const FleetChild c = { name, items[k].kind, items[k].field, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL };
+        UA_StatusCode rc = add_fleet_child(server, objId, UA_NODEID_NULL, objectName, &c);
+        if (rc != UA_STATUSCODE_GOOD)
+            return rc;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode add_diag_object(UA_Server* server, UA_NodeId folder, const char* name,
+    UA_NodeId* objId) {
+
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    oAttr.displayName = UA_LOCALIZEDTEXT("en-US", (char*)name);
+    UA_StatusCode rc = UA_Server_addObjectNode(server, UA_NODEID_NULL, folder,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+        UA_QUALIFIEDNAME(1, (char*)name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+        oAttr, NULL, objId);
+    if (rc != UA_STATUSCODE_GOOD)
+        LOG_MSG(LOG_LEVEL_ERROR, "Failed to add object %s", name);
+    return rc;
+}
+
+/**
+ * @brief Creates the objects of the runtime diagnostics (diag.c) in folder.
+ *
+ * "ModelCallback" has CALLS, LATE_CALLS, OVERRUNS, SKIPPED_TICKS and the
+ * DURATION_*, JITTER_* and PERIOD_* figures of model_cb() or the model
+ * thread; "DataSource<Kind>" per binding kind READS,
+ * WRITES, REJECTED and the READ_* and WRITE_* latencies. Every histogram
+ * is published as MEAN_US, P50_US, P90_US, P99_US and MAX_US, refreshed
+ * by diag_cb(), and as HISTOGRAM, its DIAG_BUCKETS raw log2 buckets.
+ * All variables are read-only.
+ */
+UA_StatusCode opc_ua_create_diagnostics(UA_Server* server, UA_NodeId folder) {
+    UA_NodeId objId;
+    UA_StatusCode rc = add_diag_object(server, folder, "ModelCallback", &objId);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+
+    const FleetChild counters[] = {
+        { "CALLS", BINDING_UINT64, (void*)&diag.calls, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+        { "LATE_CALLS", BINDING_UINT64, (void*)&diag.lateCalls, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+        { "OVERRUNS", BINDING_UINT64, (void*)&diag.overruns, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+        { "SKIPPED_TICKS", BINDING_UINT64, (void*)&diag.skippedTicks, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+    };
+    for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); c++) {
+        rc = add_fleet_child(server, objId, UA_NODEID_NULL, "ModelCallback", &counters[c]);
+        if (rc != UA_STATUSCODE_GOOD)
+            return rc;
+    }
+    rc = add_diag_histogram(server, objId, "ModelCallback", "DURATION", &diag.tickNs, &diag.tick);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+    rc = add_diag_histogram(server, objId, "ModelCallback", "JITTER", &diag.jitterNs, &diag.jitter);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+    rc = add_diag_histogram(server, objId, "ModelCallback", "PERIOD", &diag.periodNs, &diag.period);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+
+    for (int k = 0; k < BINDING_KIND_COUNT; k++) {
+        DiagDataSource* d = &diag.dataSource[k];
+        char name[64];
+        snprintf(name, sizeof(name), "DataSource%s", diag_kind_name((BindingKind)k));
+        rc = add_diag_object(server, folder, name, &objId);
+        if (rc != UA_STATUSCODE_GOOD)
+            return rc;
+
+        const FleetChild calls[] = {
+            { "READS", BINDING_UINT64, &d->reads, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+            { "WRITES", BINDING_UINT64, &d->writes, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+            { "REJECTED", BINDING_UINT64, &d->rejected, ACCESS_RO, 0.0, INFINITY, NULL, 0, NULL },
+        };
+        for (size_t c = 0; c < sizeof(calls) / sizeof(calls[0]); c++) {
+            rc = add_fleet_child(server, objId, UA_NODEID_NULL, name, &calls[c]);
+            if (rc != UA_STATUSCODE_GOOD)
+                return rc;
+        }
+        rc = add_diag_histogram(server, objId, name, "READ", &d->readNs, &d->read);
+        if (rc != UA_STATUSCODE_GOOD)
+            return rc;
+        rc = add_diag_histogram(server, objId, name, "WRITE", &d->writeNs, &d->write);
+        if (rc != UA_STATUSCODE_GOOD)
+            return rc;
+    }
+    return UA_STATUSCODE_GOOD;
+}
@@ -1,22 +1,67 @@
 ﻿#pragma once
 #include <open62541/server.h>
 #include "types.h"
+#include "plant.h"
+#include "sim_clock.h"
+#include "binding.h"
+#include "engine.h"
+#include "historian.h"
+#include "sweep.h"
 
 UA_NodeId addSensorType(UA_Server* server);
 UA_NodeId addReactorType(UA_Server* server);
 UA_NodeId addMathModelType(UA_Server* server);
 UA_NodeId addValveHandleControlType(UA_Server* server);
 
+UA_DataSource opc_ua_binding_data_source(BindingKind kind);
+
 UA_StatusCode opc_ua_create_cell_folder(UA_Server* server, const char* cellName, UA_NodeId* outFolderId);
 
 UA_StatusCode opc_ua_create_math_model_instance(UA_Server* server, UA_NodeId parentFolder,
-    const char* name, ModelCtx* m);
+    const char* name, ReactorFleet* fleet, UA_UInt32 index);
 
 UA_StatusCode opc_ua_create_reactor_instance(UA_Server* server, UA_NodeId parentFolder,
-    const char* reactorName, Reactor* reactor);
+    const char* reactorName, ReactorFleet* fleet, UA_UInt32 index);
 
 UA_StatusCode opc_ua_create_sensor_instance(UA_Server* server, UA_NodeId parentFolder,
-    const char* sensorName, UA_Boolean enableAlarms, Sensor* sensor);
+    const char* sensorName, UA_Boolean enableAlarms, ReactorFleet* fleet, UA_UInt32 index,
+    FleetSensor sensor, SensorPublishMode mode, DeadbandType deadbandType, UA_Double deadband);
 
 UA_StatusCode opc_ua_create_valve_handle_control(UA_Server* server, UA_NodeId parentFolder,
-    const char* valveHandleControlName, ValveHandleControl* valveHandleControl);
\ No newline at end of file
+    const char* valveHandleControlName, ReactorFleet* fleet, UA_UInt32 index,
+    FleetValve valve);
+
+/* Namespace of the NodeIds assigned by opc_ua_create_fleet_instances() */
+#define FLEET_NAMESPACE_URI "urn:opc_demo:fleet"
+
+/* NodeIds reserved per object: the object itself and up to 15 children */
+#define FLEET_NODE_STRIDE 16
+
+/* Parent folders and sensor publish settings of bulk-created reactors */
+typedef struct {
+    UA_NodeId model;
+    UA_NodeId valves;
+    UA_NodeId sensors;
+    UA_NodeId reactors;
+    SensorPublishMode publishMode;
+    DeadbandType deadbandType;
+    UA_Double deadband;
+    UA_Boolean historizing;     /* PROCESS_VALUE history served by the historian */
+    SweepSet* sweeps;           /* sweeps bound to the Reactor objects, or NULL for none */
+} FleetNodeOptions;
+
+UA_UInt16 opc_ua_fleet_namespace(UA_Server* server);
+UA_NodeId opc_ua_fleet_node_id(UA_UInt16 ns, UA_UInt32 index, FleetObject object, UA_UInt32 child);
+UA_StatusCode opc_ua_fleet_node_index(UA_UInt16 ns, const UA_NodeId* id, UA_UInt32* index,
+    FleetObject* object);
+
+UA_StatusCode opc_ua_create_fleet_instances(UA_Server* server, const FleetNodeOptions* opt,
+    ReactorFleet* fleet, const PlantReactor* plant, UA_UInt32 begin, UA_UInt32 end);
+
+UA_StatusCode opc_ua_create_kinetics_method(UA_Server* server, UA_NodeId folder);
+UA_StatusCode opc_ua_enable_estimation(UA_Server* server, Historian* history, ModelEngine* engine,
+    UA_Boolean async);
+UA_StatusCode opc_ua_enable_reactor_methods(UA_Server* server, ModelEngine* engine,
+    UA_Boolean async);
+UA_StatusCode opc_ua_create_simulation_object(UA_Server* server, SimClock* clock);
+UA_StatusCode opc_ua_create_diagnostics(UA_Server* server, UA_NodeId folder);
\ No newline at end of file
@@ -0,0 +1,374 @@
+/**
+ * @file optimize.c
+ * @brief Steady-state optimization of the valve openings of one reactor.
+ *
+ * optimize_run() looks for the HC-1, HC-2 and HC-3 openings, within the
+ * bounds of an OptimizeProblem, that give the highest steady-state CB
+ * (OPTIMIZE_MAX_CB) or CB equal to a target at the lowest flow F
+ * (OPTIMIZE_TARGET_CB). The objective is the model itself: the valve
+ * characteristics of the reactor followed by compute_CB_rates() at the
+ * Arrhenius rates of its temperature, the same as a model tick in
+ * steady state.
+ *
+ * optimize_plan() captures the kinetics, the volume and a copy of the
+ * three valve characteristics while the caller holds the model lock,
+ * the lock the model tick, the bound writes and SET_KINETICS take too;
+ * from then on the search reads no live state.
+ *
+ * The flow enters CB in closed form, so HC-2 is not searched but solved
+ * for each HC-1/HC-3 pair (optimize_profile()): CB is scanned over the
+ * HC-2 bounds, and the best scan point refined by golden-section search,
+ * or every crossing of the target by bisection, keeping the one at the
+ * lowest flow. A pair that reaches no crossing scores how far it misses
+ * the target, so the search is drawn towards pairs that do.
+ *
+ * HC-1 and HC-3 are searched by compass search: poll both directions of
+ * both axes, move to the best improvement or halve the step, until the
+ * step is below OptimizeOptions::step. The model has several local optima
+ * once custom characteristics bend the axes, so the search is run from
+ * OptimizeOptions::starts points spread over the bounds by a Halton
+ * sequence and the best result wins. The starts are independent and are
+ * split over a ModelEngine (engine.c), a few per chunk, each writing only
+ * its own slot; the result does not depend on the number of threads.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "optimize.h"
+#include "fleet.h"
+#include "math_model.h"
+
+#define OPTIMIZE_T_OFFSET 273.15
+#define OPTIMIZE_CHUNK 8                /* starts claimed per pop */
+#define OPTIMIZE_PROFILE_STEPS 200      /* intervals of the HC-2 scan */
+#define OPTIMIZE_REFINE_ITERATIONS 48   /* bisection and golden-section steps */
+#define OPTIMIZE_FIRST_STEP 0.25        /* first compass step, share of the bounds */
+
+/* Axes the compass search moves; HC-2 is solved for */
+static const int optimizeAxes[2] = { 0, 2 };
+
+/* HC-1/HC-3 pair with the HC-2 opening solved for it */
+typedef struct {
+    UA_Double opening[OPTIMIZE_AXES];
+    UA_Double violation;        /* how far CB misses the target; INFINITY without a CB */
+    UA_Double cost;             /* -CB, or F for a target */
+    UA_Double CB;
+    UA_Double F;
+} OptimizePoint;
+
+typedef struct {
+    const OptimizePlan* plan;
+    const OptimizeOptions* opt;
+    OptimizePoint* best;        /* per start */
+    UA_UInt32* evaluations;     /* per start */
+} OptimizePass;
+
+void optimize_default_options(OptimizeOptions* opt) {
+    opt->starts = 256;
+    opt->maxIterations = 200;
+    opt->step = 1e-3;
+}
+
+/**
+ * @brief BadOutOfRange unless the goal is known, every axis runs 0 <= min <= max <= 100
+ * and a target CB is positive.
+ */
+UA_StatusCode optimize_check(const OptimizeProblem* p) {
+    if ((UA_UInt32)p->goal >= OPTIMIZE_GOAL_COUNT)
+        return UA_STATUSCODE_BADOUTOFRANGE;
+    if (p->goal == OPTIMIZE_TARGET_CB && !(isfinite(p->target) && p->target > 0.0))
+        return UA_STATUSCODE_BADOUTOFRANGE;
+    for (int a = 0; a < OPTIMIZE_AXES; a++) {
+        if (!(p->min[a] >= 0.0 && p->min[a] <= p->max[a] && p->max[a] <= 100.0))
+            return UA_STATUSCODE_BADOUTOFRANGE;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Captures reactor i of f for optimizing p, which must pass optimize_check().
+ *
+ * Reads the kinetics, volume and valve characteristics of the reactor:
+ * callers on another thread than the model's and the server's hold the
+ * model lock, which the model and the server-side writers take as well.
+ */
+void optimize_plan(const ReactorFleet* f, UA_UInt32 i, const OptimizeProblem* p,
+    OptimizePlan* plan) {
+    plan->problem = *p;
+    plan->kinetics.k01 = f->k01[i];
+    plan->kinetics.EA1 = f->EA1[i];
+    plan->kinetics.k02 = f->k02[i];
+    plan->kinetics.EA2 = f->EA2[i];
+    plan->kinetics.R = f->R[i];
+    plan->volume = f->volume[i];
+    valve_curve_copy(f->valveCurve[FLEET_VALVE_CA][i], &plan->curve[0]);
+    valve_curve_copy(f->valveCurve[FLEET_VALVE_Q][i], &plan->curve[1]);
+    valve_curve_copy(f->valveCurve[FLEET_VALVE_T][i], &plan->curve[2]);
+}
+
+/* True if a is better than b: misses the target by less, or by as much at a lower cost */
+static UA_Boolean optimize_better(const OptimizePoint* a, const OptimizePoint* b) {
+    return a->violation < b->violation || (a->violation == b->violation && a->cost < b->cost);
+}
+
+/* Replaces pt's HC-2 solution by opening u if that is better */
+static void optimize_offer(OptimizePoint* pt, double u, double CB, double F, double violation,
+    double cost) {
+    OptimizePoint c = *pt;
+    c.opening[1] = u;
+    c.violation = violation;
+    c.cost = cost;
+    c.CB = CB;
+    c.F = F;
+    if (optimize_better(&c, pt))
+        *pt = c;
+}
+
+/* Pair of one HC-1/HC-3 point: inlet concentration and rates (1/s) */
+typedef struct {
+    double CA;
+    double k1;
+    double k2;
+} OptimizePair;
+
+/* CB at HC-2 opening u; *F receives the flow */
+static double optimize_cb(const OptimizePlan* p, const OptimizePair* q, double u, double* F,
+    UA_UInt32* evaluations) {
+    (*evaluations)++;
+    *F = valve_curve_table_value(&p->curve[1], u);
+    return compute_CB_rates(*F, q->CA, p->volume, q->k1, q->k2);
+}
+
+/* What the scan of HC-2 minimizes: -CB, or the distance to the target */
+static double optimize_miss(const OptimizeProblem* prob, double CB) {
+    if (!isfinite(CB))
+        return INFINITY;
+    return prob->goal == OPTIMIZE_MAX_CB ? -CB : fabs(CB - prob->target);
+}
+
+/* Offers HC-2 opening u with its CB and flow F, scored for the goal */
+static void optimize_offer_cb(const OptimizeProblem* prob, OptimizePoint* pt, double u, double CB,
+    double F) {
+    if (!isfinite(CB))
+        return;
+    if (prob->goal == OPTIMIZE_MAX_CB)
+        optimize_offer(pt, u, CB, F, 0.0, -CB);
+    else
+        optimize_offer(pt, u, CB, F, fabs(CB - prob->target), F);
+}
+
+/*
+ * Lowest optimize_miss() on [a, b] around the best scan point, by
+ * golden-section search: the highest CB, or the closest to a target
+ * the scan found no crossing of.
+ */
+static void optimize_refine_best(const OptimizePlan* p, const OptimizePair* q, double a,
+    double b, OptimizePoint* pt, UA_UInt32* evaluations) {
+    const OptimizeProblem* prob = &p->problem;
+    const double g = 0.5 * (sqrt(5.0) - 1.0);
+    double F;
+    double x1 = b - g * (b - a);
+    double x2 = a + g * (b - a);
+    double f1 = optimize_miss(prob, optimize_cb(p, q, x1, &F, evaluations));
+    double f2 = optimize_miss(prob, optimize_cb(p, q, x2, &F, evaluations));
+    for (int k = 0; k < OPTIMIZE_REFINE_ITERATIONS; k++) {
+        if (f1 <= f2) {
+            b = x2;
+            x2 = x1;
+            f2 = f1;
+            x1 = b - g * (b - a);
+            f1 = optimize_miss(prob, optimize_cb(p, q, x1, &F, evaluations));
+        }
+        else {
+            a = x1;
+            x1 = x2;
+            f1 = f2;
+            x2 = a + g * (b - a);
+            f2 = optimize_miss(prob, optimize_cb(p, q, x2, &F, evaluations));
+        }
+    }
+    const double u = 0.5 * (a + b);
+    const double CB = optimize_cb(p, q, u, &F, evaluations);
+    optimize_offer_cb(prob, pt, u, CB, F);
+}
+
+/* Crossing of the target on [a, b], where CB - target changes sign, by bisection */
+static void optimize_refine_target(const OptimizePlan* p, const OptimizePair* q, double a,
+    double b, double devA, OptimizePoint* pt, UA_UInt32* evaluations) {
+    const double target = p->problem.target;
+    double F;
+    for (int k = 0; k < OPTIMIZE_REFINE_ITERATIONS; k++) {
+        const double m = 0.5 * (a + b);
+        const double dev = optimize_cb(p, q, m, &F, evaluations) - target;
+        if ((dev < 0.0) == (devA < 0.0)) {
+            a = m;
+            devA = dev;
+        }
+        else {
+            b = m;
+        }
+    }
+    const double CBa = optimize_cb(p, q, a, &F, evaluations);
+    const double Fa = F;
+    const double CBb = optimize_cb(p, q, b, &F, evaluations);
+    if (fabs(CBa - target) <= fabs(CBb - target))
+        optimize_offer(pt, a, CBa, Fa, 0.0, Fa);
+    else
+        optimize_offer(pt, b, CBb, F, 0.0, F);
+}
+
+/**
+ * @brief Solves HC-2 for the HC-1/HC-3 pair of pt and scores it.
+ *
+ * Scans CB over the HC-2 bounds, then refines the best scan point for the
+ * highest CB, or every crossing of the target for the lowest flow; if
+ * there is none, the point closest to the target.
+ */
+static void optimize_profile(const OptimizePlan* p, OptimizePoint* pt, UA_UInt32* evaluations) {
+    const OptimizeProblem* prob = &p->problem;
+    const ConfigMathModel* k = &p->kinetics;
+
+    OptimizePair q;
+    q.CA = valve_curve_table_value(&p->curve[0], pt->opening[0]);
+    const double T_K = valve_curve_table_value(&p->curve[2], pt->opening[2]) + OPTIMIZE_T_OFFSET;
+    if (isfinite(T_K) && T_K > 0.0) {
+        q.k1 = arrhenius_rate(k->k01, k->EA1, k->R, T_K);
+        q.k2 = arrhenius_rate(k->k02, k->EA2, k->R, T_K);
+    }
+    else {
+        q.k1 = NAN;
+        q.k2 = NAN;
+    }
+
+    pt->opening[1] = prob->min[1];
+    pt->violation = INFINITY;
+    pt->cost = INFINITY;
+    pt->CB = NAN;
+    pt->F = NAN;
+
+    const double lo = prob->min[1];
+    const double hi = prob->max[1];
+    const UA_UInt32 steps = hi > lo ? OPTIMIZE_PROFILE_STEPS : 0;
+    const double h = steps ? (hi - lo) / steps : 0.0;
+    double prevU = lo;
+    double prevDev = NAN;
+    for (UA_UInt32 s = 0; s <= steps; s++) {
+        const double u = (s == steps) ? hi : lo + h * s;
+        double F;
+        const double CB = optimize_cb(p, &q, u, &F, evaluations);
+        if (!isfinite(CB)) {
+            prevDev = NAN;
+            continue;
+        }
+        optimize_offer_cb(prob, pt, u, CB, F);
+        if (prob->goal == OPTIMIZE_MAX_CB)
+            continue;
+        const double dev = CB - prob->target;
+        if (s > 0 && ((dev < 0.0 && prevDev > 0.0) || (dev > 0.0 && prevDev < 0.0)))
+            optimize_refine_target(p, &q, prevU, u, prevDev, pt, evaluations);
+        prevU = u;
+        prevDev = dev;
+    }
+
+    /* A reached target is refined by the bisection already */
+    if (steps && isfinite(pt->cost) && (prob->goal == OPTIMIZE_MAX_CB || pt->violation > 0.0)) {
+        const double u = pt->opening[1];
+        optimize_refine_best(p, &q, u - h > lo ? u - h : lo, u + h < hi ? u + h : hi, pt, evaluations);
+    }
+}
+
+/* Element index of the Halton sequence of base, in [0, 1) */
+static double optimize_halton(UA_UInt32 index, UA_UInt32 base) {
+    double r = 0.0;
+    double f = 1.0 / base;
+    for (; index; index /= base, f /= base)
+        r += f * (index % base);
+    return r;
+}
+
+/* Compass search over HC-1 and HC-3 from start number `start` */
+static void optimize_search(const OptimizePlan* p, const OptimizeOptions* opt, UA_UInt32 start,
+    OptimizePoint* best, UA_UInt32* evaluations) {
+    const OptimizeProblem* prob = &p->problem;
+    OptimizePoint cur;
+    memset(&cur, 0, sizeof(cur));
+    cur.opening[0] = prob->min[0] + (prob->max[0] - prob->min[0]) * optimize_halton(start + 1, 2);
+    cur.opening[2] = prob->min[2] + (prob->max[2] - prob->min[2]) * optimize_halton(start + 1, 3);
+    optimize_profile(p, &cur, evaluations);
+
+    const double range = fmax(prob->max[0] - prob->min[0], prob->max[2] - prob->min[2]);
+    double scale = OPTIMIZE_FIRST_STEP;
+    for (UA_UInt32 it = 0; it < opt->maxIterations && scale * range >= opt->step; it++) {
+        OptimizePoint next = cur;
+        for (int k = 0; k < 2; k++) {
+            const int a = optimizeAxes[k];
+            const double step = scale * (prob->max[a] - prob->min[a]);
+            for (int dir = -1; dir <= 1; dir += 2) {
+                OptimizePoint trial = cur;
+                trial.opening[a] = fmin(fmax(cur.opening[a] + dir * step, prob->min[a]), prob->max[a]);
+                if (trial.opening[a] == cur.opening[a])
+                    continue;
+                optimize_profile(p, &trial, evaluations);
+                if (optimize_better(&trial, &next))
+                    next = trial;
+            }
+        }
+        if (optimize_better(&next, &cur))
+            cur = next;
+        else
+            scale *= 0.5;
+    }
+    *best = cur;
+}
+
+/* Starts [begin, end) */
+static void optimize_range(void* ctx, UA_UInt32 worker, UA_UInt32 begin, UA_UInt32 end) {
+    (void)worker;
+    const OptimizePass* pass = (const OptimizePass*)ctx;
+    for (UA_UInt32 s = begin; s < end; s++) {
+        pass->evaluations[s] = 0;
+        optimize_search(pass->plan, pass->opt, s, &pass->best[s], &pass->evaluations[s]);
+    }
+}
+
+/**
+ * @brief Searches the openings of plan from opt->starts points and keeps the best.
+ *
+ * engine may be NULL to search on the calling thread. *out is filled
+ * even if no opening reaches the goal, with feasible false and, for a
+ * target, the opening whose CB comes closest.
+ */
+UA_StatusCode optimize_run(ModelEngine* engine, const OptimizePlan* plan,
+    const OptimizeOptions* opt, OptimizeResult* out) {
+    const UA_UInt32 starts = opt->starts ? opt->starts : 1;
+    OptimizePoint* best = (OptimizePoint*)UA_malloc(starts * sizeof(OptimizePoint));
+    UA_UInt32* evaluations = (UA_UInt32*)UA_malloc(starts * sizeof(UA_UInt32));
+    if (!best || !evaluations) {
+        UA_free(best);
+        UA_free(evaluations);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    OptimizePass pass = { plan, opt, best, evaluations };
+    if (engine)
+        engine_run_chunked(engine, starts, OPTIMIZE_CHUNK, optimize_range, &pass);
+    else
+        optimize_range(&pass, 0, 0, starts);
+
+    /* Ties go to the lower start, so the result is that of a serial run */
+    UA_UInt32 k = 0;
+    out->evaluations = 0;
+    for (UA_UInt32 s = 0; s < starts; s++) {
+        if (optimize_better(&best[s], &best[k]))
+            k = s;
+        out->evaluations += evaluations[s];
+    }
+    memcpy(out->opening, best[k].opening, sizeof(out->opening));
+    out->CB = best[k].CB;
+    out->F = best[k].F;
+    out->feasible = best[k].violation == 0.0 && isfinite(best[k].cost);
+
+    UA_free(best);
+    UA_free(evaluations);
+    return UA_STATUSCODE_GOOD;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <open62541/types.h>
+#include "types.h"
+#include "engine.h"
+#include "valve_curve.h"
+
+struct ReactorFleet;
+
+/* Valves the optimizer sets, in this order: HC-1 (CA), HC-2 (F), HC-3 (T) */
+#define OPTIMIZE_AXES 3
+
+/* What OPTIMIZE looks for, as passed in its GOAL argument */
+typedef enum {
+    OPTIMIZE_MAX_CB,            /* the highest CB within the bounds */
+    OPTIMIZE_TARGET_CB,         /* CB equal to the target at the lowest flow */
+    OPTIMIZE_GOAL_COUNT
+} OptimizeGoal;
+
+/* Goal and valve bounds (%) of one optimization */
+typedef struct {
+    OptimizeGoal goal;
+    UA_Double target;           /* CB sought by OPTIMIZE_TARGET_CB */
+    UA_Double min[OPTIMIZE_AXES];
+    UA_Double max[OPTIMIZE_AXES];
+} OptimizeProblem;
+
+/*
+ * Everything one optimization evaluates, captured from the fleet: the
+ * kinetics, the volume and a copy of the valve characteristic of each
+ * axis, so the search reads nothing of the live model.
+ */
+typedef struct {
+    OptimizeProblem problem;
+    ConfigMathModel kinetics;
+    UA_Double volume;
+    ValveCurveTable curve[OPTIMIZE_AXES];
+} OptimizePlan;
+
+typedef struct {
+    UA_UInt32 starts;           /* searches from spread out starting points */
+    UA_UInt32 maxIterations;    /* polls of each search at most */
+    UA_Double step;             /* valve step (%) at which a search has converged */
+} OptimizeOptions;
+
+typedef struct {
+    UA_Double opening[OPTIMIZE_AXES];   /* valve positions found, % */
+    UA_Double CB;               /* steady-state CB at opening */
+    UA_Double F;                /* flow at opening, l/min */
+    UA_Boolean feasible;        /* CB is finite and, for a target, equal to it */
+    UA_UInt32 evaluations;      /* steady-state CB computed over all starts */
+} OptimizeResult;
+
+void optimize_default_options(OptimizeOptions* opt);
+UA_StatusCode optimize_check(const OptimizeProblem* p);
+void optimize_plan(const struct ReactorFleet* f, UA_UInt32 i, const OptimizeProblem* p,
+    OptimizePlan* plan);
+UA_StatusCode optimize_run(ModelEngine* engine, const OptimizePlan* plan,
+    const OptimizeOptions* opt, OptimizeResult* out);
@@ -0,0 +1,531 @@
+/**
+ * @file plant.c
+ * @brief Plant description file and its memory-mapped binary cache.
+ *
+ * The plant description lists the folders of the address space and every
+ * reactor with the tag names of its objects, kinetic configuration,
+ * initial valve positions and the valve wired to each model input:
+ *
+ *     [folders]
+ *     model = Model
+ *     valves = Valves
+ *     sensors = Sensors
+ *     reactors = Reactors
+ *
+ *     [reactor 1-F]
+ *     model = Config
+ *     volume = 100
+ *     substance = 0
+ *     k01 = 0
+ *     ea1 = 0
+ *     k02 = 0
+ *     ea2 = 0
+ *     sensor.f = FRA-1
+ *     sensor.t = TRA-1
+ *     sensor.ca = CRA-1
+ *     sensor.cb = CRA-2
+ *     valve.ca = HC-1
+ *     valve.q = HC-2
+ *     valve.t = HC-3
+ *     output.q = 50
+ *     repeat = 1
+ *
+ * Lines starting with '#' or ';' are comments. A reactor section with
+ * `repeat = N` stands for N reactors; copy k > 0 appends "_<k+1>" to each
+ * of its tag names. Tag names left out get the built-in tag of their slot
+ * (see plant_default()), suffixed by the position of the reactor in the
+ * plant; folders left out keep their built-in names.
+ *
+ * plant_load() keeps a binary copy of the parsed description next to the
+ * source ("<path>.cache"): a header with the source size and modification
+ * time followed by the PlantReactor records exactly as they are in
+ * memory. As long as the source is unchanged, the cache is mapped and the
+ * records are used in place, so restarting a large plant neither reads
+ * nor parses the text. The cache is specific to the build that wrote it
+ * (record layout and byte order) and is rebuilt when they differ.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "plant.h"
+#include "log.h"
+
+#define PLANT_CACHE_MAGIC "PLANTBC1"
+#define PLANT_CACHE_VERSION 1
+
+/* Longest cache file name, including the terminating zero */
+#define PLANT_PATH_SIZE 1024
+
+/* Records start at this offset, which keeps their doubles aligned */
+#define PLANT_CACHE_HEADER_SIZE 256
+
+typedef struct {
+    char magic[8];
+    UA_UInt32 version;
+    UA_UInt32 recordSize;       /* sizeof(PlantReactor) of the writer */
+    UA_UInt64 sourceSize;
+    UA_Int64 sourceMtime;
+    UA_UInt32 reactorCount;
+    UA_UInt32 reserved;
+    char folder[PLANT_FOLDER_COUNT][PLANT_NAME_SIZE];
+} PlantCacheHeader;
+
+static const char* const plant_folder_keys[PLANT_FOLDER_COUNT] = { "model", "valves", "sensors", "reactors" };
+static const char* const plant_folder_tags[PLANT_FOLDER_COUNT] = { "Model", "Valves", "Sensors", "Reactors" };
+static const char* const plant_sensor_keys[FLEET_SENSOR_COUNT] = { "sensor.f", "sensor.t", "sensor.ca", "sensor.cb" };
+static const char* const plant_sensor_tags[FLEET_SENSOR_COUNT] = { "FRA-1", "TRA-1", "CRA-1", "CRA-2" };
+static const char* const plant_valve_keys[FLEET_VALVE_COUNT] = { "valve.ca", "valve.q", "valve.t" };
+static const char* const plant_output_keys[FLEET_VALVE_COUNT] = { "output.ca", "output.q", "output.t" };
+static const char* const plant_valve_tags[FLEET_VALVE_COUNT] = { "HC-1", "HC-2", "HC-3" };
+
+/**
+ * @brief Writes `tag` with the "_<n+1>" suffix of copy n (none for n = 0).
+ *
+ * @return false if the result does not fit into PLANT_NAME_SIZE.
+ */
+static UA_Boolean plant_tag(char* out, const char* tag, UA_UInt32 n) {
+    const int len = (n == 0) ?
+        snprintf(out, PLANT_NAME_SIZE, "%s", tag) :
+        snprintf(out, PLANT_NAME_SIZE, "%s_%u", tag, n + 1);
+    return len >= 0 && len < PLANT_NAME_SIZE;
+}
+
+static void plant_reactor_unset(PlantReactor* r) {
+    memset(r, 0, sizeof(*r));
+    r->volume = NAN;
+    r->k01 = NAN;
+    r->EA1 = NAN;
+    r->k02 = NAN;
+    r->EA2 = NAN;
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++)
+        r->manualOutput[v] = NAN;
+    r->substanceId = PLANT_SUBSTANCE_UNSET;
+}
+
+/**
+ * @brief Fills the tag names of reactor `index` that are still empty.
+ *
+ * Uses the naming of the original hard-coded plant: "<n>-F" for the
+ * reactor, the slot tag for the others, suffixed for all but the first.
+ */
+static void plant_reactor_default_names(PlantReactor* r, UA_UInt32 index) {
+    if (!r->name[0])
+        snprintf(r->name, PLANT_NAME_SIZE, "%u-F", index + 1);
+    if (!r->model[0])
+        plant_tag(r->model, "Config", index);
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++) {
+        if (!r->sensor[s][0])
+            plant_tag(r->sensor[s], plant_sensor_tags[s], index);
+    }
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+        if (!r->valve[v][0])
+            plant_tag(r->valve[v], plant_valve_tags[v], index);
+    }
+}
+
+static void plant_init(Plant* p) {
+    memset(p, 0, sizeof(*p));
+    for (int k = 0; k < PLANT_FOLDER_COUNT; k++)
+        plant_tag(p->folder[k], plant_folder_tags[k], 0);
+}
+
+/**
+ * @brief Built-in plant: `reactors` reactors with the default tags and no overrides.
+ */
+void plant_default(Plant* p, UA_UInt32 reactors) {
+    plant_init(p);
+    p->owned = (PlantReactor*)UA_malloc((reactors ? reactors : 1) * sizeof(PlantReactor));
+    if (!p->owned)
+        return;
+    for (UA_UInt32 i = 0; i < reactors; i++) {
+        plant_reactor_unset(&p->owned[i]);
+        plant_reactor_default_names(&p->owned[i], i);
+    }
+    p->reactors = p->owned;
+    p->reactorCount = reactors;
+}
+
+void plant_clear(Plant* p) {
+    if (p->fromCache)
+        platform_file_unmap(&p->map);
+    UA_free(p->owned);
+    memset(p, 0, sizeof(*p));
+}
+
+/**
+ * @brief Writes the description values of a reactor over its fleet defaults.
+ *
+ * Call right after fleet_add_reactor(); values the description leaves
+ * out are not touched.
+ */
+void plant_apply(const PlantReactor* r, ReactorFleet* f, UA_UInt32 index) {
+    if (!isnan(r->volume))
+        f->volume[index] = r->volume;
+    if (!isnan(r->k01))
+        f->k01[index] = r->k01;
+    if (!isnan(r->EA1))
+        f->EA1[index] = r->EA1;
+    if (!isnan(r->k02))
+        f->k02[index] = r->k02;
+    if (!isnan(r->EA2))
+        f->EA2[index] = r->EA2;
+    if (r->substanceId != PLANT_SUBSTANCE_UNSET)
+        f->substanceId[index] = r->substanceId;
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+        if (!isnan(r->manualOutput[v]))
+            f->manualoutput[v][index] = r->manualOutput[v];
+    }
+}
+
+/* ---- text parser ---- */
+
+typedef struct {
+    Plant* plant;
+    UA_UInt32 capacity;
+    UA_UInt32 line;
+    UA_Boolean inReactor;
+    UA_Boolean inFolders;
+    PlantReactor tmpl;          /* reactor section being read */
+    UA_UInt32 repeat;
+} PlantParser;
+
+static char* plant_trim(char* s) {
+    while (isspace((unsigned char)*s))
+        s++;
+    char* e = s + strlen(s);
+    while (e > s && isspace((unsigned char)e[-1]))
+        *--e = '\0';
+    return s;
+}
+
+static UA_Boolean plant_parse_double(const char* s, UA_Double* out) {
+    char* end;
+    const double v = strtod(s, &end);
+    if (end == s || *end != '\0' || !isfinite(v))
+        return false;
+    *out = v;
+    return true;
+}
+
+static UA_Boolean plant_parse_uint(const char* s, UA_UInt32* out) {
+    char* end;
+    const unsigned long v = strtoul(s, &end, 10);
+    if (end == s || *end != '\0' || *s == '-' || v >= UA_UINT32_MAX)
+        return false;
+    *out = (UA_UInt32)v;
+    return true;
+}
+
+static UA_Boolean plant_copy_name(char* out, const char* value) {
+    const size_t len = strlen(value);
+    if (len == 0 || len >= PLANT_NAME_SIZE)
+        return false;
+    memcpy(out, value, len + 1);
+    return true;
+}
+
+/**
+ * @brief Appends the `repeat` copies of the finished reactor section.
+ */
+static UA_StatusCode plant_flush_reactor(PlantParser* ps) {
+    if (!ps->inReactor)
+        return UA_STATUSCODE_GOOD;
+    ps->inReactor = false;
+
+    Plant* p = ps->plant;
+    if (ps->repeat > UA_UINT32_MAX - p->reactorCount)
+        return UA_STATUSCODE_BADOUTOFRANGE;
+    if (p->reactorCount + ps->repeat > ps->capacity) {
+        UA_UInt32 cap = ps->capacity ? ps->capacity : 64;
+        while (cap < p->reactorCount + ps->repeat)
+            cap = (cap > UA_UINT32_MAX / 2) ? p->reactorCount + ps->repeat : cap * 2;
+        PlantReactor* grown = (PlantReactor*)UA_realloc(p->owned, (size_t)cap * sizeof(PlantReactor));
+        if (!grown)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        p->owned = grown;
+        ps->capacity = cap;
+    }
+
+    const PlantReactor* t = &ps->tmpl;
+    for (UA_UInt32 k = 0; k < ps->repeat; k++) {
+        const UA_UInt32 index = p->reactorCount;
+        PlantReactor* r = &p->owned[index];
+        *r = *t;
+        UA_Boolean ok = true;
+        if (k > 0) {
+            ok = ok && plant_tag(r->name, t->name, k);
+            ok = ok && (!t->model[0] || plant_tag(r->model, t->model, k));
+            for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+                ok = ok && (!t->sensor[s][0] || plant_tag(r->sensor[s], t->sensor[s], k));
+            for (int v = 0; v < FLEET_VALVE_COUNT; v++)
+                ok = ok && (!t->valve[v][0] || plant_tag(r->valve[v], t->valve[v], k));
+        }
+        if (!ok) {
+            LOG_MSG(LOG_LEVEL_ERROR,
+                "Plant description line %u: tag names of %s copy %u exceed %d characters",
+                ps->line, t->name, k + 1, PLANT_NAME_SIZE - 1);
+            return UA_STATUSCODE_BADCONFIGURATIONERROR;
+        }
+        plant_reactor_default_names(r, index);
+        p->reactorCount++;
+    }
+    p->reactors = p->owned;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode plant_parse_section(PlantParser* ps, char* header) {
+    UA_StatusCode rc = plant_flush_reactor(ps);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+
+    char* end = strchr(header, ']');
+    if (!end || plant_trim(end + 1)[0] != '\0') {
+        LOG_MSG(LOG_LEVEL_ERROR, "Plant description line %u: malformed section header", ps->line);
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+    *end = '\0';
+    char* name = plant_trim(header + 1);
+
+    ps->inFolders = false;
+    if (strcmp(name, "folders") == 0) {
+        ps->inFolders = true;
+        return UA_STATUSCODE_GOOD;
+    }
+    if (strncmp(name, "reactor", 7) == 0 && isspace((unsigned char)name[7])) {
+        plant_reactor_unset(&ps->tmpl);
+        if (!plant_copy_name(ps->tmpl.name, plant_trim(name + 7))) {
+            LOG_MSG(LOG_LEVEL_ERROR, "Plant description line %u: reactor name empty or longer than %d",
+                ps->line, PLANT_NAME_SIZE - 1);
+            return UA_STATUSCODE_BADCONFIGURATIONERROR;
+        }
+        ps->repeat = 1;
+        ps->inReactor = true;
+        return UA_STATUSCODE_GOOD;
+    }
+    LOG_MSG(LOG_LEVEL_ERROR, "Plant description line %u: unknown section [%s]",
+        ps->line, name);
+    return UA_STATUSCODE_BADCONFIGURATIONERROR;
+}
+
+static UA_Boolean plant_parse_reactor_key(PlantParser* ps, const char* key, const char* value) {
+    PlantReactor* r = &ps->tmpl;
+    if (strcmp(key, "model") == 0)
+        return plant_copy_name(r->model, value);
+    if (strcmp(key, "volume") == 0)
+        return plant_parse_double(value, &r->volume);
+    if (strcmp(key, "substance") == 0)
+        return plant_parse_uint(value, &r->substanceId);
+    if (strcmp(key, "k01") == 0)
+        return plant_parse_double(value, &r->k01);
+    if (strcmp(key, "ea1") == 0)
+        return plant_parse_double(value, &r->EA1);
+    if (strcmp(key, "k02") == 0)
+        return plant_parse_double(value, &r->k02);
+    if (strcmp(key, "ea2") == 0)
+        return plant_parse_double(value, &r->EA2);
+    if (strcmp(key, "repeat") == 0)
+        return plant_parse_uint(value, &ps->repeat) && ps->repeat > 0;
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++) {
+        if (strcmp(key, plant_sensor_keys[s]) == 0)
+            return plant_copy_name(r->sensor[s], value);
+    }
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+        if (strcmp(key, plant_valve_keys[v]) == 0)
+            return plant_copy_name(r->valve[v], value);
+        if (strcmp(key, plant_output_keys[v]) == 0)
+            return plant_parse_double(value, &r->manualOutput[v]) &&
+                r->manualOutput[v] >= 0.0 && r->manualOutput[v] <= 100.0;
+    }
+    return false;
+}
+
+static UA_StatusCode plant_parse_line(PlantParser* ps, char* line) {
+    line = plant_trim(line);
+    if (line[0] == '\0' || line[0] == '#' || line[0] == ';')
+        return UA_STATUSCODE_GOOD;
+    if (line[0] == '[')
+        return plant_parse_section(ps, line);
+
+    char* eq = strchr(line, '=');
+    if (!eq || (!ps->inFolders && !ps->inReactor)) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Plant description line %u: expected key = value inside a section",
+            ps->line);
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+    *eq = '\0';
+    char* key = plant_trim(line);
+    char* value = plant_trim(eq + 1);
+    for (char* c = key; *c; c++)
+        *c = (char)tolower((unsigned char)*c);
+
+    UA_Boolean ok = false;
+    if (ps->inFolders) {
+        for (int k = 0; k < PLANT_FOLDER_COUNT; k++) {
+            if (strcmp(key, plant_folder_keys[k]) == 0)
+                ok = plant_copy_name(ps->plant->folder[k], value);
+        }
+    }
+    else {
+        ok = plant_parse_reactor_key(ps, key, value);
+    }
+    if (!ok) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Plant description line %u: unknown key or bad value for %s",
+            ps->line, key);
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Reads the plant description text at path.
+ *
+ * Errors are logged with their line number; p is left empty on failure.
+ */
+UA_StatusCode plant_parse(Plant* p, const char* path) {
+    plant_init(p);
+
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    PlantParser ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.plant = p;
+
+    UA_StatusCode rc = UA_STATUSCODE_GOOD;
+    char buf[512];
+    while (rc == UA_STATUSCODE_GOOD && fgets(buf, sizeof(buf), fp)) {
+        ps.line++;
+        if (!strchr(buf, '\n') && !feof(fp)) {
+            LOG_MSG(LOG_LEVEL_ERROR, "Plant description line %u: longer than %zu characters",
+                ps.line, sizeof(buf) - 2);
+            rc = UA_STATUSCODE_BADCONFIGURATIONERROR;
+            break;
+        }
+        /* Skip a UTF-8 byte order mark */
+        char* line = buf;
+        if (ps.line == 1 && memcmp(line, "\xEF\xBB\xBF", 3) == 0)
+            line += 3;
+        rc = plant_parse_line(&ps, line);
+    }
+    fclose(fp);
+
+    if (rc == UA_STATUSCODE_GOOD)
+        rc = plant_flush_reactor(&ps);
+    if (rc == UA_STATUSCODE_GOOD && p->reactorCount == 0) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Plant description contains no reactor");
+        rc = UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+    if (rc != UA_STATUSCODE_GOOD)
+        plant_clear(p);
+    return rc;
+}
+
+/* ---- binary cache ---- */
+
+static UA_Boolean plant_cache_path(char* out, const char* path) {
+    const int len = snprintf(out, PLANT_PATH_SIZE, "%s.cache", path);
+    return len > 0 && len < PLANT_PATH_SIZE;
+}
+
+/**
+ * @brief Maps the cache and uses it if it was built from this source by this build.
+ */
+static UA_StatusCode plant_cache_open(Plant* p, const char* cachePath,
+    UA_UInt64 sourceSize, UA_Int64 sourceMtime) {
+
+    plant_init(p);
+    if (platform_file_map(&p->map, cachePath, 0) != UA_STATUSCODE_GOOD)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    const PlantCacheHeader* h = (const PlantCacheHeader*)p->map.data;
+    const UA_Boolean valid = p->map.size >= PLANT_CACHE_HEADER_SIZE &&
+        memcmp(h->magic, PLANT_CACHE_MAGIC, sizeof(h->magic)) == 0 &&
+        h->version == PLANT_CACHE_VERSION &&
+        h->recordSize == sizeof(PlantReactor) &&
+        h->sourceSize == sourceSize &&
+        h->sourceMtime == sourceMtime &&
+        h->reactorCount > 0 &&
+        p->map.size == PLANT_CACHE_HEADER_SIZE + (size_t)h->reactorCount * sizeof(PlantReactor);
+    if (!valid) {
+        platform_file_unmap(&p->map);
+        return UA_STATUSCODE_BADNOTFOUND;
+    }
+
+    memcpy(p->folder, h->folder, sizeof(p->folder));
+    for (int k = 0; k < PLANT_FOLDER_COUNT; k++)
+        p->folder[k][PLANT_NAME_SIZE - 1] = '\0';
+    p->reactorCount = h->reactorCount;
+    p->reactors = (const PlantReactor*)((const unsigned char*)p->map.data + PLANT_CACHE_HEADER_SIZE);
+    p->fromCache = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Writes the parsed plant as cache; replaces the old one atomically.
+ */
+static UA_StatusCode plant_cache_write(const Plant* p, const char* cachePath,
+    UA_UInt64 sourceSize, UA_Int64 sourceMtime) {
+
+    char tmpPath[PLANT_PATH_SIZE + 4];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", cachePath);
+
+    unsigned char header[PLANT_CACHE_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    PlantCacheHeader* h = (PlantCacheHeader*)header;
+    memcpy(h->magic, PLANT_CACHE_MAGIC, sizeof(h->magic));
+    h->version = PLANT_CACHE_VERSION;
+    h->recordSize = sizeof(PlantReactor);
+    h->sourceSize = sourceSize;
+    h->sourceMtime = sourceMtime;
+    h->reactorCount = p->reactorCount;
+    memcpy(h->folder, p->folder, sizeof(h->folder));
+
+    FILE* fp = fopen(tmpPath, "wb");
+    if (!fp)
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    UA_Boolean ok = fwrite(header, sizeof(header), 1, fp) == 1 &&
+        fwrite(p->reactors, sizeof(PlantReactor), p->reactorCount, fp) == p->reactorCount;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || platform_file_replace(tmpPath, cachePath) != UA_STATUSCODE_GOOD) {
+        remove(tmpPath);
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Loads the plant description at path, through its binary cache.
+ *
+ * Uses "<path>.cache" when it matches the size and modification time of
+ * the source; otherwise parses the text and rewrites the cache. Returns
+ * BadNotFound if the description does not exist.
+ */
+UA_StatusCode plant_load(Plant* p, const char* path) {
+    UA_UInt64 size;
+    UA_Int64 mtime;
+    plant_init(p);
+    if (!path || platform_file_stat(path, &size, &mtime) != UA_STATUSCODE_GOOD)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    char cachePath[PLANT_PATH_SIZE];
+    const UA_Boolean cached = plant_cache_path(cachePath, path);
+
+    if (cached && plant_cache_open(p, cachePath, size, mtime) == UA_STATUSCODE_GOOD) {
+        LOG_MSG(LOG_LEVEL_INFO, "Plant %s: %u reactors from the binary cache",
+            path, p->reactorCount);
+        return UA_STATUSCODE_GOOD;
+    }
+
+    UA_StatusCode rc = plant_parse(p, path);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+    LOG_MSG(LOG_LEVEL_INFO, "Plant %s: %u reactors parsed", path, p->reactorCount);
+
+    if (!cached || plant_cache_write(p, cachePath, size, mtime) != UA_STATUSCODE_GOOD)
+        LOG_MSG(LOG_LEVEL_WARN, "Plant %s: binary cache could not be written", path);
+    return UA_STATUSCODE_GOOD;
+}
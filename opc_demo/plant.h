@@ -0,0 +1,56 @@
+#pragma once
+#include "types.h"
+#include "platform.h"
+
+/* Tag names including the terminating zero */
+#define PLANT_NAME_SIZE 32
+
+/* Value of PlantReactor::substanceId when the description leaves it out */
+#define PLANT_SUBSTANCE_UNSET UA_UINT32_MAX
+
+typedef enum {
+    PLANT_FOLDER_MODEL,
+    PLANT_FOLDER_VALVES,
+    PLANT_FOLDER_SENSORS,
+    PLANT_FOLDER_REACTORS,
+    PLANT_FOLDER_COUNT
+} PlantFolder;
+
+/*
+ * One reactor of the plant description.
+ *
+ * Fixed-size and pointer-free, so the records can be stored as they are
+ * in the binary cache and used straight from the mapping. Doubles left
+ * out of the description are NAN and keep the fleet defaults.
+ */
+typedef struct {
+    UA_Double volume;
+    UA_Double k01;
+    UA_Double EA1;
+    UA_Double k02;
+    UA_Double EA2;
+    UA_Double manualOutput[FLEET_VALVE_COUNT];  /* initial valve position, % */
+    UA_UInt32 substanceId;
+    UA_UInt32 reserved;
+    char name[PLANT_NAME_SIZE];                 /* ReactorType object */
+    char model[PLANT_NAME_SIZE];                /* MathModelType object */
+    char sensor[FLEET_SENSOR_COUNT][PLANT_NAME_SIZE];
+    char valve[FLEET_VALVE_COUNT][PLANT_NAME_SIZE];     /* valve wired to each model input */
+} PlantReactor;
+
+typedef struct {
+    char folder[PLANT_FOLDER_COUNT][PLANT_NAME_SIZE];
+    UA_UInt32 reactorCount;
+    const PlantReactor* reactors;
+
+    UA_Boolean fromCache;       /* reactors point into the mapped cache */
+    PlantReactor* owned;        /* parsed or built-in records */
+    PlatformFileMap map;
+} Plant;
+
+void plant_default(Plant* p, UA_UInt32 reactors);
+UA_StatusCode plant_parse(Plant* p, const char* path);
+UA_StatusCode plant_load(Plant* p, const char* path);
+void plant_clear(Plant* p);
+
+void plant_apply(const PlantReactor* r, ReactorFleet* f, UA_UInt32 index);
@@ -0,0 +1,475 @@
+/**
+ * @file platform.c
+ * @brief Win32 / POSIX implementations of the portability layer.
+ *
+ * Threads, mutexes, condition variables, sleeping, a monotonic clock, the
+ * CPU count, process CPU time and memory-mapped files. See platform.h for
+ * the inline atomics.
+ *
+ * platform_process_cpu_ns() returns the user plus system CPU time of a
+ * process, pid 0 being the calling one. platform_find_process() looks a
+ * process up by executable name and returns 0 if there is none; it reads
+ * /proc and finds nothing on other systems.
+ *
+ * platform_sleep_until_ns() sleeps until an absolute platform_now_ns()
+ * time, so a periodic thread does not accumulate the error of relative
+ * sleeps. platform_thread_set_affinity() and platform_thread_set_realtime()
+ * apply to the calling thread; the latter usually needs privileges
+ * (CAP_SYS_NICE, or an rtprio limit) and fails without changing anything
+ * otherwise. Affinity is not supported outside Linux and Windows.
+ *
+ * platform_file_map() maps a whole existing file read-only when size is 0.
+ * With a size it opens or creates the file read-write, sets its length
+ * to size and maps it shared, so stores reach the file.
+ */
+
+#include "platform.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <sched.h>
+#endif
+
+#if defined(_WIN32)
+
+static DWORD WINAPI thread_trampoline(LPVOID p) {
+    PlatformThread* t = (PlatformThread*)p;
+    t->fn(t->arg);
+    return 0;
+}
+
+UA_StatusCode platform_thread_start(PlatformThread* t, PlatformThreadFn fn, void* arg) {
+    t->fn = fn;
+    t->arg = arg;
+    t->handle = CreateThread(NULL, 0, thread_trampoline, t, 0, NULL);
+    return t->handle ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+}
+
+void platform_thread_join(PlatformThread* t) {
+    if (!t->handle)
+        return;
+    WaitForSingleObject((HANDLE)t->handle, INFINITE);
+    CloseHandle((HANDLE)t->handle);
+    t->handle = NULL;
+}
+
+void platform_mutex_init(PlatformMutex* m) {
+    InitializeSRWLock((PSRWLOCK)&m->srw);
+}
+
+void platform_mutex_destroy(PlatformMutex* m) {
+    (void)m;
+}
+
+void platform_mutex_lock(PlatformMutex* m) {
+    AcquireSRWLockExclusive((PSRWLOCK)&m->srw);
+}
+
+void platform_mutex_unlock(PlatformMutex* m) {
+    ReleaseSRWLockExclusive((PSRWLOCK)&m->srw);
+}
+
+void platform_cond_init(PlatformCond* c) {
+    InitializeConditionVariable((PCONDITION_VARIABLE)&c->cv);
+}
+
+void platform_cond_destroy(PlatformCond* c) {
+    (void)c;
+}
+
+void platform_cond_wait(PlatformCond* c, PlatformMutex* m) {
+    SleepConditionVariableSRW((PCONDITION_VARIABLE)&c->cv, (PSRWLOCK)&m->srw, INFINITE, 0);
+}
+
+void platform_cond_broadcast(PlatformCond* c) {
+    WakeAllConditionVariable((PCONDITION_VARIABLE)&c->cv);
+}
+
+void platform_sleep_ms(UA_UInt32 ms) {
+    Sleep(ms);
+}
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+void platform_sleep_until_ns(UA_UInt64 deadlineNs) {
+    const UA_UInt64 now = platform_now_ns();
+    if (deadlineNs <= now)
+        return;
+
+    /* Sleep() rounds to the timer tick; a high resolution timer does not */
+    HANDLE timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+        TIMER_ALL_ACCESS);
+    if (!timer) {
+        Sleep((DWORD)((deadlineNs - now) / 1000000ULL));
+        return;
+    }
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG)((deadlineNs - now) / 100ULL);
+    if (SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE))
+        WaitForSingleObject(timer, INFINITE);
+    CloseHandle(timer);
+}
+
+UA_StatusCode platform_thread_set_affinity(UA_UInt32 cpu) {
+    if (cpu >= 64 || cpu >= platform_cpu_count())
+        return UA_STATUSCODE_BADOUTOFRANGE;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) ?
+        UA_STATUSCODE_GOOD : UA_STATUSCODE_BADINTERNALERROR;
+}
+
+UA_StatusCode platform_thread_set_realtime(UA_Int32 priority) {
+    (void)priority;
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) ?
+        UA_STATUSCODE_GOOD : UA_STATUSCODE_BADUSERACCESSDENIED;
+}
+
+UA_UInt64 platform_now_ns(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (UA_UInt64)((now.QuadPart / freq.QuadPart) * 1000000000ULL +
+        (now.QuadPart % freq.QuadPart) * 1000000000ULL / freq.QuadPart);
+}
+
+UA_UInt32 platform_cpu_count(void) {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors ? (UA_UInt32)si.dwNumberOfProcessors : 1;
+}
+
+UA_StatusCode platform_process_cpu_ns(UA_UInt32 pid, UA_UInt64* cpuNs) {
+    HANDLE h = pid ? OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid) : GetCurrentProcess();
+    FILETIME created, exited, kernel, user;
+    if (!h)
+        return UA_STATUSCODE_BADNOTFOUND;
+    const BOOL ok = GetProcessTimes(h, &created, &exited, &kernel, &user);
+    if (pid)
+        CloseHandle(h);
+    if (!ok)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    *cpuNs = ((((UA_UInt64)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+        (((UA_UInt64)user.dwHighDateTime << 32) | user.dwLowDateTime)) * 100;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_UInt32 platform_find_process(const char* name) {
+    (void)name;
+    return 0;
+}
+
+UA_StatusCode platform_file_stat(const char* path, UA_UInt64* size, UA_Int64* mtime) {
+    WIN32_FILE_ATTRIBUTE_DATA fa;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &fa))
+        return UA_STATUSCODE_BADNOTFOUND;
+    if (size)
+        *size = ((UA_UInt64)fa.nFileSizeHigh << 32) | fa.nFileSizeLow;
+    if (mtime)
+        *mtime = (UA_Int64)(((UA_UInt64)fa.ftLastWriteTime.dwHighDateTime << 32) |
+            fa.ftLastWriteTime.dwLowDateTime);
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode platform_file_replace(const char* from, const char* to) {
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING)
+        ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADINTERNALERROR;
+}
+
+UA_StatusCode platform_file_map(PlatformFileMap* m, const char* path, size_t size) {
+    const BOOL writable = size > 0;
+    m->data = NULL;
+    m->size = 0;
+    m->mapping = NULL;
+    m->file = CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+        FILE_SHARE_READ, NULL, writable ? OPEN_ALWAYS : OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m->file == INVALID_HANDLE_VALUE) {
+        m->file = NULL;
+        return UA_STATUSCODE_BADNOTFOUND;
+    }
+
+    if (!writable) {
+        LARGE_INTEGER li;
+        if (!GetFileSizeEx((HANDLE)m->file, &li) || li.QuadPart == 0) {
+            platform_file_unmap(m);
+            return UA_STATUSCODE_BADNOTFOUND;
+        }
+        size = (size_t)li.QuadPart;
+    }
+
+    m->mapping = CreateFileMappingA((HANDLE)m->file, NULL,
+        writable ? PAGE_READWRITE : PAGE_READONLY,
+        (DWORD)((UA_UInt64)size >> 32), (DWORD)size, NULL);
+    if (m->mapping)
+        m->data = MapViewOfFile((HANDLE)m->mapping,
+            writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+    if (!m->data) {
+        platform_file_unmap(m);
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    }
+    m->size = size;
+    return UA_STATUSCODE_GOOD;
+}
+
+void platform_file_unmap(PlatformFileMap* m) {
+    if (m->data)
+        UnmapViewOfFile(m->data);
+    if (m->mapping)
+        CloseHandle((HANDLE)m->mapping);
+    if (m->file)
+        CloseHandle((HANDLE)m->file);
+    m->data = NULL;
+    m->size = 0;
+    m->mapping = NULL;
+    m->file = NULL;
+}
+
+#else
+
+static void* thread_trampoline(void* p) {
+    PlatformThread* t = (PlatformThread*)p;
+    t->fn(t->arg);
+    return NULL;
+}
+
+UA_StatusCode platform_thread_start(PlatformThread* t, PlatformThreadFn fn, void* arg) {
+    t->fn = fn;
+    t->arg = arg;
+    return pthread_create(&t->handle, NULL, thread_trampoline, t) == 0
+        ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+}
+
+void platform_thread_join(PlatformThread* t) {
+    pthread_join(t->handle, NULL);
+}
+
+void platform_mutex_init(PlatformMutex* m) {
+    pthread_mutex_init(&m->m, NULL);
+}
+
+void platform_mutex_destroy(PlatformMutex* m) {
+    pthread_mutex_destroy(&m->m);
+}
+
+void platform_mutex_lock(PlatformMutex* m) {
+    pthread_mutex_lock(&m->m);
+}
+
+void platform_mutex_unlock(PlatformMutex* m) {
+    pthread_mutex_unlock(&m->m);
+}
+
+void platform_cond_init(PlatformCond* c) {
+    pthread_cond_init(&c->c, NULL);
+}
+
+void platform_cond_destroy(PlatformCond* c) {
+    pthread_cond_destroy(&c->c);
+}
+
+void platform_cond_wait(PlatformCond* c, PlatformMutex* m) {
+    pthread_cond_wait(&c->c, &m->m);
+}
+
+void platform_cond_broadcast(PlatformCond* c) {
+    pthread_cond_broadcast(&c->c);
+}
+
+void platform_sleep_ms(UA_UInt32 ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0) {
+        /* interrupted by a signal: sleep for the remainder */
+    }
+}
+
+UA_UInt64 platform_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UA_UInt64)ts.tv_sec * 1000000000ULL + (UA_UInt64)ts.tv_nsec;
+}
+
+void platform_sleep_until_ns(UA_UInt64 deadlineNs) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadlineNs / 1000000000ULL);
+    ts.tv_nsec = (long)(deadlineNs % 1000000000ULL);
+#if defined(__APPLE__)
+    const UA_UInt64 now = platform_now_ns();
+    if (deadlineNs > now) {
+        ts.tv_sec = (time_t)((deadlineNs - now) / 1000000000ULL);
+        ts.tv_nsec = (long)((deadlineNs - now) % 1000000000ULL);
+        while (nanosleep(&ts, &ts) != 0) {
+            /* interrupted by a signal: sleep for the remainder */
+        }
+    }
+#else
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        /* interrupted by a signal: the deadline still holds */
+    }
+#endif
+}
+
+UA_StatusCode platform_thread_set_affinity(UA_UInt32 cpu) {
+    if (cpu >= platform_cpu_count())
+        return UA_STATUSCODE_BADOUTOFRANGE;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ?
+        UA_STATUSCODE_GOOD : UA_STATUSCODE_BADINTERNALERROR;
+#else
+    return UA_STATUSCODE_BADNOTSUPPORTED;
+#endif
+}
+
+UA_StatusCode platform_thread_set_realtime(UA_Int32 priority) {
+    struct sched_param sp;
+    const int lo = sched_get_priority_min(SCHED_FIFO);
+    const int hi = sched_get_priority_max(SCHED_FIFO);
+    sp.sched_priority = priority < lo ? lo : priority > hi ? hi : priority;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0 ?
+        UA_STATUSCODE_GOOD : UA_STATUSCODE_BADUSERACCESSDENIED;
+}
+
+UA_UInt32 platform_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (UA_UInt32)n : 1;
+}
+
+UA_StatusCode platform_process_cpu_ns(UA_UInt32 pid, UA_UInt64* cpuNs) {
+    if (pid == 0) {
+        struct timespec ts;
+        if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+            return UA_STATUSCODE_BADINTERNALERROR;
+        *cpuNs = (UA_UInt64)ts.tv_sec * 1000000000ULL + (UA_UInt64)ts.tv_nsec;
+        return UA_STATUSCODE_GOOD;
+    }
+
+    char path[64], line[1024];
+    snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+        return UA_STATUSCODE_BADNOTFOUND;
+    const size_t n = fread(line, 1, sizeof(line) - 1, fp);
+    fclose(fp);
+    line[n] = '\0';
+
+    /* "pid (comm) state ppid ...": comm may contain spaces, utime and
+       stime are the 14th and 15th fields */
+    const char* p = strrchr(line, ')');
+    unsigned long utime, stime;
+    if (!p || sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+            &utime, &stime) != 2)
+        return UA_STATUSCODE_BADINTERNALERROR;
+    const long hz = sysconf(_SC_CLK_TCK);
+    *cpuNs = (UA_UInt64)(utime + stime) * (1000000000ULL / (UA_UInt64)(hz > 0 ? hz : 100));
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_UInt32 platform_find_process(const char* name) {
+    DIR* dir = opendir("/proc");
+    if (!dir)
+        return 0;
+
+    UA_UInt32 found = 0;
+    const UA_UInt32 self = (UA_UInt32)getpid();
+    struct dirent* e;
+    while (!found && (e = readdir(dir)) != NULL) {
+        char* end;
+        const unsigned long pid = strtoul(e->d_name, &end, 10);
+        if (*end != '\0' || pid == 0 || pid == self)
+            continue;
+
+        char path[64], comm[64];
+        snprintf(path, sizeof(path), "/proc/%lu/comm", pid);
+        FILE* fp = fopen(path, "r");
+        if (!fp)
+            continue;
+        if (fgets(comm, sizeof(comm), fp)) {
+            comm[strcspn(comm, "\n")] = '\0';
+            if (strcmp(comm, name) == 0)
+                found = (UA_UInt32)pid;
+        }
+        fclose(fp);
+    }
+    closedir(dir);
+    return found;
+}
+
+UA_StatusCode platform_file_stat(const char* path, UA_UInt64* size, UA_Int64* mtime) {
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return UA_STATUSCODE_BADNOTFOUND;
+    if (size)
+        *size = (UA_UInt64)st.st_size;
+    if (mtime)
+        *mtime = (UA_Int64)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_StatusCode platform_file_replace(const char* from, const char* to) {
+    return rename(from, to) == 0 ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADINTERNALERROR;
+}
+
+UA_StatusCode platform_file_map(PlatformFileMap* m, const char* path, size_t size) {
+    const int writable = size > 0;
+    m->data = NULL;
+    m->size = 0;
+    m->fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (m->fd < 0)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    if (writable) {
+        if (ftruncate(m->fd, (off_t)size) != 0) {
+            platform_file_unmap(m);
+            return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        }
+    }
+    else {
+        struct stat st;
+        if (fstat(m->fd, &st) != 0 || st.st_size == 0) {
+            platform_file_unmap(m);
+            return UA_STATUSCODE_BADNOTFOUND;
+        }
+        size = (size_t)st.st_size;
+    }
+
+    void* p = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+        MAP_SHARED, m->fd, 0);
+    if (p == MAP_FAILED) {
+        platform_file_unmap(m);
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    }
+    m->data = p;
+    m->size = size;
+    return UA_STATUSCODE_GOOD;
+}
+
+void platform_file_unmap(PlatformFileMap* m) {
+    if (m->data)
+        munmap(m->data, m->size);
+    if (m->fd >= 0)
+        close(m->fd);
+    m->data = NULL;
+    m->size = 0;
+    m->fd = -1;
+}
+
+#endif
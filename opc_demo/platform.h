@@ -0,0 +1,169 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <open62541/types.h>
+
+#if defined(_WIN32)
+#include <intrin.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+ * Thin portability layer over the Win32 and POSIX threading APIs.
+ * Everything that needs a thread, a lock or an atomic goes through here so
+ * the rest of the code base stays free of #ifdef _WIN32.
+ */
+
+typedef void (*PlatformThreadFn)(void* arg);
+
+typedef struct {
+#if defined(_WIN32)
+    void* handle;
+#else
+    pthread_t handle;
+#endif
+    PlatformThreadFn fn;
+    void* arg;
+} PlatformThread;
+
+typedef struct {
+#if defined(_WIN32)
+    void* srw;          /* SRWLOCK */
+#else
+    pthread_mutex_t m;
+#endif
+} PlatformMutex;
+
+typedef struct {
+#if defined(_WIN32)
+    void* cv;           /* CONDITION_VARIABLE */
+#else
+    pthread_cond_t c;
+#endif
+} PlatformCond;
+
+UA_StatusCode platform_thread_start(PlatformThread* t, PlatformThreadFn fn, void* arg);
+void platform_thread_join(PlatformThread* t);
+
+void platform_mutex_init(PlatformMutex* m);
+void platform_mutex_destroy(PlatformMutex* m);
+void platform_mutex_lock(PlatformMutex* m);
+void platform_mutex_unlock(PlatformMutex* m);
+
+void platform_cond_init(PlatformCond* c);
+void platform_cond_destroy(PlatformCond* c);
+void platform_cond_wait(PlatformCond* c, PlatformMutex* m);
+void platform_cond_broadcast(PlatformCond* c);
+
+void platform_sleep_ms(UA_UInt32 ms);
+UA_UInt64 platform_now_ns(void);
+void platform_sleep_until_ns(UA_UInt64 deadlineNs);
+UA_StatusCode platform_thread_set_affinity(UA_UInt32 cpu);
+UA_StatusCode platform_thread_set_realtime(UA_Int32 priority);
+UA_UInt32 platform_cpu_count(void);
+UA_StatusCode platform_process_cpu_ns(UA_UInt32 pid, UA_UInt64* cpuNs);
+UA_UInt32 platform_find_process(const char* name);
+
+/* A file mapped into memory by platform_file_map() */
+typedef struct {
+    void* data;
+    size_t size;
+#if defined(_WIN32)
+    void* file;
+    void* mapping;
+#else
+    int fd;
+#endif
+} PlatformFileMap;
+
+UA_StatusCode platform_file_stat(const char* path, UA_UInt64* size, UA_Int64* mtime);
+UA_StatusCode platform_file_replace(const char* from, const char* to);
+UA_StatusCode platform_file_map(PlatformFileMap* m, const char* path, size_t size);
+void platform_file_unmap(PlatformFileMap* m);
+
+/*
+ * Atomics. Loads have acquire and stores release semantics; the
+ * read-modify-write operations are full barriers.
+ */
+#if defined(_MSC_VER)
+
+static inline UA_UInt32 atomic_u32_load(const volatile UA_UInt32* p) {
+    UA_UInt32 v = *p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static inline void atomic_u32_store(volatile UA_UInt32* p, UA_UInt32 v) {
+    _ReadWriteBarrier();
+    *p = v;
+}
+
+static inline UA_UInt32 atomic_u32_add(volatile UA_UInt32* p, UA_UInt32 v) {
+    return (UA_UInt32)_InterlockedExchangeAdd((volatile long*)p, (long)v) + v;
+}
+
+static inline UA_UInt64 atomic_u64_load(const volatile UA_UInt64* p) {
+    UA_UInt64 v = *p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static inline void atomic_u64_store(volatile UA_UInt64* p, UA_UInt64 v) {
+    _ReadWriteBarrier();
+    *p = v;
+}
+
+static inline UA_UInt64 atomic_u64_add(volatile UA_UInt64* p, UA_UInt64 v) {
+    return (UA_UInt64)_InterlockedExchangeAdd64((volatile long long*)p, (long long)v) + v;
+}
+
+static inline UA_Boolean atomic_u64_cas(volatile UA_UInt64* p, UA_UInt64* expected, UA_UInt64 desired) {
+    UA_UInt64 prev = (UA_UInt64)_InterlockedCompareExchange64((volatile long long*)p,
+        (long long)desired, (long long)*expected);
+    if (prev == *expected)
+        return true;
+    *expected = prev;
+    return false;
+}
+
+static inline void atomic_fence(void) {
+    _mm_mfence();
+}
+
+#else
+
+static inline UA_UInt32 atomic_u32_load(const volatile UA_UInt32* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_u32_store(volatile UA_UInt32* p, UA_UInt32 v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline UA_UInt32 atomic_u32_add(volatile UA_UInt32* p, UA_UInt32 v) {
+    return __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST);
+}
+
+static inline UA_UInt64 atomic_u64_load(const volatile UA_UInt64* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_u64_store(volatile UA_UInt64* p, UA_UInt64 v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline UA_UInt64 atomic_u64_add(volatile UA_UInt64* p, UA_UInt64 v) {
+    return __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST);
+}
+
+static inline UA_Boolean atomic_u64_cas(volatile UA_UInt64* p, UA_UInt64* expected, UA_UInt64 desired) {
+    return __atomic_compare_exchange_n(p, expected, desired, false,
+        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_fence(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
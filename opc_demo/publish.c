@@ -0,0 +1,101 @@
+/**
+ * @file publish.c
+ * @brief Change-driven publishing of sensor values with deadbands.
+ *
+ * A sensor in SENSOR_PUBLISH_POLL mode exposes PROCESS_VALUE through
+ * readSensorDS, which is evaluated for every client read and every sample
+ * of every monitored item, whether the value changed or not.
+ *
+ * A sensor in SENSOR_PUBLISH_PUSH mode has a plain value-backed
+ * PROCESS_VALUE node instead. After each model tick publish_tick() pins
+ * the freshly published snapshot (fleet_pin()), walks the push sensors,
+ * compares each value with the last value written to the node and writes
+ * it only when it moved beyond the sensor's deadband. The walk reads the
+ * pinned copy, so all sensors are published from one tick even while the
+ * model thread flips its snapshots. Sampling a value-backed node is a cheap
+ * copy, and data change notifications fire only on real changes.
+ *
+ * publish_tick() calls into the server and therefore has to run on the
+ * server thread.
+ */
+
+#include <math.h>
+#include "publish.h"
+#include "fleet.h"
+
+/**
+ * @brief Checks whether value differs enough from the last pushed one.
+ *
+ * Always true before the first push and when either value is NaN, so a
+ * model fault is never hidden by the deadband. A negative deadband counts
+ * as zero.
+ */
+UA_Boolean publish_deadband_exceeded(const SensorPublish* p, UA_Double value) {
+    const UA_Double last = p->lastValue;
+    if (isnan(last) || isnan(value))
+        return !(isnan(last) && isnan(value));
+
+    const UA_Double diff = fabs(value - last);
+    const UA_Double db = p->deadband > 0.0 ? p->deadband : 0.0;
+    switch (p->deadbandType) {
+    case DEADBAND_ABSOLUTE:
+        return diff > db;
+    case DEADBAND_PERCENT:
+        return diff > db * 0.01 * fabs(last);
+    default:
+        return value != last;
+    }
+}
+
+/**
+ * @brief Writes the changed values of all push mode sensors.
+ *
+ * Values and source timestamps come from the last completed tick, pinned
+ * to the server thread's view. stats may be NULL; the per-sensor and
+ * fleet totals are updated in any case.
+ */
+void publish_tick(UA_Server* server, ReactorFleet* f, PublishStats* stats) {
+    fleet_pin(f);
+    const FleetSnapshot* snap = &f->view;
+    UA_UInt32 published = 0;
+    UA_UInt32 suppressed = 0;
+
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++) {
+        const UA_Double* pv = snap->pv[s];
+        SensorPublish* pub = f->publish[s];
+
+        for (UA_UInt32 i = 0; i < f->count; i++) {
+            SensorPublish* p = &pub[i];
+            if (p->mode != SENSOR_PUBLISH_PUSH)
+                continue;
+
+            UA_Double v = pv[i];
+            if (!publish_deadband_exceeded(p, v)) {
+                p->suppressed++;
+                suppressed++;
+                continue;
+            }
+
+            UA_DataValue dv;
+            UA_DataValue_init(&dv);
+            UA_Variant_setScalar(&dv.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+            dv.hasValue = true;
+            dv.sourceTimestamp = snap->tickTime;
+            dv.hasSourceTimestamp = true;
+
+            if (UA_Server_writeDataValue(server, p->valueId, dv) != UA_STATUSCODE_GOOD)
+                continue;
+
+            p->lastValue = v;
+            p->published++;
+            published++;
+        }
+    }
+
+    f->pushPublished += published;
+    f->pushSuppressed += suppressed;
+    if (stats) {
+        stats->published = published;
+        stats->suppressed = suppressed;
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <open62541/server.h>
+#include "types.h"
+
+/* Updates of one publish_tick() call */
+typedef struct {
+    UA_UInt32 published;
+    UA_UInt32 suppressed;
+} PublishStats;
+
+UA_Boolean publish_deadband_exceeded(const SensorPublish* p, UA_Double value);
+void publish_tick(UA_Server* server, ReactorFleet* f, PublishStats* stats);
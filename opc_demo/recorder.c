@@ -0,0 +1,563 @@
+/**
+ * @file recorder.c
+ * @brief Tick recorder and deterministic replay of the model.
+ *
+ * The recorder appends every model tick to a memory-mapped file: the
+ * inputs the tick ran with (valve outputs and characteristics, reactor
+ * volume, kinetic configuration, substance IDs and the dirty flags left
+ * by client writes) and the sensor values it produced. Nothing else is
+ * needed to reproduce the tick, because the model is a pure function of
+ * these inputs and of the model state, which is stored once when the
+ * recording starts.
+ *
+ * File layout (host byte order, specific to the build that wrote it):
+ *
+ *     RecorderHeader
+ *     state block     stateCA, stateCB, odeStep, rateK1, rateK2, rateT, pv[]
+ *     frame 1..n      RecorderFrame, custom curves, inputs, outputs
+ *
+ * Every per-reactor array is stored whole and padded to 8 bytes. The
+ * file is mapped shared and grows by doubling; a frame only counts once
+ * tickCount in the header has been advanced past it, so the recording
+ * always ends at a whole tick even when the process dies.
+ *
+ * Custom valve curves (CHARACTERISTIC_TABLE) are recorded by their
+ * breakpoints: a frame carries a RecorderCurve for every custom curve
+ * its inputs use that the file does not hold yet, or whose registry
+ * slot has since been given another table (valve_curve_generation()).
+ * Frames without new curves are frameBytes long.
+ *
+ * recorder_replay() rebuilds the fleet from a recording and feeds every
+ * frame back through model_cb(), as fast as the model runs, comparing
+ * the outputs with the recorded ones bit for bit. Recorded custom curves
+ * are registered again and the valves pointed at them.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "recorder.h"
+#include "config.h"
+#include "engine.h"
+#include "fleet.h"
+#include "log.h"
+#include "math_model.h"
+#include "valve_curve.h"
+
+#define RECORDER_MAGIC "OPCDREC1"
+#define RECORDER_VERSION 2
+
+/* Initial size of a recording file; it doubles whenever it is full */
+#define RECORDER_INITIAL_SIZE ((size_t)1 << 20)
+
+/* Fields of each recorded per-reactor array group, see recorder_fields() */
+#define RECORDER_STATE_FIELDS (6 + FLEET_SENSOR_COUNT)
+#define RECORDER_INPUTS_FIELDS (2 * FLEET_VALVE_COUNT + 8)
+#define RECORDER_OUTPUTS_FIELDS FLEET_SENSOR_COUNT
+#define RECORDER_FIELDS_MAX (RECORDER_STATE_FIELDS > RECORDER_INPUTS_FIELDS ? \
+    RECORDER_STATE_FIELDS : RECORDER_INPUTS_FIELDS)
+
+typedef struct {
+    char magic[8];
+    UA_UInt32 version;
+    UA_UInt32 reactorCount;
+    UA_UInt32 mode;             /* ModelMode */
+    UA_UInt32 dtMs;             /* model period the ticks ran with */
+    UA_Double odeRtol;
+    UA_Double odeAtol;
+    UA_UInt32 odeMaxSteps;
+    UA_UInt32 frameBytes;       /* frame without custom curves */
+    UA_UInt64 stateOffset;
+    UA_UInt64 frameOffset;
+    volatile UA_UInt64 tickCount;
+} RecorderHeader;
+
+typedef struct {
+    UA_UInt64 tick;             /* model tick number of the published snapshot */
+    UA_DateTime tickTime;
+    UA_UInt64 curveBytes;       /* RecorderCurve records between this and the inputs */
+} RecorderFrame;
+
+/* Custom curve, followed by pointCount (u, y) pairs of doubles */
+typedef struct {
+    UA_UInt32 id;               /* curve id in the recording process */
+    UA_UInt32 pointCount;
+} RecorderCurve;
+
+typedef enum {
+    RECORDER_STATE,
+    RECORDER_INPUTS,
+    RECORDER_OUTPUTS
+} RecorderGroup;
+
+/* One per-reactor array of the fleet and the size of its elements */
+typedef struct {
+    void* array;
+    size_t elemSize;
+} RecorderField;
+
+static size_t recorder_pad(size_t bytes) {
+    return (bytes + 7) & ~(size_t)7;
+}
+
+/**
+ * @brief Lists the fleet arrays of a group in the order they are stored.
+ *
+ * out holds RECORDER_FIELDS_MAX entries; a group lists exactly the count
+ * given by its RECORDER_*_FIELDS, which debug builds check.
+ */
+static size_t recorder_fields(const ReactorFleet* f, RecorderGroup group, RecorderField* out) {
+    static const size_t expected[] = {
+        RECORDER_STATE_FIELDS, RECORDER_INPUTS_FIELDS, RECORDER_OUTPUTS_FIELDS
+    };
+    size_t n = 0;
+#define RECORDER_FIELD(a) do { \
+        assert(n < RECORDER_FIELDS_MAX); \
+        out[n].array = (void*)(a); out[n].elemSize = sizeof(*(a)); n++; \
+    } while (0)
+    switch (group) {
+    case RECORDER_STATE:
+        RECORDER_FIELD(f->stateCA);
+        RECORDER_FIELD(f->stateCB);
+        RECORDER_FIELD(f->odeStep);
+        RECORDER_FIELD(f->rateK1);
+        RECORDER_FIELD(f->rateK2);
+        RECORDER_FIELD(f->rateT);
+        for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+            RECORDER_FIELD(f->pv[s]);
+        break;
+    case RECORDER_INPUTS:
+        for (int v = 0; v < FLEET_VALVE_COUNT; v++)
+            RECORDER_FIELD(f->manualoutput[v]);
+        RECORDER_FIELD(f->volume);
+        RECORDER_FIELD(f->k01);
+        RECORDER_FIELD(f->EA1);
+        RECORDER_FIELD(f->k02);
+        RECORDER_FIELD(f->EA2);
+        RECORDER_FIELD(f->R);
+        for (int v = 0; v < FLEET_VALVE_COUNT; v++)
+            RECORDER_FIELD(f->valveCurve[v]);
+        RECORDER_FIELD(f->substanceId);
+        RECORDER_FIELD(f->inputDirty);
+        break;
+    case RECORDER_OUTPUTS:
+        for (int s = 0; s < FLEET_SENSOR_COUNT; s++)
+            RECORDER_FIELD(f->pv[s]);
+        break;
+    }
+#undef RECORDER_FIELD
+    assert(n == expected[group]);
+    (void)expected;
+    return n;
+}
+
+/**
+ * @brief Bytes a group takes in the file for count reactors.
+ */
+static size_t recorder_group_bytes(UA_UInt32 count, RecorderGroup group) {
+    static const ReactorFleet shape;    /* only the element sizes are used */
+    RecorderField fields[RECORDER_FIELDS_MAX];
+    const size_t n = recorder_fields(&shape, group, fields);
+    size_t bytes = 0;
+    for (size_t k = 0; k < n; k++)
+        bytes += recorder_pad(fields[k].elemSize * count);
+    return bytes;
+}
+
+static size_t recorder_frame_bytes(UA_UInt32 count) {
+    return recorder_pad(sizeof(RecorderFrame)) + recorder_group_bytes(count, RECORDER_INPUTS) +
+        recorder_group_bytes(count, RECORDER_OUTPUTS);
+}
+
+/**
+ * @brief Copies a group between the fleet and the file; returns the bytes used.
+ */
+static size_t recorder_copy(const ReactorFleet* f, RecorderGroup group, UA_Byte* at, UA_Boolean toFile) {
+    RecorderField fields[RECORDER_FIELDS_MAX];
+    const size_t n = recorder_fields(f, group, fields);
+    size_t off = 0;
+    for (size_t k = 0; k < n; k++) {
+        const size_t bytes = fields[k].elemSize * f->count;
+        if (toFile)
+            memcpy(at + off, fields[k].array, bytes);
+        else
+            memcpy(fields[k].array, at + off, bytes);
+        off += recorder_pad(bytes);
+    }
+    return off;
+}
+
+static RecorderHeader* recorder_header(const TickRecorder* r) {
+    return (RecorderHeader*)r->map.data;
+}
+
+/**
+ * @brief Makes room for bytes more, doubling the file if needed.
+ */
+static UA_StatusCode recorder_reserve(TickRecorder* r, size_t bytes) {
+    if (r->used + bytes <= r->map.size)
+        return UA_STATUSCODE_GOOD;
+
+    size_t size = r->map.size;
+    while (r->used + bytes > size)
+        size *= 2;
+    platform_file_unmap(&r->map);
+    return platform_file_map(&r->map, r->path, size);
+}
+
+/**
+ * @brief Starts a new recording of fleet f at path.
+ *
+ * Writes the header and the current model state; an existing file is
+ * overwritten. dtMs is the period the ticks will run with.
+ */
+UA_StatusCode recorder_open(TickRecorder* r, const char* path, const ReactorFleet* f, int dtMs) {
+    memset(r, 0, sizeof(*r));
+    if (!path || strlen(path) >= sizeof(r->path) || f->count == 0)
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    strcpy(r->path, path);
+
+    const size_t stateOffset = recorder_pad(sizeof(RecorderHeader));
+    const size_t frameOffset = stateOffset + recorder_group_bytes(f->count, RECORDER_STATE);
+    const size_t frameBytes = recorder_frame_bytes(f->count);
+
+    size_t size = RECORDER_INITIAL_SIZE;
+    while (size < frameOffset + frameBytes)
+        size *= 2;
+    UA_StatusCode rc = platform_file_map(&r->map, path, size);
+    if (rc != UA_STATUSCODE_GOOD) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Recording %s could not be created", path);
+        return rc;
+    }
+
+    RecorderHeader* h = recorder_header(r);
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, RECORDER_MAGIC, sizeof(h->magic));
+    h->version = RECORDER_VERSION;
+    h->reactorCount = f->count;
+    h->mode = (UA_UInt32)f->mode;
+    h->dtMs = (UA_UInt32)dtMs;
+    h->odeRtol = f->ode.rtol;
+    h->odeAtol = f->ode.atol;
+    h->odeMaxSteps = f->ode.maxSteps;
+    h->frameBytes = (UA_UInt32)frameBytes;
+    h->stateOffset = stateOffset;
+    h->frameOffset = frameOffset;
+    recorder_copy(f, RECORDER_STATE, (UA_Byte*)r->map.data + stateOffset, true);
+
+    r->reactorCount = f->count;
+    r->frameBytes = (UA_UInt32)frameBytes;
+    r->used = frameOffset;
+    LOG_MSG(LOG_LEVEL_INFO, "Recording ticks to %s, %zu bytes per tick", path, frameBytes);
+    return UA_STATUSCODE_GOOD;
+}
+
+void recorder_close(TickRecorder* r) {
+    if (r->map.data) {
+        LOG_MSG(LOG_LEVEL_INFO, "Recording %s closed after %llu ticks",
+            r->path, (unsigned long long)recorder_header(r)->tickCount);
+        platform_file_unmap(&r->map);
+    }
+    r->inTick = false;
+}
+
+/* Stops a recording that cannot continue; what was recorded stays valid */
+static void recorder_fail(TickRecorder* r) {
+    LOG_MSG(LOG_LEVEL_ERROR, "Recording %s stopped, file could not grow", r->path);
+    platform_file_unmap(&r->map);
+    r->inTick = false;
+}
+
+/**
+ * @brief Records the inputs of the tick about to run.
+ *
+ * Call right before the tick, while the dirty flags of client writes
+ * are still set. Custom curves the file does not hold yet go ahead of
+ * the inputs. Does nothing once the recording is closed or if the fleet
+ * has grown since it was opened.
+ */
+void recorder_begin_tick(TickRecorder* r, const ReactorFleet* f) {
+    r->inTick = false;
+    if (!r->map.data || f->count != r->reactorCount)
+        return;
+
+    UA_UInt32 pending[VALVE_CURVE_MAX];
+    size_t pendingCount = 0;
+    size_t curveBytes = 0;
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+        for (UA_UInt32 i = 0; i < f->count; i++) {
+            const UA_UInt32 id = f->valveCurve[v][i];
+            const UA_UInt32 generation = valve_curve_generation(id);
+            if (generation == 0 || r->curveGeneration[id] == generation)
+                continue;
+            const UA_Double* points;
+            r->curveGeneration[id] = generation;
+            pending[pendingCount++] = id;
+            curveBytes += sizeof(RecorderCurve) + 2 * valve_curve_points(id, &points) * sizeof(UA_Double);
+        }
+    }
+
+    if (recorder_reserve(r, r->frameBytes + curveBytes) != UA_STATUSCODE_GOOD) {
+        recorder_fail(r);
+        return;
+    }
+    UA_Byte* at = (UA_Byte*)r->map.data + r->used + recorder_pad(sizeof(RecorderFrame));
+    for (size_t k = 0; k < pendingCount; k++) {
+        RecorderCurve c;
+        const UA_Double* points;
+        c.id = pending[k];
+        c.pointCount = (UA_UInt32)valve_curve_points(c.id, &points);
+        memcpy(at, &c, sizeof(c));
+        memcpy(at + sizeof(c), points, 2 * c.pointCount * sizeof(UA_Double));
+        at += sizeof(c) + 2 * c.pointCount * sizeof(UA_Double);
+    }
+    recorder_copy(f, RECORDER_INPUTS, at, true);
+    r->curveBytes = (UA_UInt32)curveBytes;
+    r->inTick = true;
+}
+
+/**
+ * @brief Records the outputs of the tick and commits its frame.
+ */
+void recorder_end_tick(TickRecorder* r, const ReactorFleet* f) {
+    if (!r->inTick)
+        return;
+    r->inTick = false;
+
+    UA_Byte* frame = (UA_Byte*)r->map.data + r->used;
+    const FleetSnapshot* snap = &f->snapshot[f->snapshotFront];
+    RecorderFrame head;
+    head.tick = snap->tick;
+    head.tickTime = snap->tickTime;
+    head.curveBytes = r->curveBytes;
+    memcpy(frame, &head, sizeof(head));
+
+    size_t off = recorder_pad(sizeof(RecorderFrame)) + r->curveBytes;
+    off += recorder_group_bytes(f->count, RECORDER_INPUTS);
+    recorder_copy(f, RECORDER_OUTPUTS, frame + off, true);
+
+    r->used += r->frameBytes + r->curveBytes;
+    RecorderHeader* h = recorder_header(r);
+    atomic_u64_store((volatile UA_UInt64*)&h->tickCount, h->tickCount + 1);
+}
+
+/**
+ * @brief Checks the header of a mapped recording; returns it on success.
+ *
+ * Needs nothing but the file, so the fleet is only sized from a header
+ * whose magic, version and layout are known to be right. Frames are
+ * checked one by one as they are replayed.
+ */
+static const RecorderHeader* recorder_validate(const PlatformFileMap* m) {
+    const RecorderHeader* h = (const RecorderHeader*)m->data;
+    if (m->size < sizeof(*h) || memcmp(h->magic, RECORDER_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != RECORDER_VERSION || h->reactorCount == 0 ||
+        h->mode > MODEL_MODE_DYNAMIC)
+        return NULL;
+
+    const size_t frameBytes = recorder_frame_bytes(h->reactorCount);
+    if (h->frameBytes != frameBytes ||
+        h->stateOffset != recorder_pad(sizeof(RecorderHeader)) ||
+        h->frameOffset != h->stateOffset + recorder_group_bytes(h->reactorCount, RECORDER_STATE) ||
+        h->frameOffset > m->size ||
+        h->tickCount > (m->size - h->frameOffset) / frameBytes)
+        return NULL;
+    return h;
+}
+
+/**
+ * @brief Registers the custom curves recorded ahead of a frame's inputs.
+ *
+ * map translates the curve ids of the recording to ids of this process
+ * and holds one reference on each curve it names; a redefined id drops
+ * the reference on the curve it named before.
+ */
+static UA_StatusCode recorder_load_curves(const UA_Byte* at, size_t bytes, UA_UInt32* map) {
+    size_t off = 0;
+    while (off < bytes) {
+        RecorderCurve c;
+        UA_Double points[2 * VALVE_CURVE_POINTS_MAX];
+        if (bytes - off < sizeof(c))
+            return UA_STATUSCODE_BADDECODINGERROR;
+        memcpy(&c, at + off, sizeof(c));
+        off += sizeof(c);
+        if (c.id >= VALVE_CURVE_MAX || valve_curve_kind(c.id) != VALVE_CHAR_CUSTOM ||
+            c.pointCount > VALVE_CURVE_POINTS_MAX ||
+            bytes - off < 2 * c.pointCount * sizeof(UA_Double))
+            return UA_STATUSCODE_BADDECODINGERROR;
+        memcpy(points, at + off, 2 * c.pointCount * sizeof(UA_Double));
+        off += 2 * c.pointCount * sizeof(UA_Double);
+
+        UA_UInt32 id;
+        UA_StatusCode rc = valve_curve_add_custom(points, c.pointCount, &id);
+        if (rc == UA_STATUSCODE_BADOUTOFRANGE)
+            return UA_STATUSCODE_BADDECODINGERROR;
+        if (rc != UA_STATUSCODE_GOOD)
+            return rc;
+        valve_curve_release(map[c.id]);
+        map[c.id] = id;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Points the recorded curve ids of the fleet at the curves registered for them */
+static UA_Boolean recorder_map_curves(ReactorFleet* f, const UA_UInt32* map) {
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+        for (UA_UInt32 i = 0; i < f->count; i++) {
+            const UA_UInt32 id = f->valveCurve[v][i];
+            if (id >= VALVE_CURVE_MAX)
+                return false;
+            if (valve_curve_kind(id) != VALVE_CHAR_CUSTOM)
+                continue;
+            if (!map[id])
+                return false;
+            f->valveCurve[v][i] = map[id];
+        }
+    }
+    return true;
+}
+
+/*
+ * Gives the valves back their default curves, which hold no reference,
+ * and drops the references of map.
+ */
+static void recorder_unmap_curves(ReactorFleet* f, UA_UInt32* map) {
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+        for (UA_UInt32 i = 0; i < f->count; i++)
+            f->valveCurve[v][i] = valve_curve_builtin((FleetValve)v, VALVE_CHAR_DEFAULT);
+    }
+    for (UA_UInt32 id = 0; id < VALVE_CURVE_MAX; id++) {
+        valve_curve_release(map[id]);
+        map[id] = 0;
+    }
+}
+
+/* Compares the outputs of a tick with the recorded ones, bit for bit */
+static void recorder_compare(const ReactorFleet* f, const UA_Byte* recorded,
+    UA_UInt64 tick, ReplayResult* res) {
+
+    UA_UInt64 differing = 0;
+    const size_t stride = recorder_pad(f->count * sizeof(UA_Double));
+    for (int s = 0; s < FLEET_SENSOR_COUNT; s++) {
+        const UA_Byte* rec = recorded + s * stride;
+        if (memcmp(rec, f->pv[s], f->count * sizeof(UA_Double)) == 0)
+            continue;
+        for (UA_UInt32 i = 0; i < f->count; i++) {
+            if (memcmp(rec + i * sizeof(UA_Double), &f->pv[s][i], sizeof(UA_Double)) == 0)
+                continue;
+            if (!res->firstTick) {
+                res->firstTick = tick;
+                res->firstReactor = i;
+                res->firstSensor = (UA_UInt32)s;
+            }
+            differing++;
+        }
+    }
+    if (differing) {
+        res->mismatchedTicks++;
+        res->mismatchedValues += differing;
+    }
+}
+
+/**
+ * @brief Replays a recording through model_cb() and verifies its outputs.
+ *
+ * The fleet is rebuilt with the recorded model mode, integrator settings
+ * and state; each frame's inputs are applied before the tick and the
+ * resulting sensor values compared with the recorded ones. Ticks run
+ * back to back on the configured worker pool. The period must match
+ * config_dt, which model_cb() steps with.
+ *
+ * @return Good when the recording could be replayed, whatever the
+ *         comparison found (see result), BadConfigurationError for
+ *         another period and BadDecodingError for a damaged or foreign
+ *         file.
+ */
+UA_StatusCode recorder_replay(const char* path, ReplayResult* result) {
+    memset(result, 0, sizeof(*result));
+
+    PlatformFileMap m;
+    UA_StatusCode rc = platform_file_map(&m, path, 0);
+    if (rc != UA_STATUSCODE_GOOD) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Recording %s not found", path);
+        return rc;
+    }
+    if (m.size < sizeof(RecorderHeader) || memcmp(m.data, RECORDER_MAGIC, 8) != 0) {
+        LOG_MSG(LOG_LEVEL_ERROR, "%s is not a recording", path);
+        platform_file_unmap(&m);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+    const RecorderHeader* h = recorder_validate(&m);
+    if (!h) {
+        LOG_MSG(LOG_LEVEL_ERROR, "%s is not a recording of this build or is damaged", path);
+        platform_file_unmap(&m);
+        return UA_STATUSCODE_BADDECODINGERROR;
+    }
+    if (h->dtMs != (UA_UInt32)config_dt) {
+        LOG_MSG(LOG_LEVEL_ERROR, "%s was recorded with a %u ms period, config_dt is %d ms",
+            path, h->dtMs, config_dt);
+        platform_file_unmap(&m);
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+
+    ReactorFleet f;
+    rc = fleet_init(&f, h->reactorCount);
+    for (UA_UInt32 i = 0; rc == UA_STATUSCODE_GOOD && i < h->reactorCount; i++)
+        rc = fleet_add_reactor(&f, NULL);
+    if (rc != UA_STATUSCODE_GOOD) {
+        fleet_clear(&f);
+        platform_file_unmap(&m);
+        return rc;
+    }
+
+    f.mode = (ModelMode)h->mode;
+    f.ode.rtol = h->odeRtol;
+    f.ode.atol = h->odeAtol;
+    f.ode.maxSteps = h->odeMaxSteps;
+    recorder_copy(&f, RECORDER_STATE, (UA_Byte*)m.data + h->stateOffset, false);
+
+    ModelEngine e;
+    if (engine_init(&e, config_model_threads, config_model_chunk) != UA_STATUSCODE_GOOD)
+        LOG_MSG(LOG_LEVEL_WARN, "Model worker pool unavailable, replaying on this thread");
+    ModelRunner runner = { &f, &e, NULL, NULL, NULL, NULL, { 0 } };
+
+    const size_t curveOffset = recorder_pad(sizeof(RecorderFrame));
+    const size_t inputBytes = recorder_group_bytes(f.count, RECORDER_INPUTS);
+    const UA_UInt64 ticks = h->tickCount;
+    UA_UInt32 curveMap[VALVE_CURVE_MAX] = { 0 };
+    size_t at = h->frameOffset;
+
+    const UA_UInt64 t0 = platform_now_ns();
+    for (UA_UInt64 k = 0; k < ticks; k++) {
+        UA_Byte* frame = (UA_Byte*)m.data + at;
+        RecorderFrame head = { 0 };
+        if (m.size - at >= h->frameBytes)
+            memcpy(&head, frame, sizeof(head));
+        if (m.size - at < h->frameBytes || head.curveBytes > m.size - at - h->frameBytes) {
+            rc = UA_STATUSCODE_BADDECODINGERROR;
+        }
+        else {
+            rc = recorder_load_curves(frame + curveOffset, (size_t)head.curveBytes, curveMap);
+            if (rc == UA_STATUSCODE_GOOD) {
+                recorder_copy(&f, RECORDER_INPUTS, frame + curveOffset + head.curveBytes, false);
+                if (!recorder_map_curves(&f, curveMap))
+                    rc = UA_STATUSCODE_BADDECODINGERROR;
+            }
+        }
+        if (rc != UA_STATUSCODE_GOOD) {
+            LOG_MSG(LOG_LEVEL_ERROR, "%s: tick %llu cannot be replayed (%s)",
+                path, (unsigned long long)(k + 1), UA_StatusCode_name(rc));
+            break;
+        }
+        model_cb(NULL, &runner);
+        recorder_compare(&f, frame + curveOffset + head.curveBytes + inputBytes, k + 1, result);
+        result->ticks++;
+        at += h->frameBytes + (size_t)head.curveBytes;
+    }
+    result->elapsedNs = platform_now_ns() - t0;
+
+    engine_clear(&e);
+    recorder_unmap_curves(&f, curveMap);
+    fleet_clear(&f);
+    platform_file_unmap(&m);
+    return rc;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <open62541/types.h>
+#include "types.h"
+#include "platform.h"
+#include "valve_curve.h"
+
+/* Longest recording file name, including the terminating zero */
+#define RECORDER_PATH_SIZE 1024
+
+/* Appends the inputs and outputs of every model tick to a mapped file */
+typedef struct TickRecorder {
+    PlatformFileMap map;
+    char path[RECORDER_PATH_SIZE];
+    UA_UInt32 reactorCount;
+    UA_UInt32 frameBytes;
+    UA_UInt64 used;             /* bytes up to the end of the last whole frame */
+    UA_UInt32 curveBytes;       /* custom curves written ahead of this tick's inputs */
+    UA_UInt32 curveGeneration[VALVE_CURVE_MAX];  /* custom curves in the file, by id */
+    UA_Boolean inTick;          /* recorder_begin_tick() wrote the inputs */
+} TickRecorder;
+
+/* Outcome of replaying a recording */
+typedef struct {
+    UA_UInt64 ticks;
+    UA_UInt64 mismatchedTicks;
+    UA_UInt64 mismatchedValues;
+    UA_UInt64 firstTick;        /* first tick with differing outputs, 1-based, 0 = none */
+    UA_UInt32 firstReactor;
+    UA_UInt32 firstSensor;
+    UA_UInt64 elapsedNs;
+} ReplayResult;
+
+UA_StatusCode recorder_open(TickRecorder* r, const char* path, const ReactorFleet* f, int dtMs);
+void recorder_close(TickRecorder* r);
+void recorder_begin_tick(TickRecorder* r, const ReactorFleet* f);
+void recorder_end_tick(TickRecorder* r, const ReactorFleet* f);
+
+UA_StatusCode recorder_replay(const char* path, ReplayResult* result);
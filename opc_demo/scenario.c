@@ -0,0 +1,268 @@
+/**
+ * @file scenario.c
+ * @brief Timeline of scheduled input changes for training scenarios.
+ *
+ * A scenario file lists model inputs to set at given simulated times,
+ * one event per line:
+ *
+ *     # time     reactor  input     value
+ *     0:10:00    1-F      valve.q   70
+ *     1:30:00    *        valve.t   40
+ *     5400       #3       k01       1.2e5
+ *
+ * The time is counted from the start of the simulation, in seconds or as
+ * h:mm:ss. The reactor is named as in the plant description, given by
+ * its position in the plant as #<n> (1-based), or * for all reactors.
+ * The inputs are those of the plant description: valve.ca, valve.q and
+ * valve.t (manual output in %), volume, k01, ea1, k02, ea2 and substance.
+ * Lines starting with '#' or ';' are comments. A value must lie in the
+ * range a client write of the input accepts (LIMIT_* in types.h), so a
+ * scenario cannot drive the model where no client could.
+ *
+ * scenario_apply() runs before every tick with the simulated time the
+ * tick starts at and applies the events that have become due, exactly
+ * like client writes: the value is stored in the fleet and the reactor's
+ * inputs are flagged dirty. Events are applied in time order, events of
+ * the same time in file order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "scenario.h"
+#include "log.h"
+
+static const char* const scenario_input_keys[SCENARIO_INPUT_COUNT] = {
+    "valve.ca", "valve.q", "valve.t", "volume", "k01", "ea1", "k02", "ea2", "substance"
+};
+
+/**
+ * @brief Parses "<seconds>" or "h:mm:ss" into seconds.
+ */
+static UA_Boolean scenario_parse_time(const char* s, UA_Double* out) {
+    char* end;
+    if (strchr(s, ':')) {
+        const unsigned long h = strtoul(s, &end, 10);
+        if (end == s || *end != ':')
+            return false;
+        const char* m = end + 1;
+        const unsigned long min = strtoul(m, &end, 10);
+        if (end == m || *end != ':' || min >= 60)
+            return false;
+        const char* sec = end + 1;
+        const double secs = strtod(sec, &end);
+        if (end == sec || *end != '\0' || !(secs >= 0.0 && secs < 60.0))
+            return false;
+        *out = h * 3600.0 + min * 60.0 + secs;
+        return true;
+    }
+    const double v = strtod(s, &end);
+    if (end == s || *end != '\0' || !(v >= 0.0) || !isfinite(v))
+        return false;
+    *out = v;
+    return true;
+}
+
+static UA_Boolean scenario_parse_reactor(const char* s, const Plant* plant, UA_UInt32* out) {
+    if (strcmp(s, "*") == 0) {
+        *out = SCENARIO_ALL_REACTORS;
+        return true;
+    }
+    if (s[0] == '#') {
+        char* end;
+        const unsigned long n = strtoul(s + 1, &end, 10);
+        if (end == s + 1 || *end != '\0' || n == 0 || n > plant->reactorCount)
+            return false;
+        *out = (UA_UInt32)(n - 1);
+        return true;
+    }
+    for (UA_UInt32 i = 0; i < plant->reactorCount; i++) {
+        if (strcmp(plant->reactors[i].name, s) == 0) {
+            *out = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static UA_Boolean scenario_parse_event(char* line, const Plant* plant, ScenarioEvent* e) {
+    char* fields[4];
+    int n = 0;
+    for (char* tok = strtok(line, " \t\r\n"); tok && n < 5; tok = strtok(NULL, " \t\r\n")) {
+        if (n == 4)
+            return false;
+        fields[n++] = tok;
+    }
+    if (n != 4)
+        return false;
+
+    if (!scenario_parse_time(fields[0], &e->time) ||
+        !scenario_parse_reactor(fields[1], plant, &e->reactor))
+        return false;
+
+    int input = 0;
+    while (input < SCENARIO_INPUT_COUNT && strcmp(fields[2], scenario_input_keys[input]) != 0)
+        input++;
+    if (input == SCENARIO_INPUT_COUNT)
+        return false;
+    e->input = (ScenarioInput)input;
+
+    char* end;
+    e->value = strtod(fields[3], &end);
+    return end != fields[3] && *end == '\0' && isfinite(e->value);
+}
+
+/**
+ * @brief Checks the value of an event against the range client writes of its input accept.
+ */
+static UA_Boolean scenario_check_value(const ScenarioEvent* e) {
+    const UA_Double v = e->value;
+    switch (e->input) {
+    case SCENARIO_VALVE_CA:
+    case SCENARIO_VALVE_Q:
+    case SCENARIO_VALVE_T:
+        return v >= LIMIT_MANUAL_OUTPUT_MIN && v <= LIMIT_MANUAL_OUTPUT_MAX;
+    case SCENARIO_VOLUME:
+        return v >= LIMIT_VOLUME_MIN && v <= LIMIT_VOLUME_MAX;
+    case SCENARIO_K01:
+    case SCENARIO_K02:
+        return v >= 0.0 && v <= LIMIT_K0_MAX;
+    case SCENARIO_EA1:
+    case SCENARIO_EA2:
+        return v >= 0.0 && v <= LIMIT_EA_MAX;
+    case SCENARIO_SUBSTANCE:
+        return v >= 0.0 && v < UA_UINT32_MAX && v == floor(v);
+    default:
+        return false;
+    }
+}
+
+/* Time order, file order for events of the same time */
+static int scenario_compare(const void* a, const void* b) {
+    const ScenarioEvent* x = (const ScenarioEvent*)a;
+    const ScenarioEvent* y = (const ScenarioEvent*)b;
+    if (x->time != y->time)
+        return x->time < y->time ? -1 : 1;
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+/**
+ * @brief Reads a scenario file; reactor names are resolved against the plant.
+ *
+ * Returns BadNotFound if the file does not exist and
+ * BadConfigurationError, after logging the line, for a malformed event
+ * or a value out of its input's range.
+ */
+UA_StatusCode scenario_load(Scenario* s, const char* path, const Plant* plant) {
+    memset(s, 0, sizeof(*s));
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Scenario %s not found", path);
+        return UA_STATUSCODE_BADNOTFOUND;
+    }
+
+    size_t capacity = 0;
+    UA_UInt32 lineNo = 0;
+    char line[512];
+    UA_StatusCode rc = UA_STATUSCODE_GOOD;
+    while (rc == UA_STATUSCODE_GOOD && fgets(line, sizeof(line), fp)) {
+        lineNo++;
+        char* p = line;
+        while (isspace((unsigned char)*p))
+            p++;
+        if (*p == '\0' || *p == '#' || *p == ';')
+            continue;
+
+        if (s->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            ScenarioEvent* grown = (ScenarioEvent*)UA_realloc(s->events, capacity * sizeof(ScenarioEvent));
+            if (!grown) {
+                rc = UA_STATUSCODE_BADOUTOFMEMORY;
+                break;
+            }
+            s->events = grown;
+        }
+        ScenarioEvent* e = &s->events[s->count];
+        e->line = lineNo;
+        if (!scenario_parse_event(p, plant, e)) {
+            LOG_MSG(LOG_LEVEL_ERROR, "Scenario %s line %u: expected <time> <reactor> <input> <value>",
+                path, lineNo);
+            rc = UA_STATUSCODE_BADCONFIGURATIONERROR;
+            break;
+        }
+        if (!scenario_check_value(e)) {
+            LOG_MSG(LOG_LEVEL_ERROR, "Scenario %s line %u: value %g out of range",
+                path, lineNo, e->value);
+            rc = UA_STATUSCODE_BADCONFIGURATIONERROR;
+            break;
+        }
+        s->count++;
+    }
+    fclose(fp);
+
+    if (rc != UA_STATUSCODE_GOOD) {
+        scenario_clear(s);
+        return rc;
+    }
+    qsort(s->events, s->count, sizeof(ScenarioEvent), scenario_compare);
+    LOG_MSG(LOG_LEVEL_INFO, "Scenario %s: %zu events over %.0f s",
+        path, s->count, s->count ? s->events[s->count - 1].time : 0.0);
+    return UA_STATUSCODE_GOOD;
+}
+
+void scenario_clear(Scenario* s) {
+    UA_free(s->events);
+    memset(s, 0, sizeof(*s));
+}
+
+static void scenario_set(ReactorFleet* f, UA_UInt32 i, const ScenarioEvent* e) {
+    switch (e->input) {
+    case SCENARIO_VALVE_CA:
+    case SCENARIO_VALVE_Q:
+    case SCENARIO_VALVE_T:
+        f->manualoutput[e->input - SCENARIO_VALVE_CA][i] = e->value;
+        f->inputDirty[i] |= FLEET_DIRTY_PROCESS;
+        break;
+    case SCENARIO_VOLUME:
+        f->volume[i] = e->value;
+        f->inputDirty[i] |= FLEET_DIRTY_PROCESS;
+        break;
+    case SCENARIO_K01: f->k01[i] = e->value; f->inputDirty[i] |= FLEET_DIRTY_KINETICS; break;
+    case SCENARIO_EA1: f->EA1[i] = e->value; f->inputDirty[i] |= FLEET_DIRTY_KINETICS; break;
+    case SCENARIO_K02: f->k02[i] = e->value; f->inputDirty[i] |= FLEET_DIRTY_KINETICS; break;
+    case SCENARIO_EA2: f->EA2[i] = e->value; f->inputDirty[i] |= FLEET_DIRTY_KINETICS; break;
+    case SCENARIO_SUBSTANCE:
+        f->substanceId[i] = (UA_UInt32)e->value;
+        f->inputDirty[i] |= FLEET_DIRTY_KINETICS;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Applies the events due at `elapsed` simulated seconds.
+ *
+ * @return number of events applied.
+ */
+size_t scenario_apply(Scenario* s, ReactorFleet* f, UA_Double elapsed) {
+    size_t applied = 0;
+    while (s->next < s->count && s->events[s->next].time <= elapsed) {
+        const ScenarioEvent* e = &s->events[s->next++];
+        if (e->reactor == SCENARIO_ALL_REACTORS) {
+            for (UA_UInt32 i = 0; i < f->count; i++)
+                scenario_set(f, i, e);
+            LOG_MSG(LOG_LEVEL_INFO, "Scenario t=%.0f s: all reactors %s = %g",
+                e->time, scenario_input_keys[e->input], e->value);
+        }
+        else if (e->reactor < f->count) {
+            scenario_set(f, e->reactor, e);
+            LOG_MSG(LOG_LEVEL_INFO, "Scenario t=%.0f s: reactor #%u %s = %g",
+                e->time, e->reactor + 1, scenario_input_keys[e->input], e->value);
+        }
+        applied++;
+    }
+    return applied;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <open62541/types.h>
+#include "types.h"
+#include "plant.h"
+
+/* Reactor of an event that applies to every reactor */
+#define SCENARIO_ALL_REACTORS UA_UINT32_MAX
+
+/* Model input an event sets */
+typedef enum {
+    SCENARIO_VALVE_CA,          /* manual outputs, in the order of FleetValve */
+    SCENARIO_VALVE_Q,
+    SCENARIO_VALVE_T,
+    SCENARIO_VOLUME,
+    SCENARIO_K01,
+    SCENARIO_EA1,
+    SCENARIO_K02,
+    SCENARIO_EA2,
+    SCENARIO_SUBSTANCE,
+    SCENARIO_INPUT_COUNT
+} ScenarioInput;
+
+typedef struct {
+    UA_Double time;             /* simulated seconds from the start */
+    UA_UInt32 reactor;          /* fleet index or SCENARIO_ALL_REACTORS */
+    ScenarioInput input;
+    UA_Double value;
+    UA_UInt32 line;             /* line in the scenario file */
+} ScenarioEvent;
+
+/* Timeline of input changes, sorted by time */
+typedef struct Scenario {
+    ScenarioEvent* events;
+    size_t count;
+    size_t next;                /* first event not applied yet */
+} Scenario;
+
+UA_StatusCode scenario_load(Scenario* s, const char* path, const Plant* plant);
+void scenario_clear(Scenario* s);
+size_t scenario_apply(Scenario* s, ReactorFleet* f, UA_Double elapsed);
@@ -0,0 +1,72 @@
+/**
+ * @file server_loop.c
+ * @brief Main loop of the OPC UA server with a per-iteration clock.
+ *
+ * server_loop_run() replaces UA_Server_runUntilInterrupt(): it starts the
+ * server, calls UA_Server_run_iterate() until SIGINT / SIGTERM or
+ * server_loop_stop() and shuts the server down.
+ *
+ * Every iteration bumps an iteration counter. server_loop_now() reads the
+ * wall clock once per iteration, on the first call after the iteration
+ * woke up, and returns that timestamp to every later caller in the same
+ * iteration. A Read request for hundreds of variables, or the sampling of
+ * all monitored items that fall due together, thus costs one clock read
+ * instead of two per value, and all values carry the same server
+ * timestamp.
+ *
+ * The loop and the clock belong to the server thread.
+ */
+
+#include <signal.h>
+#include "server_loop.h"
+
+static volatile sig_atomic_t g_running;
+static UA_UInt64 g_iteration;
+static UA_UInt64 g_cachedIteration;
+static UA_DateTime g_cachedNow;
+
+static void server_loop_signal(int sig) {
+    (void)sig;
+    g_running = 0;
+}
+
+UA_StatusCode server_loop_run(UA_Server* server) {
+    UA_StatusCode rc = UA_Server_run_startup(server);
+    if (rc != UA_STATUSCODE_GOOD)
+        return rc;
+
+    g_running = 1;
+    signal(SIGINT, server_loop_signal);
+    signal(SIGTERM, server_loop_signal);
+
+    while (g_running) {
+        g_iteration++;
+        UA_Server_run_iterate(server, true);
+    }
+
+    g_running = 0;
+    return UA_Server_run_shutdown(server);
+}
+
+void server_loop_stop(void) {
+    g_running = 0;
+}
+
+/**
+ * @brief Wall clock time of the current server iteration.
+ *
+ * Outside of server_loop_run() every call reads the clock.
+ */
+UA_DateTime server_loop_now(void) {
+    if (!g_running)
+        return UA_DateTime_now();
+    if (g_cachedIteration != g_iteration) {
+        g_cachedNow = UA_DateTime_now();
+        g_cachedIteration = g_iteration;
+    }
+    return g_cachedNow;
+}
+
+UA_UInt64 server_loop_iterations(void) {
+    return g_iteration;
+}
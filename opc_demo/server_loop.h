@@ -0,0 +1,8 @@
+#pragma once
+#include <open62541/server.h>
+
+UA_StatusCode server_loop_run(UA_Server* server);
+void server_loop_stop(void);
+
+UA_DateTime server_loop_now(void);
+UA_UInt64 server_loop_iterations(void);
@@ -0,0 +1,145 @@
+/**
+ * @file sim_clock.c
+ * @brief Simulated time base of the model.
+ *
+ * The model advances in simulated time: tick n ends at start + n * dt,
+ * and that is the source timestamp the sensor values of the tick are
+ * published with. How fast simulated time passes is the time scale:
+ *
+ *   - 1 runs in real time, one tick per config_dt as before;
+ *   - s > 1 (or < 1) runs s times faster (slower). The model callback is
+ *     retimed to dt / s, but never shorter than SIM_CLOCK_MIN_PERIOD_MS;
+ *     when that is not enough, one callback runs several ticks;
+ *   - 0 runs as fast as possible: every callback runs ticks until
+ *     SIM_CLOCK_BUDGET_MS of wall time are spent, leaving the rest of the
+ *     period to the server for client requests.
+ *
+ * Ticks due are counted from an anchor (wall time, tick) set whenever
+ * the scale changes. A tick becomes due half a period early, so timer
+ * jitter of the callback neither drops nor doubles ticks. A clock that
+ * falls behind catches up within the budget of each callback; the
+ * backlog beyond SIM_CLOCK_BUDGET_MS is dropped, simulated time then
+ * runs slower than asked instead of bursting later.
+ *
+ * A dedicated model thread (model_thread.c) paces single ticks itself
+ * and uses only sim_clock_rescale() of the pacing above.
+ *
+ * sim_clock_report() measures the achieved tick rate over
+ * SIM_CLOCK_REPORT_MS windows.
+ */
+
+#include "sim_clock.h"
+
+#define SIM_CLOCK_NS_PER_MS 1000000.0
+
+static void sim_clock_anchor(SimClock* c, UA_UInt64 wallNs) {
+    c->appliedScale = c->timeScale;
+    c->anchorWallNs = wallNs;
+    c->anchorTicks = c->ticks;
+}
+
+void sim_clock_init(SimClock* c, UA_UInt32 dtMs, UA_Double timeScale, UA_DateTime start,
+    UA_UInt64 wallNs) {
+    c->timeScale = timeScale;
+    c->elapsed = 0.0;
+    c->tickRate = 0.0;
+    c->speed = 0.0;
+    c->dtMs = dtMs ? dtMs : 1;
+    c->start = start;
+    c->ticks = 0;
+    c->callbackId = 0;
+    c->callbackWallNs = wallNs;
+    c->reportWallNs = wallNs;
+    c->reportTicks = 0;
+    sim_clock_anchor(c, wallNs);
+}
+
+/**
+ * @brief Period the model callback should run at for the current scale.
+ */
+UA_Double sim_clock_period_ms(const SimClock* c) {
+    if (!(c->timeScale > 0.0))
+        return SIM_CLOCK_MIN_PERIOD_MS;
+    const UA_Double period = c->dtMs / c->timeScale;
+    return period > SIM_CLOCK_MIN_PERIOD_MS ? period : SIM_CLOCK_MIN_PERIOD_MS;
+}
+
+/**
+ * @brief Starts a callback and applies a new time scale; true if it changed.
+ */
+UA_Boolean sim_clock_rescale(SimClock* c, UA_UInt64 wallNs) {
+    c->callbackWallNs = wallNs;
+
+    /* Reject what a client cannot have meant; keep the pace */
+    if (!(c->timeScale >= 0.0 && c->timeScale <= SIM_CLOCK_SCALE_MAX))
+        c->timeScale = c->appliedScale;
+
+    if (c->timeScale == c->appliedScale)
+        return false;
+    sim_clock_anchor(c, wallNs);
+    return true;
+}
+
+/**
+ * @brief Starts a callback: returns the number of ticks due now.
+ *
+ * As fast as possible, every tick is due (UA_UINT64_MAX) and the budget
+ * ends the callback. *rescaled is set if the scale changed since the
+ * last callback, so the callback period has to follow.
+ */
+UA_UInt64 sim_clock_due(SimClock* c, UA_UInt64 wallNs, UA_Boolean* rescaled) {
+    *rescaled = sim_clock_rescale(c, wallNs);
+
+    if (!(c->appliedScale > 0.0))
+        return UA_UINT64_MAX;
+
+    const UA_Double wallMs = (wallNs - c->anchorWallNs) / SIM_CLOCK_NS_PER_MS;
+    const UA_UInt64 target = c->anchorTicks +
+        (UA_UInt64)((wallMs * c->appliedScale + c->dtMs * 0.5) / c->dtMs);
+    return target > c->ticks ? target - c->ticks : 0;
+}
+
+/**
+ * @brief True once the current callback has used up its wall time budget.
+ */
+UA_Boolean sim_clock_over_budget(const SimClock* c, UA_UInt64 wallNs) {
+    return (wallNs - c->callbackWallNs) / SIM_CLOCK_NS_PER_MS >= SIM_CLOCK_BUDGET_MS;
+}
+
+void sim_clock_advance(SimClock* c) {
+    c->ticks++;
+    c->elapsed = (UA_Double)c->ticks * c->dtMs / 1000.0;
+}
+
+/**
+ * @brief Ends a callback; true when a new rate report window is complete.
+ *
+ * Drops the backlog of a clock that cannot keep up, see the file comment.
+ */
+UA_Boolean sim_clock_report(SimClock* c, UA_UInt64 wallNs) {
+    if (c->appliedScale > 0.0 && sim_clock_over_budget(c, wallNs))
+        sim_clock_anchor(c, wallNs);
+
+    const UA_Double windowMs = (wallNs - c->reportWallNs) / SIM_CLOCK_NS_PER_MS;
+    if (windowMs < SIM_CLOCK_REPORT_MS)
+        return false;
+    c->tickRate = (c->ticks - c->reportTicks) * 1000.0 / windowMs;
+    c->speed = c->tickRate * c->dtMs / 1000.0;
+    c->reportWallNs = wallNs;
+    c->reportTicks = c->ticks;
+    return true;
+}
+
+/**
+ * @brief Simulated time at the end of the last tick.
+ */
+UA_DateTime sim_clock_now(const SimClock* c) {
+    return c->start + (UA_DateTime)c->ticks * c->dtMs * UA_DATETIME_MSEC;
+}
+
+/**
+ * @brief Simulated time at the end of the tick about to run.
+ */
+UA_DateTime sim_clock_next(const SimClock* c) {
+    return c->start + (UA_DateTime)(c->ticks + 1) * c->dtMs * UA_DATETIME_MSEC;
+}
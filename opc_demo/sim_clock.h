@@ -0,0 +1,58 @@
+#pragma once
+#include <open62541/types.h>
+
+/* Shortest callback period of the model, ms; also used when running as fast as possible */
+#define SIM_CLOCK_MIN_PERIOD_MS 10.0
+
+/* Wall time one callback may spend on catching up or running ahead, ms */
+#define SIM_CLOCK_BUDGET_MS 50.0
+
+/* Wall time over which the achieved tick rate is measured, ms */
+#define SIM_CLOCK_REPORT_MS 5000.0
+
+/* Largest time scale accepted, 0 stands for "as fast as possible" */
+#define SIM_CLOCK_SCALE_MAX 10000.0
+
+/*
+ * Simulated time of the model.
+ *
+ * Every tick advances simulated time by dtMs. timeScale says how many
+ * simulated seconds pass per wall second (1 = real time, 0 = as fast as
+ * possible); it may be written at any time, the clock then continues
+ * from where it is at the new pace. timeScale, elapsed, tickRate and
+ * speed are exposed in the address space, so they are plain doubles.
+ */
+typedef struct SimClock {
+    UA_Double timeScale;
+    UA_Double elapsed;          /* simulated seconds since start */
+    UA_Double tickRate;         /* ticks per wall second, last report window */
+    UA_Double speed;            /* simulated seconds per wall second, last window */
+
+    UA_UInt32 dtMs;
+    UA_DateTime start;          /* simulated time of tick 0 */
+    UA_UInt64 ticks;
+    UA_UInt64 callbackId;       /* repeated callback of the model, retimed with the scale */
+
+    /* Pacing: ticks due are counted from this anchor at appliedScale */
+    UA_Double appliedScale;
+    UA_UInt64 anchorWallNs;
+    UA_UInt64 anchorTicks;
+    UA_UInt64 callbackWallNs;   /* start of the current callback */
+
+    /* Rate report window */
+    UA_UInt64 reportWallNs;
+    UA_UInt64 reportTicks;
+} SimClock;
+
+void sim_clock_init(SimClock* c, UA_UInt32 dtMs, UA_Double timeScale, UA_DateTime start,
+    UA_UInt64 wallNs);
+UA_Double sim_clock_period_ms(const SimClock* c);
+
+UA_Boolean sim_clock_rescale(SimClock* c, UA_UInt64 wallNs);
+UA_UInt64 sim_clock_due(SimClock* c, UA_UInt64 wallNs, UA_Boolean* rescaled);
+UA_Boolean sim_clock_over_budget(const SimClock* c, UA_UInt64 wallNs);
+void sim_clock_advance(SimClock* c);
+UA_Boolean sim_clock_report(SimClock* c, UA_UInt64 wallNs);
+
+UA_DateTime sim_clock_now(const SimClock* c);
+UA_DateTime sim_clock_next(const SimClock* c);
@@ -0,0 +1,423 @@
+/**
+ * @file substance.c
+ * @brief Library of substance kinetics, selected through SUBSTANCE_ID.
+ *
+ * The library file lists kinetic parameter sets by substance ID:
+ *
+ *     [substance 7]
+ *     k01 = 5.0e9
+ *     ea1 = 75000
+ *     k02 = 3.0e10
+ *     ea2 = 85000
+ *     r = 8.314
+ *
+ * k01, ea1, k02 and ea2 are required; r is optional, leaving it out keeps
+ * the R of the reactor. Lines starting with '#' or ';' are comments. IDs
+ * are 1 .. 2^32 - 2, each at most once; SUBSTANCE_NONE (0) means kinetics
+ * set by hand and cannot be listed.
+ *
+ * substance_table_load() turns the file into a SubstanceTable, one
+ * allocation holding the kinetics in file order and a hash index over
+ * them (substance_find(), O(1)). At the start of each tick
+ * substance_apply() copies the kinetics of every reactor whose
+ * SUBSTANCE_ID differs from the one last applied into its K01, EA1, K02,
+ * EA2 (and R), in parallel on the model engine, and marks them changed,
+ * so writing SUBSTANCE_ID switches the kinetics at the next tick. An ID
+ * the library does not list leaves the kinetics as they are. Kinetics
+ * staged with SET_KINETICS win over the library: staging marks their
+ * SUBSTANCE_ID as applied (fleet_apply_staged()).
+ *
+ * substance_poll_cb(), a repeated server callback, reloads the file when
+ * its size or modification time changes. The new version is built aside
+ * and swapped in atomically (see SubstanceLibrary); the model keeps
+ * ticking on the version it holds and picks up the new one at its next
+ * tick, applying it again to every reactor with a SUBSTANCE_ID. A file
+ * that fails to parse is logged and the current version stays.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "substance.h"
+#include "fleet.h"
+#include "log.h"
+
+/* Kinetic keys of a substance section, in ConfigMathModel order */
+enum { SUBSTANCE_K01, SUBSTANCE_EA1, SUBSTANCE_K02, SUBSTANCE_EA2, SUBSTANCE_R, SUBSTANCE_KEYS };
+static const char* const substance_keys[SUBSTANCE_KEYS] = { "k01", "ea1", "k02", "ea2", "r" };
+
+/* Entries read so far */
+typedef struct {
+    UA_UInt32* ids;
+    ConfigMathModel* kinetics;
+    UA_UInt32 count;
+    UA_UInt32 capacity;
+    UA_UInt32 line;             /* line of the open section */
+    UA_Boolean open;
+} SubstanceParser;
+
+static char* substance_trim(char* s) {
+    while (isspace((unsigned char)*s))
+        s++;
+    char* e = s + strlen(s);
+    while (e > s && isspace((unsigned char)e[-1]))
+        *--e = '\0';
+    return s;
+}
+
+static UA_Double* substance_field(ConfigMathModel* k, int key) {
+    switch (key) {
+    case SUBSTANCE_K01: return &k->k01;
+    case SUBSTANCE_EA1: return &k->EA1;
+    case SUBSTANCE_K02: return &k->k02;
+    case SUBSTANCE_EA2: return &k->EA2;
+    default: return &k->R;
+    }
+}
+
+/* Checks the open section; all but R must be set, every value in range */
+static UA_StatusCode substance_close(SubstanceParser* ps) {
+    if (!ps->open)
+        return UA_STATUSCODE_GOOD;
+    ps->open = false;
+    ConfigMathModel* k = &ps->kinetics[ps->count - 1];
+    for (int key = 0; key < SUBSTANCE_KEYS; key++) {
+        const UA_Double v = *substance_field(k, key);
+        const UA_Boolean ok = key == SUBSTANCE_R ? (isnan(v) || v > 0.0) : v >= 0.0;
+        if (!ok) {
+            LOG_MSG(LOG_LEVEL_ERROR, "Substance library line %u: %s missing or out of range",
+                ps->line, substance_keys[key]);
+            return UA_STATUSCODE_BADCONFIGURATIONERROR;
+        }
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Starts the section of header, "[substance <id>]", at line */
+static UA_StatusCode substance_open(SubstanceParser* ps, char* header, UA_UInt32 line) {
+    ps->line = line;
+    char* end = strchr(header, ']');
+    char* name = NULL;
+    if (end) {
+        *end = '\0';
+        name = substance_trim(header + 1);
+    }
+    if (!end || substance_trim(end + 1)[0] != '\0' || strncmp(name, "substance", 9) != 0 ||
+        !isspace((unsigned char)name[9])) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Substance library line %u: expected [substance <id>]",
+            line);
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+
+    char* idText = substance_trim(name + 9);
+    char* idEnd;
+    const unsigned long id = strtoul(idText, &idEnd, 10);
+    if (idEnd == idText || *idEnd != '\0' || *idText == '-' || id == SUBSTANCE_NONE ||
+        id >= UA_UINT32_MAX) {
+        LOG_MSG(LOG_LEVEL_ERROR, "Substance library line %u: invalid ID %s",
+            line, idText);
+        return UA_STATUSCODE_BADCONFIGURATIONERROR;
+    }
+
+    if (ps->count == ps->capacity) {
+        const UA_UInt32 cap = ps->capacity ? ps->capacity * 2 : 64;
+        UA_UInt32* ids = (UA_UInt32*)UA_realloc(ps->ids, cap * sizeof(UA_UInt32));
+        if (ids)
+            ps->ids = ids;
+        ConfigMathModel* kinetics = (ConfigMathModel*)UA_realloc(ps->kinetics,
+            cap * sizeof(ConfigMathModel));
+        if (kinetics)
+            ps->kinetics = kinetics;
+        if (!ids || !kinetics)
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+        ps->capacity = cap;
+    }
+    ps->ids[ps->count] = (UA_UInt32)id;
+    ConfigMathModel* k = &ps->kinetics[ps->count++];
+    k->k01 = k->EA1 = k->k02 = k->EA2 = k->R = NAN;
+    ps->open = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_Boolean substance_value(SubstanceParser* ps, char* line) {
+    char* eq = strchr(line, '=');
+    if (!eq || !ps->open)
+        return false;
+    *eq = '\0';
+    char* key = substance_trim(line);
+    char* value = substance_trim(eq + 1);
+    for (char* c = key; *c; c++)
+        *c = (char)tolower((unsigned char)*c);
+
+    for (int k = 0; k < SUBSTANCE_KEYS; k++) {
+        if (strcmp(key, substance_keys[k]) != 0)
+            continue;
+        char* end;
+        const double v = strtod(value, &end);
+        if (end == value || *end != '\0' || !isfinite(v))
+            return false;
+        *substance_field(&ps->kinetics[ps->count - 1], k) = v;
+        return true;
+    }
+    return false;
+}
+
+/* Hash index and kinetics of the parsed entries in one allocation; NULL *out if an ID repeats */
+static UA_StatusCode substance_table_build(const SubstanceParser* ps, SubstanceTable** out) {
+    UA_UInt32 slots = 8;
+    while (slots < 2 * ps->count)
+        slots *= 2;
+    const size_t bytes = sizeof(SubstanceTable) + slots * sizeof(SubstanceSlot) +
+        (size_t)ps->count * sizeof(ConfigMathModel);
+    SubstanceTable* t = (SubstanceTable*)UA_calloc(1, bytes);
+    if (!t)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    t->count = ps->count;
+    t->mask = slots - 1;
+    t->slots = (SubstanceSlot*)(t + 1);
+    t->kinetics = (ConfigMathModel*)(t->slots + slots);
+    if (ps->count)
+        memcpy(t->kinetics, ps->kinetics, ps->count * sizeof(ConfigMathModel));
+
+    for (UA_UInt32 e = 0; e < ps->count; e++) {
+        UA_UInt32 s = substance_hash(ps->ids[e]) & t->mask;
+        while (t->slots[s].id != SUBSTANCE_NONE && t->slots[s].id != ps->ids[e])
+            s = (s + 1) & t->mask;
+        if (t->slots[s].id == ps->ids[e]) {
+            LOG_MSG(LOG_LEVEL_ERROR, "Substance library: substance %u listed twice",
+                ps->ids[e]);
+            UA_free(t);
+            return UA_STATUSCODE_BADCONFIGURATIONERROR;
+        }
+        t->slots[s].id = ps->ids[e];
+        t->slots[s].entry = e;
+    }
+    *out = t;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Reads the library file at path into a new table.
+ *
+ * Returns BadNotFound if there is no file and BadConfigurationError,
+ * after logging the line, for a malformed one.
+ */
+UA_StatusCode substance_table_load(SubstanceTable** out, const char* path) {
+    *out = NULL;
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return UA_STATUSCODE_BADNOTFOUND;
+
+    SubstanceParser ps;
+    memset(&ps, 0, sizeof(ps));
+    UA_StatusCode rc = UA_STATUSCODE_GOOD;
+    UA_UInt32 lineNo = 0;
+    char buf[512];
+    while (rc == UA_STATUSCODE_GOOD && fgets(buf, sizeof(buf), fp)) {
+        lineNo++;
+        char* line = buf;
+        if (lineNo == 1 && memcmp(line, "\xEF\xBB\xBF", 3) == 0)
+            line += 3;
+        line = substance_trim(line);
+        if (line[0] == '\0' || line[0] == '#' || line[0] == ';')
+            continue;
+        if (line[0] == '[') {
+            rc = substance_close(&ps);
+            if (rc == UA_STATUSCODE_GOOD)
+                rc = substance_open(&ps, line, lineNo);
+        }
+        else if (!substance_value(&ps, line)) {
+            LOG_MSG(LOG_LEVEL_ERROR, "Substance library line %u: expected k01, ea1, k02, ea2 "
+                "or r = <value> inside a [substance <id>] section", lineNo);
+            rc = UA_STATUSCODE_BADCONFIGURATIONERROR;
+        }
+    }
+    fclose(fp);
+
+    if (rc == UA_STATUSCODE_GOOD)
+        rc = substance_close(&ps);
+    if (rc == UA_STATUSCODE_GOOD)
+        rc = substance_table_build(&ps, out);
+    UA_free(ps.ids);
+    UA_free(ps.kinetics);
+    return rc;
+}
+
+void substance_table_free(SubstanceTable* t) {
+    UA_free(t);
+}
+
+/**
+ * @brief Opens the library file at path, which need not exist yet.
+ *
+ * Without a file the library is empty and substance_library_poll() loads
+ * it once it appears. Returns the result of the first load; lib is usable
+ * either way.
+ */
+UA_StatusCode substance_library_open(SubstanceLibrary* lib, const char* path) {
+    memset(lib, 0, sizeof(*lib));
+    /* Starts at 1 so that generation - 1 never equals SUBSTANCE_IDLE */
+    lib->generation = 1;
+    lib->applied = 1;
+    lib->reader = SUBSTANCE_IDLE;
+    if (strlen(path) >= SUBSTANCE_PATH_SIZE)
+        return UA_STATUSCODE_BADOUTOFRANGE;
+    memcpy(lib->path, path, strlen(path) + 1);
+
+    if (platform_file_stat(path, &lib->sourceSize, &lib->sourceMtime) != UA_STATUSCODE_GOOD)
+        return UA_STATUSCODE_BADNOTFOUND;
+    SubstanceTable** t = &lib->table[lib->generation & 1];
+    const UA_StatusCode rc = substance_table_load(t, path);
+    if (rc == UA_STATUSCODE_GOOD)
+        LOG_MSG(LOG_LEVEL_INFO, "Substance library %s: %u substances",
+            path, (*t)->count);
+    return rc;
+}
+
+/**
+ * @brief Frees both versions; the model must no longer use lib.
+ */
+void substance_library_clear(SubstanceLibrary* lib) {
+    substance_table_free(lib->table[0]);
+    substance_table_free(lib->table[1]);
+    memset(lib, 0, sizeof(*lib));
+    lib->reader = SUBSTANCE_IDLE;
+}
+
+/**
+ * @brief Reloads the library if its file changed since the last look.
+ *
+ * Never blocks the model: if it still reads the version the reload would
+ * replace, the reload waits for the next poll. Returns true if a new
+ * version was published.
+ */
+UA_Boolean substance_library_poll(SubstanceLibrary* lib) {
+    UA_UInt64 size;
+    UA_Int64 mtime;
+    if (platform_file_stat(lib->path, &size, &mtime) != UA_STATUSCODE_GOOD ||
+        (size == lib->sourceSize && mtime == lib->sourceMtime))
+        return false;
+
+    /* The back slot holds generation - 1, which the model may still read */
+    const UA_UInt32 generation = lib->generation;
+    atomic_fence();
+    if (atomic_u32_load(&lib->reader) == generation - 1)
+        return false;
+
+    SubstanceTable* t;
+    const UA_StatusCode rc = substance_table_load(&t, lib->path);
+    lib->sourceSize = size;
+    lib->sourceMtime = mtime;
+    if (rc != UA_STATUSCODE_GOOD) {
+        LOG_MSG(LOG_LEVEL_WARN, "Substance library %s not reloaded, keeping the current one", lib->path);
+        return false;
+    }
+
+    const UA_UInt32 back = (generation + 1) & 1;
+    substance_table_free(lib->table[back]);
+    lib->table[back] = t;
+    atomic_u32_store(&lib->generation, generation + 1);
+    lib->reloads++;
+    LOG_MSG(LOG_LEVEL_INFO, "Substance library %s reloaded: %u substances",
+        lib->path, t->count);
+    return true;
+}
+
+/**
+ * @brief Repeated server callback polling the library file.
+ */
+void substance_poll_cb(UA_Server* server, void* data) {
+    (void)server;
+    substance_library_poll((SubstanceLibrary*)data);
+}
+
+/**
+ * @brief Current version of the library for the model, until substance_library_release().
+ *
+ * Wait-free. *generation receives its generation. Only one thread, the
+ * one ticking the model, may hold a version.
+ */
+const SubstanceTable* substance_library_acquire(SubstanceLibrary* lib, UA_UInt32* generation) {
+    UA_UInt32 g;
+    do {
+        g = atomic_u32_load(&lib->generation);
+        atomic_u32_store(&lib->reader, g);
+        atomic_fence();
+    } while (atomic_u32_load(&lib->generation) != g);
+    *generation = g;
+    return lib->table[g & 1];
+}
+
+void substance_library_release(SubstanceLibrary* lib) {
+    atomic_u32_store(&lib->reader, SUBSTANCE_IDLE);
+}
+
+/* One pass of substance_apply() */
+typedef struct {
+    ReactorFleet* fleet;
+    const SubstanceTable* table;
+    UA_Boolean all;             /* a new version: every reactor with a substance */
+    SubstanceStats stats[ENGINE_MAX_WORKERS];
+} SubstancePass;
+
+static void substance_apply_range(void* ctx, UA_UInt32 worker, UA_UInt32 begin, UA_UInt32 end) {
+    SubstancePass* pass = (SubstancePass*)ctx;
+    ReactorFleet* f = pass->fleet;
+    SubstanceStats* s = &pass->stats[worker];
+
+    for (UA_UInt32 i = begin; i < end; i++) {
+        const UA_UInt32 id = f->substanceId[i];
+        if (id == f->substanceApplied[i] && !(pass->all && id != SUBSTANCE_NONE))
+            continue;
+        f->substanceApplied[i] = id;
+        const ConfigMathModel* k = substance_find(pass->table, id);
+        if (!k) {
+            s->unknown += id != SUBSTANCE_NONE ? 1 : 0;
+            continue;
+        }
+        f->k01[i] = k->k01;
+        f->EA1[i] = k->EA1;
+        f->k02[i] = k->k02;
+        f->EA2[i] = k->EA2;
+        if (!isnan(k->R))
+            f->R[i] = k->R;
+        f->inputDirty[i] |= FLEET_DIRTY_KINETICS;
+        s->applied++;
+    }
+}
+
+/**
+ * @brief Switches reactors whose SUBSTANCE_ID changed to the kinetics of the library.
+ *
+ * Runs at the start of a tick, before its inputs are recorded. After a
+ * reload every reactor with a SUBSTANCE_ID is switched again. The pass
+ * compares one ID per reactor and is split over engine (NULL = calling
+ * thread). stats may be NULL.
+ */
+void substance_apply(SubstanceLibrary* lib, ReactorFleet* f, ModelEngine* engine,
+    SubstanceStats* stats) {
+    SubstancePass pass;
+    UA_UInt32 generation;
+    pass.fleet = f;
+    pass.table = substance_library_acquire(lib, &generation);
+    pass.all = generation != lib->applied;
+    lib->applied = generation;
+
+    const UA_UInt32 workers = engine ? engine_worker_count(engine) : 1;
+    memset(pass.stats, 0, workers * sizeof(SubstanceStats));
+    if (engine)
+        engine_run(engine, f->count, substance_apply_range, &pass);
+    else
+        substance_apply_range(&pass, 0, 0, f->count);
+    substance_library_release(lib);
+
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        for (UA_UInt32 w = 0; w < workers; w++) {
+            stats->applied += pass.stats[w].applied;
+            stats->unknown += pass.stats[w].unknown;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <open62541/server.h>
+#include "types.h"
+#include "engine.h"
+#include "platform.h"
+
+/* SUBSTANCE_ID of a reactor whose kinetics are set by hand; never in a library */
+#define SUBSTANCE_NONE 0
+
+/* SubstanceLibrary::reader while the model holds no table */
+#define SUBSTANCE_IDLE UA_UINT32_MAX
+
+/* Longest library path, including the terminating zero */
+#define SUBSTANCE_PATH_SIZE 1024
+
+/* Hash slot: SUBSTANCE_NONE if empty, else a substance and its entry */
+typedef struct {
+    UA_UInt32 id;
+    UA_UInt32 entry;
+} SubstanceSlot;
+
+/*
+ * Immutable lookup table of one version of the library, one allocation.
+ *
+ * Open addressing with linear probing over a power-of-two number of
+ * slots, at most half of them used, so a lookup touches one or two slots.
+ */
+typedef struct {
+    UA_UInt32 count;
+    UA_UInt32 mask;             /* slots - 1 */
+    SubstanceSlot* slots;
+    ConfigMathModel* kinetics;  /* per entry; R is NAN where the reactor's R stays */
+} SubstanceTable;
+
+/*
+ * Substance library with copy-on-write reload.
+ *
+ * table[generation & 1] is the current version. A reload builds the next
+ * one in the other slot and publishes it by advancing generation; the
+ * model announces the generation it reads in `reader`, so the slot it may
+ * still use is never overwritten and the model never waits.
+ */
+typedef struct SubstanceLibrary {
+    char path[SUBSTANCE_PATH_SIZE];
+    SubstanceTable* table[2];
+    volatile UA_UInt32 generation;
+    volatile UA_UInt32 reader;  /* generation in use by the model, or SUBSTANCE_IDLE */
+    UA_UInt32 applied;          /* generation the fleet was last updated from (model side) */
+    UA_UInt64 sourceSize;       /* library file the current version was read from */
+    UA_Int64 sourceMtime;
+    UA_UInt32 reloads;
+} SubstanceLibrary;
+
+static inline UA_UInt32 substance_hash(UA_UInt32 id) {
+    return id * 2654435761u;
+}
+
+/**
+ * @brief Kinetics of substance id, or NULL if t is NULL or does not list it.
+ */
+static inline const ConfigMathModel* substance_find(const SubstanceTable* t, UA_UInt32 id) {
+    if (!t || id == SUBSTANCE_NONE)
+        return NULL;
+    for (UA_UInt32 s = substance_hash(id) & t->mask; ; s = (s + 1) & t->mask) {
+        if (t->slots[s].id == id)
+            return &t->kinetics[t->slots[s].entry];
+        if (t->slots[s].id == SUBSTANCE_NONE)
+            return NULL;
+    }
+}
+
+UA_StatusCode substance_table_load(SubstanceTable** out, const char* path);
+void substance_table_free(SubstanceTable* t);
+
+UA_StatusCode substance_library_open(SubstanceLibrary* lib, const char* path);
+void substance_library_clear(SubstanceLibrary* lib);
+UA_Boolean substance_library_poll(SubstanceLibrary* lib);
+void substance_poll_cb(UA_Server* server, void* data);
+
+const SubstanceTable* substance_library_acquire(SubstanceLibrary* lib, UA_UInt32* generation);
+void substance_library_release(SubstanceLibrary* lib);
+
+/* Reactors switched by substance_apply() */
+typedef struct {
+    UA_UInt32 applied;          /* kinetics taken from the library */
+    UA_UInt32 unknown;          /* SUBSTANCE_ID not in the library, kinetics kept */
+} SubstanceStats;
+
+void substance_apply(SubstanceLibrary* lib, struct ReactorFleet* f, ModelEngine* engine,
+    SubstanceStats* stats);
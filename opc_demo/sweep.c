@@ -0,0 +1,227 @@
+/**
+ * @file sweep.c
+ * @brief What-if sweeps of the steady-state CB over the valve openings.
+ *
+ * A sweep evaluates the steady-state model of one reactor over a grid of
+ * HC-1, HC-2 and HC-3 openings (SweepGrid) and keeps the resulting CB
+ * surface, so an operator sees how CB responds to the valves without
+ * moving them and waiting a tick per trial.
+ *
+ * sweep_plan() captures what the sweep needs while the caller holds the
+ * model lock: the kinetics, the volume and a copy of the three valve
+ * characteristics (valve_curve_copy()), the registry being changed by the
+ * server thread. From then on the sweep reads no live state. sweep_run()
+ * takes each axis through its copied characteristic, the temperature axis
+ * further through the Arrhenius rates, and evaluates compute_CB_rates() at every cell;
+ * the cells are laid out HC-3 fastest, so each run of cells shares its
+ * flow and concentration and walks the rate arrays contiguously, a loop
+ * without branches that the compiler vectorizes. The cells are split over
+ * a ModelEngine (engine.c). A cell whose valves are all closed, or whose
+ * temperature is not physical, is NAN.
+ *
+ * sweep_publish() swaps the finished surface in and sweep_read() hands it
+ * to a reader as a three-dimensional array [HC-1][HC-2][HC-3], or the
+ * slice of it an index range selects; both hold the lock of the SweepSet,
+ * so a sweep computed on one thread can be read on another.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "sweep.h"
+#include "fleet.h"
+#include "math_model.h"
+
+/**
+ * @brief Sweeps of capacity reactors, each with the default grid and no surface.
+ */
+UA_StatusCode sweep_set_init(SweepSet* s, UA_UInt32 capacity) {
+    memset(s, 0, sizeof(*s));
+    s->items = (Sweep*)UA_calloc(capacity ? capacity : 1, sizeof(Sweep));
+    if (!s->items)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    s->capacity = capacity;
+    platform_mutex_init(&s->lock);
+    for (UA_UInt32 i = 0; i < capacity; i++) {
+        sweep_grid_default(&s->items[i].grid);
+        s->items[i].lock = &s->lock;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+void sweep_set_clear(SweepSet* s) {
+    if (!s->items)
+        return;
+    for (UA_UInt32 i = 0; i < s->capacity; i++)
+        UA_free(s->items[i].cb);
+    UA_free(s->items);
+    platform_mutex_destroy(&s->lock);
+    memset(s, 0, sizeof(*s));
+}
+
+void sweep_grid_default(SweepGrid* g) {
+    for (int a = 0; a < SWEEP_AXES; a++) {
+        g->min[a] = 0.0;
+        g->max[a] = 100.0;
+        g->points[a] = SWEEP_DEFAULT_POINTS;
+    }
+}
+
+/**
+ * @brief BadOutOfRange unless every axis runs 0 <= min <= max <= 100 in 1 .. SWEEP_POINTS_MAX points.
+ */
+UA_StatusCode sweep_grid_check(const SweepGrid* g) {
+    for (int a = 0; a < SWEEP_AXES; a++) {
+        if (!(g->min[a] >= 0.0 && g->min[a] <= g->max[a] && g->max[a] <= 100.0) ||
+            g->points[a] < 1 || g->points[a] > SWEEP_POINTS_MAX)
+            return UA_STATUSCODE_BADOUTOFRANGE;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+UA_UInt32 sweep_grid_cells(const SweepGrid* g) {
+    return g->points[0] * g->points[1] * g->points[2];
+}
+
+/**
+ * @brief Valve opening (%) of grid point `point` of an axis; a single point sits at min.
+ */
+UA_Double sweep_axis_value(const SweepGrid* g, int axis, UA_UInt32 point) {
+    if (g->points[axis] < 2)
+        return g->min[axis];
+    return g->min[axis] + (g->max[axis] - g->min[axis]) * point / (g->points[axis] - 1);
+}
+
+/**
+ * @brief Captures reactor i of f for a sweep over g, which must pass sweep_grid_check().
+ *
+ * Copies the kinetics, volume and valve characteristics of the reactor:
+ * callers on another thread than the model's hold the model thread's lock.
+ */
+void sweep_plan(const ReactorFleet* f, UA_UInt32 i, const SweepGrid* g, SweepPlan* p) {
+    p->grid = *g;
+    p->kinetics.k01 = f->k01[i];
+    p->kinetics.EA1 = f->EA1[i];
+    p->kinetics.k02 = f->k02[i];
+    p->kinetics.EA2 = f->EA2[i];
+    p->kinetics.R = f->R[i];
+    p->volume = f->volume[i];
+    valve_curve_copy(f->valveCurve[FLEET_VALVE_CA][i], &p->curve[0]);
+    valve_curve_copy(f->valveCurve[FLEET_VALVE_Q][i], &p->curve[1]);
+    valve_curve_copy(f->valveCurve[FLEET_VALVE_T][i], &p->curve[2]);
+}
+
+/* Takes the grid axes of p through its characteristics and kinetics */
+static void sweep_axes(SweepPlan* p) {
+    const SweepGrid* g = &p->grid;
+    const ConfigMathModel* k = &p->kinetics;
+    for (UA_UInt32 c = 0; c < g->points[0]; c++)
+        p->CA[c] = valve_curve_table_value(&p->curve[0], sweep_axis_value(g, 0, c));
+    for (UA_UInt32 c = 0; c < g->points[1]; c++)
+        p->F[c] = valve_curve_table_value(&p->curve[1], sweep_axis_value(g, 1, c));
+    for (UA_UInt32 c = 0; c < g->points[2]; c++) {
+        const double T_K = valve_curve_table_value(&p->curve[2], sweep_axis_value(g, 2, c)) + 273.15;
+        if (!isfinite(T_K) || T_K <= 0.0) {
+            p->k1[c] = NAN;
+            p->k2[c] = NAN;
+            continue;
+        }
+        p->k1[c] = arrhenius_rate(k->k01, k->EA1, k->R, T_K);
+        p->k2[c] = arrhenius_rate(k->k02, k->EA2, k->R, T_K);
+    }
+}
+
+/*
+ * compute_CB_rates() over the HC-3 points [begin, end) of one row, in the
+ * same order of operations. A zero denominator means a zero numerator
+ * (see compute_CB_rates()), so 0 / 0 yields its NAN without a branch.
+ */
+static void sweep_row(UA_Double* out, const UA_Double* k1, const UA_Double* k2,
+    UA_UInt32 begin, UA_UInt32 end, double Vr, double Q, double CA) {
+    const double twoVr = 2.0 * Vr;
+    for (UA_UInt32 c = begin; c < end; c++) {
+        const double a = Vr * k1[c] + Q;
+        const double b = Vr * k2[c] + Q;
+        out[c] = twoVr * k1[c] * Q * CA / (a * b);
+    }
+}
+
+typedef struct {
+    const SweepPlan* plan;
+    UA_Double* cb;
+} SweepPass;
+
+/* Cells [begin, end), split at row boundaries */
+static void sweep_range(void* ctx, UA_UInt32 worker, UA_UInt32 begin, UA_UInt32 end) {
+    (void)worker;
+    const SweepPass* pass = (const SweepPass*)ctx;
+    const SweepPlan* p = pass->plan;
+    const UA_UInt32 n2 = p->grid.points[1];
+    const UA_UInt32 n3 = p->grid.points[2];
+    const double Vr = p->volume * 1e-3;   // m^3
+
+    UA_UInt32 row = begin / n3;
+    UA_UInt32 c = begin % n3;
+    for (UA_UInt32 cell = begin; cell < end; row++, c = 0) {
+        const UA_UInt32 last = (end - cell < n3 - c) ? c + (end - cell) : n3;
+        const double Q = p->F[row % n2] * 1e-3 / 60.0;     // m^3/s
+        sweep_row(pass->cb + (size_t)row * n3, p->k1, p->k2, c, last, Vr, Q, p->CA[row / n2]);
+        cell += last - c;
+    }
+}
+
+/**
+ * @brief Evaluates the steady-state CB of every cell of p into cb.
+ *
+ * cb holds sweep_grid_cells() values, laid out [HC-1][HC-2][HC-3].
+ * engine may be NULL to evaluate on the calling thread.
+ */
+void sweep_run(ModelEngine* engine, SweepPlan* p, UA_Double* cb) {
+    sweep_axes(p);
+    SweepPass pass = { p, cb };
+    const UA_UInt32 cells = sweep_grid_cells(&p->grid);
+    if (engine)
+        engine_run(engine, cells, sweep_range, &pass);
+    else
+        sweep_range(&pass, 0, 0, cells);
+}
+
+/**
+ * @brief Makes cb, a surface over g allocated with UA_malloc(), the current one of s.
+ *
+ * s takes ownership of cb and frees the surface it replaces.
+ */
+void sweep_publish(Sweep* s, const SweepGrid* g, UA_Double* cb) {
+    platform_mutex_lock(s->lock);
+    UA_Double* old = s->cb;
+    s->cb = cb;
+    s->done = *g;
+    s->time = UA_DateTime_now();
+    platform_mutex_unlock(s->lock);
+    UA_free(old);
+}
+
+/**
+ * @brief Copies the current surface of s, or the part range selects, into out.
+ *
+ * The variant is a Double array with the dimensions of the grid.
+ * *time receives when the surface was computed. Returns
+ * BadWaitingForInitialData before the first sweep.
+ */
+UA_StatusCode sweep_read(Sweep* s, const UA_NumericRange* range, UA_Variant* out,
+    UA_DateTime* time) {
+    UA_StatusCode rc = UA_STATUSCODE_BADWAITINGFORINITIALDATA;
+    platform_mutex_lock(s->lock);
+    if (s->cb) {
+        UA_UInt32 dims[SWEEP_AXES];
+        memcpy(dims, s->done.points, sizeof(dims));
+        UA_Variant v;
+        UA_Variant_setArray(&v, s->cb, sweep_grid_cells(&s->done), &UA_TYPES[UA_TYPES_DOUBLE]);
+        v.arrayDimensions = dims;
+        v.arrayDimensionsSize = SWEEP_AXES;
+        rc = (range && range->dimensionsSize > 0) ?
+            UA_Variant_copyRange(&v, out, *range) : UA_Variant_copy(&v, out);
+        *time = s->time;
+    }
+    platform_mutex_unlock(s->lock);
+    return rc;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <open62541/types.h>
+#include "types.h"
+#include "engine.h"
+#include "platform.h"
+#include "valve_curve.h"
+
+struct ReactorFleet;
+
+/* Axes of a sweep, in surface order: HC-1 (CA), HC-2 (F), HC-3 (T) */
+#define SWEEP_AXES 3
+
+/* Grid points per axis at most; 128^3 doubles are 16 MB */
+#define SWEEP_POINTS_MAX 128
+
+/* Grid of a new reactor: the whole valve range in 5 % steps */
+#define SWEEP_DEFAULT_POINTS 21
+
+/* Valve openings swept along each axis, min .. max in points steps (%) */
+typedef struct {
+    UA_Double min[SWEEP_AXES];
+    UA_Double max[SWEEP_AXES];
+    UA_UInt32 points[SWEEP_AXES];
+} SweepGrid;
+
+/*
+ * Everything one sweep evaluates, captured from the fleet.
+ *
+ * sweep_plan() copies the kinetics, the volume and the valve
+ * characteristics; sweep_run() takes the axes through the copies once,
+ * and the Arrhenius rates once per temperature, so evaluating the grid
+ * reads nothing of the live model and calls no exp().
+ */
+typedef struct {
+    SweepGrid grid;
+    ConfigMathModel kinetics;
+    UA_Double volume;
+    ValveCurveTable curve[SWEEP_AXES];
+    UA_Double CA[SWEEP_POINTS_MAX];     /* HC-1 axis, inlet concentration */
+    UA_Double F[SWEEP_POINTS_MAX];      /* HC-2 axis, flow l/min */
+    UA_Double k1[SWEEP_POINTS_MAX];     /* HC-3 axis, rates (1/s) at its temperatures */
+    UA_Double k2[SWEEP_POINTS_MAX];
+} SweepPlan;
+
+/* Sweep of one reactor: the grid set by the client and the last surface */
+typedef struct {
+    SweepGrid grid;             /* bound to SWEEP_MIN, SWEEP_MAX, SWEEP_POINTS; model lock */
+    SweepGrid done;             /* grid of cb */
+    UA_Double* cb;              /* CB per cell, HC-3 fastest; NULL before the first sweep */
+    UA_DateTime time;           /* when cb was computed */
+    PlatformMutex* lock;        /* of the SweepSet, guards cb, done and time */
+} Sweep;
+
+/* Sweeps of every reactor of a fleet */
+typedef struct SweepSet {
+    Sweep* items;
+    UA_UInt32 capacity;
+    PlatformMutex lock;
+} SweepSet;
+
+UA_StatusCode sweep_set_init(SweepSet* s, UA_UInt32 capacity);
+void sweep_set_clear(SweepSet* s);
+
+void sweep_grid_default(SweepGrid* g);
+UA_StatusCode sweep_grid_check(const SweepGrid* g);
+UA_UInt32 sweep_grid_cells(const SweepGrid* g);
+UA_Double sweep_axis_value(const SweepGrid* g, int axis, UA_UInt32 point);
+
+void sweep_plan(const struct ReactorFleet* f, UA_UInt32 i, const SweepGrid* g, SweepPlan* p);
+void sweep_run(ModelEngine* engine, SweepPlan* p, UA_Double* cb);
+void sweep_publish(Sweep* s, const SweepGrid* g, UA_Double* cb);
+UA_StatusCode sweep_read(Sweep* s, const UA_NumericRange* range, UA_Variant* out,
+    UA_DateTime* time);
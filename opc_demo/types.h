@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <open62541/types.h>
+#include "cstr_ode.h"
 
 typedef struct {
 	UA_NodeId objId;
@@ -24,18 +25,211 @@ typedef struct {
     UA_Double R;
 } ConfigMathModel;
 
+/* Engineering ranges of the model inputs, enforced on client writes and scenario events */
+#define LIMIT_MANUAL_OUTPUT_MIN 0.0
+#define LIMIT_MANUAL_OUTPUT_MAX 100.0
+#define LIMIT_VOLUME_MIN        1e-3
+#define LIMIT_VOLUME_MAX        1e6
+#define LIMIT_K0_MAX            1e30
+#define LIMIT_EA_MAX            1e7
+#define LIMIT_R_MAX             1e6
+
+/* How the model computes CB */
+typedef enum {
+    MODEL_MODE_STEADY_STATE,    /* closed form, CB follows the valves instantly */
+    MODEL_MODE_DYNAMIC          /* integrated mass balances with transients */
+} ModelMode;
+
+/* What the model thread does when a tick ends past the next deadline */
+typedef enum {
+    MODEL_OVERRUN_SKIP,         /* drop the missed deadlines, stay on the grid */
+    MODEL_OVERRUN_CATCH_UP,     /* run the missed ticks back to back, up to a limit */
+    MODEL_OVERRUN_SLIP          /* run the next tick now and restart the grid there */
+} ModelOverrunPolicy;
+
+/* Sensor slots of one reactor in ReactorFleet::pv */
+typedef enum {
+    FLEET_SENSOR_F,     /* volumetric flow rate Q, l/min   (FRA-1) */
+    FLEET_SENSOR_T,     /* reactor temperature, degC       (TRA-1) */
+    FLEET_SENSOR_CA,    /* inlet concentration CA          (CRA-1) */
+    FLEET_SENSOR_CB,    /* outlet concentration CB         (CRA-2) */
+    FLEET_SENSOR_COUNT
+} FleetSensor;
+
+/* Valve slots of one reactor in ReactorFleet::manualoutput */
+typedef enum {
+    FLEET_VALVE_CA,     /* inlet concentration valve (HC-1) */
+    FLEET_VALVE_Q,      /* flow rate valve           (HC-2) */
+    FLEET_VALVE_T,      /* temperature valve         (HC-3) */
+    FLEET_VALVE_COUNT
+} FleetValve;
+
+/* OPC UA objects of one reactor; sensors and valves in slot order */
+typedef enum {
+    FLEET_OBJECT_REACTOR,
+    FLEET_OBJECT_MODEL,
+    FLEET_OBJECT_SENSOR,
+    FLEET_OBJECT_VALVE = FLEET_OBJECT_SENSOR + FLEET_SENSOR_COUNT,
+    FLEET_OBJECT_COUNT = FLEET_OBJECT_VALVE + FLEET_VALVE_COUNT
+} FleetObject;
+
+/*
+ * One published copy of the sensor process values.
+ *
+ * The fleet holds two of them. The model fills the back copy at the end
+ * of a tick and then makes it the front one. seq is odd while the model
+ * writes the copy, so a reader that raced with two flips detects the
+ * torn read and retries.
+ *
+ * A third one, the view, is private to the server thread: fleet_pin()
+ * copies the front into it whole, so push publishing and all reads of one
+ * server iteration see the sensors of a single tick however many flips
+ * happen meanwhile.
+ */
 typedef struct {
-    Reactor* reactor;
+    volatile UA_UInt64 seq;
+    UA_DateTime tickTime;       /* wall clock time the values belong to */
+    UA_UInt64 tick;             /* model tick number, 1 = first tick */
+    UA_Double* pv[FLEET_SENSOR_COUNT];
+} FleetSnapshot;
+
+/* How a sensor's PROCESS_VALUE reaches clients */
+typedef enum {
+    SENSOR_PUBLISH_POLL,        /* DataSource, evaluated on every client sample */
+    SENSOR_PUBLISH_PUSH         /* value-backed node, written on change */
+} SensorPublishMode;
+
+/* Change filter applied before a pushed value is written */
+typedef enum {
+    DEADBAND_NONE,              /* every change is published */
+    DEADBAND_ABSOLUTE,          /* |v - last| > deadband */
+    DEADBAND_PERCENT            /* |v - last| > deadband % of |last| */
+} DeadbandType;
+
+/* Filter deciding which sensor samples the historian archives */
+typedef enum {
+    HISTORY_COMPRESSION_NONE,           /* every tick */
+    HISTORY_COMPRESSION_DEADBAND,       /* |v - last archived| > deviation */
+    HISTORY_COMPRESSION_SWINGING_DOOR   /* leaves the corridor of +-deviation */
+} HistoryCompression;
+
+/*
+ * Push state of one sensor instance. mode, deadbandType, deadband and the
+ * counters are exposed as variables of the SensorType instance.
+ */
+typedef struct {
+    UA_UInt32 mode;             /* SensorPublishMode */
+    UA_UInt32 deadbandType;     /* DeadbandType */
+    UA_Double deadband;
+    UA_Double lastValue;        /* last pushed value, NaN before the first push */
+    UA_UInt32 published;
+    UA_UInt32 suppressed;
+    UA_NodeId valueId;          /* value-backed PROCESS_VALUE node */
+} SensorPublish;
+
+/* Bits of ReactorFleet::inputDirty */
+#define FLEET_DIRTY_PROCESS  0x01   /* valve outputs or volume */
+#define FLEET_DIRTY_KINETICS 0x02   /* k0, EA or substance */
+#define FLEET_DIRTY_ALL      (FLEET_DIRTY_PROCESS | FLEET_DIRTY_KINETICS)
+
+/* Whole kinetic configuration of one reactor, staged as a unit */
+typedef struct {
+    ConfigMathModel config;
     UA_UInt32 substanceId;
-    ConfigMathModel cfg;
-    Sensor
-        * sensorT,
-        * sensorF,
-        * sensorConcentrationA,
-        * sensorConcentrationB;
-	ValveHandleControl
-        * valveRegulationConcentrationA,
-        * valveRegulationQ,
-        * valveRegulationT;
-
-} ModelCtx;
\ No newline at end of file
+} FleetKinetics;
+
+struct ReactorFleet;
+struct SubstanceLibrary;
+
+/* One per-reactor field of the fleet, used as OPC UA node context */
+typedef struct {
+    struct ReactorFleet* fleet;
+    UA_UInt32 index;
+    UA_UInt32 field;            /* FleetSensor or FleetValve of the slot */
+} FleetSlot;
+
+/*
+ * Registry of all simulated reactors stored as struct-of-arrays.
+ *
+ * Every array holds `capacity` elements and reactor i lives at index i of
+ * each of them, so one model pass walks a handful of contiguous streams
+ * instead of chasing per-reactor pointers. All arrays are carved out of a
+ * single arena allocated by fleet_init().
+ */
+typedef struct ReactorFleet {
+    UA_UInt32 count;
+    UA_UInt32 capacity;
+
+    ModelMode mode;
+    OdeOptions ode;
+
+    /* Reactor and kinetic configuration (inputs) */
+    UA_Double* volume;
+    UA_Double* k01;
+    UA_Double* EA1;
+    UA_Double* k02;
+    UA_Double* EA2;
+    UA_Double* R;
+    UA_UInt32* substanceId;
+
+    /* FLEET_DIRTY_* bits set by client writes to the inputs, cleared by the model */
+    UA_Byte* inputDirty;
+
+    /* Valve manual outputs, 0-100 % (inputs) */
+    UA_Double* manualoutput[FLEET_VALVE_COUNT];
+
+    /* Characteristic of every valve, id of a curve in the registry (valve_curve.h) */
+    UA_UInt32* valveCurve[FLEET_VALVE_COUNT];
+
+    /* Sensor process values (outputs) */
+    UA_Double* pv[FLEET_SENSOR_COUNT];
+
+    /* Per-tick scratch: raw CB model result before validation */
+    UA_Double* cbResult;
+
+    /* Cached Arrhenius rate constants (1/s) and the temperature (°C) they
+       belong to; NAN while no rates have been computed */
+    UA_Double* rateK1;
+    UA_Double* rateK2;
+    UA_Double* rateT;
+
+    /* Dynamic model state and integrator statistics of the last tick */
+    UA_Double* stateCA;
+    UA_Double* stateCB;
+    UA_Double* odeStep;
+    UA_Double* odeError;
+    UA_UInt32* odeSteps;
+
+    /* Published sensor values, double-buffered (see FleetSnapshot) */
+    FleetSnapshot snapshot[2];
+    volatile UA_UInt32 snapshotFront;
+    FleetSnapshot view;         /* server thread's copy of one tick, fleet_pin() */
+    UA_UInt64 viewIteration;    /* server iteration fleet_read_pv() last pinned in */
+
+    /* Kinetic configurations waiting for the next tick (fleet_stage_kinetics()):
+       reactors stagedIndex[0 .. stagedCount), each flagged in kineticsStaged */
+    FleetKinetics* stagedKinetics;
+    UA_UInt32* stagedIndex;
+    UA_Byte* kineticsStaged;
+    UA_UInt32 stagedCount;
+
+    /* Substance library selected by SUBSTANCE_ID (substance.h), NULL = none;
+       substanceApplied is the SUBSTANCE_ID each reactor's kinetics came from */
+    struct SubstanceLibrary* substances;
+    UA_UInt32* substanceApplied;
+
+    /* Push mode totals over all sensors since start */
+    UA_UInt64 pushPublished;
+    UA_UInt64 pushSuppressed;
+
+    /* OPC UA object NodeIds, written once while building the address space */
+    UA_NodeId* reactorObjId;
+    UA_NodeId* modelObjId;
+    UA_NodeId* sensorObjId[FLEET_SENSOR_COUNT];
+    UA_NodeId* valveObjId[FLEET_VALVE_COUNT];
+    FleetSlot* sensorSlot[FLEET_SENSOR_COUNT];
+    FleetSlot* valveSlot[FLEET_VALVE_COUNT];
+    SensorPublish* publish[FLEET_SENSOR_COUNT];
+
+    void* arena;
+} ReactorFleet;
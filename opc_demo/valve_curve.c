@@ -0,0 +1,362 @@
+/**
+ * @file valve_curve.c
+ * @brief Table-driven valve characteristics.
+ *
+ * A valve characteristic maps the manual output of a valve (0–100 %) to
+ * the process quantity it drives: flow rate for the Q valve, inlet
+ * concentration for the CA valve and the temperature for the T valve.
+ * VALVE_CHAR_DEFAULT is evaluated exactly, as the plant always did, so
+ * the default outputs do not move by a bit. Every other characteristic
+ * is held as a lookup table of VALVE_CURVE_SEGMENTS linear segments over
+ * the valve opening, so evaluating any of them is the same branch-free
+ * interpolation; valve_curve_eval() does it for a whole block of valves.
+ *
+ * The registry holds up to VALVE_CURVE_MAX tables and every valve of the
+ * fleet refers to one by its id (ReactorFleet::valveCurve):
+ *
+ *   - built-in curves, one per valve and ValveCharacteristic shape.
+ *     VALVE_CHAR_DEFAULT is the plant's original piecewise
+ *     quadratic/linear curve; the linear, equal-percentage and
+ *     quick-opening shapes span the same output range;
+ *   - custom curves from breakpoint tables written by clients
+ *     (CHARACTERISTIC_TABLE). Identical tables share one slot; slots are
+ *     allocated when a table is registered, reference counted and freed
+ *     when no valve uses them any more.
+ *
+ * The registry is a process-wide singleton, like the binding pool, and
+ * is only changed by the thread that runs the server, from bound writes
+ * that hold the model lock (writeBindingDS). Work on another thread
+ * takes a private copy of the curves it needs (valve_curve_copy()) under
+ * that same lock and evaluates the copy (valve_curve_table_value()).
+ */
+
+#include <string.h>
+#include <math.h>
+#include "valve_curve.h"
+
+/* Built-in curves come first: valve * VALVE_CHAR_CUSTOM + shape */
+#define VALVE_CURVE_BUILTIN_COUNT (FLEET_VALVE_COUNT * VALVE_CHAR_CUSTOM)
+
+/* Storage of a custom curve, allocated while the slot is in use */
+typedef struct {
+    UA_Double points[2 * VALVE_CURVE_POINTS_MAX];
+    UA_Double lut[VALVE_CURVE_LUT_SIZE];
+} ValveCurveCustom;
+
+typedef struct {
+    UA_UInt32 refs;             /* valves using a custom curve */
+    UA_UInt32 pointCount;       /* breakpoints of a custom curve, 0 while free */
+    UA_UInt32 generation;       /* registration the slot holds, see valve_curve_generation() */
+    ValveCurveCustom* custom;
+} ValveCurveInfo;
+
+/* Lookup table of every curve id; NULL for the exact DEFAULT curves and free slots */
+static const UA_Double* g_lut[VALVE_CURVE_MAX];
+static UA_Double g_builtin[FLEET_VALVE_COUNT][VALVE_CHAR_CUSTOM - 1][VALVE_CURVE_LUT_SIZE];
+static ValveCurveInfo g_info[VALVE_CURVE_MAX];
+static UA_UInt32 g_generation;
+static UA_Boolean g_ready;
+
+/* Output range of each valve, in the order of FleetValve */
+static const UA_Double g_range[FLEET_VALVE_COUNT][2] = {
+    { 0.0, 0.9 },       /* CA */
+    { 0.0, 160.0 },     /* Q, l/min */
+    { -8.0, 16.0 },     /* T offset, degC */
+};
+
+// Original characteristics emulating the influence of the valve opening on the sensors
+static double default_curve_Q(double u) {
+    if (u <= 0.0)
+        return 0.0;
+    if (u >= 100.0)
+        return 160.0;
+
+    if (u <= 70.0) {
+        double x = u / 70.0;
+        return 144.0 * x * x;
+    }
+    else {
+        double x = (u - 70.0) / 30.0;
+        return 144.0 + 16.0 * x;
+    }
+}
+
+static double default_curve_CA(double u) {
+    if (u <= 0.0)
+        return 0.0;
+    if (u >= 100.0)
+        return 0.9;
+
+    if (u <= 70.0) {
+        double x = u / 70.0;
+        return 0.7 * x * x;
+    }
+    else {
+        double x = (u - 70.0) / 30.0;
+        return 0.7 + 0.2 * x;
+    }
+}
+
+static double default_curve_T(double u) {
+    if (u <= 0.0)
+        return -8.0;
+    if (u >= 100.0)
+        return 16.0;
+
+    if (u <= 70.0) {
+        double x = u / 70.0;
+        return -8.0 + 20.0 * x * x;
+    }
+    else {
+        double x = (u - 70.0) / 30.0;
+        return 12.0 + 4.0 * x;
+    }
+}
+
+/**
+ * @brief Value of the DEFAULT curve of valve at opening u (%).
+ */
+static inline double default_value(FleetValve valve, double u) {
+    switch (valve) {
+    case FLEET_VALVE_CA: return default_curve_CA(u);
+    case FLEET_VALVE_Q: return default_curve_Q(u);
+    default: return default_curve_T(u);
+    }
+}
+
+/**
+ * @brief Value of a built-in shaped curve at opening u (0–100 %).
+ */
+static double builtin_value(FleetValve valve, ValveCharacteristic kind, double u) {
+    const double lo = g_range[valve][0];
+    const double hi = g_range[valve][1];
+    const double x = u / 100.0;
+
+    switch (kind) {
+    case VALVE_CHAR_EQUAL_PERCENTAGE:
+        /* R^(x-1), shifted so that the closed valve shuts off completely */
+        return lo + (hi - lo) * (pow(VALVE_CURVE_RANGEABILITY, x) - 1.0) /
+            (VALVE_CURVE_RANGEABILITY - 1.0);
+    case VALVE_CHAR_QUICK_OPENING:
+        return lo + (hi - lo) * sqrt(x);
+    default:
+        return lo + (hi - lo) * x;
+    }
+}
+
+/**
+ * @brief Samples the piecewise linear breakpoint table into a lookup table.
+ */
+static void fill_custom(UA_Double* lut, const UA_Double* points, size_t pointCount) {
+    size_t j = 0;
+    for (UA_UInt32 k = 0; k <= VALVE_CURVE_SEGMENTS; k++) {
+        const double u = k * (100.0 / VALVE_CURVE_SEGMENTS);
+        while (j + 2 < pointCount && u > points[2 * (j + 1)])
+            j++;
+        const double u0 = points[2 * j], y0 = points[2 * j + 1];
+        const double u1 = points[2 * j + 2], y1 = points[2 * j + 3];
+        lut[k] = y0 + (y1 - y0) * (u - u0) / (u1 - u0);
+    }
+}
+
+/**
+ * @brief Builds the built-in lookup tables; later calls do nothing.
+ *
+ * Called by fleet_init(), so every fleet starts out with valid curves.
+ */
+void valve_curve_init(void) {
+    if (g_ready)
+        return;
+
+    for (int v = 0; v < FLEET_VALVE_COUNT; v++) {
+        for (int c = VALVE_CHAR_DEFAULT + 1; c < VALVE_CHAR_CUSTOM; c++) {
+            UA_Double* lut = g_builtin[v][c - 1];
+            for (UA_UInt32 k = 0; k <= VALVE_CURVE_SEGMENTS; k++)
+                lut[k] = builtin_value((FleetValve)v, (ValveCharacteristic)c,
+                    k * (100.0 / VALVE_CURVE_SEGMENTS));
+            g_lut[valve_curve_builtin((FleetValve)v, (ValveCharacteristic)c)] = lut;
+        }
+    }
+    g_ready = true;
+}
+
+UA_UInt32 valve_curve_builtin(FleetValve valve, ValveCharacteristic kind) {
+    return (UA_UInt32)valve * VALVE_CHAR_CUSTOM + (UA_UInt32)kind;
+}
+
+/**
+ * @brief Registers a custom characteristic and takes a reference on it.
+ *
+ * points holds pointCount (u, y) pairs: u in % strictly increasing from
+ * 0 to 100, y in the unit of the valve's process value. An identical
+ * table already registered is shared. Returns BadOutOfRange for an
+ * invalid table, BadResourceUnavailable when the registry is full and
+ * BadOutOfMemory when the slot cannot be allocated.
+ */
+UA_StatusCode valve_curve_add_custom(const UA_Double* points, size_t pointCount,
+    UA_UInt32* outId) {
+
+    if (!points || pointCount < VALVE_CURVE_POINTS_MIN || pointCount > VALVE_CURVE_POINTS_MAX)
+        return UA_STATUSCODE_BADOUTOFRANGE;
+    for (size_t j = 0; j < pointCount; j++) {
+        if (!isfinite(points[2 * j]) || !isfinite(points[2 * j + 1]))
+            return UA_STATUSCODE_BADOUTOFRANGE;
+        if (j > 0 && !(points[2 * j] > points[2 * (j - 1)]))
+            return UA_STATUSCODE_BADOUTOFRANGE;
+    }
+    if (points[0] != 0.0 || points[2 * (pointCount - 1)] != 100.0)
+        return UA_STATUSCODE_BADOUTOFRANGE;
+
+    const size_t bytes = 2 * pointCount * sizeof(UA_Double);
+    UA_UInt32 freeId = 0;
+    for (UA_UInt32 id = VALVE_CURVE_BUILTIN_COUNT; id < VALVE_CURVE_MAX; id++) {
+        ValveCurveInfo* info = &g_info[id];
+        if (info->pointCount == 0) {
+            if (!freeId)
+                freeId = id;
+            continue;
+        }
+        if (info->pointCount == pointCount && memcmp(info->custom->points, points, bytes) == 0) {
+            info->refs++;
+            *outId = id;
+            return UA_STATUSCODE_GOOD;
+        }
+    }
+    if (!freeId)
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+
+    ValveCurveCustom* custom = (ValveCurveCustom*)UA_malloc(sizeof(ValveCurveCustom));
+    if (!custom)
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    memcpy(custom->points, points, bytes);
+    fill_custom(custom->lut, points, pointCount);
+
+    ValveCurveInfo* info = &g_info[freeId];
+    info->custom = custom;
+    info->pointCount = (UA_UInt32)pointCount;
+    info->refs = 1;
+    if (++g_generation == 0)
+        g_generation = 1;       /* 0 stands for no custom table */
+    info->generation = g_generation;
+    g_lut[freeId] = custom->lut;
+    *outId = freeId;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Drops a reference on a custom curve; built-in ids are ignored.
+ */
+void valve_curve_release(UA_UInt32 id) {
+    if (id < VALVE_CURVE_BUILTIN_COUNT || id >= VALVE_CURVE_MAX)
+        return;
+    ValveCurveInfo* info = &g_info[id];
+    if (info->refs && --info->refs == 0) {
+        g_lut[id] = NULL;
+        UA_free(info->custom);
+        info->custom = NULL;
+        info->pointCount = 0;
+    }
+}
+
+/**
+ * @brief Points a valve at curve id and releases the curve it used before.
+ *
+ * The caller hands over its reference on id; if the valve already used
+ * id, the reference it held is the one dropped.
+ */
+void valve_curve_assign(UA_UInt32* slot, UA_UInt32 id) {
+    const UA_UInt32 old = *slot;
+    *slot = id;
+    valve_curve_release(old);
+}
+
+ValveCharacteristic valve_curve_kind(UA_UInt32 id) {
+    if (id < VALVE_CURVE_BUILTIN_COUNT)
+        return (ValveCharacteristic)(id % VALVE_CHAR_CUSTOM);
+    return VALVE_CHAR_CUSTOM;
+}
+
+/**
+ * @brief Breakpoint table of a custom curve; built-in curves have none.
+ *
+ * @return number of (u, y) pairs at *points.
+ */
+size_t valve_curve_points(UA_UInt32 id, const UA_Double** points) {
+    if (id < VALVE_CURVE_BUILTIN_COUNT || id >= VALVE_CURVE_MAX || !g_info[id].custom) {
+        *points = NULL;
+        return 0;
+    }
+    *points = g_info[id].custom->points;
+    return g_info[id].pointCount;
+}
+
+/**
+ * @brief Tells apart the tables a custom curve id has held over time.
+ *
+ * Changes whenever slot id is given a new table, so a table seen under
+ * an id before is still the one the id refers to if the generation is
+ * unchanged. 0 for built-in curves and free slots.
+ */
+UA_UInt32 valve_curve_generation(UA_UInt32 id) {
+    if (id < VALVE_CURVE_BUILTIN_COUNT || id >= VALVE_CURVE_MAX || !g_info[id].custom)
+        return 0;
+    return g_info[id].generation;
+}
+
+/**
+ * @brief Interpolates a lookup table without branches.
+ *
+ * The opening is clamped to 0–100 % with selects the compiler turns into
+ * min/max instructions; NaN reads as a closed valve.
+ */
+static inline UA_Double lut_eval(const UA_Double* lut, UA_Double u) {
+    UA_Double x = u * (VALVE_CURVE_SEGMENTS / 100.0);
+    x = (x > 0.0) ? x : 0.0;
+    x = (x < VALVE_CURVE_SEGMENTS) ? x : VALVE_CURVE_SEGMENTS;
+    UA_UInt32 k = (UA_UInt32)x;
+    k = (k < VALVE_CURVE_SEGMENTS - 1) ? k : VALVE_CURVE_SEGMENTS - 1;
+    const UA_Double frac = x - (UA_Double)k;
+    return lut[k] + frac * (lut[k + 1] - lut[k]);
+}
+
+/**
+ * @brief Value of curve id at opening u: its table, or the exact DEFAULT curve.
+ */
+static inline UA_Double curve_eval(UA_UInt32 id, const UA_Double* lut, UA_Double u) {
+    return lut ? lut_eval(lut, u) : default_value((FleetValve)(id / VALVE_CHAR_CUSTOM), u);
+}
+
+UA_Double valve_curve_value(UA_UInt32 id, UA_Double u) {
+    return curve_eval(id, g_lut[id], u);
+}
+
+/**
+ * @brief Evaluates n valves: out[i] = characteristic ids[i] at opening u[i].
+ */
+void valve_curve_eval(const UA_UInt32* ids, const UA_Double* u, UA_Double* out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = curve_eval(ids[i], g_lut[ids[i]], u[i]);
+}
+
+/**
+ * @brief Copies curve id to table.
+ *
+ * The DEFAULT curves have no lookup table and are only noted by id.
+ * Off the server thread the caller holds the model lock, which every
+ * change of the registry is made under.
+ */
+void valve_curve_copy(UA_UInt32 id, ValveCurveTable* table) {
+    table->id = id;
+    table->exact = g_lut[id] == NULL;
+    if (!table->exact)
+        memcpy(table->lut, g_lut[id], sizeof(table->lut));
+}
+
+/**
+ * @brief Characteristic at opening u from a curve copied by valve_curve_copy().
+ *
+ * Equal to valve_curve_value() of the curve the table was copied from.
+ */
+UA_Double valve_curve_table_value(const ValveCurveTable* table, UA_Double u) {
+    return curve_eval(table->id, table->exact ? NULL : table->lut, u);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "types.h"
+
+/* Linear segments of every lookup table, over 0-100 % valve opening */
+#define VALVE_CURVE_SEGMENTS 1000
+
+/* Entries of a lookup table, both ends included */
+#define VALVE_CURVE_LUT_SIZE (VALVE_CURVE_SEGMENTS + 1)
+
+/* Curves the registry holds, built-in ones included */
+#define VALVE_CURVE_MAX 256
+
+/* Breakpoints of a custom characteristic */
+#define VALVE_CURVE_POINTS_MIN 2
+#define VALVE_CURVE_POINTS_MAX 32
+
+/* Rangeability of the equal-percentage characteristic */
+#define VALVE_CURVE_RANGEABILITY 50.0
+
+/* Shape of a valve characteristic, as exposed by the CHARACTERISTIC variable */
+typedef enum {
+    VALVE_CHAR_DEFAULT,             /* the plant's original curve of this valve */
+    VALVE_CHAR_LINEAR,
+    VALVE_CHAR_EQUAL_PERCENTAGE,
+    VALVE_CHAR_QUICK_OPENING,
+    VALVE_CHAR_CUSTOM,              /* breakpoint table written by a client */
+    VALVE_CHAR_COUNT
+} ValveCharacteristic;
+
+/* Private copy of one characteristic, see valve_curve_copy() */
+typedef struct {
+    UA_UInt32 id;               /* curve copied */
+    UA_Boolean exact;           /* DEFAULT curve, evaluated without lut */
+    UA_Double lut[VALVE_CURVE_LUT_SIZE];
+} ValveCurveTable;
+
+void valve_curve_init(void);
+
+UA_UInt32 valve_curve_builtin(FleetValve valve, ValveCharacteristic kind);
+UA_StatusCode valve_curve_add_custom(const UA_Double* points, size_t pointCount,
+    UA_UInt32* outId);
+void valve_curve_release(UA_UInt32 id);
+void valve_curve_assign(UA_UInt32* slot, UA_UInt32 id);
+
+ValveCharacteristic valve_curve_kind(UA_UInt32 id);
+size_t valve_curve_points(UA_UInt32 id, const UA_Double** points);
+UA_UInt32 valve_curve_generation(UA_UInt32 id);
+
+UA_Double valve_curve_value(UA_UInt32 id, UA_Double u);
+void valve_curve_eval(const UA_UInt32* ids, const UA_Double* u, UA_Double* out, size_t n);
+
+void valve_curve_copy(UA_UInt32 id, ValveCurveTable* table);
+UA_Double valve_curve_table_value(const ValveCurveTable* table, UA_Double u);